@@ -6,6 +6,11 @@
 #define DEBUG_BOOTLOG
 #define DEBUG_GRAPHICS
 #define DEBUG_MEMORY
+
+// Uncomment to count acquisitions, contention and wait cycles in every
+// lock (core/spinlock.h); costs every acquire a few counter updates
+// #define LOCK_STATS
+
 typedef enum {
     VERBOSITY_SILENT,
     VERBOSITY_MINIMAL,
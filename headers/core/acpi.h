@@ -0,0 +1,100 @@
+/**
+ * QARMA - ACPI Table Discovery
+ *
+ * Locates the RSDP/RSDT and parses the MADT ("APIC" table) so the SMP
+ * layer knows which local APICs and I/O APICs actually exist.
+ */
+
+#ifndef ACPI_H
+#define ACPI_H
+
+#include "kernel_types.h"
+
+#define ACPI_MAX_LAPICS     64
+#define ACPI_MAX_IOAPICS    8
+#define ACPI_MAX_OVERRIDES  16
+
+// Root System Description Pointer (ACPI 1.0 fields + 2.0 extension)
+typedef struct {
+    char signature[8];                  // "RSD PTR "
+    uint8_t checksum;
+    char oem_id[6];
+    uint8_t revision;                   // 0 = ACPI 1.0, 2+ = ACPI 2.0+
+    uint32_t rsdt_address;
+    uint32_t length;
+    uint64_t xsdt_address;
+    uint8_t extended_checksum;
+    uint8_t reserved[3];
+} PACKED acpi_rsdp_t;
+
+// Common header for every System Description Table
+typedef struct {
+    char signature[4];
+    uint32_t length;
+    uint8_t revision;
+    uint8_t checksum;
+    char oem_id[6];
+    char oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} PACKED acpi_sdt_header_t;
+
+// MADT entry types
+#define MADT_ENTRY_LAPIC            0
+#define MADT_ENTRY_IOAPIC           1
+#define MADT_ENTRY_ISO              2
+#define MADT_ENTRY_LAPIC_NMI        4
+#define MADT_ENTRY_LAPIC_OVERRIDE   5
+
+#define MADT_LAPIC_ENABLED          0x1
+#define MADT_LAPIC_ONLINE_CAPABLE   0x2
+
+// Local APIC as reported by the MADT
+typedef struct {
+    uint8_t acpi_processor_id;
+    uint8_t apic_id;
+    bool enabled;
+} acpi_lapic_t;
+
+// I/O APIC as reported by the MADT
+typedef struct {
+    uint8_t id;
+    uint32_t address;                   // Physical MMIO base
+    uint32_t gsi_base;                  // First global system interrupt
+} acpi_ioapic_t;
+
+// ISA interrupt source override (e.g. IRQ0 -> GSI2)
+typedef struct {
+    uint8_t source_irq;
+    uint32_t gsi;
+    uint16_t flags;                     // Polarity / trigger mode
+} acpi_irq_override_t;
+
+// Everything the kernel needs from the MADT
+typedef struct {
+    bool present;
+    uint32_t lapic_address;             // Physical LAPIC MMIO base
+    bool has_legacy_pics;               // PCAT_COMPAT flag
+
+    uint32_t lapic_count;
+    acpi_lapic_t lapics[ACPI_MAX_LAPICS];
+
+    uint32_t ioapic_count;
+    acpi_ioapic_t ioapics[ACPI_MAX_IOAPICS];
+
+    uint32_t override_count;
+    acpi_irq_override_t overrides[ACPI_MAX_OVERRIDES];
+} acpi_madt_info_t;
+
+// Initialization
+bool acpi_init(void);
+
+// Table lookup
+acpi_sdt_header_t* acpi_find_table(const char* signature);
+
+// MADT results
+const acpi_madt_info_t* acpi_get_madt_info(void);
+uint32_t acpi_irq_to_gsi(uint8_t irq);
+
+#endif // ACPI_H
@@ -0,0 +1,90 @@
+/**
+ * QARMA - Local APIC / I/O APIC Driver
+ *
+ * MMIO access to the local APIC (IPIs, EOI, identification) and the
+ * I/O APICs discovered through the MADT.
+ */
+
+#ifndef APIC_H
+#define APIC_H
+
+#include "kernel_types.h"
+
+// Local APIC register offsets
+#define LAPIC_REG_ID            0x020
+#define LAPIC_REG_VERSION       0x030
+#define LAPIC_REG_TPR           0x080
+#define LAPIC_REG_EOI           0x0B0
+#define LAPIC_REG_SVR           0x0F0
+#define LAPIC_REG_ESR           0x280
+#define LAPIC_REG_ICR_LOW       0x300
+#define LAPIC_REG_ICR_HIGH      0x310
+#define LAPIC_REG_LVT_TIMER     0x320
+#define LAPIC_REG_LVT_LINT0     0x350
+#define LAPIC_REG_LVT_LINT1     0x360
+#define LAPIC_REG_LVT_ERROR     0x370
+#define LAPIC_REG_TIMER_INIT    0x380
+#define LAPIC_REG_TIMER_CURRENT 0x390
+#define LAPIC_REG_TIMER_DIVIDE  0x3E0
+
+// ICR fields
+#define LAPIC_ICR_INIT          0x00000500
+#define LAPIC_ICR_STARTUP       0x00000600
+#define LAPIC_ICR_FIXED         0x00000000
+#define LAPIC_ICR_LEVEL_ASSERT  0x00004000
+#define LAPIC_ICR_TRIGGER_LEVEL 0x00008000
+#define LAPIC_ICR_PENDING       0x00001000
+#define LAPIC_ICR_ALL_BUT_SELF  0x000C0000
+
+#define LAPIC_SVR_ENABLE        0x100
+#define LAPIC_SPURIOUS_VECTOR   0xFF
+#define LAPIC_TIMER_VECTOR      0xF0
+#define LAPIC_LVT_MASKED        0x10000
+
+// LVT timer modes and divide configuration
+#define LAPIC_TIMER_ONESHOT     0x00000
+#define LAPIC_TIMER_TSC_DEADLINE 0x40000
+#define LAPIC_TIMER_DIVIDE_16   0x3
+#define IA32_TSC_DEADLINE_MSR   0x6E0
+
+#define LAPIC_DEFAULT_BASE      0xFEE00000
+#define IA32_APIC_BASE_MSR      0x1B
+
+// I/O APIC registers (indirect through IOREGSEL / IOWIN)
+#define IOAPIC_REG_ID           0x00
+#define IOAPIC_REG_VERSION      0x01
+#define IOAPIC_REG_REDTBL       0x10
+#define IOAPIC_REDIR_MASKED     0x10000
+
+// Local APIC
+bool lapic_init(uint32_t phys_base);
+void lapic_enable(void);
+bool lapic_is_available(void);
+uint8_t lapic_get_id(void);
+void lapic_eoi(void);
+uint32_t lapic_read(uint32_t reg);
+void lapic_write(uint32_t reg, uint32_t value);
+
+// Local APIC timer (one-shot or TSC-deadline, never periodic)
+bool lapic_timer_calibrate(void);
+uint32_t lapic_timer_khz(void);
+bool lapic_timer_has_tsc_deadline(void);
+void lapic_timer_setup(void);
+void lapic_timer_oneshot(uint32_t count);
+void lapic_timer_deadline(uint64_t tsc);
+void lapic_timer_stop(void);
+
+// Inter-processor interrupts
+void lapic_send_init(uint8_t apic_id);
+void lapic_send_startup(uint8_t apic_id, uint8_t vector);
+void lapic_send_ipi(uint8_t apic_id, uint8_t vector);
+bool lapic_wait_icr_idle(void);
+
+// I/O APIC
+void ioapic_init(void);
+uint32_t ioapic_count(void);
+uint32_t ioapic_max_redirections(uint32_t index);
+void ioapic_set_redirect(uint32_t gsi, uint8_t vector, uint8_t dest_apic_id, uint16_t flags, bool masked);
+void ioapic_mask_gsi(uint32_t gsi);
+
+#endif // APIC_H
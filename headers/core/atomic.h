@@ -0,0 +1,129 @@
+/**
+ * QARMA - Atomic Operations
+ *
+ * Lock-prefixed x86 primitives shared by the SMP-aware parts of the
+ * kernel. x86 is TSO: plain aligned loads and stores are atomic and only
+ * store->load reordering needs an explicit fence.
+ */
+
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+#include "stdtools.h"
+
+/**
+ * Full memory fence (orders stores before later loads)
+ */
+static inline void atomic_fence(void) {
+    __asm__ volatile ("lock; addl $0, 0(%%esp)" ::: "memory", "cc");
+}
+
+/**
+ * Compare-and-swap; returns the value observed before the operation
+ * (equal to expected on success)
+ */
+static inline uint32_t atomic_cmpxchg_u32(volatile uint32_t* ptr, uint32_t expected, uint32_t desired) {
+    uint32_t prev;
+    __asm__ volatile ("lock; cmpxchgl %2, %1"
+                      : "=a"(prev), "+m"(*ptr)
+                      : "r"(desired), "0"(expected)
+                      : "memory", "cc");
+    return prev;
+}
+
+/**
+ * Atomically add and return the previous value
+ */
+static inline uint32_t atomic_xadd_u32(volatile uint32_t* ptr, uint32_t value) {
+    __asm__ volatile ("lock; xaddl %0, %1"
+                      : "+r"(value), "+m"(*ptr)
+                      :
+                      : "memory", "cc");
+    return value;
+}
+
+/**
+ * Atomically exchange and return the previous value
+ */
+static inline uint32_t atomic_xchg_u32(volatile uint32_t* ptr, uint32_t value) {
+    // xchg with memory is implicitly locked
+    __asm__ volatile ("xchgl %0, %1"
+                      : "+r"(value), "+m"(*ptr)
+                      :
+                      : "memory");
+    return value;
+}
+
+static inline void atomic_inc_u32(volatile uint32_t* ptr) {
+    __asm__ volatile ("lock; incl %0" : "+m"(*ptr) : : "memory", "cc");
+}
+
+static inline void atomic_dec_u32(volatile uint32_t* ptr) {
+    __asm__ volatile ("lock; decl %0" : "+m"(*ptr) : : "memory", "cc");
+}
+
+static inline void atomic_or_u32(volatile uint32_t* ptr, uint32_t bits) {
+    __asm__ volatile ("lock; orl %1, %0" : "+m"(*ptr) : "ir"(bits) : "memory", "cc");
+}
+
+/**
+ * Atomically decrement; true when the counter reached zero
+ */
+static inline bool atomic_dec_and_test_u32(volatile uint32_t* ptr) {
+    uint8_t zero;
+    __asm__ volatile ("lock; decl %0; sete %1"
+                      : "+m"(*ptr), "=q"(zero)
+                      :
+                      : "memory", "cc");
+    return zero != 0;
+}
+
+static inline uint32_t atomic_load_u32(const volatile uint32_t* ptr) {
+    uint32_t value = *ptr;
+    __asm__ volatile ("" ::: "memory");
+    return value;
+}
+
+static inline void atomic_store_u32(volatile uint32_t* ptr, uint32_t value) {
+    __asm__ volatile ("" ::: "memory");
+    *ptr = value;
+}
+
+/**
+ * Pointer compare-and-swap; returns the previous pointer
+ */
+static inline void* atomic_cmpxchg_ptr(void* volatile* ptr, void* expected, void* desired) {
+    return (void*)atomic_cmpxchg_u32((volatile uint32_t*)ptr, (uint32_t)expected, (uint32_t)desired);
+}
+
+static inline void* atomic_xchg_ptr(void* volatile* ptr, void* value) {
+    return (void*)atomic_xchg_u32((volatile uint32_t*)ptr, (uint32_t)value);
+}
+
+/**
+ * 64-bit counters (cmpxchg8b loop; plain 64-bit loads can tear on i686)
+ */
+static inline uint64_t atomic_cmpxchg_u64(volatile uint64_t* ptr, uint64_t expected, uint64_t desired) {
+    uint64_t prev;
+    __asm__ volatile ("lock; cmpxchg8b %1"
+                      : "=A"(prev), "+m"(*ptr)
+                      : "b"((uint32_t)desired), "c"((uint32_t)(desired >> 32)), "0"(expected)
+                      : "memory", "cc");
+    return prev;
+}
+
+static inline uint64_t atomic_load_u64(volatile uint64_t* ptr) {
+    // A failing CAS with a dummy value returns the current contents atomically
+    return atomic_cmpxchg_u64(ptr, 0, 0);
+}
+
+static inline void atomic_add_u64(volatile uint64_t* ptr, uint64_t value) {
+    uint64_t old = *ptr;
+    for (;;) {
+        uint64_t seen = atomic_cmpxchg_u64(ptr, old, old + value);
+        if (seen == old) break;
+        old = seen;
+    }
+}
+
+#endif // ATOMIC_H
@@ -13,6 +13,7 @@ typedef struct {
 
 
 void clock_tick(void);
+void clock_start(void);
 void draw_clock(void);
 void reset_clock(void);
 void toggle_clock_visibility(void);
@@ -0,0 +1,71 @@
+/**
+ * QARMA - Lazy FPU/SSE state
+ *
+ * Every task gets its own x87/SSE register file, saved with FXSAVE into a
+ * 512-byte area allocated the first time the task touches the FPU. The
+ * switch path only sets CR0.TS; the first FPU or SSE instruction after it
+ * raises #NM (vector 7), whose handler loads the task's state and clears
+ * TS. A task that never uses the FPU never traps and never gets an area.
+ *
+ * State is saved when its owner is switched out after using the FPU in
+ * that slice, so a task can resume on any CPU. If nothing else touched
+ * the FPU meanwhile and it comes back to the same CPU, its registers are
+ * still loaded and TS is simply cleared.
+ *
+ * Kernel code that drives XMM registers from inline assembly (the SSE2
+ * memcpy and blitter) brackets each interrupts-off section with
+ * fpu_kernel_begin()/fpu_kernel_end(), which park the owner's state first.
+ * Interrupt handlers must not use the FPU.
+ *
+ * CPUs without FXSR keep the old behaviour: one shared, unsaved FPU.
+ */
+
+#ifndef FPU_H
+#define FPU_H
+
+#include "kernel_types.h"
+
+#define FPU_STATE_SIZE      512         // FXSAVE image
+#define FPU_DEFAULT_FCW     0x037F      // FNINIT control word: all exceptions masked
+#define FPU_DEFAULT_MXCSR   0x1F80      // All SIMD exceptions masked, round to nearest
+
+typedef struct {
+    uint8_t data[FPU_STATE_SIZE];
+} __attribute__((aligned(16))) fpu_state_t;
+
+// Per-task FPU bookkeeping, embedded in task_t
+typedef struct {
+    fpu_state_t* state;                 // Save area, NULL until first use
+    uint32_t last_cpu;                  // CPU whose registers it was last loaded into
+} fpu_context_t;
+
+typedef struct {
+    uint32_t traps;                     // #NM faults taken
+    uint32_t restores;                  // States loaded from a save area
+    uint32_t saves;                     // States written back on switch-out
+    uint32_t fast_resumes;              // Switch-ins that found their state still loaded
+    uint32_t areas;                     // Save areas allocated
+} fpu_stats_t;
+
+// Set CR0/CR4 for x87 and SSE on the calling CPU (every CPU, early)
+void fpu_init_cpu(void);
+// Save-area cache; needs the heap
+void fpu_init(void);
+bool fpu_sse_enabled(void);
+
+void fpu_context_init(fpu_context_t* ctx);
+void fpu_context_release(fpu_context_t* ctx);
+
+// Context switch hook, interrupts disabled, on the CPU that will run 'next'
+void fpu_switch(uint32_t cpu, fpu_context_t* next);
+
+// #NM handler (from the vector 7 stub)
+void fpu_device_not_available(void);
+
+// Exclusive use of the XMM registers by kernel code; interrupts disabled
+void fpu_kernel_begin(void);
+void fpu_kernel_end(void);
+
+void fpu_get_stats(fpu_stats_t* stats);
+
+#endif // FPU_H
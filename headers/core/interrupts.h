@@ -17,7 +17,7 @@ typedef struct {
 } __attribute__((packed)) idt_ptr_t;
 
 
-idt_entry_t idt[IDT_ENTRIES];
+extern idt_entry_t idt[IDT_ENTRIES];
 
 typedef void (*isr_t)(regs_t*);
 
@@ -26,6 +26,8 @@ void register_interrupt_handler(uint8_t int_no, isr_t handler);
 // Initialize and remap the legacy PICs. Implemented in assembly (pic.asm).
 void init_pic(void);
 void divide_by_zero_handler();
+void page_fault_handler(uint32_t err_code);
 void timer_handler(struct regs* r);
 void send_eoi(uint8_t int_no);
-idt_ptr_t idt_ptr;
\ No newline at end of file
+void idt_load(void);
+extern idt_ptr_t idt_ptr;
\ No newline at end of file
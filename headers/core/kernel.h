@@ -73,10 +73,8 @@ void draw_splash(const char *title);
 // void vmm_map_page(uint32_t virtual_addr, uint32_t physical_addr, uint32_t flags);
 // bool vmm_map_framebuffer(uint32_t fb_physical_addr, uint32_t fb_size);
 
-// Page flags
-#define PAGE_PRESENT    0x1
-#define PAGE_WRITE      0x2
-#define PAGE_USER       0x4
+// Page flags (PAGE_PRESENT, PAGE_WRITE, PAGE_USER, ...)
+#include "core/memory/vmm/vmm.h"
 
 // Interrupt system
 void interrupts_system_init(void);
@@ -84,6 +82,7 @@ void interrupts_system_init(void);
 void quantum_interrupts_init(void);
 void idt_init(void);
 void gdt_init(void);
+void gdt_init_ap(uint32_t cpu);
 
 // Console functions
 void console_init(void);
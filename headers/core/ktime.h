@@ -0,0 +1,79 @@
+/**
+ * QARMA - High-resolution time and deadline timers
+ *
+ * ktime_get() is a 64-bit monotonic nanosecond clock. It reads the TSC,
+ * calibrated against PIT channel 2 at boot, and falls back to the PIT
+ * tick count (10 ms resolution) when the CPU has no TSC. The TSCs of all
+ * processors are assumed to run in sync, which holds for invariant TSCs
+ * and under QEMU.
+ *
+ * Deadline timers (ktimer_t) fire on the CPU that started them. Each CPU
+ * keeps its timers in deadline order and programs its local APIC timer,
+ * one-shot or TSC-deadline, for the earliest one only, so a CPU with no
+ * timers pending takes no timer interrupts. Without a local APIC the PIT
+ * tick polls the boot CPU's queue instead.
+ */
+
+#ifndef KTIME_H
+#define KTIME_H
+
+#include "kernel_types.h"
+
+typedef uint64_t ktime_t;               // Nanoseconds since boot
+
+#define NSEC_PER_USEC   1000u
+#define NSEC_PER_MSEC   1000000u
+#define NSEC_PER_SEC    1000000000u
+
+// Deadline timers
+typedef struct ktimer ktimer_t;
+typedef void (*ktimer_fn_t)(ktimer_t* timer);
+
+struct ktimer {
+    ktime_t expires;                    // Absolute deadline
+    ktimer_fn_t fn;                     // Runs in interrupt context
+    void* data;                         // Caller's context
+    struct ktimer* next;
+    struct ktimer* prev;
+    uint32_t cpu;                       // Queue it is on
+    bool queued;
+};
+
+// Clock
+bool ktime_init(void);
+ktime_t ktime_get(void);
+uint64_t ktime_get_cycles(void);
+uint64_t ktime_cycles_to_ns(uint64_t cycles);
+uint32_t ktime_tsc_khz(void);
+bool ktime_has_tsc(void);
+
+// Timers
+void ktimer_cpu_init(void);
+void ktimer_init(ktimer_t* timer, ktimer_fn_t fn, void* data);
+void ktimer_start(ktimer_t* timer, ktime_t expires);
+bool ktimer_cancel(ktimer_t* timer);
+bool ktimer_pending(const ktimer_t* timer);
+void ktimer_interrupt(void);
+void ktimer_poll(void);
+
+/**
+ * 64-by-32 bit division with two divl instructions (no libgcc on i686)
+ */
+static inline uint64_t ktime_div_u32(uint64_t dividend, uint32_t divisor) {
+    uint32_t hi = (uint32_t)(dividend >> 32);
+    uint32_t lo = (uint32_t)dividend;
+    uint32_t q_hi = hi / divisor;
+    uint32_t q_lo, rem = hi % divisor;
+    __asm__("divl %3" : "=a"(q_lo), "+d"(rem) : "0"(lo), "rm"(divisor) : "cc");
+    return ((uint64_t)q_hi << 32) | q_lo;
+}
+
+static inline uint64_t ktime_to_us(ktime_t t) {
+    return ktime_div_u32(t, NSEC_PER_USEC);
+}
+
+static inline uint64_t ktime_to_ms(ktime_t t) {
+    return ktime_div_u32(t, NSEC_PER_MSEC);
+}
+
+#endif // KTIME_H
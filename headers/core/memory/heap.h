@@ -2,8 +2,48 @@
 
 #include "../stdtools.h"
 
+/**
+ * QARMA - Kernel Heap
+ *
+ * Small requests (<= HEAP_SMALL_MAX) come from per-size-class slab pages;
+ * everything else from a boundary-tag allocator with binned free lists
+ * and immediate coalescing. The first region is the static, identity
+ * mapped bootstrap arena; further regions are taken from vmm_alloc_pages
+ * and are NOT identity mapped (use memory_pool DMA flags for devices).
+ *
+ * heap_alloc() does not clear memory; use heap_zalloc() when needed.
+ */
+
+#define HEAP_ALIGNMENT      16
+#define HEAP_SMALL_MAX      1024
+#define HEAP_SIZE_CLASSES   12
+
+typedef struct {
+    uint32_t total_bytes;           // Bytes managed by all regions
+    uint32_t used_bytes;            // Bytes handed out (block/object sizes)
+    uint32_t free_bytes;            // Bytes on the large free lists
+    uint32_t largest_free;          // Largest single free block
+    uint32_t free_blocks;           // Number of free large blocks
+    uint32_t fragmentation;         // 0-100: 100 - largest_free / free_bytes
+    uint32_t region_count;          // Bootstrap arena + vmm regions
+    uint32_t slab_pages;            // Pages carved for size classes
+    uint32_t slab_pages_free;       // Empty slab pages kept cached
+    uint32_t small_allocs;          // Lifetime small allocations
+    uint32_t large_allocs;          // Lifetime large allocations
+    uint32_t frees;                 // Lifetime frees
+    uint32_t failed_allocs;         // Requests that returned NULL
+
+    uint32_t class_size[HEAP_SIZE_CLASSES];
+    uint32_t class_in_use[HEAP_SIZE_CLASSES];
+    uint32_t class_pages[HEAP_SIZE_CLASSES];
+} heap_stats_t;
 
 void heap_init(void);
 void* heap_alloc(size_t size);
+void* heap_zalloc(size_t size);
 void* heap_alloc_aligned(size_t size, size_t alignment);
-void  heap_free(void* ptr);
\ No newline at end of file
+void  heap_free(void* ptr);
+size_t heap_usable_size(void* ptr);
+
+void heap_get_stats(heap_stats_t* stats);
+void heap_print_stats(void);
@@ -2,6 +2,14 @@
  * QARMA - Memory Pool Manager
  * 
  * Per-subsystem memory pools with NUMA awareness and PMM/VMM integration
+ *
+ * Small requests are sub-allocated from per-subsystem arenas of 64 KB
+ * chunks. CONTIGUOUS/DMA_CAPABLE slots come from a low arena (buddy
+ * chunks from the identity mapped zone); the rest take low chunks while
+ * they last and fall back to high pages mapped through the VMM.
+ * Larger requests get whole pages: buddy blocks when CONTIGUOUS or
+ * DMA_CAPABLE is set, the kernel heap otherwise. A page-granular radix
+ * map resolves any pointer to its chunk or block in O(1).
  */
 
 #ifndef MEMORY_POOL_H
@@ -20,7 +28,21 @@ typedef enum {
     POOL_FLAG_ZERO_INIT     = 0x20   // Zero-initialize on allocation
 } memory_pool_flags_t;
 
-// Memory block tracking
+#define MEMORY_POOL_CHUNK_ORDER     4       // 64 KB arena chunks
+#define MEMORY_POOL_CLASSES         8       // 32..4096 byte slots
+#define MEMORY_POOL_SMALL_MAX       (4096 - 16)
+
+// Arena chunk (sub-allocated)
+typedef struct memory_chunk {
+    subsystem_id_t owner;            // Owning subsystem
+    uint32_t base;                   // Start (virtual == physical unless mapped)
+    uint32_t used;                   // Bump offset of carved slots
+    bool mapped;                     // High pages mapped through the VMM
+    bool low;                        // Carved by the low (DMA) arena
+    struct memory_chunk* next;       // Next chunk of the same pool
+} memory_chunk_t;
+
+// Memory block tracking (page-granular allocations)
 typedef struct memory_block {
     void* virtual_addr;              // Virtual address
     uint32_t physical_addr;          // Physical address
@@ -29,8 +51,10 @@ typedef struct memory_block {
     subsystem_id_t owner;            // Owning subsystem
     uint32_t numa_node;              // NUMA node
     bool from_heap;                  // True if from heap, false if from PMM
+    uint32_t order;                  // Buddy order when from PMM
     
     struct memory_block* next;       // Next block in list
+    struct memory_block* prev;       // Previous block in list
 } memory_block_t;
 
 // Per-subsystem memory pool
@@ -43,6 +67,14 @@ typedef struct memory_pool {
     
     memory_block_t* blocks;          // Linked list of blocks
     
+    // Arena (index 0: any memory, 1: low/DMA-capable)
+    memory_chunk_t* chunks;          // Chunks carved by this pool
+    memory_chunk_t* carving[2];      // Newest chunk of each arena
+    void* free_slots[2][MEMORY_POOL_CLASSES];
+    uint32_t chunk_count;
+    uint32_t small_count;            // Live sub-allocations
+    volatile uint32_t lock;
+    
     // Limits
     size_t max_allocation;           // Maximum pool size
     bool enforce_limits;             // Enforce allocation limits
@@ -0,0 +1,69 @@
+/**
+ * QARMA - Object Caches
+ *
+ * Fixed-size object allocator for hot kernel structures. Each processor
+ * keeps two magazines (small stacks of free objects) so the common alloc
+ * and free paths touch no shared state; the shared depot is only visited
+ * when both magazines are exhausted or full.
+ *
+ * Objects are constructed once, when the cache grows, and must be
+ * returned to the cache in their constructed state.
+ */
+
+#ifndef OBJECT_CACHE_H
+#define OBJECT_CACHE_H
+
+#include "kernel_types.h"
+#include "core/smp.h"
+
+#define OBJECT_CACHE_MAX            32      // Registered caches
+#define OBJECT_CACHE_MAGAZINE_SIZE  14      // Rounds per magazine (64-byte magazine)
+#define OBJECT_CACHE_NAME_LEN       24
+
+typedef void (*object_ctor_t)(void* object);
+
+typedef struct object_magazine {
+    struct object_magazine* next;
+    uint32_t rounds;
+    void* objects[OBJECT_CACHE_MAGAZINE_SIZE];
+} object_magazine_t;
+
+// Per-CPU state; only ever touched by its own processor
+typedef struct {
+    object_magazine_t* loaded;
+    object_magazine_t* previous;
+    uint32_t allocs;
+    uint32_t frees;
+} __attribute__((aligned(64))) object_cache_cpu_t;
+
+typedef struct object_cache {
+    char name[OBJECT_CACHE_NAME_LEN];
+    size_t object_size;
+    size_t align;
+    object_ctor_t ctor;
+
+    // Depot (protected by lock)
+    volatile uint32_t lock;
+    object_magazine_t* full;        // Magazines holding at least one object
+    object_magazine_t* empty;
+    uint32_t full_count;
+    uint32_t empty_count;
+
+    // Statistics
+    uint32_t total_objects;         // Objects carved so far
+    uint32_t chunks;                // Backing allocations
+    uint32_t depot_hits;            // Magazine exchanges with the depot
+    uint32_t failed_allocs;
+
+    object_cache_cpu_t cpus[SMP_MAX_CPUS];
+} object_cache_t;
+
+object_cache_t* object_cache_create(const char* name, size_t size, size_t align, object_ctor_t ctor);
+void* object_cache_alloc(object_cache_t* cache);
+void  object_cache_free(object_cache_t* cache, void* object);
+
+uint32_t object_cache_in_use(object_cache_t* cache);
+void object_cache_print_stats(object_cache_t* cache);
+void object_cache_print_all_stats(void);
+
+#endif // OBJECT_CACHE_H
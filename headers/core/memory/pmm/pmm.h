@@ -2,9 +2,51 @@
 #include "kernel_types.h"
 #include "../../stdtools.h"
 
+/**
+ * QARMA - Physical Memory Manager
+ *
+ * Binary buddy allocator over every usable page reported by the
+ * multiboot memory map (up to 4GB). Order-0 pages are served from small
+ * per-CPU caches. Memory is split into two zones: LOW is covered by the
+ * kernel's identity map and may be used directly or for DMA; HIGH must
+ * be mapped through the VMM before use.
+ */
+
+#define PMM_PAGE_SIZE       0x1000
+#define PMM_MAX_ORDER       10                  // Largest block: 1024 pages (4MB)
+#define PMM_LOW_LIMIT       0x4000000           // End of the boot identity map (64MB)
+
+#define PMM_ZONE_LOW        0
+#define PMM_ZONE_HIGH       1
+#define PMM_ZONE_COUNT      2
+
+typedef struct {
+    uint32_t managed_pages;                     // Pages covered by the free lists at setup
+    uint32_t free_pages;                        // Pages on the buddy free lists
+    uint32_t cached_pages;                      // Pages parked in per-CPU caches
+    uint32_t zone_free[PMM_ZONE_COUNT];
+    uint32_t order_blocks[PMM_MAX_ORDER + 1];   // Free blocks per order (both zones)
+    uint32_t highest_page;                      // One past the highest usable page
+    uint32_t metadata_bytes;
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t cache_hits;
+    uint32_t failed_allocs;
+} pmm_stats_t;
+
 void pmm_init(void);
+bool pmm_setup(uint64_t highest_addr, uint32_t usable_end);
+
 uint32_t pmm_alloc_page(void);
 void pmm_free_page(uint32_t addr);
+uint32_t pmm_alloc_pages(uint32_t order);
+uint32_t pmm_alloc_pages_zone(uint32_t order, uint32_t zone);
+void pmm_free_pages(uint32_t addr, uint32_t order);
+uint32_t pmm_order_for_size(uint32_t size);
+
 void pmm_mark_region_free(uint32_t start_addr, uint32_t length);
 void pmm_mark_region_used(uint32_t start_addr, uint32_t length);
-void pmm_print_stats(void);
\ No newline at end of file
+
+void pmm_get_stats(pmm_stats_t* stats);
+void pmm_print_stats(void);
+void pmm_dump_free_lists(void);
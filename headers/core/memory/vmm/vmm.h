@@ -15,6 +15,7 @@
 
 void vmm_init(void);
 void* vmm_alloc_pages(size_t num_pages);   // page-aligned allocation
+void* vmm_alloc_guarded_pages(size_t num_pages);   // preceded by an unmapped page
  void  vmm_free_pages(void* addr, size_t num_pages);
 
 void vmm_map_page(uint32_t virtual_addr, uint32_t physical_addr, uint32_t flags);
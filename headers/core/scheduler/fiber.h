@@ -0,0 +1,141 @@
+/**
+ * QARMA - Fibers
+ *
+ * Lightweight cooperative threads for short background jobs that do not
+ * justify a task and its 8 KB stack. Each CPU has an executor that runs
+ * the fibers placed on it, one at a time, until they yield, wait or
+ * finish; a fiber never migrates.
+ *
+ * Two kinds share the executor:
+ *  - Stackful fibers run a plain function on a small pooled stack and
+ *    may call fiber_yield(), fiber_sleep() and fiber_await() anywhere.
+ *  - Poll fibers have no stack at all: the executor calls their poll
+ *    function, which arms at most one wait and returns FIBER_PENDING,
+ *    or returns FIBER_DONE. FIBER_BEGIN/FIBER_YIELD/FIBER_END turn a
+ *    poll function into a resumable state machine; locals do not
+ *    survive a yield, so keep state in 'arg', and use at most one
+ *    yield point per source line.
+ *
+ * Executors are driven from idle contexts: the application processors'
+ * core loops, the per-CPU idle tasks and the halting path of sleep_ms().
+ * Fiber timers count scheduler ticks derived from ktime, so they advance
+ * even while the timer interrupt is masked. Timeouts are in
+ * milliseconds; 0 waits without limit.
+ */
+
+#ifndef FIBER_H
+#define FIBER_H
+
+#include "core/stdtools.h"
+#include "core/spinlock.h"
+#include "core/scheduler/timer_wheel.h"
+
+#define FIBER_STACK_SIZE    4096        /* Pooled stack of a stackful fiber */
+
+/* Poll function results */
+#define FIBER_PENDING       0
+#define FIBER_DONE          1
+
+typedef enum {
+    FIBER_STATE_READY = 0,      /* Queued on its executor */
+    FIBER_STATE_RUNNING,        /* Current fiber of its executor */
+    FIBER_STATE_WAITING,        /* Parked on a timer and/or an event */
+    FIBER_STATE_DEAD            /* Finished, freed by the executor */
+} fiber_state_t;
+
+struct fiber;
+struct fiber_event;
+
+typedef void (*fiber_fn_t)(void *arg);
+typedef int (*fiber_poll_fn_t)(struct fiber *fiber, void *arg);
+
+typedef struct fiber {
+    struct fiber *next;                 /* Ready queue link */
+    struct fiber *wait_next;            /* Event wait list links */
+    struct fiber *wait_prev;
+
+    uint32_t id;
+    const char *name;
+    volatile fiber_state_t state;
+    uint32_t cpu;                       /* Owning executor */
+
+    fiber_fn_t entry;                   /* Stackful body */
+    fiber_poll_fn_t poll;               /* Poll function, NULL if stackful */
+    void *arg;
+
+    uint32_t esp;                       /* Saved stack pointer while switched out */
+    void *stack;                        /* Pooled stack, NULL for poll fibers */
+    uint32_t resume_line;               /* FIBER_YIELD resume point */
+
+    timer_wheel_node_t timer;           /* Sleep or wait timeout */
+    struct fiber_event *event;          /* Event waited on, NULL once signaled */
+    bool timed_out;                     /* Last event wait ran out of time */
+} fiber_t;
+
+/* Manual-reset event: signal wakes every waiter and stays set until reset */
+typedef struct fiber_event {
+    spinlock_t lock;
+    fiber_t *head;
+    fiber_t *tail;
+    volatile uint32_t signaled;
+} fiber_event_t;
+
+#define FIBER_EVENT_INIT(n) { .lock = SPINLOCK_INIT(n), .head = NULL, .tail = NULL, .signaled = 0 }
+
+typedef struct {
+    uint32_t live_fibers;               /* Spawned and not yet finished */
+    uint32_t ready_fibers;
+    uint32_t waiting_timers;
+    uint32_t spawned;
+    uint32_t resumes;                   /* Fibers run by the executors */
+    uint32_t stacks_in_use;
+    uint32_t stack_overflows;           /* Stack canaries found clobbered */
+} fiber_stats_t;
+
+void fiber_init(void);
+
+/* Spawn on the calling CPU, or on a given one */
+fiber_t* fiber_spawn(const char *name, fiber_fn_t fn, void *arg);
+fiber_t* fiber_spawn_on(uint32_t cpu, const char *name, fiber_fn_t fn, void *arg);
+fiber_t* fiber_spawn_poll(const char *name, fiber_poll_fn_t poll, void *arg);
+fiber_t* fiber_spawn_poll_on(uint32_t cpu, const char *name, fiber_poll_fn_t poll, void *arg);
+
+/* Run the calling CPU's ready fibers once each; returns how many ran */
+uint32_t fiber_run_pending(void);
+
+fiber_t* fiber_current(void);
+
+/* Stackful fibers only; outside a fiber they fall back to plain waits */
+void fiber_yield(void);
+void fiber_sleep(uint32_t ms);
+bool fiber_await(fiber_event_t *ev, uint32_t timeout_ms);
+
+/* Poll fibers: arm a wait, then return FIBER_PENDING. fiber_wait_event()
+   returns false, arming nothing, if the event is already set. */
+void fiber_wait_ms(fiber_t *fiber, uint32_t ms);
+bool fiber_wait_event(fiber_t *fiber, fiber_event_t *ev, uint32_t timeout_ms);
+
+static inline bool fiber_timed_out(const fiber_t *fiber)
+{
+    return fiber->timed_out;
+}
+
+void fiber_event_init(fiber_event_t *ev, const char *name);
+uint32_t fiber_event_signal(fiber_event_t *ev);
+void fiber_event_reset(fiber_event_t *ev);
+
+void fiber_get_stats(fiber_stats_t *stats);
+
+/* Low-level switch from fiber_switch.asm: saves the callee-saved
+   registers and stack pointer to *save_esp and resumes new_esp */
+void fiber_switch(uint32_t *save_esp, uint32_t new_esp);
+
+/* State machine helpers for poll functions */
+#define FIBER_BEGIN(f)          switch ((f)->resume_line) { case 0:
+#define FIBER_YIELD(f)          do { (f)->resume_line = __LINE__; return FIBER_PENDING; \
+                                     case __LINE__:; } while (0)
+#define FIBER_SLEEP(f, ms)      do { fiber_wait_ms((f), (ms)); FIBER_YIELD(f); } while (0)
+#define FIBER_AWAIT(f, ev, ms)  do { if (fiber_wait_event((f), (ev), (ms))) { FIBER_YIELD(f); } } while (0)
+#define FIBER_END(f)            } (f)->resume_line = 0; return FIBER_DONE
+
+#endif /* FIBER_H */
@@ -0,0 +1,38 @@
+/**
+ * QARMA - Sleeping mutexes
+ *
+ * A mutex is free when 'locked' is 0 and is taken with one cmpxchg. A
+ * contended locker first spins briefly while the owner is on a CPU, as
+ * it will likely release soon, and otherwise sleeps on the mutex's wait
+ * queue. Unlock wakes one waiter, which competes for the lock again.
+ *
+ * Only tasks may sleep on a mutex; the idle loops and early boot code
+ * poll instead (see wait_queue.h). Never take a mutex from an interrupt
+ * handler.
+ */
+
+#ifndef MUTEX_H
+#define MUTEX_H
+
+#include "core/stdtools.h"
+#include "core/spinlock.h"
+#include "core/scheduler/wait_queue.h"
+
+typedef struct {
+    volatile uint32_t locked;
+    task_t *owner;                      /* NULL outside task context */
+    wait_queue_t waiters;
+    LOCK_STATS_FIELDS
+} mutex_t;
+
+#define MUTEX_INIT(n) { .locked = 0, .owner = NULL, .waiters = WAIT_QUEUE_INIT(n) LOCK_STATS_INIT(n) }
+
+void mutex_init(mutex_t *mutex, const char *name);
+void mutex_lock(mutex_t *mutex);
+bool mutex_lock_timeout(mutex_t *mutex, uint32_t timeout_ms);
+bool mutex_trylock(mutex_t *mutex);
+void mutex_unlock(mutex_t *mutex);
+bool mutex_is_locked(const mutex_t *mutex);
+const lock_stats_t* mutex_stats(const mutex_t *mutex);
+
+#endif /* MUTEX_H */
@@ -0,0 +1,56 @@
+/**
+ * QARMA - Scheduler latency histograms
+ *
+ * Log2 histograms of scheduler latencies, fed from ktime (TSC)
+ * timestamps. Bucket 0 counts samples under 1 us and bucket N, for N > 0,
+ * those in [2^(N-1), 2^N) us; the last bucket is open-ended (16 ms up).
+ *
+ * The scheduler keeps one sched_latency_t per task and one per CPU:
+ *  - wakeup:  from a sleeping or blocked task being made runnable to it
+ *             running
+ *  - wait:    time spent on a ready queue, whatever put it there
+ *  - overrun: run time past the end of the time slice when the task was
+ *             preempted
+ * plus counts of voluntary and involuntary switches away.
+ *
+ * Recording does no locking; each record is owned by one run queue.
+ */
+
+#ifndef SCHED_STATS_H
+#define SCHED_STATS_H
+
+#include "core/stdtools.h"
+
+#define SCHED_HIST_BUCKETS  16
+
+typedef struct {
+    uint32_t buckets[SCHED_HIST_BUCKETS];
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t total_ns;
+} sched_hist_t;
+
+typedef struct {
+    sched_hist_t wakeup;                /* Wakeup to running */
+    sched_hist_t wait;                  /* Time on the ready queue */
+    sched_hist_t overrun;               /* Slice overrun at preemption */
+    uint32_t voluntary;                 /* Blocked, slept, yielded or exited */
+    uint32_t involuntary;               /* Preempted while runnable */
+} sched_latency_t;
+
+void sched_hist_add(sched_hist_t *hist, uint64_t ns);
+void sched_hist_merge(sched_hist_t *into, const sched_hist_t *from);
+
+/* Upper bound (us) of the bucket holding the given percentile; 0 if empty */
+uint32_t sched_hist_percentile(const sched_hist_t *hist, uint32_t percent);
+uint32_t sched_hist_mean_us(const sched_hist_t *hist);
+
+void sched_latency_reset(sched_latency_t *lat);
+void sched_latency_merge(sched_latency_t *into, const sched_latency_t *from);
+
+/* One line per histogram: count, p50/p99/max and the bucket counts */
+void sched_hist_print(const char *label, const sched_hist_t *hist);
+/* Compact one-line summary (used per task) */
+void sched_latency_print_summary(const sched_latency_t *lat);
+
+#endif /* SCHED_STATS_H */
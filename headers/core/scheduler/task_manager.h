@@ -4,6 +4,10 @@
 // #include <stdint.h>
 // #include <stdbool.h>
 #include "core/stdtools.h"
+#include "core/scheduler/timer_wheel.h"
+#include "core/fpu.h"
+#include "core/ktime.h"
+#include "core/scheduler/sched_stats.h"
 
 /* Task states */
 typedef enum {
@@ -25,12 +29,55 @@ typedef enum {
     TASK_PRIORITY_IDLE = 4      /* Idle/cleanup tasks */
 } task_priority_t;
 
+#define TASK_PRIORITY_COUNT 5
+
 /* Task flags */
 #define TASK_FLAG_KERNEL        (1 << 0)    /* Kernel space task */
 #define TASK_FLAG_USER          (1 << 1)    /* User space task */
 #define TASK_FLAG_SYSTEM        (1 << 2)    /* System service */
 #define TASK_FLAG_PREEMPTIBLE   (1 << 3)    /* Can be preempted */
 #define TASK_FLAG_PERSISTENT    (1 << 4)    /* Don't terminate on error */
+#define TASK_FLAG_IDLE          (1 << 5)    /* Per-CPU idle task, never queued */
+#define TASK_FLAG_DEADLINE      (1 << 6)    /* Deadline class, see task_set_deadline() */
+
+/* Deadline class bandwidth (runtime/period) in 20-bit fixed point; each
+   CPU admits deadline tasks up to TASK_DL_BW_LIMIT and leaves the rest
+   to the priority classes */
+#define TASK_DL_BW_SHIFT        20
+#define TASK_DL_BW_ONE          (1u << TASK_DL_BW_SHIFT)
+#define TASK_DL_BW_LIMIT        (TASK_DL_BW_ONE / 10 * 9)
+
+/* CPU affinity masks (bit N = CPU N) */
+#define TASK_AFFINITY_ALL       (~0ULL)
+#define TASK_CPU_BIT(cpu)       (1ULL << (cpu))
+
+/* Subsystem value for tasks not bound to a core_manager subsystem */
+#define TASK_SUBSYSTEM_NONE     0xFFFFFFFF
+
+/* Deadline (EDF) parameters and state of a TASK_FLAG_DEADLINE task. Each
+   period releases a job with 'runtime' of CPU budget due 'deadline' after
+   its release. Ready deadline tasks with budget left run before every
+   priority class, earliest deadline first; a job that exhausts its budget
+   drops to the task's own priority until the next release. */
+typedef struct {
+    ktime_t runtime;                /* Budget per job (ns) */
+    ktime_t deadline;               /* Relative deadline (ns) */
+    ktime_t period;                 /* Release interval (ns) */
+    uint32_t bw;                    /* runtime/period, TASK_DL_BW_ONE = 100% */
+    uint32_t cpu;                   /* CPU it was admitted on (and pinned to) */
+    
+    ktime_t release;                /* Current job's release time */
+    ktime_t abs_deadline;           /* Current job's deadline */
+    int64_t budget;                 /* Budget left in the current job (ns) */
+    ktime_t exec_start;             /* Start of the charged run, 0 while not charging */
+    bool queued;                    /* On its run queue's deadline list */
+    bool waiting;                   /* Parked in task_wait_period() */
+    ktimer_t timer;                 /* Next release (replenishment) */
+    
+    uint32_t jobs;                  /* Jobs released */
+    uint32_t overruns;              /* Jobs that ran out of budget */
+    uint32_t misses;                /* Jobs finished after their deadline */
+} task_dl_t;
 
 /* CPU register context for task switching */
 typedef struct {
@@ -58,7 +105,7 @@ typedef struct task {
     uint32_t time_slice;            /* Time slice in ms */
     uint32_t time_remaining;        /* Remaining time in current slice */
     uint32_t total_runtime;         /* Total CPU time used */
-    uint32_t wake_time;             /* Wake up time (for sleeping tasks) */
+    uint32_t wake_time;             /* Wake up tick (for sleeping tasks) */
     
     void *entry_point;              /* Task entry function */
     void *user_data;                /* User-defined data pointer */
@@ -71,15 +118,41 @@ typedef struct task {
     /* Linked list pointers for scheduling queues */
     struct task *next;              /* Next task in queue */
     struct task *prev;              /* Previous task in queue */
+
+    timer_wheel_node_t sleep_node;  /* Timer wheel entry while sleeping */
+    
+    /* SMP placement */
+    uint64_t affinity_mask;         /* CPUs the task may run on */
+    uint32_t subsystem;             /* core_manager subsystem_id_t whose cores it may use */
+    uint32_t cpu;                   /* Run queue the task belongs to */
+    uint32_t last_run_tick;         /* Tick it last left a CPU (migration cost) */
+    volatile uint32_t on_cpu;       /* Context not yet saved by its last CPU */
+    
+    fpu_context_t fpu;              /* Lazily saved x87/SSE state */
+    
+    task_dl_t dl;                   /* Deadline class, if TASK_FLAG_DEADLINE */
+    
+    /* Latency tracing (ktime ns, owned by the task's run queue) */
+    ktime_t ready_since;            /* Queued since, 0 while not waiting */
+    ktime_t run_start;              /* Start of the current slice */
+    bool woken;                     /* Wait began with a wakeup */
+    bool yielded;                   /* Gave up the CPU through task_yield() */
+    sched_latency_t latency;
 } task_t;
 
 /* Task manager statistics */
 typedef struct {
     uint32_t total_tasks;           /* Total tasks created */
     uint32_t active_tasks;          /* Currently active tasks */
-    uint32_t tasks_by_priority[5];  /* Tasks per priority level */
+    uint32_t tasks_by_priority[TASK_PRIORITY_COUNT];  /* Tasks per priority level */
     uint32_t context_switches;     /* Total context switches */
     uint32_t scheduler_calls;       /* Scheduler invocation count */
+    uint32_t sleeping_tasks;        /* Tasks waiting on the timer wheels */
+    uint32_t migrations;            /* Tasks pulled between CPUs */
+    uint32_t online_cpus;           /* CPUs with a run queue */
+    uint32_t deadline_tasks;        /* Tasks admitted to the deadline class */
+    uint32_t deadline_overruns;     /* Deadline jobs that exhausted their budget */
+    uint32_t deadline_misses;       /* Deadline jobs finished late */
 } task_manager_stats_t;
 
 /* Task entry point function type */
@@ -103,18 +176,35 @@ void task_yield(void);             /* Voluntary yield CPU */
 void task_sleep(uint32_t milliseconds);
 void task_wake(task_t *task);
 void task_block(task_t *task);
+void task_block_prepare(task_t *task, uint32_t timeout_ms);
 void task_unblock(task_t *task);
 
 /* Task lookup and information */
 task_t* task_current(void);        /* Get current running task */
 task_t* task_find_by_id(uint32_t task_id);
 task_t* task_find_by_name(const char *name);
+task_t* task_find_by_stack_guard(uint32_t addr);  /* Owner of a faulting guard page */
 uint32_t task_get_current_id(void);
 
 /* Priority management */
 int task_set_priority(task_t *task, task_priority_t new_priority);
 task_priority_t task_get_priority(task_t *task);
 
+/* Deadline class: admit a CREATED task with a budget of runtime_us every
+   period_us, due deadline_us after each release. Fails (-1) if no CPU it
+   may use has the bandwidth left. task_wait_period() ends the current
+   job and sleeps until the next release. */
+int task_set_deadline(task_t *task, uint32_t runtime_us, uint32_t deadline_us, uint32_t period_us);
+int task_wait_period(void);
+
+/* CPU affinity and placement */
+int task_set_affinity(task_t *task, uint64_t cpu_mask);
+uint64_t task_get_affinity(task_t *task);
+int task_set_subsystem(task_t *task, uint32_t subsystem);
+int task_bind_subsystem(task_t *task, uint16_t registry_id);
+uint32_t task_cpu_load(uint32_t cpu);
+void task_cpu_run(void);           /* Idle hook for application processors */
+
 /* Timer callbacks for scheduler */
 void task_timer_tick(void);        /* Called on timer interrupt */
 
@@ -123,6 +213,7 @@ void task_get_stats(task_manager_stats_t *stats);
 void task_manager_get_stats(task_manager_stats_t *stats);
 void task_dump_info(task_t *task);
 void task_dump_all_tasks(void);
+void task_dump_latency(bool reset);  /* Per-CPU histograms, then per task */
 
 /* Memory management for tasks */
 void* task_allocate_stack(size_t stack_size);
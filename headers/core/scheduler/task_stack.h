@@ -0,0 +1,49 @@
+/**
+ * QARMA - Task stack pool
+ *
+ * Task stacks come in power-of-two page classes and are recycled through
+ * a free list per class instead of going back to the heap. Once paging
+ * is on, each new stack is mapped through the VMM with an unmapped guard
+ * page directly below it, so running off the bottom faults instead of
+ * corrupting whatever lies beneath.
+ *
+ * Stacks are filled with a canary pattern when created and the used part
+ * is refilled when they are freed; the deepest word that no longer holds
+ * the pattern gives a stack's high-water mark.
+ */
+
+#ifndef TASK_STACK_H
+#define TASK_STACK_H
+
+#include "core/stdtools.h"
+
+#define TASK_STACK_PAGE_SIZE    4096
+#define TASK_STACK_CLASSES      4       /* 4, 8, 16 and 32 KB */
+#define TASK_STACK_MAX_SIZE     (TASK_STACK_PAGE_SIZE << (TASK_STACK_CLASSES - 1))
+#define TASK_STACK_CANARY       0x57AC57AC
+
+typedef struct {
+    uint32_t size;                      /* Bytes per stack */
+    uint32_t created;                   /* Stacks carved so far */
+    uint32_t guarded;                   /* ... of which have a guard page */
+    uint32_t in_use;
+    uint32_t peak_in_use;
+    uint32_t peak_depth;                /* Deepest high-water mark seen on free */
+} task_stack_class_stats_t;
+
+/* Size actually handed out for a request; 0 if too large */
+size_t task_stack_class_size(size_t size);
+
+void* task_stack_alloc(size_t size);
+void task_stack_free(void *base, size_t size);
+
+/* Bytes of the stack that have ever been used */
+uint32_t task_stack_high_water(const void *base, size_t size);
+
+/* Whether addr lies in the guard page below a stack */
+bool task_stack_in_guard(const void *base, uint32_t addr);
+
+void task_stack_get_stats(uint32_t class_index, task_stack_class_stats_t *stats);
+void task_stack_print_stats(void);
+
+#endif /* TASK_STACK_H */
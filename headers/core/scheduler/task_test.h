@@ -21,4 +21,11 @@
  */
 void task_manager_test(void);
 
+/**
+ * Write into the guard page below a live task's stack. The page fault
+ * handler should name the task and halt the system; returning means no
+ * guard page was available.
+ */
+void task_stack_guard_test(void);
+
 #endif /* TASK_TEST_H */
\ No newline at end of file
@@ -0,0 +1,54 @@
+/**
+ * QARMA - Hierarchical timer wheel
+ *
+ * Tick-keyed timers with O(1) insert, O(1) removal and constant amortized
+ * work per tick regardless of how many timers are pending. The root level
+ * has one slot per tick for the next 256 ticks; each outer level covers
+ * 64 times the span of the level below and is cascaded down whenever the
+ * level below wraps. Deadlines beyond the outermost level are clamped to
+ * it and re-filed as they come into range.
+ *
+ * The wheel does no locking; callers serialize access (the scheduler
+ * runs it with interrupts disabled).
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include "core/stdtools.h"
+
+#define TIMER_WHEEL_ROOT_BITS   8
+#define TIMER_WHEEL_ROOT_SIZE   (1u << TIMER_WHEEL_ROOT_BITS)
+#define TIMER_WHEEL_LEVEL_BITS  6
+#define TIMER_WHEEL_LEVEL_SIZE  (1u << TIMER_WHEEL_LEVEL_BITS)
+#define TIMER_WHEEL_LEVELS      3       /* Outer levels; 2^26 ticks in total */
+#define TIMER_WHEEL_MAX_DELTA   ((1u << (TIMER_WHEEL_ROOT_BITS + TIMER_WHEEL_LEVELS * TIMER_WHEEL_LEVEL_BITS)) - 1)
+
+/* Intrusive timer node; embed it in the object being timed */
+typedef struct timer_wheel_node {
+    struct timer_wheel_node *next;
+    struct timer_wheel_node *prev;
+    struct timer_wheel_node **slot;     /* Owning slot, NULL when not queued */
+    uint32_t expires;                   /* Tick at which the node fires */
+} timer_wheel_node_t;
+
+typedef void (*timer_wheel_fn_t)(timer_wheel_node_t *node);
+
+typedef struct {
+    uint32_t now;                       /* Next tick to be processed */
+    uint32_t pending;                   /* Nodes queued */
+    timer_wheel_node_t *root[TIMER_WHEEL_ROOT_SIZE];
+    timer_wheel_node_t *levels[TIMER_WHEEL_LEVELS][TIMER_WHEEL_LEVEL_SIZE];
+} timer_wheel_t;
+
+void timer_wheel_init(timer_wheel_t *wheel, uint32_t now);
+void timer_wheel_add(timer_wheel_t *wheel, timer_wheel_node_t *node, uint32_t expires);
+void timer_wheel_remove(timer_wheel_t *wheel, timer_wheel_node_t *node);
+void timer_wheel_advance(timer_wheel_t *wheel, uint32_t now, timer_wheel_fn_t fire);
+
+static inline bool timer_wheel_pending(const timer_wheel_node_t *node)
+{
+    return node->slot != NULL;
+}
+
+#endif /* TIMER_WHEEL_H */
@@ -0,0 +1,77 @@
+/**
+ * QARMA - Wait queues and completions
+ *
+ * A wait queue is a FIFO of waiters, each an entry on the waiting
+ * task's stack. Tasks block through task_block_prepare(): the entry is
+ * queued and the task marked blocked under the queue lock, and only then
+ * does it schedule, so a wakeup that lands in between is not lost.
+ *
+ * Callers that cannot block - early boot, before the scheduler owns the
+ * CPU, or a per-CPU idle loop - wait by polling their entry instead.
+ * Timeouts are in milliseconds; 0 waits without limit.
+ */
+
+#ifndef WAIT_QUEUE_H
+#define WAIT_QUEUE_H
+
+#include "core/stdtools.h"
+#include "core/spinlock.h"
+#include "core/ktime.h"
+#include "core/scheduler/task_manager.h"
+
+#define WAIT_FOREVER 0
+
+typedef struct wait_queue_entry {
+    struct wait_queue_entry *next;
+    struct wait_queue_entry *prev;
+    task_t *task;                       /* NULL when the waiter polls */
+    volatile uint32_t woken;            /* Dequeued by a waker */
+} wait_queue_entry_t;
+
+typedef struct {
+    spinlock_t lock;
+    wait_queue_entry_t *head;
+    wait_queue_entry_t *tail;
+} wait_queue_t;
+
+#define WAIT_QUEUE_INIT(n) { .lock = SPINLOCK_INIT(n), .head = NULL, .tail = NULL }
+
+/* Wait condition; may take the queue's lock */
+typedef bool (*wait_cond_fn_t)(void *arg);
+
+void wait_queue_init(wait_queue_t *wq, const char *name);
+bool wait_queue_active(wait_queue_t *wq);
+
+/* Wait until cond(arg) holds; false if the timeout passed first */
+bool wait_event(wait_queue_t *wq, wait_cond_fn_t cond, void *arg, uint32_t timeout_ms);
+
+/* Building blocks for waits wait_event() cannot express */
+void wait_prepare(wait_queue_t *wq, wait_queue_entry_t *entry, uint32_t timeout_ms);
+void wait_sleep(wait_queue_entry_t *entry, ktime_t deadline);
+bool wait_finish(wait_queue_t *wq, wait_queue_entry_t *entry);
+
+/* Wake waiters in FIFO order; returns how many were woken */
+uint32_t wake_up(wait_queue_t *wq, uint32_t count);
+uint32_t wake_up_one(wait_queue_t *wq);
+uint32_t wake_up_all(wait_queue_t *wq);
+
+/* One-shot or counted event: each complete() releases one waiter,
+   complete_all() every current and future waiter until reinit */
+typedef struct {
+    wait_queue_t wait;
+    volatile uint32_t done;
+} completion_t;
+
+#define COMPLETION_DONE_ALL 0xFFFFFFFF
+#define COMPLETION_INIT(n) { .wait = WAIT_QUEUE_INIT(n), .done = 0 }
+
+void completion_init(completion_t *c, const char *name);
+void completion_reinit(completion_t *c);
+void complete(completion_t *c);
+void complete_all(completion_t *c);
+bool completion_done(completion_t *c);
+bool try_wait_for_completion(completion_t *c);
+void wait_for_completion(completion_t *c);
+bool wait_for_completion_timeout(completion_t *c, uint32_t timeout_ms);
+
+#endif /* WAIT_QUEUE_H */
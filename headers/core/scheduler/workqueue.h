@@ -0,0 +1,75 @@
+/**
+ * QARMA - Workqueues
+ *
+ * Deferred work for interrupt handlers. A handler acknowledges its
+ * device, queues a work item and returns; a worker fiber on the queue's
+ * CPU later calls the item's function with interrupts enabled, from the
+ * same idle contexts that drive every other fiber.
+ *
+ * A work item sits on at most one queue: queueing it again before it has
+ * run does nothing, so a handler may queue the same item on every
+ * interrupt and one run covers them all. The function runs after the
+ * item has left the queue and may queue it again.
+ *
+ * Every CPU has a system queue. Queueing works from any context and at
+ * any time; work queued before workqueue_init() runs once it has started
+ * the workers. Work functions must not block, like any poll fiber.
+ */
+
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include "core/stdtools.h"
+#include "core/spinlock.h"
+#include "core/scheduler/fiber.h"
+
+struct work;
+typedef void (*work_fn_t)(struct work *work);
+
+typedef struct work {
+    struct work *next;
+    work_fn_t fn;
+    void *data;                         /* For the function; unused by the queue */
+    volatile uint32_t pending;          /* Queued and not yet started */
+} work_t;
+
+#define WORK_INIT(f, d)     { .next = NULL, .fn = (f), .data = (d), .pending = 0 }
+
+typedef struct {
+    uint32_t queued;                    /* Items put on the queue */
+    uint32_t merged;                    /* Requests for items already pending */
+    uint32_t executed;
+    uint32_t max_depth;                 /* Most items waiting at once */
+} workqueue_stats_t;
+
+typedef struct workqueue {
+    const char *name;
+    uint32_t cpu;                       /* Where the worker runs */
+    spinlock_t lock;
+    work_t *head;
+    work_t *tail;
+    uint32_t depth;
+    fiber_event_t event;                /* Set while items wait */
+    fiber_t *worker;
+    workqueue_stats_t stats;
+} workqueue_t;
+
+/* Start the system queues' workers; needs fibers and the APs online */
+void workqueue_init(void);
+
+void work_init(work_t *work, work_fn_t fn, void *data);
+
+/* Set up a caller-owned queue and start its worker on the given CPU */
+bool workqueue_create(workqueue_t *wq, const char *name, uint32_t cpu);
+
+/* Any context. False if the item was already pending. */
+bool queue_work(workqueue_t *wq, work_t *work);
+
+/* The calling CPU's system queue, or a given CPU's */
+bool schedule_work(work_t *work);
+bool schedule_work_on(uint32_t cpu, work_t *work);
+workqueue_t* workqueue_system(uint32_t cpu);
+
+void workqueue_print_stats(void);
+
+#endif /* WORKQUEUE_H */
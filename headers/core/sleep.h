@@ -2,7 +2,9 @@
 #define SLEEP_H
 
 #include "stdtools.h"
-#define MS_PER_TICK 10  // Assuming 100Hz timer interrupt
+#include "timer.h"
+
+#define MS_PER_TICK (1000 / TIMER_HZ)
 
 void sleep_ms(uint32_t ms) ;
 
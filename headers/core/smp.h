@@ -0,0 +1,49 @@
+/**
+ * QARMA - Symmetric Multi-Processing
+ *
+ * Discovers processors through the ACPI MADT, starts the application
+ * processors with INIT-SIPI-SIPI and hands each one to its per-core
+ * parallel scheduler loop.
+ */
+
+#ifndef SMP_H
+#define SMP_H
+
+#include "kernel_types.h"
+
+#define SMP_MAX_CPUS            64
+#define SMP_TRAMPOLINE_BASE     0x8000      // Must be page aligned and below 1 MB
+#define SMP_AP_STACK_SIZE       16384
+
+// Per-processor bookkeeping
+typedef struct smp_cpu {
+    uint32_t cpu_index;                 // Logical index (BSP is always 0)
+    uint8_t apic_id;                    // Local APIC ID
+    uint8_t acpi_id;                    // ACPI processor UID
+    bool is_bsp;                        // Bootstrap processor
+    volatile bool started;              // Reached 32-bit C code
+    volatile bool online;               // Running its scheduler loop
+    uint8_t* stack_base;                // Bottom of the kernel stack
+    uint32_t stack_size;                // Stack size in bytes
+} smp_cpu_t;
+
+// Initialization
+bool smp_init(void);
+void smp_boot_aps(void);
+
+// Queries
+uint32_t smp_cpu_count(void);
+uint32_t smp_online_count(void);
+uint32_t smp_current_cpu(void);
+smp_cpu_t* smp_get_cpu(uint32_t cpu_index);
+bool smp_is_enabled(void);
+
+// AP entry point (called from the trampoline, never returns)
+void smp_ap_entry(uint32_t cpu_index);
+
+// Spin-wait hint
+static inline void cpu_relax(void) {
+    __asm__ volatile("pause" ::: "memory");
+}
+
+#endif // SMP_H
@@ -0,0 +1,66 @@
+/**
+ * QARMA - Softirqs (interrupt bottom halves)
+ *
+ * Interrupt handlers are split in two. The top half runs with interrupts
+ * disabled: it acknowledges the device, saves what it must, raises a
+ * softirq or queues work (core/scheduler/workqueue.h) and sends the EOI.
+ * The bottom half runs on the way out of the interrupt, with interrupts
+ * enabled again, from irq_exit().
+ *
+ * Each CPU has a bitmap of pending softirqs; raising one sets its bit on
+ * the calling CPU. irq_exit() runs the handlers of the set bits in vector
+ * order and repeats while new bits appear, up to SOFTIRQ_MAX_RESTART
+ * passes; whatever is still pending then waits for the next interrupt
+ * to leave (the timer tick at the latest), so a flood of interrupts
+ * cannot starve the interrupted code. Softirqs never nest: an interrupt
+ * taken while they run leaves its bits for the run in progress, and the
+ * timer tick does not preempt the task they interrupted until they end.
+ * Handlers must stay short; anything long, like a shell command, goes
+ * to a workqueue.
+ *
+ * irq_enter()/irq_exit() also time each top half, which is how long the
+ * CPU ran with interrupts masked on its behalf.
+ */
+
+#ifndef SOFTIRQ_H
+#define SOFTIRQ_H
+
+#include "core/stdtools.h"
+#include "core/ktime.h"
+#include "core/scheduler/sched_stats.h"
+
+#define SOFTIRQ_MAX_RESTART 4
+
+typedef enum {
+    SOFTIRQ_INPUT = 0,                  // Keyboard scancodes queued by IRQ1
+    SOFTIRQ_COUNT
+} softirq_vector_t;
+
+typedef void (*softirq_fn_t)(void);
+
+typedef struct {
+    uint32_t irqs;                      // Top halves timed by irq_enter/irq_exit
+    uint32_t runs;                      // Bottom-half runs started from irq_exit
+    uint32_t handled[SOFTIRQ_COUNT];    // Handler calls per vector
+    uint32_t deferred;                  // Runs cut short with work still pending
+    sched_hist_t irq_off;               // Top half, entry to irq_exit
+    sched_hist_t softirq;               // One bottom-half run, all passes
+} softirq_stats_t;
+
+void softirq_register(softirq_vector_t nr, softirq_fn_t fn);
+
+// Mark a softirq pending on the calling CPU; any context
+void softirq_raise(softirq_vector_t nr);
+
+// Whether bottom halves are running on the calling CPU; the scheduler
+// must not switch away from under them
+bool softirq_active(void);
+
+// Bracket a top half. irq_exit() sends nothing to the PIC: EOI first.
+ktime_t irq_enter(void);
+void irq_exit(ktime_t entered);
+
+void softirq_get_stats(uint32_t cpu, softirq_stats_t* stats);
+void softirq_print_stats(void);
+
+#endif // SOFTIRQ_H
@@ -0,0 +1,139 @@
+/**
+ * QARMA - Spinlocks
+ *
+ * Ticket spinlocks hand the lock out in arrival order, so no CPU starves
+ * under contention. The low half of the lock word is the ticket being
+ * served, the high half the next ticket to hand out; taking a ticket is
+ * one xadd and the uncontended path stays inline.
+ *
+ * MCS locks queue each waiter on its own node, so waiters spin on their
+ * own cache line instead of the shared lock word. Use them on paths that
+ * are contended by many CPUs at once.
+ *
+ * With LOCK_STATS defined (config.h) every lock counts acquisitions and
+ * contended acquisitions and sums the TSC cycles spent waiting.
+ */
+
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include "stdtools.h"
+#include "atomic.h"
+#include "config.h"
+
+// Contention statistics
+typedef struct {
+    uint32_t acquisitions;
+    uint32_t contended;                 // Acquisitions that had to wait
+    uint64_t wait_cycles;               // Total TSC cycles spent waiting
+    uint64_t max_wait_cycles;           // Longest single wait
+} lock_stats_t;
+
+#ifdef LOCK_STATS
+    #define LOCK_STATS_FIELDS   const char* name; lock_stats_t stats;
+    #define LOCK_STATS_INIT(n)  , .name = (n)
+#else
+    #define LOCK_STATS_FIELDS
+    #define LOCK_STATS_INIT(n)
+#endif
+
+// ────────────────
+// Ticket spinlock
+// ────────────────
+
+typedef struct {
+    volatile uint32_t ticket;           // next << 16 | owner
+    LOCK_STATS_FIELDS
+} spinlock_t;
+
+#define SPINLOCK_INIT(n)        { .ticket = 0 LOCK_STATS_INIT(n) }
+#define SPIN_TICKET_NEXT        0x10000u
+
+void spin_lock_init(spinlock_t* lock, const char* name);
+void spin_lock_slow(spinlock_t* lock, uint16_t ticket);
+bool spin_trylock(spinlock_t* lock);
+const lock_stats_t* spin_lock_stats(const spinlock_t* lock);
+
+static inline void spin_lock(spinlock_t* lock) {
+    uint32_t prev = atomic_xadd_u32(&lock->ticket, SPIN_TICKET_NEXT);
+    uint16_t ticket = (uint16_t)(prev >> 16);
+    if ((uint16_t)prev != ticket) {
+        spin_lock_slow(lock, ticket);
+        return;
+    }
+#ifdef LOCK_STATS
+    lock->stats.acquisitions++;
+#endif
+}
+
+static inline void spin_unlock(spinlock_t* lock) {
+    // Only the holder writes the owner half; a 16-bit increment cannot
+    // carry into the ticket counter
+    __asm__ volatile("incw %0" : "+m"(*(volatile uint16_t*)&lock->ticket) :: "memory", "cc");
+}
+
+static inline bool spin_is_locked(const spinlock_t* lock) {
+    uint32_t word = atomic_load_u32(&lock->ticket);
+    return (uint16_t)word != (uint16_t)(word >> 16);
+}
+
+/**
+ * Disable interrupts on this CPU, then take the lock. Use for any lock
+ * also taken from interrupt context.
+ */
+static inline uint32_t spin_lock_irqsave(spinlock_t* lock) {
+    uint32_t flags;
+    __asm__ volatile("pushfl; popl %0; cli" : "=r"(flags) :: "memory");
+    spin_lock(lock);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t* lock, uint32_t flags) {
+    spin_unlock(lock);
+    if (flags & 0x200) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
+
+// ────────────────
+// MCS queue lock
+// ────────────────
+
+// Per-acquisition queue node, usually on the caller's stack
+typedef struct mcs_node {
+    struct mcs_node* volatile next;
+    volatile uint32_t locked;
+} mcs_node_t;
+
+typedef struct {
+    mcs_node_t* volatile tail;          // Last waiter, NULL when free
+    LOCK_STATS_FIELDS
+} mcs_lock_t;
+
+#define MCS_LOCK_INIT(n)        { .tail = NULL LOCK_STATS_INIT(n) }
+
+void mcs_lock_init(mcs_lock_t* lock, const char* name);
+void mcs_lock(mcs_lock_t* lock, mcs_node_t* node);
+bool mcs_trylock(mcs_lock_t* lock, mcs_node_t* node);
+void mcs_unlock(mcs_lock_t* lock, mcs_node_t* node);
+const lock_stats_t* mcs_lock_stats(const mcs_lock_t* lock);
+
+static inline uint32_t mcs_lock_irqsave(mcs_lock_t* lock, mcs_node_t* node) {
+    uint32_t flags;
+    __asm__ volatile("pushfl; popl %0; cli" : "=r"(flags) :: "memory");
+    mcs_lock(lock, node);
+    return flags;
+}
+
+static inline void mcs_unlock_irqrestore(mcs_lock_t* lock, mcs_node_t* node, uint32_t flags) {
+    mcs_unlock(lock, node);
+    if (flags & 0x200) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
+
+// Statistics helpers shared with the sleeping locks
+void lock_stats_record_wait(lock_stats_t* stats, uint64_t start_cycles);
+void lock_stats_print(const char* name, const lock_stats_t* stats);
+
+#endif // SPINLOCK_H
@@ -47,6 +47,11 @@ void* memchr(const void* ptr, int value, size_t num);
 void* memzero(void* ptr, size_t size);
 bool memeq(const void* ptr1, const void* ptr2, size_t size);
 
+// SIMD setup for the bulk memory paths (call once on every CPU)
+void string_init_cpu(void);
+bool string_set_sse2(bool enable);
+bool string_sse2_enabled(void);
+
 // String conversion functions
 int atoi(const char* str);
 long atol(const char* str);
@@ -11,6 +11,9 @@ typedef struct {
 } system_timer;
 
 
+// PIT tick rate programmed by init_interrupts()
+#define TIMER_HZ 100
+
 // System tick counter (increments on each PIT tick)
 extern volatile uint32_t system_ticks;
 
@@ -24,6 +27,10 @@ void inc_ticks(void);
 // frequency (Hz). This programs channel 0 of the PIT (ports 0x43/0x40).
 void init_timer(uint32_t frequency);
 
+// Busy-wait for the given number of microseconds (PIT channel 2,
+// does not depend on interrupts being enabled)
+void timer_udelay(uint32_t microseconds);
+
 double get_system_time_seconds(uint32_t frequency);
 
 uint64_t get_system_time_millis(uint32_t frequency);
@@ -2,6 +2,7 @@
 #define UHCI_H
 
 #include "core/kernel.h"
+#include "core/scheduler/workqueue.h"
 #include "usb.h"
 
 // UHCI Register Offsets
@@ -90,6 +91,10 @@ typedef struct uhci_controller {
     uhci_qh_t *qh_pool;     // Pool of QHs
     
     uint8_t bus, slot, func; // PCI location
+    
+    // Interrupt bottom half
+    volatile uint32_t irq_status;  // USBSTS bits acknowledged, not yet handled
+    work_t irq_work;
 } uhci_controller_t;
 
 // TD Control Bits
@@ -131,7 +136,7 @@ int uhci_interrupt_transfer(uhci_controller_t *uhci, usb_device_t *device,
                            uint8_t endpoint, void *data, uint16_t length,
                            void (*callback)(usb_transfer_t *));
 
-void uhci_interrupt_handler(uhci_controller_t *uhci);
+void uhci_interrupt_handler(uhci_controller_t *uhci);  // Top half: ack and queue irq_work
 bool uhci_port_device_connected(uhci_controller_t *uhci, int port);
 bool uhci_reset_port(uhci_controller_t *uhci, int port);
 
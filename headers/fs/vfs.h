@@ -36,6 +36,9 @@ typedef struct vfs_node {
 void vfs_register_fs(struct fs_driver* fs);
 // Initialize VFS system
 void vfs_init(void);
+// Allocate / release a zeroed node (object cache backed)
+vfs_node_t* vfs_node_alloc(void);
+void vfs_node_free(vfs_node_t* node);
 // Mount a filesystem
 int vfs_mount(const char* devname, const char* fstype, const char* mountpoint);
 // Open a file
@@ -0,0 +1,38 @@
+/**
+ * QARMA - Span blitter
+ * Integer alpha blending for 32bpp surfaces (R in the low byte, A in the high)
+ */
+
+#ifndef QARMA_BLIT_H
+#define QARMA_BLIT_H
+
+#include "kernel_types.h"
+
+#define BLIT_ALPHA_MASK     0xFF000000u
+
+/**
+ * Blend one source pixel over a destination pixel using
+ * (a*s + (255-a)*d + 128) >> 8 per channel; the result is opaque
+ */
+static inline uint32_t blit_blend_pixel(uint32_t dst, uint32_t src) {
+    uint32_t a = src >> 24;
+    uint32_t ia = 255 - a;
+    uint32_t rb = ((src & 0x00FF00FF) * a + (dst & 0x00FF00FF) * ia + 0x00800080) >> 8;
+    uint32_t g = (((src >> 8) & 0xFF) * a + ((dst >> 8) & 0xFF) * ia + 0x80) & 0xFF00;
+    return (rb & 0x00FF00FF) | g | BLIT_ALPHA_MASK;
+}
+
+// Row operations; dst and src must not overlap
+void blit_span_over(uint32_t* dst, const uint32_t* src, uint32_t count);
+void blit_span_opaque(uint32_t* dst, const uint32_t* src, uint32_t count);
+void blit_span_fill(uint32_t* dst, uint32_t color, uint32_t count);
+
+// Rectangle over a destination surface; strides are in pixels
+void blit_rect_over(uint32_t* dst, uint32_t dst_stride, const uint32_t* src,
+                    uint32_t src_stride, uint32_t width, uint32_t height);
+
+// SSE2 path control (follows string_sse2_enabled() by default)
+bool blit_set_sse2(bool enable);
+bool blit_sse2_enabled(void);
+
+#endif // QARMA_BLIT_H
@@ -65,8 +65,48 @@ void draw_scaled_text(int x, int y, const char *text, int scale, rgb_color_t fg,
 extern uint32_t* fb_ptr;
 
 // Compositor/backing store
+#define FB_MAX_DAMAGE_RECTS  32
+#define FB_POINTER_WIDTH     8
+#define FB_POINTER_HEIGHT    12
+#define FB_MAX_FLIP_PAGES    3
+
+typedef struct {
+    int x, y;
+    int width, height;
+} fb_rect_t;
+
+typedef struct {
+    uint32_t frames;            // Composes that had damage
+    uint32_t rects;             // Damage rectangles composed
+    uint32_t pixels_composed;   // Pixels rebuilt
+    uint32_t windows_culled;    // Window/rect pairs skipped as occluded
+    uint32_t frames_deferred;   // Composes held back to the next frame slot
+    uint32_t presents;          // Frames handed to the display
+    uint32_t pixels_presented;  // Pixels written to VRAM
+} fb_compose_stats_t;
+
+/**
+ * How a composed frame reaches the screen. The compositor always renders
+ * into a RAM back buffer and never reads VRAM; COPY streams the damaged
+ * rectangles into the visible page, FLIP fills a hidden Bochs VBE page and
+ * moves the display start to it. Direct fb_* drawing targets page 0, so
+ * FLIP is meant for loops where the compositor owns the whole screen.
+ */
+typedef enum {
+    FB_PRESENT_COPY = 0,
+    FB_PRESENT_FLIP = 1
+} fb_present_mode_t;
+
 void fb_compose(void);
+void fb_compose_all(void);
 void fb_mark_dirty(void);
+void fb_damage_rect(int x, int y, int width, int height);
+void fb_damage_window(QARMA_WIN_HANDLE* win, int x, int y, int width, int height);
+void fb_set_pointer(int x, int y, bool visible);
+void fb_get_compose_stats(fb_compose_stats_t* stats);
+bool fb_set_present_mode(fb_present_mode_t mode);
+fb_present_mode_t fb_get_present_mode(void);
+uint32_t fb_get_flip_pages(void);
 
 extern uint32_t fb_width;
 extern uint32_t fb_height;
@@ -16,5 +16,8 @@ void irq_log_flush_to_message_box(void);
 // Flush queued IRQ log lines directly to the serial port. Safe to call
 // from IRQ context for short debug prints.
 void irq_log_flush_to_serial(void);
+bool irq_log_pending(void);
+// From IRQ context: flush to serial later, from the system workqueue
+void irq_log_schedule_flush(void);
 
 #endif // IRQ_LOGGER_H
@@ -53,7 +53,7 @@
 #define UNUSED           __attribute__((unused))
 
 // Memory barriers and atomic operations
-#define MEMORY_BARRIER() __asm__ __volatile__("" ::: "memory")
+#define MEMORY_BARRIER() __asm__ __volatile__("lock; addl $0, 0(%%esp)" ::: "memory", "cc")
 #define COMPILER_BARRIER() __asm__ __volatile__("" ::: "memory")
 
 // Assembly instruction macros
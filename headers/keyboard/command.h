@@ -85,6 +85,8 @@ void cmd_reboot(int argc, char** argv);
 void cmd_version(int argc, char** argv);
 void cmd_clear(int argc, char** argv);
 void cmd_exit(int argc, char** argv);
+void cmd_heap(int argc, char** argv);
+void cmd_pmm(int argc, char** argv);
 
 // Network commands
 void cmd_ifconfig(int argc, char** argv);
@@ -95,6 +97,16 @@ void cmd_arp(int argc, char** argv);
 
 // Pipeline commands
 void cmd_pipeline(int argc, char** argv);
+void cmd_pipebench(int argc, char** argv);
+void cmd_wqtest(int argc, char** argv);
+void cmd_graphtest(int argc, char** argv);
+void cmd_pfortest(int argc, char** argv);
+void cmd_futuretest(int argc, char** argv);
+void cmd_fibers(int argc, char** argv);
+void cmd_tasks(int argc, char** argv);
+void cmd_guardtest(int argc, char** argv);
+void cmd_schedlat(int argc, char** argv);
+void cmd_irqstat(int argc, char** argv);
 
 // Window commands
 void cmd_window(int argc, char** argv);
@@ -26,6 +26,7 @@ bool keyboard_init(void);
 //void keyboard_handler(regs_t* regs);
 void keyboard_send_eoi(uint32_t int_no);
 void keyboard_process_scancode(uint8_t scancode);
+void keyboard_irq_enqueue(uint8_t scancode);  // IRQ1 top half
 void keyboard_set_enabled(bool enabled);
 bool keyboard_is_enabled(void);
 void keyboard_handle_key_press(uint8_t scancode);
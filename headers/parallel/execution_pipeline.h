@@ -1,28 +1,52 @@
 /**
  * QARMA - Execution Pipeline System
  * 
- * Core-local execution chains with zero cross-core synchronization.
- * Each pipeline runs entirely on a single CPU core for maximum cache efficiency.
+ * Core-local execution chains. pipeline_execute and pipeline_execute_batch
+ * run a pipeline entirely on the calling core for cache efficiency;
+ * pipeline_stream spreads its nodes over several cores (see below).
  * 
  * Architecture:
  *   - Pipelines are linked lists of execution nodes
  *   - Each node contains a function pointer and data
  *   - Output from node N becomes input to node N+1
- *   - All execution happens in one core's cache (L1/L2)
- *   - No locks, no barriers, no cross-core data sharing
+ *   - Single-core runs stay in one core's cache (L1/L2), with no locks,
+ *     barriers or cross-core data sharing
  * 
- * Benefits:
+ * Benefits (single-core runs):
  *   - Zero synchronization overhead
  *   - Maximum cache efficiency (~4 cycles per access)
  *   - Predictable performance (no contention)
  *   - Easy checkpoint/resume (save current node + data)
  *   - Linear debugging (single execution path)
+ * 
+ * Streaming (pipeline_stream):
+ *   - A stream of items flows through the same chain with every node
+ *     pinned to a core of its own, so N nodes work on N items at once
+ *   - Neighbouring nodes are joined by SPSC rings (pipeline_ring.h);
+ *     the only cross-core traffic is the items themselves
+ *   - Nodes move items in batches of up to PIPELINE_BATCH_SIZE and stop
+ *     taking input while their output ring is full (backpressure)
+ *   - With fewer cores than nodes, nodes share cores; with no APs the
+ *     caller runs every node itself
+ * 
+ * Batching (pipeline_execute_batch):
+ *   - Runs an array of items through the chain on the calling core, a
+ *     chunk at a time, each node taking a whole batch per call
+ *   - Glyphs may provide batch_ptr to loop over a batch themselves;
+ *     otherwise the pipeline calls func_ptr once per item, which must
+ *     then be SIG_PTR_TO_PTR (batches and streams refuse other nodes)
+ *   - Each node sizes its batches from its measured cost per item so a
+ *     call takes about PIPELINE_BATCH_TARGET_US, in both modes
+ *   - Checkpoints are taken between chunks, every K chunks or T
+ *     microseconds, rather than after every node
  */
 
 #ifndef EXECUTION_PIPELINE_H
 #define EXECUTION_PIPELINE_H
 
 #include "kernel_types.h"
+#include "core/smp.h"
+#include "parallel/pipeline_ring.h"
 
 // ────────────────────────────────────────────────────────────────────────────
 // Configuration
@@ -31,6 +55,11 @@
 #define MAX_PIPELINE_NODES      32      // Max functions in a pipeline
 #define MAX_PIPELINES_PER_CORE  8       // Max concurrent pipelines per core
 #define MAX_FUNCTION_NAME       64      // Max length of function semantic name
+#define MAX_PIPELINE_CORES      SMP_MAX_CPUS
+#define PIPELINE_RING_SIZE      256     // Ring slots between two streaming nodes
+#define PIPELINE_BATCH_SIZE     32      // Initial batch a node takes per call
+#define PIPELINE_BATCH_MAX      128     // Largest adaptive batch (half a ring)
+#define PIPELINE_BATCH_TARGET_US 20     // Adaptive batches aim to take this long
 
 // ────────────────────────────────────────────────────────────────────────────
 // Function Metadata (Glyphic Headers)
@@ -57,6 +86,7 @@ typedef struct {
     char semantic_name[MAX_FUNCTION_NAME];  // e.g., "network.parse_ipv4"
     function_signature_t signature;         // Function signature type
     void* (*func_ptr)(void*);              // Actual function pointer
+    void (*batch_ptr)(void* const* inputs, void** outputs, uint32_t count);  // Optional: outputs[i] for inputs[i]
     uint32_t version_id;                    // For tracking mutations
     float estimated_cycles;                 // Performance estimate
     bool is_resumable;                      // Can be checkpointed mid-execution
@@ -67,6 +97,18 @@ typedef struct {
 // Execution Pipeline Structures
 // ────────────────────────────────────────────────────────────────────────────
 
+/**
+ * Per-node counters of the last stream or batched run
+ */
+typedef struct {
+    uint32_t items;                         // Items passed on
+    uint32_t batches;                       // Calls that took input
+    uint32_t errors;                        // NULL results, dropped
+    uint32_t input_stalls;                  // Steps that found no input
+    uint32_t output_stalls;                 // Steps held back by a full ring
+    uint64_t busy_cycles;                   // Inside the function
+} pipeline_stage_stats_t;
+
 /**
  * Single node in an execution pipeline
  * 
@@ -84,6 +126,12 @@ typedef struct execution_node {
     uint64_t start_cycles;                  // When execution started
     uint64_t end_cycles;                    // When execution finished
     int result_code;                        // Return code (0 = success)
+    
+    // Streaming and batching
+    uint32_t stream_core;                   // Core of the last stream, UINT32_MAX: caller's
+    uint32_t batch_size;                    // Items per call, adapted to item_cycles
+    uint32_t item_cycles;                   // Smoothed cost of one item
+    pipeline_stage_stats_t stats;
 } execution_node_t;
 
 /**
@@ -111,6 +159,12 @@ typedef struct {
     uint64_t total_cycles;                  // Total execution time
     uint32_t cache_misses;                  // L1 cache misses (if available)
     
+    // Batched execution checkpoints
+    uint32_t checkpoint_batches;            // Every K chunks (0: not by count)
+    uint32_t checkpoint_us;                 // Every T microseconds (0: not by time)
+    uint32_t checkpoints_taken;
+    struct pipeline_checkpoint* batch_checkpoint;  // Latest, overwritten in place
+    
     // Context
     void* core_local_context;               // Core-specific state/memory
 } execution_pipeline_t;
@@ -125,13 +179,17 @@ typedef struct {
  * Allows a pipeline to be saved mid-execution and resumed later
  * on the same or different core.
  */
-typedef struct {
+typedef struct pipeline_checkpoint {
     uint32_t pipeline_id;                   // Which pipeline
     uint32_t original_core_id;              // Original core
     uint32_t current_node_index;            // Where we are in the chain
     void* intermediate_data;                // Output from last completed node
     uint64_t checkpoint_timestamp;          // When saved
     
+    // Batched execution: taken between chunks, so every node is done
+    uint32_t items_done;                    // Inputs through the whole chain
+    uint32_t items_produced;                // Outputs written so far
+    
     // Function-specific state (for resumable functions)
     void* node_states[MAX_PIPELINE_NODES];
 } pipeline_checkpoint_t;
@@ -166,6 +224,10 @@ execution_pipeline_t* pipeline_create(uint32_t core_id);
 void pipeline_destroy(execution_pipeline_t* pipeline);
 bool pipeline_add_node(execution_pipeline_t* pipeline, glyph_function_t* func);
 void pipeline_execute(execution_pipeline_t* pipeline);
+bool pipeline_stream(execution_pipeline_t* pipeline, void* const* inputs, void** outputs,
+                     uint32_t count, uint32_t* produced);
+bool pipeline_execute_batch(execution_pipeline_t* pipeline, void* const* inputs, void** outputs,
+                            uint32_t count, uint32_t* produced);
 
 // Node management
 execution_node_t* node_create(glyph_function_t* func);
@@ -175,6 +237,9 @@ void node_destroy(execution_node_t* node);
 pipeline_checkpoint_t* pipeline_checkpoint(execution_pipeline_t* pipeline);
 bool pipeline_resume(pipeline_checkpoint_t* checkpoint, uint32_t new_core_id);
 void checkpoint_destroy(pipeline_checkpoint_t* checkpoint);
+bool pipeline_set_checkpoint_interval(execution_pipeline_t* pipeline, uint32_t batches, uint32_t us);
+bool pipeline_resume_batch(execution_pipeline_t* pipeline, const pipeline_checkpoint_t* checkpoint,
+                           void* const* inputs, void** outputs, uint32_t count, uint32_t* produced);
 
 // Core management
 void pipeline_system_init(void);
@@ -185,6 +250,7 @@ bool assign_pipeline_to_core(execution_pipeline_t* pipeline, uint32_t core_id);
 // Debugging and introspection
 void pipeline_print_status(execution_pipeline_t* pipeline);
 void pipeline_print_metrics(execution_pipeline_t* pipeline);
+void pipeline_print_stage_stats(execution_pipeline_t* pipeline);
 
 // ────────────────────────────────────────────────────────────────────────────
 // TODO / Future Enhancements
@@ -197,9 +263,7 @@ void pipeline_print_metrics(execution_pipeline_t* pipeline);
  * Future enhancement could add optional sharing mechanisms:
  * 
  * 1. Lock-Free Queues: For producer/consumer patterns
- *    - Single-writer, single-reader ring buffers
- *    - No locks, atomic head/tail pointers
- *    - Best for streaming data between cores
+ *    - Done: pipeline_ring.h, used by pipeline_stream()
  * 
  * 2. Read-Only Shared State: For broadcast data
  *    - One writer, multiple readers
@@ -0,0 +1,117 @@
+/**
+ * QARMA - Futures
+ *
+ * A future is a result that will exist later. Its producer settles it
+ * once: completed with a value, failed with a nonzero error code, or
+ * cancelled; later attempts return false and change nothing. Consumers
+ * wait on it or chain continuations onto it.
+ *
+ * future_then() runs its function on whichever processor settles the
+ * source, right after it does (immediately if the source is already
+ * settled), and completes the future it returned with the function's
+ * value. A failed or cancelled source skips the function and passes
+ * its state on. when_all completes once every source has completed
+ * and fails or cancels as soon as one of them does; when_any completes
+ * with the value of the first source to complete, and fails only when
+ * all have failed or been cancelled. Continuations must not block.
+ *
+ * future_wait() first runs queued parallel tasks, which may be the
+ * very ones it waits for. When this processor has none left and other
+ * processors run the engine, it parks on the future's wait queue until
+ * the future is settled.
+ *
+ * Futures are reference counted. future_create() and every function
+ * returning a future hand the caller one reference, to be dropped with
+ * future_put(). Settling requires holding a reference. Values are the
+ * producer's; the future only passes the pointer along.
+ *
+ * A cancel token is a flag shared by whoever might want to stop some
+ * work and the work itself. parallel_async() checks it before starting
+ * the function and passes it in, so long functions can check it too;
+ * a function that returns after cancellation cancels its future.
+ */
+
+#ifndef FUTURE_H
+#define FUTURE_H
+
+#include "parallel_engine.h"
+#include "core/spinlock.h"
+#include "core/atomic.h"
+#include "core/scheduler/wait_queue.h"
+
+typedef enum {
+    FUTURE_PENDING   = 0,
+    FUTURE_COMPLETED = 1,
+    FUTURE_FAILED    = 2,
+    FUTURE_CANCELLED = 3
+} future_state_t;
+
+struct future;
+
+// Run when a future settles; intrusive, so combinators allocate nothing extra
+typedef struct future_callback {
+    struct future_callback* next;
+    void (*fn)(struct future* source, struct future_callback* callback);
+} future_callback_t;
+
+typedef struct future {
+    volatile uint32_t state;            // future_state_t
+    volatile uint32_t refs;
+    void* value;                        // Valid once completed
+    int32_t error;                      // Valid once failed
+    spinlock_t lock;                    // Guards settling and the callback list
+    future_callback_t* callbacks;       // Most recently added first
+    wait_queue_t waiters;               // future_wait() callers that parked
+} future_t;
+
+typedef struct {
+    volatile uint32_t cancelled;
+} cancel_token_t;
+
+#define CANCEL_TOKEN_INIT { .cancelled = 0 }
+
+typedef void* (*future_then_fn_t)(void* value, void* arg);
+typedef void* (*parallel_async_fn_t)(void* arg, cancel_token_t* token);
+
+void future_init(void);
+
+// Lifetime
+future_t* future_create(void);
+future_t* future_get(future_t* future);
+void future_put(future_t* future);
+
+// Producer side; false if the future was already settled
+bool future_complete(future_t* future, void* value);
+bool future_fail(future_t* future, int32_t error);
+bool future_cancel(future_t* future);
+
+// Consumer side
+static inline future_state_t future_state(const future_t* future) {
+    return (future_state_t)atomic_load_u32(&future->state);
+}
+static inline bool future_is_settled(const future_t* future) {
+    return future_state(future) != FUTURE_PENDING;
+}
+bool future_wait(future_t* future, uint32_t timeout_ms);   // 0: no limit
+
+// Composition; NULL if out of memory
+void future_on_settled(future_t* future, future_callback_t* callback);
+future_t* future_then(future_t* source, future_then_fn_t fn, void* arg);
+future_t* future_when_all(future_t** sources, uint32_t count);
+future_t* future_when_any(future_t** sources, uint32_t count);
+
+// Run fn(arg, token) as a parallel task; token may be NULL
+future_t* parallel_async(const char* name, parallel_async_fn_t fn, void* arg,
+                         cancel_token_t* token);
+
+static inline void cancel_token_init(cancel_token_t* token) {
+    token->cancelled = 0;
+}
+static inline void cancel_token_cancel(cancel_token_t* token) {
+    atomic_store_u32(&token->cancelled, 1);
+}
+static inline bool cancel_requested(const cancel_token_t* token) {
+    return token && atomic_load_u32(&token->cancelled);
+}
+
+#endif // FUTURE_H
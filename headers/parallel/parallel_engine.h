@@ -77,10 +77,16 @@ typedef struct parallel_task {
     uint32_t assigned_core;             // Core assigned to run this task
     uint32_t preferred_numa_node;       // Preferred NUMA node
     
-    // Dependencies
+    // Dependencies (see parallel/task_graph.h)
     uint32_t* dependencies;             // Array of task IDs this task depends on
     uint32_t dependency_count;          // Number of dependencies
-    uint32_t completed_dependencies;    // Number of completed dependencies
+    volatile uint32_t completed_dependencies; // Number of completed dependencies
+    struct parallel_task** dependents;  // Tasks waiting on this one
+    uint32_t dependent_count;           // Number of dependents
+    struct parallel_graph* graph;       // Owning graph, NULL if standalone
+    
+    // Called on the executing core once the task is done with; may free it
+    void (*on_complete)(struct parallel_task* task, uint32_t core_id);
     
     // Execution tracking
     uint64_t start_time;                // Start execution time
@@ -93,13 +99,26 @@ typedef struct parallel_task {
     
 } parallel_task_t;
 
-// Work stealing queue (lock-free)
+// Backing array of a work-stealing deque; grown by the owner and never
+// freed while thieves might still be reading from it
+typedef struct work_queue_buffer {
+    uint32_t capacity;                  // Slot count (power of 2)
+    uint32_t mask;                      // capacity - 1
+    struct work_queue_buffer* retired;  // Previous (smaller) buffer
+    parallel_task_t* slots[];           // Circular task array
+} work_queue_buffer_t;
+
+// Chase-Lev work-stealing deque (lock-free)
+// The owning core pushes and pops at the bottom; any other core may steal
+// from the top. Indices grow monotonically and are compared as signed
+// differences, so wrap-around is harmless.
 typedef struct work_queue {
-    parallel_task_t** tasks;            // Array of task pointers
-    volatile uint32_t head;             // Head index (consumer end)
-    volatile uint32_t tail;             // Tail index (producer end)
-    uint32_t capacity;                  // Queue capacity
-    uint32_t mask;                      // Capacity mask for wrap-around
+    volatile uint32_t top;              // Steal end (CAS by thieves / last pop)
+    volatile uint32_t bottom;           // Owner end
+    work_queue_buffer_t* volatile buffer;
+    
+    // Remote submissions (multi-producer LIFO drained by the owner)
+    parallel_task_t* volatile inbox;
 } work_queue_t;
 
 // Per-core scheduler data
@@ -107,6 +126,7 @@ typedef struct core_scheduler {
     uint32_t core_id;                   // Core this scheduler belongs to
     work_queue_t local_queue;           // Local work queue
     parallel_task_t* current_task;      // Currently executing task
+    volatile bool ap_driven;            // Drained by its own processor, not the BSP tick
     
     // Statistics
     uint64_t tasks_executed;            // Total tasks executed
@@ -121,11 +141,11 @@ typedef struct {
     uint32_t total_cores;               // Total CPU cores
     uint32_t active_cores;              // Currently active cores
     uint32_t numa_nodes;                // Number of NUMA nodes
-    uint32_t total_tasks_created;       // Total tasks created
-    uint32_t total_tasks_completed;     // Total tasks completed
-    uint32_t tasks_in_flight;           // Currently executing tasks
-    uint64_t total_cpu_cycles;          // Total CPU cycles used
-    uint32_t work_stealing_events;      // Work stealing events
+    volatile uint32_t total_tasks_created;   // Total tasks created
+    volatile uint32_t total_tasks_completed; // Total tasks completed
+    volatile uint32_t tasks_in_flight;       // Currently executing tasks
+    uint64_t total_cpu_cycles;               // Total CPU cycles used
+    volatile uint32_t work_stealing_events;  // Work stealing events
 } parallel_engine_stats_t;
 
 // Function declarations
@@ -148,19 +168,32 @@ parallel_task_t* parallel_task_create(const char* name, void (*function)(void*),
 void parallel_task_destroy(parallel_task_t* task);
 void parallel_task_add_dependency(parallel_task_t* task, uint32_t dependency_id);
 void parallel_task_submit(parallel_task_t* task);
+void parallel_task_submit_on(parallel_task_t* task, uint32_t core_id);
 bool parallel_task_is_ready(parallel_task_t* task);
 
 // Scheduling and execution
 void parallel_engine_tick(void);
+void parallel_core_attach(uint32_t core_id);
+void parallel_core_loop(uint32_t core_id);
 void parallel_schedule_task(parallel_task_t* task);
 parallel_task_t* parallel_get_next_task(uint32_t core_id);
 void parallel_execute_task(parallel_task_t* task, uint32_t core_id);
+bool parallel_help(void);
+uint32_t parallel_current_core(void);
+uint32_t parallel_core_queue_size(uint32_t core_id);
+uint32_t parallel_worker_count(void);
+bool parallel_core_is_ap_driven(uint32_t core_id);
 
 // Work stealing
 parallel_task_t* work_stealing_attempt(uint32_t stealing_core, uint32_t victim_core);
-void work_queue_push(work_queue_t* queue, parallel_task_t* task);
-parallel_task_t* work_queue_pop(work_queue_t* queue);
-parallel_task_t* work_queue_steal(work_queue_t* queue);
+bool work_queue_init(work_queue_t* queue, uint32_t initial_capacity);
+void work_queue_destroy(work_queue_t* queue);                           // No thieves left
+void work_queue_push(work_queue_t* queue, parallel_task_t* task);      // Owner only
+parallel_task_t* work_queue_pop(work_queue_t* queue);                  // Owner only
+parallel_task_t* work_queue_steal(work_queue_t* queue);                // Any core
+void work_queue_post(work_queue_t* queue, parallel_task_t* task);      // Any core, via inbox
+uint32_t work_queue_drain_inbox(work_queue_t* queue);                  // Owner only
+uint32_t work_queue_size(work_queue_t* queue);
 
 // Load balancing
 void adaptive_load_balance(void);
@@ -185,7 +218,7 @@ void parallel_unregister_core_allocation(uint32_t core_id, uint32_t subsystem_id
 void parallel_update_core_affinity(parallel_task_t* task, uint32_t core_id);
 bool parallel_is_core_busy(uint32_t core_id);
 
-// Atomic operations for lock-free data structures
+// Atomic operations for lock-free data structures (see core/atomic.h)
 uint32_t atomic_compare_exchange(volatile uint32_t* ptr, uint32_t expected, uint32_t desired);
 uint32_t atomic_fetch_add(volatile uint32_t* ptr, uint32_t value);
 uint32_t atomic_load(volatile uint32_t* ptr);
@@ -0,0 +1,55 @@
+/**
+ * QARMA - Data-parallel loops
+ *
+ * parallel_for() runs fn over [begin, end) in sub-ranges spread across
+ * the parallel engine's cores. The caller works on the whole range
+ * itself and gives work away lazily: between chunks it checks its core's
+ * deque, and only when that is empty - nothing left there for an idle
+ * core to steal - splits off the upper half of what remains as a new
+ * task. Thieves taking a half split it again the same way, so a range is
+ * divided about as often as there are cores to take the pieces, and an
+ * idle machine pays for no splits at all. No range smaller than twice
+ * the grain is split.
+ *
+ * Chunks start at the grain and double while a chunk takes less than
+ * PARALLEL_LOOP_CHUNK_US, which bounds how often the deque is checked
+ * without delaying a split for long. Grain PARALLEL_GRAIN_AUTO splits
+ * down to about PARALLEL_LOOP_SPLITS_PER_WORKER pieces per worker.
+ *
+ * The caller returns once every sub-range has run. While it waits it
+ * runs queued tasks, its own split-off halves first, instead of spinning.
+ *
+ * parallel_reduce() folds each sub-range into an accumulator starting
+ * at identity, then merges the partial results with combine, in no fixed
+ * order: combine must be associative and commutative.
+ */
+
+#ifndef PARALLEL_LOOP_H
+#define PARALLEL_LOOP_H
+
+#include "parallel_engine.h"
+
+#define PARALLEL_GRAIN_AUTO                 0
+#define PARALLEL_LOOP_CHUNK_US              20
+#define PARALLEL_LOOP_SPLITS_PER_WORKER     8
+
+typedef void (*parallel_for_fn_t)(uint32_t begin, uint32_t end, void* ctx);
+typedef uint64_t (*parallel_reduce_fn_t)(uint32_t begin, uint32_t end, uint64_t acc, void* ctx);
+typedef uint64_t (*parallel_combine_fn_t)(uint64_t a, uint64_t b, void* ctx);
+
+typedef struct {
+    uint32_t loops;                     // parallel_for/parallel_reduce calls
+    volatile uint32_t splits;           // Ranges given away as tasks
+    volatile uint32_t chunks;           // Calls into loop bodies
+} parallel_loop_stats_t;
+
+void parallel_loop_init(void);
+
+void parallel_for(uint32_t begin, uint32_t end, uint32_t grain,
+                  parallel_for_fn_t fn, void* ctx);
+uint64_t parallel_reduce(uint32_t begin, uint32_t end, uint32_t grain, uint64_t identity,
+                         parallel_reduce_fn_t fn, parallel_combine_fn_t combine, void* ctx);
+
+parallel_loop_stats_t* parallel_loop_get_stats(void);
+
+#endif // PARALLEL_LOOP_H
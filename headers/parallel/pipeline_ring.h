@@ -0,0 +1,55 @@
+/**
+ * QARMA - Single-producer single-consumer ring
+ *
+ * Connects two pipeline stages running on different cores. One core only
+ * ever pushes and one core only ever pops, so neither side needs a lock
+ * or a locked instruction: the producer publishes items by advancing
+ * head after writing the slots, the consumer frees slots by advancing
+ * tail after reading them, and x86 keeps both sides' stores in order.
+ *
+ * Each side's index sits on its own cache line together with that
+ * side's copy of the other index, refreshed only when the copy says the
+ * ring is full (producer) or empty (consumer). A side working through a
+ * batch therefore touches the other side's line once per refresh rather
+ * than once per item.
+ *
+ * Push and pop move as many items as fit and return the count, so a
+ * full ring pushes back on the producer instead of dropping work.
+ */
+
+#ifndef PIPELINE_RING_H
+#define PIPELINE_RING_H
+
+#include "kernel_types.h"
+
+#define PIPELINE_CACHE_LINE     64
+
+typedef struct {
+    // Producer's line
+    volatile uint32_t head __attribute__((aligned(PIPELINE_CACHE_LINE)));
+    uint32_t tail_cache;                // Producer's view of tail
+    uint32_t full_stalls;               // Pushes that found no room at all
+
+    // Consumer's line
+    volatile uint32_t tail __attribute__((aligned(PIPELINE_CACHE_LINE)));
+    uint32_t head_cache;                // Consumer's view of head
+    uint32_t empty_stalls;              // Pops that found nothing at all
+
+    // Read-only after init
+    void** slots __attribute__((aligned(PIPELINE_CACHE_LINE)));
+    uint32_t mask;                      // Capacity - 1
+} pipeline_ring_t;
+
+// capacity must be a power of two; slots holds that many pointers
+bool pipeline_ring_init(pipeline_ring_t* ring, void** slots, uint32_t capacity);
+
+// Producer only
+uint32_t pipeline_ring_push(pipeline_ring_t* ring, void* const* items, uint32_t count);
+
+// Consumer only
+uint32_t pipeline_ring_pop(pipeline_ring_t* ring, void** items, uint32_t max);
+
+// Either side; a snapshot
+uint32_t pipeline_ring_count(const pipeline_ring_t* ring);
+
+#endif // PIPELINE_RING_H
@@ -0,0 +1,57 @@
+/**
+ * QARMA - Task Graphs
+ *
+ * A graph is a set of parallel tasks plus "runs before" edges between
+ * them. Launching it submits the tasks with no predecessors; every other
+ * task waits until its last predecessor completes. Each task counts its
+ * completed predecessors atomically (completed_dependencies against
+ * dependency_count), so the processor that finishes the last one, and
+ * only that processor, makes the successor ready. It pushes the successor
+ * onto its own core's deque: the successor most likely reads what its
+ * predecessor just wrote, which is still in that core's cache, and idle
+ * cores steal the rest.
+ *
+ * Nodes and edges are added before launch and a graph runs once. Its
+ * nodes belong to it: parallel_graph_destroy() frees them, so callers
+ * must not destroy or submit them on their own. A node may have no
+ * function, which makes it a join point for fan-in.
+ */
+
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+#include "parallel_engine.h"
+
+typedef struct parallel_graph {
+    char name[32];
+    parallel_task_t** nodes;            // Every node, in creation order
+    uint32_t node_count;
+    uint32_t edge_count;
+    bool launched;                      // Frozen: no more nodes or edges
+    volatile uint32_t remaining;        // Nodes not yet completed
+    volatile uint32_t done;             // Set once the last node completes
+    uint64_t start_cycles;              // Launch
+    uint64_t end_cycles;                // Last node completed
+} parallel_graph_t;
+
+parallel_graph_t* parallel_graph_create(const char* name);
+void parallel_graph_destroy(parallel_graph_t* graph);   // Not while running
+
+// Building
+parallel_task_t* parallel_graph_add_node(parallel_graph_t* graph, const char* name,
+                                         void (*function)(void*), void* data);
+bool parallel_graph_add_edge(parallel_graph_t* graph, parallel_task_t* before,
+                             parallel_task_t* after);
+
+// Running. launch fails on an empty or cyclic graph.
+bool parallel_graph_launch(parallel_graph_t* graph);
+bool parallel_graph_is_done(parallel_graph_t* graph);
+bool parallel_graph_wait(parallel_graph_t* graph, uint32_t timeout_ms);   // 0: no limit
+bool parallel_graph_run(parallel_graph_t* graph, uint32_t timeout_ms);    // launch + wait
+
+// Completion hook of every graph node
+void parallel_graph_task_done(parallel_task_t* task, uint32_t core_id);
+
+void parallel_graph_print(parallel_graph_t* graph);
+
+#endif // TASK_GRAPH_H
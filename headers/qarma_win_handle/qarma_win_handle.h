@@ -42,7 +42,8 @@ typedef enum {
     QARMA_FLAG_VISIBLE      = 1 << 0,
     QARMA_FLAG_FADE_OUT     = 1 << 1,
     QARMA_FLAG_TOPMOST      = 1 << 2,
-    QARMA_FLAG_INTERACTIVE  = 1 << 3
+    QARMA_FLAG_INTERACTIVE  = 1 << 3,
+    QARMA_FLAG_OPAQUE       = 1 << 4    // Buffer fully covers the window; hides what is below
 } QARMA_WIN_FLAGS;
 
 typedef struct {
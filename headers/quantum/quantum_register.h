@@ -10,6 +10,8 @@
 #define QUANTUM_REGISTER_H
 
 #include "kernel_types.h"
+#include "core/spinlock.h"
+#include "parallel/future.h"
 
 // Forward declarations
 typedef struct QARMA_QUBIT QARMA_QUBIT;
@@ -94,8 +96,8 @@ struct QARMA_QUBIT {
     size_t result_size;              // Size of result data
     
     // Timing (for performance analysis)
-    uint64_t start_time;             // When execution started
-    uint64_t end_time;               // When execution completed
+    uint64_t start_time;             // When execution started (ktime ns)
+    uint64_t end_time;               // When execution completed (ktime ns)
     
     // Core assignment (set by scheduler)
     uint32_t assigned_core;          // Which CPU core executed this
@@ -144,12 +146,13 @@ struct QARMA_QUANTUM_REGISTER {
     bool wait_for_all;               // Wait for all qubits before collapse
     
     // Statistics
-    uint64_t total_execution_time;   // Total time for all qubits
-    uint64_t collapse_time;          // Time spent collapsing
+    uint64_t total_execution_time;   // Total time for all qubits (ns)
+    uint64_t collapse_time;          // Time spent collapsing (ns)
     
     // Synchronization
     volatile bool executing;         // Currently executing
-    uint32_t lock;                   // Spinlock for thread safety
+    spinlock_t lock;                 // Guards starting an execution
+    future_t* completion;            // Settled with the register by the last qubit
     
     // Adaptive execution (opaque pointer to avoid circular dependency)
     void* adaptive_state;            // Adaptive execution state
@@ -290,6 +293,14 @@ bool qarma_quantum_is_complete(QARMA_QUANTUM_REGISTER* reg);
  */
 bool qarma_quantum_wait(QARMA_QUANTUM_REGISTER* reg, uint32_t timeout_ms);
 
+/**
+ * Future for the latest execution, completed with the register once
+ * every enabled qubit has finished; chain collapse steps onto it
+ * @param reg Register to watch
+ * @return New reference (drop with future_put), NULL if never executed
+ */
+future_t* qarma_quantum_future(QARMA_QUANTUM_REGISTER* reg);
+
 // ============================================================================
 // Result Collapse API
 // ============================================================================
@@ -0,0 +1,234 @@
+/**
+ * QARMA - ACPI Table Discovery
+ *
+ * Finds the RSDP in the EBDA / BIOS area, walks the RSDT (or XSDT when
+ * it is reachable from 32-bit mode) and parses the MADT into a flat
+ * description of local APICs, I/O APICs and ISA overrides.
+ */
+
+#include "acpi.h"
+#include "core/kernel.h"
+#include "core/string.h"
+#include "core/memory/vmm/vmm.h"
+#include "config.h"
+
+static acpi_rsdp_t* g_rsdp = NULL;
+static acpi_sdt_header_t* g_rsdt = NULL;
+static bool g_use_xsdt = false;
+static acpi_madt_info_t g_madt = {0};
+static bool g_acpi_initialized = false;
+
+/**
+ * Identity-map a physical range so table contents can be read once
+ * paging is on (firmware places tables near the top of RAM, well above
+ * the boot identity map).
+ */
+static void acpi_map_range(uint32_t phys, uint32_t length) {
+    if (!vmm_is_initialized() || length == 0) return;
+
+    uint32_t page = phys & ~0xFFFu;
+    uint32_t end = phys + length;
+    while (page < end) {
+        if (vmm_get_physical_address(page) != page) {
+            vmm_map_page(page, page, PAGE_WRITE);
+        }
+        if (page + 0x1000 < page) break;  // Wrapped past 4 GB
+        page += 0x1000;
+    }
+}
+
+static bool acpi_checksum_ok(const void* data, uint32_t length) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint8_t sum = 0;
+    for (uint32_t i = 0; i < length; i++) {
+        sum += bytes[i];
+    }
+    return sum == 0;
+}
+
+static acpi_rsdp_t* acpi_scan_rsdp(uint32_t start, uint32_t length) {
+    for (uint32_t addr = start; addr + sizeof(acpi_rsdp_t) <= start + length; addr += 16) {
+        acpi_rsdp_t* rsdp = (acpi_rsdp_t*)addr;
+        if (memcmp(rsdp->signature, "RSD PTR ", 8) == 0 &&
+            acpi_checksum_ok(rsdp, 20)) {
+            return rsdp;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Locate the RSDP: first KB of the EBDA, then the BIOS ROM area
+ */
+static acpi_rsdp_t* acpi_find_rsdp(void) {
+    uint32_t ebda = ((uint32_t)(*(volatile uint16_t*)0x40E)) << 4;
+    if (ebda >= 0x80000 && ebda < 0xA0000) {
+        acpi_rsdp_t* rsdp = acpi_scan_rsdp(ebda, 1024);
+        if (rsdp) return rsdp;
+    }
+    return acpi_scan_rsdp(0xE0000, 0x20000);
+}
+
+static acpi_sdt_header_t* acpi_map_table(uint32_t phys) {
+    if (phys == 0) return NULL;
+
+    acpi_map_range(phys, sizeof(acpi_sdt_header_t));
+    acpi_sdt_header_t* header = (acpi_sdt_header_t*)phys;
+    acpi_map_range(phys, header->length);
+
+    if (!acpi_checksum_ok(header, header->length)) {
+        SERIAL_LOG("ACPI: table checksum mismatch\n");
+        return NULL;
+    }
+    return header;
+}
+
+/**
+ * Find a System Description Table by its 4-character signature
+ */
+acpi_sdt_header_t* acpi_find_table(const char* signature) {
+    if (!g_rsdt) return NULL;
+
+    uint32_t entry_size = g_use_xsdt ? 8 : 4;
+    uint32_t entries = (g_rsdt->length - sizeof(acpi_sdt_header_t)) / entry_size;
+    uint8_t* base = (uint8_t*)g_rsdt + sizeof(acpi_sdt_header_t);
+
+    for (uint32_t i = 0; i < entries; i++) {
+        uint32_t phys;
+        if (g_use_xsdt) {
+            uint64_t addr64 = *(uint64_t*)(base + i * 8);
+            if (addr64 >> 32) continue;  // Not reachable without PAE
+            phys = (uint32_t)addr64;
+        } else {
+            phys = *(uint32_t*)(base + i * 4);
+        }
+
+        acpi_map_range(phys, sizeof(acpi_sdt_header_t));
+        acpi_sdt_header_t* header = (acpi_sdt_header_t*)phys;
+        if (memcmp(header->signature, signature, 4) == 0) {
+            return acpi_map_table(phys);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Parse the MADT into g_madt
+ */
+static void acpi_parse_madt(acpi_sdt_header_t* madt) {
+    uint8_t* ptr = (uint8_t*)madt + sizeof(acpi_sdt_header_t);
+    uint8_t* end = (uint8_t*)madt + madt->length;
+
+    g_madt.lapic_address = *(uint32_t*)ptr;
+    g_madt.has_legacy_pics = (*(uint32_t*)(ptr + 4) & 0x1) != 0;
+    ptr += 8;
+
+    while (ptr + 2 <= end) {
+        uint8_t type = ptr[0];
+        uint8_t length = ptr[1];
+        if (length < 2 || ptr + length > end) break;
+
+        switch (type) {
+            case MADT_ENTRY_LAPIC: {
+                uint32_t flags = *(uint32_t*)(ptr + 4);
+                if (g_madt.lapic_count < ACPI_MAX_LAPICS &&
+                    (flags & (MADT_LAPIC_ENABLED | MADT_LAPIC_ONLINE_CAPABLE))) {
+                    acpi_lapic_t* lapic = &g_madt.lapics[g_madt.lapic_count++];
+                    lapic->acpi_processor_id = ptr[2];
+                    lapic->apic_id = ptr[3];
+                    lapic->enabled = (flags & MADT_LAPIC_ENABLED) != 0;
+                }
+                break;
+            }
+            case MADT_ENTRY_IOAPIC:
+                if (g_madt.ioapic_count < ACPI_MAX_IOAPICS) {
+                    acpi_ioapic_t* ioapic = &g_madt.ioapics[g_madt.ioapic_count++];
+                    ioapic->id = ptr[2];
+                    ioapic->address = *(uint32_t*)(ptr + 4);
+                    ioapic->gsi_base = *(uint32_t*)(ptr + 8);
+                }
+                break;
+            case MADT_ENTRY_ISO:
+                if (g_madt.override_count < ACPI_MAX_OVERRIDES) {
+                    acpi_irq_override_t* iso = &g_madt.overrides[g_madt.override_count++];
+                    iso->source_irq = ptr[3];
+                    iso->gsi = *(uint32_t*)(ptr + 4);
+                    iso->flags = *(uint16_t*)(ptr + 8);
+                }
+                break;
+            case MADT_ENTRY_LAPIC_OVERRIDE: {
+                uint64_t addr64 = *(uint64_t*)(ptr + 4);
+                if ((addr64 >> 32) == 0) {
+                    g_madt.lapic_address = (uint32_t)addr64;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        ptr += length;
+    }
+
+    g_madt.present = true;
+}
+
+/**
+ * Initialize ACPI table discovery
+ */
+bool acpi_init(void) {
+    if (g_acpi_initialized) return g_madt.present;
+    g_acpi_initialized = true;
+
+    g_rsdp = acpi_find_rsdp();
+    if (!g_rsdp) {
+        SERIAL_LOG("ACPI: RSDP not found\n");
+        return false;
+    }
+    SERIAL_LOG_HEX("ACPI: RSDP at ", (uint32_t)g_rsdp);
+
+    if (g_rsdp->revision >= 2 && g_rsdp->xsdt_address &&
+        (g_rsdp->xsdt_address >> 32) == 0) {
+        g_rsdt = acpi_map_table((uint32_t)g_rsdp->xsdt_address);
+        g_use_xsdt = (g_rsdt != NULL);
+    }
+    if (!g_rsdt) {
+        g_rsdt = acpi_map_table(g_rsdp->rsdt_address);
+        g_use_xsdt = false;
+    }
+    if (!g_rsdt) {
+        SERIAL_LOG("ACPI: no usable RSDT/XSDT\n");
+        return false;
+    }
+
+    acpi_sdt_header_t* madt = acpi_find_table("APIC");
+    if (!madt) {
+        SERIAL_LOG("ACPI: MADT not found\n");
+        return false;
+    }
+
+    acpi_parse_madt(madt);
+
+    SERIAL_LOG_HEX("ACPI: LAPIC base ", g_madt.lapic_address);
+    SERIAL_LOG_DEC("ACPI: local APICs ", g_madt.lapic_count);
+    SERIAL_LOG_DEC("ACPI: I/O APICs ", g_madt.ioapic_count);
+    return true;
+}
+
+/**
+ * Get parsed MADT information
+ */
+const acpi_madt_info_t* acpi_get_madt_info(void) {
+    return &g_madt;
+}
+
+/**
+ * Translate an ISA IRQ to a global system interrupt using the overrides
+ */
+uint32_t acpi_irq_to_gsi(uint8_t irq) {
+    for (uint32_t i = 0; i < g_madt.override_count; i++) {
+        if (g_madt.overrides[i].source_irq == irq) {
+            return g_madt.overrides[i].gsi;
+        }
+    }
+    return irq;
+}
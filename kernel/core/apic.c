@@ -0,0 +1,297 @@
+/**
+ * QARMA - Local APIC / I/O APIC Driver
+ *
+ * The legacy 8259 PICs stay in charge of device IRQs for now; the I/O
+ * APICs are discovered and left fully masked so routing can be moved
+ * over one line at a time with ioapic_set_redirect().
+ */
+
+#include "apic.h"
+#include "acpi.h"
+#include "core/kernel.h"
+#include "core/timer.h"
+#include "core/memory/vmm/vmm.h"
+#include "config.h"
+
+// PWT | PCD: APIC registers must never be cached
+#define APIC_PAGE_FLAGS (PAGE_WRITE | 0x18)
+
+static volatile uint32_t* g_lapic = NULL;
+static uint32_t g_lapic_timer_khz = 0;      // Timer counts per ms at divide-by-16
+static bool g_lapic_tsc_deadline = false;
+
+typedef struct {
+    volatile uint32_t* base;
+    uint32_t gsi_base;
+    uint32_t redirections;
+    uint8_t id;
+} ioapic_state_t;
+
+static ioapic_state_t g_ioapics[ACPI_MAX_IOAPICS];
+static uint32_t g_ioapic_count = 0;
+
+static void apic_map_mmio(uint32_t phys) {
+    if (vmm_is_initialized() && vmm_get_physical_address(phys) != phys) {
+        vmm_map_page(phys, phys, APIC_PAGE_FLAGS);
+    }
+}
+
+static inline uint64_t apic_read_msr(uint32_t msr) {
+    uint32_t lo, hi;
+    __asm__ volatile("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void apic_write_msr(uint32_t msr, uint64_t value) {
+    __asm__ volatile("wrmsr" :: "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
+
+uint32_t lapic_read(uint32_t reg) {
+    return g_lapic[reg / 4];
+}
+
+void lapic_write(uint32_t reg, uint32_t value) {
+    g_lapic[reg / 4] = value;
+    (void)g_lapic[LAPIC_REG_ID / 4];  // Serialize the posted write
+}
+
+/**
+ * Map the local APIC. phys_base comes from the MADT; 0 falls back to
+ * IA32_APIC_BASE.
+ */
+bool lapic_init(uint32_t phys_base) {
+    uint32_t eax, ebx, ecx, edx;
+    __asm__ volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+    if (!(edx & (1 << 9))) {
+        SERIAL_LOG("APIC: CPU has no local APIC\n");
+        return false;
+    }
+
+    if (phys_base == 0) {
+        phys_base = (uint32_t)(apic_read_msr(IA32_APIC_BASE_MSR) & 0xFFFFF000u);
+        if (phys_base == 0) phys_base = LAPIC_DEFAULT_BASE;
+    }
+
+    apic_map_mmio(phys_base);
+    g_lapic = (volatile uint32_t*)phys_base;
+
+    SERIAL_LOG_HEX("APIC: local APIC mapped at ", phys_base);
+    lapic_enable();
+    return true;
+}
+
+/**
+ * Software-enable the calling CPU's local APIC
+ */
+void lapic_enable(void) {
+    if (!g_lapic) return;
+
+    lapic_write(LAPIC_REG_TPR, 0);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_LVT_ERROR, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+
+    // Clear any stale errors (ESR needs a write before it can be read)
+    lapic_write(LAPIC_REG_ESR, 0);
+    (void)lapic_read(LAPIC_REG_ESR);
+}
+
+bool lapic_is_available(void) {
+    return g_lapic != NULL;
+}
+
+uint8_t lapic_get_id(void) {
+    if (!g_lapic) return 0;
+    return (uint8_t)(lapic_read(LAPIC_REG_ID) >> 24);
+}
+
+void lapic_eoi(void) {
+    if (g_lapic) lapic_write(LAPIC_REG_EOI, 0);
+}
+
+/**
+ * Wait for the previous IPI to be accepted (~100 ms upper bound)
+ */
+bool lapic_wait_icr_idle(void) {
+    for (uint32_t i = 0; i < 1000; i++) {
+        if (!(lapic_read(LAPIC_REG_ICR_LOW) & LAPIC_ICR_PENDING)) {
+            return true;
+        }
+        timer_udelay(100);
+    }
+    SERIAL_LOG("APIC: IPI delivery timed out\n");
+    return false;
+}
+
+static void lapic_send_icr(uint8_t apic_id, uint32_t low) {
+    lapic_write(LAPIC_REG_ESR, 0);
+    lapic_write(LAPIC_REG_ICR_HIGH, (uint32_t)apic_id << 24);
+    lapic_write(LAPIC_REG_ICR_LOW, low);
+    lapic_wait_icr_idle();
+}
+
+void lapic_send_init(uint8_t apic_id) {
+    if (!g_lapic) return;
+    lapic_send_icr(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_LEVEL_ASSERT | LAPIC_ICR_TRIGGER_LEVEL);
+    timer_udelay(200);
+    lapic_send_icr(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_TRIGGER_LEVEL);
+}
+
+void lapic_send_startup(uint8_t apic_id, uint8_t vector) {
+    if (!g_lapic) return;
+    lapic_send_icr(apic_id, LAPIC_ICR_STARTUP | vector);
+}
+
+void lapic_send_ipi(uint8_t apic_id, uint8_t vector) {
+    if (!g_lapic) return;
+    lapic_send_icr(apic_id, LAPIC_ICR_FIXED | LAPIC_ICR_LEVEL_ASSERT | vector);
+}
+
+/**
+ * Measure the local APIC timer rate against a 10 ms PIT channel 2 delay
+ * (best of three) and check for TSC-deadline mode. BSP only: every CPU's
+ * timer runs off the same bus clock.
+ */
+bool lapic_timer_calibrate(void) {
+    if (!g_lapic) return false;
+
+    uint32_t eax, ebx, ecx, edx;
+    __asm__ volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+    g_lapic_tsc_deadline = (ecx & (1 << 24)) != 0;
+
+    uint32_t best = 0;
+    lapic_write(LAPIC_REG_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_VECTOR);
+    for (int run = 0; run < 3; run++) {
+        lapic_write(LAPIC_REG_TIMER_INIT, 0xFFFFFFFFu);
+        timer_udelay(10000);
+        uint32_t elapsed = 0xFFFFFFFFu - lapic_read(LAPIC_REG_TIMER_CURRENT);
+        // The delay only overshoots, so the smallest count is the closest
+        if (best == 0 || elapsed < best) best = elapsed;
+    }
+    lapic_write(LAPIC_REG_TIMER_INIT, 0);
+
+    g_lapic_timer_khz = best / 10;
+    SERIAL_LOG_DEC("APIC: timer kHz ", g_lapic_timer_khz);
+    SERIAL_LOG(g_lapic_tsc_deadline ? "APIC: TSC-deadline mode\n" : "APIC: one-shot mode\n");
+    return g_lapic_timer_khz != 0;
+}
+
+uint32_t lapic_timer_khz(void) {
+    return g_lapic_timer_khz;
+}
+
+bool lapic_timer_has_tsc_deadline(void) {
+    return g_lapic_tsc_deadline;
+}
+
+/**
+ * Point the calling CPU's timer at LAPIC_TIMER_VECTOR, stopped
+ */
+void lapic_timer_setup(void) {
+    if (!g_lapic || !g_lapic_timer_khz) return;
+
+    lapic_write(LAPIC_REG_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_TIMER_VECTOR |
+                (g_lapic_tsc_deadline ? LAPIC_TIMER_TSC_DEADLINE : LAPIC_TIMER_ONESHOT));
+    lapic_timer_stop();
+}
+
+void lapic_timer_oneshot(uint32_t count) {
+    lapic_write(LAPIC_REG_TIMER_INIT, count ? count : 1);
+}
+
+void lapic_timer_deadline(uint64_t tsc) {
+    apic_write_msr(IA32_TSC_DEADLINE_MSR, tsc ? tsc : 1);
+}
+
+void lapic_timer_stop(void) {
+    if (g_lapic_tsc_deadline) {
+        apic_write_msr(IA32_TSC_DEADLINE_MSR, 0);
+    } else {
+        lapic_write(LAPIC_REG_TIMER_INIT, 0);
+    }
+}
+
+static uint32_t ioapic_read(ioapic_state_t* io, uint32_t reg) {
+    io->base[0] = reg;
+    return io->base[4];
+}
+
+static void ioapic_write(ioapic_state_t* io, uint32_t reg, uint32_t value) {
+    io->base[0] = reg;
+    io->base[4] = value;
+}
+
+/**
+ * Map every MADT I/O APIC and mask all of its redirection entries
+ */
+void ioapic_init(void) {
+    const acpi_madt_info_t* madt = acpi_get_madt_info();
+    g_ioapic_count = 0;
+
+    for (uint32_t i = 0; i < madt->ioapic_count && i < ACPI_MAX_IOAPICS; i++) {
+        ioapic_state_t* io = &g_ioapics[g_ioapic_count];
+        apic_map_mmio(madt->ioapics[i].address);
+
+        io->base = (volatile uint32_t*)madt->ioapics[i].address;
+        io->id = madt->ioapics[i].id;
+        io->gsi_base = madt->ioapics[i].gsi_base;
+        io->redirections = ((ioapic_read(io, IOAPIC_REG_VERSION) >> 16) & 0xFF) + 1;
+
+        for (uint32_t pin = 0; pin < io->redirections; pin++) {
+            ioapic_write(io, IOAPIC_REG_REDTBL + pin * 2, IOAPIC_REDIR_MASKED);
+            ioapic_write(io, IOAPIC_REG_REDTBL + pin * 2 + 1, 0);
+        }
+
+        SERIAL_LOG_HEX("APIC: I/O APIC at ", madt->ioapics[i].address);
+        SERIAL_LOG_DEC("APIC:   redirection entries ", io->redirections);
+        g_ioapic_count++;
+    }
+}
+
+uint32_t ioapic_count(void) {
+    return g_ioapic_count;
+}
+
+uint32_t ioapic_max_redirections(uint32_t index) {
+    if (index >= g_ioapic_count) return 0;
+    return g_ioapics[index].redirections;
+}
+
+static ioapic_state_t* ioapic_for_gsi(uint32_t gsi) {
+    for (uint32_t i = 0; i < g_ioapic_count; i++) {
+        ioapic_state_t* io = &g_ioapics[i];
+        if (gsi >= io->gsi_base && gsi < io->gsi_base + io->redirections) {
+            return io;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Program a redirection entry. flags carries the MPS INTI polarity and
+ * trigger bits from the MADT override (0 = bus default).
+ */
+void ioapic_set_redirect(uint32_t gsi, uint8_t vector, uint8_t dest_apic_id, uint16_t flags, bool masked) {
+    ioapic_state_t* io = ioapic_for_gsi(gsi);
+    if (!io) return;
+
+    uint32_t pin = gsi - io->gsi_base;
+    uint32_t low = vector;
+    if ((flags & 0x3) == 0x3) low |= (1 << 13);  // Active low
+    if ((flags & 0xC) == 0xC) low |= (1 << 15);  // Level triggered
+    if (masked) low |= IOAPIC_REDIR_MASKED;
+
+    ioapic_write(io, IOAPIC_REG_REDTBL + pin * 2 + 1, (uint32_t)dest_apic_id << 24);
+    ioapic_write(io, IOAPIC_REG_REDTBL + pin * 2, low);
+}
+
+void ioapic_mask_gsi(uint32_t gsi) {
+    ioapic_state_t* io = ioapic_for_gsi(gsi);
+    if (!io) return;
+
+    uint32_t pin = gsi - io->gsi_base;
+    uint32_t low = ioapic_read(io, IOAPIC_REG_REDTBL + pin * 2);
+    ioapic_write(io, IOAPIC_REG_REDTBL + pin * 2, low | IOAPIC_REDIR_MASKED);
+}
@@ -8,6 +8,8 @@
 #include "qarma_win_handle/qarma_win_factory.h"
 #include "qarma_win_handle/qarma_window_manager.h"
 #include "core/memory.h"
+#include "gui/renderer.h"
+#include "core/scheduler/fiber.h"
 
 static uint32_t elapsed_seconds = 0;
 static bool clock_initialized = false;
@@ -17,6 +19,7 @@ static const uint32_t clock_x = 700;
 static const uint32_t clock_y = 10;
 static const uint32_t clock_width = 80;
 static const uint32_t clock_height = 20;
+#define CLOCK_SHADOW_OFFSET 4
 
 //static const rgb_color_t clock_bg = {0, 0, 0, 128};
 static const uint32_t clock_bg_color = 0xFF008000; 
@@ -103,6 +106,22 @@ void clock_tick(void) {
 
 }
 
+// Redraws the clock once a second from the BSP's fiber executor
+static int clock_fiber(fiber_t* fiber, void* arg) {
+    (void)arg;
+    FIBER_BEGIN(fiber);
+    for (;;) {
+        FIBER_SLEEP(fiber, 1000);
+        elapsed_seconds++;
+        draw_clock();
+    }
+    FIBER_END(fiber);
+}
+
+void clock_start(void) {
+    fiber_spawn_poll_on(0, "clock", clock_fiber, NULL);
+}
+
 void reset_clock(void) {
     elapsed_seconds = 0;
     if (clock_initialized) draw_clock();
@@ -134,8 +153,8 @@ QARMA_WIN_HANDLE* clock_overlay_init(void) {
     win->title = "Clock Overlay";
     win->x = clock_x;
     win->y = clock_y;
-    win->size.width = clock_width;
-    win->size.height = clock_height;
+    win->size.width = clock_width + CLOCK_SHADOW_OFFSET;   // Room for the drop shadow
+    win->size.height = clock_height + CLOCK_SHADOW_OFFSET;
     win->background = (QARMA_COLOR){0, 0, 0, 128};
     win->vtable = &clock_overlay_vtable;
 
@@ -180,26 +199,30 @@ rgb_color_t qarma_to_rgb(QARMA_COLOR qc) {
 
 void clock_overlay_render(QARMA_WIN_HANDLE* self) {
     CLOCK_OVERLAY_TRAIT* trait = (CLOCK_OVERLAY_TRAIT*) self->traits;
+    int stride = self->size.width;
+
+    // Draw into the window buffer; the compositor blends it over what is below
+    memset(self->pixel_buffer, 0, stride * self->size.height * sizeof(uint32_t));
     if (!trait->visible) return;
 
     QARMA_COLOR shadow = {32, 32, 32, 128};
     QARMA_COLOR bg = {0, 128, 0, 192};
-    // QARMA_COLOR border = {64, 64, 64, 255};
-    // QARMA_COLOR fg = {192, 255, 192, 255};
+    QARMA_DIMENSION box = { clock_width, clock_height };
 
-    fb_draw_rect_alpha(self->x + 4, self->y + 4, self->size.width, self->size.height, shadow);
-    fb_draw_rect_alpha(self->x, self->y, self->size.width, self->size.height, bg);
-    fb_draw_rect_outline(self->x, self->y, self->size.width, self->size.height, 0x404040);
+    fb_draw_rect_to_buffer(self->pixel_buffer, self->size, CLOCK_SHADOW_OFFSET, CLOCK_SHADOW_OFFSET, box, shadow);
+    fb_draw_rect_to_buffer(self->pixel_buffer, self->size, 0, 0, box, bg);
+    draw_rect_border(self->pixel_buffer, stride, 0, 0, clock_width, clock_height, 0xFF404040, 1);
 
     char time_str[9];
     format_time(time_str, trait->elapsed_seconds);
 
-    fb_draw_text_with_bg(self->x + 10, self->y + 6, time_str, qarma_to_rgb((QARMA_COLOR){192, 255, 192, 255}), qarma_to_rgb((QARMA_COLOR){0, 0, 0, 0}));
+    // Pale green-white, packed like QARMA_COLOR (R in the low byte)
+    draw_string_to_buffer(self->pixel_buffer, stride, 10, 6, time_str, 0xFFC0FFC0);
 }
 
 void clock_overlay_destroy(QARMA_WIN_HANDLE* self) {
+    fb_damage_rect(self->x, self->y, self->size.width, self->size.height);
     if (self->traits) free(self->traits);
     free(self);
-    fb_mark_dirty();
 }
 
@@ -0,0 +1,230 @@
+/**
+ * QARMA - Lazy FPU/SSE state
+ *
+ * Per CPU, 'owner' is the context whose state sits in the FPU registers
+ * and 'current' the context of the task running there. CR0.TS is clear
+ * only while owner == current, so TS clear at switch-out means the
+ * outgoing task used the FPU in its slice and its registers must be saved.
+ */
+
+#include "fpu.h"
+#include "smp.h"
+#include "core/atomic.h"
+#include "core/kernel.h"
+#include "core/memory/object_cache.h"
+#include "config.h"
+
+#define CPUID_EDX_FPU           (1u << 0)
+#define CPUID_EDX_FXSR          (1u << 24)
+#define CPUID_EDX_SSE           (1u << 25)
+#define CR0_MP                  (1u << 1)
+#define CR0_EM                  (1u << 2)
+#define CR0_TS                  (1u << 3)
+#define CR0_NE                  (1u << 5)
+#define CR4_OSFXSR              (1u << 9)
+#define CR4_OSXMMEXCPT          (1u << 10)
+
+// FXSAVE image offsets
+#define FXSAVE_FCW              0
+#define FXSAVE_MXCSR            24
+
+typedef struct {
+    fpu_context_t* owner;
+    fpu_context_t* current;
+    fpu_stats_t stats;
+} __attribute__((aligned(64))) fpu_cpu_t;
+
+static fpu_cpu_t g_fpu_cpus[SMP_MAX_CPUS];
+static object_cache_t* g_fpu_cache = NULL;
+static fpu_state_t g_fpu_init_state;    // What FNINIT leaves, with SSE defaults
+static bool g_fpu_lazy = false;         // FXSR present and CR4.OSFXSR set
+static bool g_fpu_sse = false;
+
+static inline uint32_t fpu_read_cr0(void) {
+    uint32_t cr0;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(cr0));
+    return cr0;
+}
+
+static inline void fpu_set_ts(void) {
+    __asm__ volatile("mov %%cr0, %%eax; orl %0, %%eax; mov %%eax, %%cr0"
+                     :: "i"(CR0_TS) : "eax", "memory");
+}
+
+static inline void fpu_clear_ts(void) {
+    __asm__ volatile("clts" ::: "memory");
+}
+
+static inline void fpu_fxsave(fpu_state_t* state) {
+    __asm__ volatile("fxsave (%0)" :: "r"(state) : "memory");
+}
+
+static inline void fpu_fxrstor(const fpu_state_t* state) {
+    __asm__ volatile("fxrstor (%0)" :: "r"(state) : "memory");
+}
+
+/**
+ * Enable the FPU, and SSE with FXSAVE when the CPU has them. The first
+ * CPU through decides whether state is switched lazily.
+ */
+void fpu_init_cpu(void) {
+    uint32_t eax, ebx, ecx, edx;
+    __asm__ volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+    if (!(edx & CPUID_EDX_FPU)) {
+        return;
+    }
+
+    uint32_t cr0 = fpu_read_cr0();
+    cr0 = (cr0 & ~(CR0_EM | CR0_TS)) | CR0_MP | CR0_NE;
+    __asm__ volatile("mov %0, %%cr0" :: "r"(cr0));
+
+    bool fxsr = (edx & CPUID_EDX_FXSR) != 0;
+    if (fxsr) {
+        uint32_t cr4;
+        __asm__ volatile("mov %%cr4, %0" : "=r"(cr4));
+        cr4 |= CR4_OSFXSR;
+        if (edx & CPUID_EDX_SSE) {
+            cr4 |= CR4_OSXMMEXCPT;
+        }
+        __asm__ volatile("mov %0, %%cr4" :: "r"(cr4));
+    }
+    __asm__ volatile("fninit");
+
+    if (fxsr && !g_fpu_lazy) {
+        uint8_t* image = g_fpu_init_state.data;
+        *(uint16_t*)(image + FXSAVE_FCW) = FPU_DEFAULT_FCW;
+        *(uint32_t*)(image + FXSAVE_MXCSR) = FPU_DEFAULT_MXCSR;
+        g_fpu_sse = (edx & CPUID_EDX_SSE) != 0;
+        g_fpu_lazy = true;
+    }
+}
+
+void fpu_init(void) {
+    if (!g_fpu_lazy || g_fpu_cache) {
+        return;
+    }
+    g_fpu_cache = object_cache_create("fpu_state", sizeof(fpu_state_t), 16, NULL);
+    if (!g_fpu_cache) {
+        SERIAL_LOG("FPU: no save-area cache, FPU state stays shared\n");
+        g_fpu_lazy = false;
+    }
+}
+
+bool fpu_sse_enabled(void) {
+    return g_fpu_sse;
+}
+
+void fpu_context_init(fpu_context_t* ctx) {
+    ctx->state = NULL;
+    ctx->last_cpu = SMP_MAX_CPUS;
+}
+
+/**
+ * Forget a dead task's state. Its registers may still be loaded on some
+ * CPU, which must not hand them to a new context at the same address.
+ */
+void fpu_context_release(fpu_context_t* ctx) {
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        atomic_cmpxchg_ptr((void* volatile*)&g_fpu_cpus[cpu].owner, ctx, NULL);
+    }
+    if (ctx->state) {
+        object_cache_free(g_fpu_cache, ctx->state);
+        ctx->state = NULL;
+    }
+}
+
+/**
+ * Save the outgoing task's state if it used the FPU, then arm the trap
+ * unless the incoming task's registers are still loaded here
+ */
+void fpu_switch(uint32_t cpu, fpu_context_t* next) {
+    if (!g_fpu_lazy || cpu >= SMP_MAX_CPUS) {
+        return;
+    }
+    fpu_cpu_t* c = &g_fpu_cpus[cpu];
+    bool ts = (fpu_read_cr0() & CR0_TS) != 0;
+
+    if (!ts && c->owner && c->owner == c->current) {
+        fpu_fxsave(c->owner->state);
+        c->stats.saves++;
+    }
+    c->current = next;
+
+    if (next && c->owner == next && next->last_cpu == cpu) {
+        if (ts) {
+            fpu_clear_ts();
+        }
+        c->stats.fast_resumes++;
+    } else if (!ts) {
+        fpu_set_ts();
+    }
+}
+
+/**
+ * #NM: the running task touched the FPU with TS set. Load its state,
+ * giving it a fresh one on first use. Other owners were saved when they
+ * were switched out, so their registers can simply be overwritten.
+ */
+void fpu_device_not_available(void) {
+    uint32_t cpu = smp_current_cpu();
+    fpu_cpu_t* c = &g_fpu_cpus[cpu];
+    fpu_context_t* ctx = c->current;
+
+    fpu_clear_ts();
+    c->stats.traps++;
+    if (!ctx || (c->owner == ctx && ctx->last_cpu == cpu)) {
+        return;
+    }
+
+    if (!ctx->state) {
+        ctx->state = g_fpu_cache ? object_cache_alloc(g_fpu_cache) : NULL;
+        if (!ctx->state) {
+            kernel_panic("FPU: out of memory for task FPU state");
+        }
+        // Not a struct copy: memcpy's SSE path would re-arm TS under us
+        fpu_fxrstor(&g_fpu_init_state);
+        fpu_fxsave(ctx->state);
+        c->stats.areas++;
+    } else {
+        fpu_fxrstor(ctx->state);
+    }
+    ctx->last_cpu = cpu;
+    c->owner = ctx;
+    c->stats.restores++;
+}
+
+void fpu_kernel_begin(void) {
+    if (!g_fpu_lazy) {
+        return;
+    }
+    fpu_cpu_t* c = &g_fpu_cpus[smp_current_cpu()];
+    if (fpu_read_cr0() & CR0_TS) {
+        fpu_clear_ts();
+    } else if (c->owner && c->owner == c->current) {
+        fpu_fxsave(c->owner->state);
+        c->stats.saves++;
+    }
+    c->owner = NULL;
+}
+
+void fpu_kernel_end(void) {
+    if (!g_fpu_lazy) {
+        return;
+    }
+    // Before the first switch nothing is per-task yet; leave the FPU open
+    if (g_fpu_cpus[smp_current_cpu()].current) {
+        fpu_set_ts();
+    }
+}
+
+void fpu_get_stats(fpu_stats_t* stats) {
+    *stats = (fpu_stats_t){0};
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        fpu_stats_t* s = &g_fpu_cpus[cpu].stats;
+        stats->traps += s->traps;
+        stats->restores += s->restores;
+        stats->saves += s->saves;
+        stats->fast_resumes += s->fast_resumes;
+        stats->areas += s->areas;
+    }
+}
@@ -6,6 +6,7 @@
 #include "kernel_types.h"
 #include "core/kernel.h"
 #include "graphics/graphics.h"
+#include "core/smp.h"
 
 // ────────────────
 // GDT Structures
@@ -30,6 +31,11 @@ struct gdt_ptr {
 static struct gdt_entry gdt_entries[5];
 static struct gdt_ptr   gdt_pointer;
 
+// Application processors each get their own copy so a future per-CPU
+// TSS/FS slot can be added without touching the BSP table
+static struct gdt_entry ap_gdt_entries[SMP_MAX_CPUS][5];
+static struct gdt_ptr   ap_gdt_pointers[SMP_MAX_CPUS];
+
 // ────────────────
 // External Invocation
 // ────────────────
@@ -72,4 +78,21 @@ void gdt_init(void) {
     gdt_flush((uint32_t)&gdt_pointer);
 
     gfx_print("GDT initialized successfully.\n");
-}
\ No newline at end of file
+}
+
+// ────────────────
+// Application Processor GDT
+// ────────────────
+void gdt_init_ap(uint32_t cpu) {
+    if (cpu >= SMP_MAX_CPUS) return;
+
+    // Same layout as the BSP so selectors 0x08/0x10 stay valid everywhere
+    for (int i = 0; i < 5; i++) {
+        ap_gdt_entries[cpu][i] = gdt_entries[i];
+    }
+
+    ap_gdt_pointers[cpu].limit = sizeof(ap_gdt_entries[cpu]) - 1;
+    ap_gdt_pointers[cpu].base  = (uint32_t)&ap_gdt_entries[cpu];
+
+    gdt_flush((uint32_t)&ap_gdt_pointers[cpu]);
+}
@@ -160,6 +160,6 @@ void update_mouse_state_from_packet(uint8_t packet[3]) {
     // Optional: dispatch events
     // dispatch_mouse_event(mouse_state.x, mouse_state.y, mouse_state.left_pressed, ...);
 
-    // Optional: mark cursor region dirty for redraw
-    // mark_cursor_dirty(mouse_state.x, mouse_state.y);
+    // Only the old and new pointer areas get recomposed
+    fb_set_pointer(mouse_state.x, mouse_state.y, true);
 }
@@ -5,6 +5,7 @@ global irqmouse
 irqmouse:
     cli
     pushad
+    cld
     call mouse_handler
     popad
     sti
@@ -7,6 +7,7 @@
 #include "core/kernel.h"
 #include "graphics/graphics.h"
 //#include "keyboard/keyboard_types.h"
+#include "keyboard/keyboard.h"
 #include "core/io.h"
 #include "config.h"
 #include "kernel.h"
@@ -16,14 +17,25 @@
 #include "core/timer.h"
 #include "core/input/mouse.h"
 #include "scheduler/task_manager.h"
+#include "core/ktime.h"
+#include "core/apic.h"
+#include "core/softirq.h"
+#include "graphics/irq_logger.h"
+
+idt_entry_t idt[IDT_ENTRIES];
+idt_ptr_t idt_ptr;
+
 // ────────────────
 // External Symbols
 // ────────────────
 extern void idt_flush(uint32_t);
 extern void irq33();
 extern void isr0();
+extern void isr14();
+extern void isr_device_not_available();
 extern void irq44();
 extern void irq0_handler();
+extern void irq_lapic_timer();
 
 // ────────────────
 // Interrupt Handler Table
@@ -55,6 +67,10 @@ void interrupt_handler(uint32_t int_no, uint32_t err_code) {
             gfx_print("Divide-by-zero fault\n");
             break;
 
+        case 14:
+            page_fault_handler(err_code);
+            break;
+
         case 33: { // IRQ1: Keyboard
             regs_t regs = { .int_no = int_no, .err_code = err_code };
             keyboard_handler(&regs, inb(0x60));
@@ -95,6 +111,33 @@ void divide_by_zero_handler() {
     // Optional: halt or recover
 }
 
+// Nothing is demand-paged, so every page fault is fatal. Name the task
+// when the address is the guard page below its stack.
+void page_fault_handler(uint32_t err_code) {
+    uint32_t addr;
+    __asm__ volatile("mov %%cr2, %0" : "=r"(addr));
+
+    task_t* task = task_find_by_stack_guard(addr);
+    if (task) {
+        gfx_print("Stack overflow in task ");
+        gfx_print(task->name);
+        gfx_print(" (id ");
+        gfx_print_decimal(task->task_id);
+        gfx_print(")\n");
+        SERIAL_LOG("PF: task stack overflow: ");
+        SERIAL_LOG(task->name);
+        SERIAL_LOG("\n");
+    }
+    gfx_print("Page fault at ");
+    gfx_print_hex(addr);
+    gfx_print(" (err=");
+    gfx_print_hex(err_code);
+    gfx_print(")\nSystem halted.\n");
+    SERIAL_LOG_HEX("PF: address 0x", addr);
+
+    while (1) __asm__ volatile("cli; hlt");
+}
+
 // ────────────────
 // IDT Gate Setup
 // ────────────────
@@ -116,32 +159,41 @@ void init_idt() {
     memset(&idt, 0, sizeof(idt));
 
     set_idt_gate(0,  (uint32_t)isr0);   // Divide-by-zero
+    set_idt_gate(7,  (uint32_t)isr_device_not_available); // Lazy FPU switch
+    set_idt_gate(14, (uint32_t)isr14);  // Page fault
     set_idt_gate(33, (uint32_t)irq33);  // Keyboard
     set_idt_gate(32, (uint32_t)irq0_handler); // Timer
+    set_idt_gate(LAPIC_TIMER_VECTOR, (uint32_t)irq_lapic_timer); // Per-CPU deadline timers
     // set_idt_gate(44, (uint32_t)irq44); // Mouse IRQ12 - Disabled to prevent conflicts
     idt_flush((uint32_t)&idt_ptr);
 }
 
+// Load the shared IDT on the calling CPU (used by application processors)
+void idt_load(void) {
+    idt_flush((uint32_t)&idt_ptr);
+}
+
 
 void timer_handler(struct regs* r) {
     (void)r; // Suppress unused parameter warning
-    static uint32_t tick_count = 0;
-    tick_count++;
+    ktime_t entered = irq_enter();
     inc_ticks();
-    clock_tick();
-    
-    /* Task manager timer tick for scheduling */
-    task_timer_tick();
 
-    // if(tick_count % 10 == 0) {
-    //     // Every second at 100Hz
-    //     gfx_print("Tick\n");
-    // }   
-    // Periodically flush any IRQ-queued debug lines to serial so they
-    // become visible in headless captures.
-    extern void irq_log_flush_to_serial(void);
-    irq_log_flush_to_serial();
+    // IRQ-queued debug lines go to serial from the workqueue, not here
+    irq_log_schedule_flush();
     send_eoi(32); // assuming regs contains int_no
+
+    // Deadline timers on machines without a local APIC timer
+    ktimer_poll();
+
+    // Bottom halves, with interrupts enabled
+    irq_exit(entered);
+    
+    /* Task manager timer tick for scheduling. Runs after the EOI because
+       it may switch to another task, and the PIT must keep ticking until
+       this one is resumed. Leaving an interrupt is the only preemption
+       point, so the tick stays in the top half. */
+    task_timer_tick();
 }
 
 
@@ -181,18 +233,24 @@ void send_eoi(uint8_t int_no) {
 // ────────────────
 // System Initialization
 // ────────────────
+// Top half of IRQ1: take the scancode off the controller and leave the
+// rest to the input softirq, which hands shell commands to a workqueue
 void keyboard_service_handler(regs_t* regs) {
+    (void)regs;
+    ktime_t entered = irq_enter();
     uint8_t scancode = inb(0x60);
     
     // Debug logging
     static int kbd_log_count = 0;
     if (kbd_log_count < 100) {
-        SERIAL_LOG_HEX("KBD IRQ: 0x", scancode);
+        irq_log_enqueue_hex("KBD IRQ: ", scancode);
+        irq_log_schedule_flush();
         kbd_log_count++;
     }
     
-    keyboard_handler(regs, scancode);
+    keyboard_irq_enqueue(scancode);
     send_eoi(33);
+    irq_exit(entered);
 }
     
 
@@ -205,7 +263,7 @@ void interrupts_system_init(void) {
     gfx_print("Remapping PIC...\n");
     init_pic();       // PIC remapping
     // Initialize PIT to 100Hz so sleep_ms and timer ticks advance
-    init_timer(100);
+    init_timer(TIMER_HZ);
     // Log PIC masks to help debug IRQ masking
     uint8_t mask1 = inb(0x21);
     uint8_t mask2 = inb(0xA1);
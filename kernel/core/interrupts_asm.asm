@@ -22,7 +22,11 @@ isr%1:
 
 %assign i 0
 %rep 32
+%if i = 8 || (i >= 10 && i <= 14) || i = 17
+    ISR_STUB_ERRCODE i     ; CPU pushes the error code itself
+%else
     ISR_STUB_NO_ERRCODE i
+%endif
 %assign i i+1
 %endrep
 
@@ -62,10 +66,37 @@ irq%1:
 extern timer_handler
 global irq0_handler
 irq0_handler:
+    pusha                 ; timer_handler may clobber eax/ecx/edx
+    cld
     push dword 0          ; dummy error code
     push dword 32         ; vector number
     call timer_handler
     add esp, 8
+    popa
+    iret
+
+; ────────────────
+; Local APIC Timer (per-CPU deadline timers)
+; ────────────────
+extern ktimer_interrupt
+global irq_lapic_timer
+irq_lapic_timer:
+    pusha
+    cld
+    call ktimer_interrupt
+    popa
+    iret
+
+; ────────────────
+; Device Not Available (#NM, vector 7): lazy FPU state switch
+; ────────────────
+extern fpu_device_not_available
+global isr_device_not_available
+isr_device_not_available:
+    pusha
+    cld
+    call fpu_device_not_available
+    popa
     iret
 
 ; ────────────────
@@ -92,12 +123,13 @@ isr_common_stub:
     mov es, ax
     mov fs, ax
     mov gs, ax
+    cld                  ; C code (rep movs/stos) assumes DF=0
 
+    mov eax, [esp + 48]  ; interrupt number (above pusha + 4 segments)
     mov ebx, [esp + 52]  ; error code
-    mov eax, [esp + 56]  ; interrupt number
 
+    push ebx             ; interrupt_handler(int_no, err_code)
     push eax
-    push ebx
     call interrupt_handler
     add esp, 8
 
@@ -124,12 +156,13 @@ irq_common_stub:
     mov es, ax
     mov fs, ax
     mov gs, ax
+    cld                  ; C code (rep movs/stos) assumes DF=0
 
+    mov eax, [esp + 48]  ; interrupt number (above pusha + 4 segments)
     mov ebx, [esp + 52]  ; error code
-    mov eax, [esp + 56]  ; interrupt number
 
+    push ebx             ; interrupt_handler(int_no, err_code)
     push eax
-    push ebx
     call interrupt_handler
     add esp, 8
 
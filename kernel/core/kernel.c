@@ -35,6 +35,12 @@
 #include "core/memory/heap.h"
 #include "drivers/usb/usb_mouse.h"
 #include "keyboard/command.h"
+#include "core/smp.h"
+#include "core/ktime.h"
+#include "core/fpu.h"
+#include "core/scheduler/fiber.h"
+#include "core/scheduler/workqueue.h"
+#include "core/clock_overlay.h"
 
 
 
@@ -138,6 +144,9 @@ int kernel_splash_test()
     // Initialize splash app
     splash_app.init(&splash_app);
 
+    // The compositor owns the screen here, so flip VRAM pages when we can
+    fb_set_present_mode(FB_PRESENT_FLIP);
+
     uint32_t last_tick = get_ticks();
     QARMA_TICK_CONTEXT ctx = {
         .tick_count = 0,
@@ -161,8 +170,8 @@ int kernel_splash_test()
             // Update all windows via manager
             qarma_window_manager.update_all(&qarma_window_manager, &ctx);
 
-            // Render all windows
-            qarma_window_manager.render_all(&qarma_window_manager);
+            // Re-render dirty windows and recompose only the damaged areas
+            fb_compose();
 
             // Exit when splash window is gone
             if (splash_app.main_window == NULL) {
@@ -174,6 +183,7 @@ int kernel_splash_test()
     }
     
     splash_app.shutdown(&splash_app);
+    fb_set_present_mode(FB_PRESENT_COPY);
     return 0;
 }
 
@@ -197,6 +207,8 @@ int kernel_main(uint32_t magic, multiboot_info_t* mbi) {
         vga_buffer[80*2 + i * 2 + 1] = 0x07;   // White on black
     }
 
+    fpu_init_cpu();      // x87/SSE control bits, before any float or SIMD code
+    string_init_cpu();   // SSE for bulk memcpy/memset before anything large is copied
     memory_init();   // Parse multiboot info first to set verbosity level
     
     // Update VGA output
@@ -230,6 +242,9 @@ int kernel_main(uint32_t magic, multiboot_info_t* mbi) {
     subsystem_registry_init();
     gfx_print("Subsystem registry initialized.\n");
     
+    // Discover processors from the ACPI MADT (topology for the engine)
+    smp_init();
+    
     // Initialize parallel processing engine (needed for core management)
     parallel_engine_init();
     gfx_print("Parallel processing engine initialized.\n");
@@ -345,6 +360,27 @@ int kernel_main(uint32_t magic, multiboot_info_t* mbi) {
     //idt_init();
     __asm__ volatile("cli");
     interrupts_system_init();
+
+    // Calibrate the TSC clock and local APIC timer against the PIT
+    gfx_print("Calibrating high-resolution clock...\n");
+    ktime_init();
+
+    // Per-task FPU save areas are allocated on first use
+    fpu_init();
+
+    // Background fibers; the clock overlay is the first of them
+    fiber_init();
+    clock_start();
+    
+    // Start application processors (they share the IDT loaded above)
+    gfx_print("Starting application processors...\n");
+    smp_boot_aps();
+    gfx_print("Processors online: ");
+    gfx_print_decimal(smp_online_count());
+    gfx_print("\n");
+
+    // Interrupt bottom halves deferred to workqueues run from here on
+    workqueue_init();
     
     // Initialize keyboard driver
     gfx_print("Initializing keyboard driver...\n");
@@ -0,0 +1,322 @@
+/**
+ * QARMA - High-resolution time and deadline timers
+ *
+ * Cycles convert to nanoseconds with a fixed-point multiplier chosen at
+ * calibration; the 64-bit product is split into two 32x32 multiplies so
+ * the conversion needs neither libgcc nor a division. Timer queues are
+ * sorted lists (timers per CPU are few) and each CPU only ever programs
+ * its own local APIC.
+ */
+
+#include "ktime.h"
+#include "apic.h"
+#include "smp.h"
+#include "core/timer.h"
+#include "core/atomic.h"
+#include "core/kernel.h"
+#include "config.h"
+
+#define KTIME_CALIBRATE_US      10000   // PIT window per calibration run
+#define KTIME_CALIBRATE_RUNS    3
+#define KTIMER_MAX_DELTA_NS     NSEC_PER_SEC    // Longer waits re-arm on expiry
+
+// Per-CPU deadline-ordered timer queue
+typedef struct {
+    volatile uint32_t lock;
+    ktimer_t* head;
+    bool hw;                            // Local APIC timer set up on this CPU
+} __attribute__((aligned(64))) ktimer_queue_t;
+
+static ktimer_queue_t g_queues[SMP_MAX_CPUS];
+
+static bool g_has_tsc = false;
+static uint32_t g_tsc_khz = 0;
+static uint64_t g_tsc_base = 0;         // TSC at calibration
+static ktime_t g_ns_base = 0;           // Boot time already elapsed then
+static uint32_t g_ns_mult = 0;          // ns = cycles * mult >> shift
+static uint32_t g_ns_shift = 0;
+
+static inline uint64_t rdtsc(void) {
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline uint32_t ktime_irq_save(void) {
+    uint32_t flags;
+    __asm__ volatile("pushfl; popl %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void ktime_irq_restore(uint32_t flags) {
+    if (flags & 0x200) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
+
+static inline void ktimer_lock(ktimer_queue_t* q) {
+    while (atomic_xchg_u32(&q->lock, 1)) {
+        cpu_relax();
+    }
+}
+
+static inline void ktimer_unlock(ktimer_queue_t* q) {
+    atomic_store_u32(&q->lock, 0);
+}
+
+/**
+ * Measure the TSC against the PIT and pick the largest shift whose
+ * multiplier still fits 32 bits
+ */
+static bool ktime_calibrate_tsc(void) {
+    uint64_t best = 0;
+    for (int run = 0; run < KTIME_CALIBRATE_RUNS; run++) {
+        uint64_t start = rdtsc();
+        timer_udelay(KTIME_CALIBRATE_US);
+        uint64_t elapsed = rdtsc() - start;
+        // The delay only overshoots, so the smallest count is the closest
+        if (best == 0 || elapsed < best) best = elapsed;
+    }
+
+    g_tsc_khz = (uint32_t)ktime_div_u32(best, KTIME_CALIBRATE_US / 1000);
+    if (g_tsc_khz == 0) return false;
+
+    for (g_ns_shift = 32; g_ns_shift > 0; g_ns_shift--) {
+        uint64_t mult = ktime_div_u32((uint64_t)NSEC_PER_MSEC << g_ns_shift, g_tsc_khz);
+        if ((mult >> 32) == 0) {
+            g_ns_mult = (uint32_t)mult;
+            break;
+        }
+    }
+    return g_ns_mult != 0;
+}
+
+/**
+ * Calibrate the clock and the local APIC timer. BSP only, after the PIT
+ * is programmed and before the application processors start.
+ */
+bool ktime_init(void) {
+    uint32_t eax, ebx, ecx, edx;
+    __asm__ volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+
+    if ((edx & (1 << 4)) && ktime_calibrate_tsc()) {
+        g_ns_base = (uint64_t)get_ticks() * (NSEC_PER_SEC / TIMER_HZ);
+        g_tsc_base = rdtsc();
+        g_has_tsc = true;
+        SERIAL_LOG_DEC("KTIME: TSC kHz ", g_tsc_khz);
+    } else {
+        SERIAL_LOG("KTIME: no TSC, using the PIT tick\n");
+    }
+
+    if (lapic_is_available()) {
+        lapic_timer_calibrate();
+    }
+    ktimer_cpu_init();
+    return g_has_tsc;
+}
+
+uint64_t ktime_cycles_to_ns(uint64_t cycles) {
+    uint32_t lo = (uint32_t)cycles;
+    uint32_t hi = (uint32_t)(cycles >> 32);
+    return (((uint64_t)lo * g_ns_mult) >> g_ns_shift) +
+           (((uint64_t)hi * g_ns_mult) << (32 - g_ns_shift));
+}
+
+/**
+ * Nanoseconds since boot
+ */
+ktime_t ktime_get(void) {
+    if (!g_has_tsc) {
+        return (uint64_t)get_ticks() * (NSEC_PER_SEC / TIMER_HZ);
+    }
+    return g_ns_base + ktime_cycles_to_ns(rdtsc() - g_tsc_base);
+}
+
+/**
+ * Raw cycle counter for profiling (0 without a TSC)
+ */
+uint64_t ktime_get_cycles(void) {
+    return g_has_tsc ? rdtsc() : 0;
+}
+
+uint32_t ktime_tsc_khz(void) {
+    return g_tsc_khz;
+}
+
+bool ktime_has_tsc(void) {
+    return g_has_tsc;
+}
+
+// ────────────────
+// Deadline timers
+// ────────────────
+
+/**
+ * Program the calling CPU's APIC timer for the earliest deadline, or stop
+ * it when nothing is queued (queue locked)
+ */
+static void ktimer_program(ktimer_queue_t* q) {
+    if (!q->hw) return;
+    if (!q->head) {
+        lapic_timer_stop();
+        return;
+    }
+
+    ktime_t now = ktime_get();
+    uint64_t delta = q->head->expires > now ? q->head->expires - now : 0;
+    if (delta > KTIMER_MAX_DELTA_NS) delta = KTIMER_MAX_DELTA_NS;
+
+    if (lapic_timer_has_tsc_deadline() && g_has_tsc) {
+        lapic_timer_deadline(rdtsc() + ktime_div_u32(delta * g_tsc_khz, NSEC_PER_MSEC));
+    } else {
+        lapic_timer_oneshot((uint32_t)ktime_div_u32(delta * lapic_timer_khz(), NSEC_PER_MSEC));
+    }
+}
+
+/**
+ * Set up the calling CPU's timer hardware; every CPU runs this once
+ */
+void ktimer_cpu_init(void) {
+    uint32_t cpu = smp_current_cpu();
+    if (cpu >= SMP_MAX_CPUS || !lapic_is_available() || !lapic_timer_khz()) return;
+
+    lapic_timer_setup();
+    g_queues[cpu].hw = true;
+}
+
+void ktimer_init(ktimer_t* timer, ktimer_fn_t fn, void* data) {
+    timer->expires = 0;
+    timer->fn = fn;
+    timer->data = data;
+    timer->next = timer->prev = NULL;
+    timer->cpu = 0;
+    timer->queued = false;
+}
+
+static void ktimer_unlink(ktimer_queue_t* q, ktimer_t* timer) {
+    if (timer->prev) {
+        timer->prev->next = timer->next;
+    } else {
+        q->head = timer->next;
+    }
+    if (timer->next) {
+        timer->next->prev = timer->prev;
+    }
+    timer->next = timer->prev = NULL;
+    timer->queued = false;
+}
+
+/**
+ * Arm a timer for an absolute deadline on the calling CPU, replacing any
+ * earlier arming. Deadlines in the past fire on the next interrupt.
+ */
+void ktimer_start(ktimer_t* timer, ktime_t expires) {
+    if (!timer || !timer->fn) return;
+
+    uint32_t flags = ktime_irq_save();
+    ktimer_cancel(timer);
+
+    // CPUs without a usable APIC timer hand their timers to the PIT poll
+    uint32_t cpu = smp_current_cpu();
+    if (cpu >= SMP_MAX_CPUS || !g_queues[cpu].hw) cpu = 0;
+    ktimer_queue_t* q = &g_queues[cpu];
+
+    ktimer_lock(q);
+    timer->expires = expires;
+    timer->cpu = cpu;
+
+    // Equal deadlines fire in arming order
+    ktimer_t* prev = NULL;
+    ktimer_t* node = q->head;
+    while (node && node->expires <= expires) {
+        prev = node;
+        node = node->next;
+    }
+    timer->prev = prev;
+    timer->next = node;
+    if (node) node->prev = timer;
+    if (prev) {
+        prev->next = timer;
+    } else {
+        q->head = timer;
+    }
+    timer->queued = true;
+
+    if (q->head == timer && cpu == smp_current_cpu()) {
+        ktimer_program(q);
+    }
+    ktimer_unlock(q);
+    ktime_irq_restore(flags);
+}
+
+/**
+ * Disarm a timer; false if it was not pending. A cancelled head timer on
+ * another CPU may still cost that CPU one early interrupt.
+ */
+bool ktimer_cancel(ktimer_t* timer) {
+    if (!timer || !timer->queued) return false;
+
+    uint32_t flags = ktime_irq_save();
+    ktimer_queue_t* q = &g_queues[timer->cpu];
+    ktimer_lock(q);
+
+    bool was_queued = timer->queued;
+    if (was_queued) {
+        bool was_head = q->head == timer;
+        ktimer_unlink(q, timer);
+        if (was_head && timer->cpu == smp_current_cpu()) {
+            ktimer_program(q);
+        }
+    }
+
+    ktimer_unlock(q);
+    ktime_irq_restore(flags);
+    return was_queued;
+}
+
+bool ktimer_pending(const ktimer_t* timer) {
+    return timer && timer->queued;
+}
+
+/**
+ * Fire every expired timer on a queue. The hardware is re-armed for the
+ * next deadline before each callback runs, so a callback that switches
+ * tasks does not hold up the timers behind it.
+ */
+static void ktimer_run(ktimer_queue_t* q) {
+    for (;;) {
+        ktimer_lock(q);
+        ktimer_t* timer = q->head;
+        if (!timer || timer->expires > ktime_get()) {
+            ktimer_program(q);
+            ktimer_unlock(q);
+            return;
+        }
+        ktimer_unlink(q, timer);
+        ktimer_program(q);
+        ktimer_unlock(q);
+
+        timer->fn(timer);
+    }
+}
+
+/**
+ * LAPIC_TIMER_VECTOR handler
+ */
+void ktimer_interrupt(void) {
+    lapic_eoi();
+
+    uint32_t cpu = smp_current_cpu();
+    if (cpu < SMP_MAX_CPUS) {
+        ktimer_run(&g_queues[cpu]);
+    }
+}
+
+/**
+ * PIT tick fallback for the boot CPU's queue when it has no APIC timer
+ */
+void ktimer_poll(void) {
+    if (!g_queues[0].hw && g_queues[0].head) {
+        ktimer_run(&g_queues[0]);
+    }
+}
@@ -1,83 +1,595 @@
 #include "heap.h"
 #include "../memory/vmm/vmm.h"
+#include "core/atomic.h"
+#include "core/string.h"
+#include "graphics/graphics.h"
+#include "config.h"
 
-#define STATIC_HEAP_SIZE (20 * 1024 * 1024)  // 20MB static heap (enough for ~10 PNG buffers)
+#define STATIC_HEAP_SIZE (20 * 1024 * 1024)  // 20MB bootstrap arena (identity mapped)
 static uint8_t static_heap[STATIC_HEAP_SIZE] __attribute__((aligned(4096)));
-static uint8_t* heap_base = NULL;
-static uint8_t* heap_top  = NULL;
+
+#define HEAP_PAGE_SIZE          4096
+#define HEAP_HEADER_SIZE        16
+#define HEAP_MIN_BLOCK          32
+#define HEAP_BINS               24
+#define HEAP_BLOCK_USED         0x1u
+#define HEAP_SIZE_MASK          (~0xFu)
+#define HEAP_MAGIC_USED         0xA110C8EDu
+#define HEAP_MAGIC_FREE         0xF4EEB10Cu
+#define HEAP_SLAB_MAGIC         0x51AB0B1Eu
+#define HEAP_SLAB_CHUNK_PAGES   16      // Slab pages are carved 64KB at a time
+#define HEAP_GROW_MIN_PAGES     256     // Grow by at least 1MB from the VMM
+
+// ────────────────
+// Large blocks (boundary tags)
+// ────────────────
+typedef struct heap_block {
+    uint32_t size;                  // Whole block incl. header; bit 0 = used
+    uint32_t prev_size;             // Size of the physically previous block (0 = first)
+    uint32_t magic;                 // HEAP_MAGIC_USED / HEAP_MAGIC_FREE
+    uint32_t requested;             // Caller's size, for stats
+} heap_block_t;
+
+typedef struct heap_free_block {
+    heap_block_t header;
+    struct heap_free_block* next;
+    struct heap_free_block* prev;
+} heap_free_block_t;
+
+typedef struct heap_region {
+    struct heap_region* next;
+    uint32_t base;
+    uint32_t length;
+    bool from_vmm;
+} heap_region_t;
+
+// ────────────────
+// Small objects (one slab per 4KB page)
+// ────────────────
+typedef struct heap_slab {
+    uint32_t magic;
+    uint16_t class_index;
+    uint16_t capacity;
+    uint16_t in_use;
+    uint16_t reserved;
+    void* free_list;
+    struct heap_slab* next;         // Partial list links
+    struct heap_slab* prev;
+    uint32_t pad[2];
+} heap_slab_t;
+
+typedef struct {
+    uint32_t size;
+    heap_slab_t* partial;           // Slabs with at least one free object
+    uint32_t in_use;
+    uint32_t pages;
+} heap_class_t;
+
+static const uint16_t g_class_sizes[HEAP_SIZE_CLASSES] = {
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024
+};
+
+static heap_class_t g_classes[HEAP_SIZE_CLASSES];
+static uint8_t g_class_lookup[HEAP_SMALL_MAX / 16 + 1];    // (size + 15) / 16 -> class
+
+static heap_free_block_t* g_bins[HEAP_BINS];
+static heap_region_t* g_regions = NULL;
+static void* g_free_slab_pages = NULL;                      // Cached empty pages
+
+// One bit per 4KB page of the address space: set for slab pages
+static uint32_t g_slab_page_map[(0x100000000ULL / HEAP_PAGE_SIZE) / 32];
+
+static heap_stats_t g_heap_stats;
+static volatile uint32_t g_heap_lock = 0;
 static bool heap_initialized = false;
 
+// ────────────────
+// Locking (IRQ-safe; the heap is shared by every processor)
+// ────────────────
+static uint32_t heap_lock(void) {
+    uint32_t flags;
+    __asm__ volatile("pushfl; popl %0; cli" : "=r"(flags) :: "memory");
+    while (atomic_xchg_u32(&g_heap_lock, 1)) {
+        __asm__ volatile("pause");
+    }
+    return flags;
+}
+
+static void heap_unlock(uint32_t flags) {
+    atomic_store_u32(&g_heap_lock, 0);
+    if (flags & 0x200) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
+
+// ────────────────
+// Helpers
+// ────────────────
+static inline uint32_t heap_block_size(heap_block_t* block) {
+    return block->size & HEAP_SIZE_MASK;
+}
+
+static inline heap_block_t* heap_next_block(heap_block_t* block) {
+    return (heap_block_t*)((uint8_t*)block + heap_block_size(block));
+}
+
+static inline uint32_t heap_bsr(uint32_t value) {
+    uint32_t index;
+    __asm__("bsrl %1, %0" : "=r"(index) : "rm"(value) : "cc");
+    return index;
+}
+
+static inline uint32_t heap_bin_index(uint32_t size) {
+    uint32_t bin = heap_bsr(size) - 5;      // 32 bytes -> bin 0
+    return bin < HEAP_BINS ? bin : HEAP_BINS - 1;
+}
+
+static inline bool heap_page_is_slab(uint32_t addr) {
+    uint32_t page = addr / HEAP_PAGE_SIZE;
+    return (g_slab_page_map[page / 32] >> (page % 32)) & 1;
+}
+
+static inline void heap_mark_slab_page(uint32_t addr) {
+    uint32_t page = addr / HEAP_PAGE_SIZE;
+    g_slab_page_map[page / 32] |= 1u << (page % 32);
+}
+
+static void heap_bin_insert(heap_free_block_t* block) {
+    uint32_t bin = heap_bin_index(heap_block_size(&block->header));
+    block->header.magic = HEAP_MAGIC_FREE;
+    block->prev = NULL;
+    block->next = g_bins[bin];
+    if (g_bins[bin]) g_bins[bin]->prev = block;
+    g_bins[bin] = block;
+}
+
+static void heap_bin_remove(heap_free_block_t* block) {
+    uint32_t bin = heap_bin_index(heap_block_size(&block->header));
+    if (block->prev) block->prev->next = block->next;
+    else g_bins[bin] = block->next;
+    if (block->next) block->next->prev = block->prev;
+}
+
+/**
+ * Add [base, base + length) as a new region: one free block followed by
+ * a zero-sized "used" fence that stops forward coalescing
+ */
+static void heap_add_region(uint32_t base, uint32_t length, bool from_vmm) {
+    heap_region_t* region = (heap_region_t*)base;
+    uint32_t start = ALIGN_UP(base + sizeof(heap_region_t), HEAP_ALIGNMENT);
+    uint32_t fence = ALIGN_DOWN(base + length, HEAP_ALIGNMENT) - HEAP_HEADER_SIZE;
+    if (fence <= start + HEAP_MIN_BLOCK) return;
+
+    region->base = base;
+    region->length = length;
+    region->from_vmm = from_vmm;
+    region->next = g_regions;
+    g_regions = region;
+
+    heap_free_block_t* block = (heap_free_block_t*)start;
+    block->header.size = fence - start;
+    block->header.prev_size = 0;
+    block->header.requested = 0;
+
+    heap_block_t* end = (heap_block_t*)fence;
+    end->size = HEAP_BLOCK_USED;
+    end->prev_size = fence - start;
+    end->magic = HEAP_MAGIC_USED;
+    end->requested = 0;
+
+    heap_bin_insert(block);
+
+    g_heap_stats.region_count++;
+    g_heap_stats.total_bytes += fence - start;
+}
+
+/**
+ * Take more address space from the VMM (not identity mapped)
+ */
+static bool heap_grow(uint32_t min_bytes) {
+    if (!vmm_is_initialized()) return false;
+
+    uint32_t bytes = min_bytes + sizeof(heap_region_t) + 4 * HEAP_HEADER_SIZE;
+    uint32_t pages = (bytes + HEAP_PAGE_SIZE - 1) / HEAP_PAGE_SIZE;
+    if (pages < HEAP_GROW_MIN_PAGES) pages = HEAP_GROW_MIN_PAGES;
+
+    void* base = vmm_alloc_pages(pages);
+    if (!base) return false;
+
+    heap_add_region((uint32_t)base, pages * HEAP_PAGE_SIZE, true);
+    SERIAL_LOG_DEC("HEAP: grew by KB ", pages * 4);
+    return true;
+}
+
+/**
+ * Leading padding needed so the payload of a block at 'base' meets
+ * 'alignment' (0 when already aligned; otherwise big enough to stand as
+ * a free block on its own)
+ */
+static inline uint32_t heap_align_gap(uint32_t base, uint32_t alignment) {
+    if (alignment <= HEAP_ALIGNMENT) return 0;
+
+    uint32_t payload = base + HEAP_HEADER_SIZE;
+    uint32_t aligned = ALIGN_UP(payload, alignment);
+    while (aligned != payload && aligned - payload < HEAP_MIN_BLOCK) {
+        aligned += alignment;
+    }
+    return aligned - payload;
+}
+
+/**
+ * Boundary-tag allocation (caller holds the lock)
+ */
+static void* heap_large_alloc(uint32_t size, uint32_t alignment) {
+    uint32_t need = ALIGN_UP(size + HEAP_HEADER_SIZE, HEAP_ALIGNMENT);
+    if (need < HEAP_MIN_BLOCK) need = HEAP_MIN_BLOCK;
+    if (need < size) return NULL;   // Overflow
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        for (uint32_t bin = heap_bin_index(need); bin < HEAP_BINS; bin++) {
+            for (heap_free_block_t* free = g_bins[bin]; free; free = free->next) {
+                uint32_t base = (uint32_t)free;
+                uint32_t block_size = heap_block_size(&free->header);
+                uint32_t gap = heap_align_gap(base, alignment);
+                if (block_size < gap + need) continue;
+
+                heap_bin_remove(free);
+                heap_block_t* block = &free->header;
+
+                // Leading gap becomes its own free block
+                if (gap) {
+                    block = (heap_block_t*)(base + gap);
+                    block->size = block_size - gap;
+                    block->prev_size = gap;
+                    heap_next_block(block)->prev_size = block_size - gap;
+
+                    free->header.size = gap;
+                    heap_bin_insert(free);
+                    block_size -= gap;
+                }
+
+                // Split off the tail if it is worth keeping
+                if (block_size - need >= HEAP_MIN_BLOCK) {
+                    heap_free_block_t* rest = (heap_free_block_t*)((uint8_t*)block + need);
+                    rest->header.size = block_size - need;
+                    rest->header.prev_size = need;
+                    rest->header.requested = 0;
+                    heap_next_block(&rest->header)->prev_size = block_size - need;
+                    heap_bin_insert(rest);
+                    block_size = need;
+                }
+
+                block->size = block_size | HEAP_BLOCK_USED;
+                block->magic = HEAP_MAGIC_USED;
+                block->requested = size;
+
+                g_heap_stats.large_allocs++;
+                g_heap_stats.used_bytes += block_size;
+                return (uint8_t*)block + HEAP_HEADER_SIZE;
+            }
+        }
+
+        if (attempt == 0 && !heap_grow(need + alignment)) break;
+    }
+
+    return NULL;
+}
+
+static void heap_large_free(heap_block_t* block) {
+    uint32_t size = heap_block_size(block);
+    g_heap_stats.used_bytes -= size;
+    block->size = size;
+
+    // Merge with the following block
+    heap_block_t* next = heap_next_block(block);
+    if (!(next->size & HEAP_BLOCK_USED)) {
+        heap_bin_remove((heap_free_block_t*)next);
+        size += heap_block_size(next);
+    }
+
+    // Merge with the preceding block
+    if (block->prev_size) {
+        heap_block_t* prev = (heap_block_t*)((uint8_t*)block - block->prev_size);
+        if (!(prev->size & HEAP_BLOCK_USED)) {
+            heap_bin_remove((heap_free_block_t*)prev);
+            size += heap_block_size(prev);
+            block = prev;
+        }
+    }
+
+    block->size = size;
+    heap_next_block(block)->prev_size = size;
+    heap_bin_insert((heap_free_block_t*)block);
+}
+
+// ────────────────
+// Slab pages
+// ────────────────
+static bool heap_slab_refill_pages(void) {
+    uint32_t bytes = HEAP_SLAB_CHUNK_PAGES * HEAP_PAGE_SIZE;
+    uint8_t* chunk = (uint8_t*)heap_large_alloc(bytes, HEAP_PAGE_SIZE);
+    if (!chunk) return false;
+
+    // Internal, not a caller allocation: account for it as slab pages instead
+    g_heap_stats.large_allocs--;
+    g_heap_stats.used_bytes -= heap_block_size((heap_block_t*)(chunk - HEAP_HEADER_SIZE));
+    for (uint32_t i = 0; i < HEAP_SLAB_CHUNK_PAGES; i++) {
+        uint8_t* page = chunk + i * HEAP_PAGE_SIZE;
+        heap_mark_slab_page((uint32_t)page);
+        *(void**)page = g_free_slab_pages;
+        g_free_slab_pages = page;
+    }
+
+    g_heap_stats.slab_pages += HEAP_SLAB_CHUNK_PAGES;
+    g_heap_stats.slab_pages_free += HEAP_SLAB_CHUNK_PAGES;
+    return true;
+}
+
+static heap_slab_t* heap_slab_create(uint32_t class_index) {
+    if (!g_free_slab_pages && !heap_slab_refill_pages()) return NULL;
+
+    heap_slab_t* slab = (heap_slab_t*)g_free_slab_pages;
+    g_free_slab_pages = *(void**)slab;
+    g_heap_stats.slab_pages_free--;
+
+    uint32_t object_size = g_class_sizes[class_index];
+    memset(slab, 0, sizeof(heap_slab_t));
+    slab->magic = HEAP_SLAB_MAGIC;
+    slab->class_index = class_index;
+    slab->capacity = (HEAP_PAGE_SIZE - sizeof(heap_slab_t)) / object_size;
+
+    // Thread the free list through the objects
+    uint8_t* object = (uint8_t*)slab + sizeof(heap_slab_t);
+    void* list = NULL;
+    for (int i = slab->capacity - 1; i >= 0; i--) {
+        void** entry = (void**)(object + i * object_size);
+        *entry = list;
+        list = entry;
+    }
+    slab->free_list = list;
+
+    g_classes[class_index].pages++;
+    return slab;
+}
+
+static void heap_partial_remove(heap_class_t* cls, heap_slab_t* slab) {
+    if (slab->prev) slab->prev->next = slab->next;
+    else cls->partial = slab->next;
+    if (slab->next) slab->next->prev = slab->prev;
+    slab->next = slab->prev = NULL;
+}
+
+static void heap_partial_insert(heap_class_t* cls, heap_slab_t* slab) {
+    slab->prev = NULL;
+    slab->next = cls->partial;
+    if (cls->partial) cls->partial->prev = slab;
+    cls->partial = slab;
+}
+
+static void* heap_small_alloc(uint32_t class_index) {
+    heap_class_t* cls = &g_classes[class_index];
+    heap_slab_t* slab = cls->partial;
+
+    if (!slab) {
+        slab = heap_slab_create(class_index);
+        if (!slab) return NULL;
+        heap_partial_insert(cls, slab);
+    }
+
+    void** object = (void**)slab->free_list;
+    slab->free_list = *object;
+    if (++slab->in_use == slab->capacity) {
+        heap_partial_remove(cls, slab);
+    }
+
+    cls->in_use++;
+    g_heap_stats.small_allocs++;
+    g_heap_stats.used_bytes += cls->size;
+    return object;
+}
+
+static void heap_small_free(void* ptr) {
+    heap_slab_t* slab = (heap_slab_t*)((uint32_t)ptr & ~(HEAP_PAGE_SIZE - 1));
+    if (slab->magic != HEAP_SLAB_MAGIC) {
+        SERIAL_LOG_HEX("HEAP: free of pointer in unused slab page ", (uint32_t)ptr);
+        return;
+    }
+
+    heap_class_t* cls = &g_classes[slab->class_index];
+    bool was_full = (slab->in_use == slab->capacity);
+
+    *(void**)ptr = slab->free_list;
+    slab->free_list = ptr;
+    slab->in_use--;
+    cls->in_use--;
+    g_heap_stats.used_bytes -= cls->size;
+
+    if (was_full) {
+        heap_partial_insert(cls, slab);
+    }
+
+    // Keep one empty slab per class; give the rest back to the page cache
+    if (slab->in_use == 0 && (cls->partial != slab || slab->next)) {
+        heap_partial_remove(cls, slab);
+        slab->magic = 0;
+        cls->pages--;
+        *(void**)slab = g_free_slab_pages;
+        g_free_slab_pages = slab;
+        g_heap_stats.slab_pages_free++;
+    }
+}
+
+// ────────────────
+// Public interface
+// ────────────────
 void heap_init(void) {
-    heap_base = static_heap;
-    heap_top  = heap_base;
+    if (heap_initialized) return;
+
+    memset(g_bins, 0, sizeof(g_bins));
+    memset(&g_heap_stats, 0, sizeof(g_heap_stats));
+
+    uint32_t class_index = 0;
+    for (uint32_t i = 0; i <= HEAP_SMALL_MAX / 16; i++) {
+        while (g_class_sizes[class_index] < i * 16) class_index++;
+        g_class_lookup[i] = (uint8_t)class_index;
+    }
+    for (uint32_t i = 0; i < HEAP_SIZE_CLASSES; i++) {
+        g_classes[i].size = g_class_sizes[i];
+        g_classes[i].partial = NULL;
+        g_classes[i].in_use = 0;
+        g_classes[i].pages = 0;
+    }
+
+    heap_add_region((uint32_t)static_heap, STATIC_HEAP_SIZE, false);
     heap_initialized = true;
 }
 
-void* heap_alloc(size_t size) {
+static void* heap_alloc_internal(size_t size, size_t alignment) {
     if (!heap_initialized) {
         heap_init(); // Auto-initialize if needed
     }
-    
-    size = (size + 7) & ~7; // align to 8 bytes
-    
-    // Check if we have enough space
-    if (heap_top + size > heap_base + STATIC_HEAP_SIZE) {
-        return NULL; // Out of heap space
-    }
-    
-    void* result = heap_top;
-    heap_top += size;
-    
-    // Zero the allocated memory to prevent garbage data
-    uint8_t* ptr = (uint8_t*)result;
-    for (size_t i = 0; i < size; i++) {
-        ptr[i] = 0;
-    }
-    
-    // Debug output for large allocations (like framebuffer backing store)
-    if (size > 1024 * 1024) {
-        // Only log large allocations to avoid spam
-        // This will catch the framebuffer backing store allocation
-    }
-    
+    if (size == 0) size = 1;
+
+    uint32_t flags = heap_lock();
+    void* result;
+    if (size <= HEAP_SMALL_MAX && alignment <= HEAP_ALIGNMENT) {
+        result = heap_small_alloc(g_class_lookup[(size + 15) / 16]);
+    } else {
+        result = heap_large_alloc(size, alignment);
+    }
+    if (!result) g_heap_stats.failed_allocs++;
+    heap_unlock(flags);
+
     return result;
 }
 
-void heap_free(void* ptr) {
-    // no-op for now - memory is not reclaimed
-    // With 20MB heap, we can allocate ~10 PNG buffers before running out
-    (void)ptr;
+void* heap_alloc(size_t size) {
+    return heap_alloc_internal(size, HEAP_ALIGNMENT);
+}
+
+void* heap_zalloc(size_t size) {
+    void* result = heap_alloc_internal(size, HEAP_ALIGNMENT);
+    if (result) {
+        memset(result, 0, size);
+    }
+    return result;
 }
 
 void* heap_alloc_aligned(size_t size, size_t alignment) {
-    if (!heap_initialized) {
-        heap_init(); // Auto-initialize if needed
+    // Alignment must be a power of two
+    if (alignment == 0 || (alignment & (alignment - 1))) return NULL;
+    return heap_alloc_internal(size, alignment);
+}
+
+void heap_free(void* ptr) {
+    if (!ptr || !heap_initialized) return;
+
+    uint32_t flags = heap_lock();
+    if (heap_page_is_slab((uint32_t)ptr)) {
+        heap_small_free(ptr);
+        g_heap_stats.frees++;
+    } else {
+        heap_block_t* block = (heap_block_t*)((uint8_t*)ptr - HEAP_HEADER_SIZE);
+        if (block->magic == HEAP_MAGIC_USED && (block->size & HEAP_BLOCK_USED)) {
+            heap_large_free(block);
+            g_heap_stats.frees++;
+        } else {
+            SERIAL_LOG_HEX("HEAP: invalid or double free ", (uint32_t)ptr);
+        }
     }
-    
-    // Align the current heap top to the required alignment
-    uintptr_t current = (uintptr_t)heap_top;
-    uintptr_t aligned = (current + alignment - 1) & ~(alignment - 1);
-    
-    // Calculate total size needed
-    size_t padding = aligned - current;
-    size_t total_size = padding + size;
-    
-    // Check if we have enough space
-    if (heap_top + total_size > heap_base + STATIC_HEAP_SIZE) {
-        return NULL; // Out of heap space
+    heap_unlock(flags);
+}
+
+size_t heap_usable_size(void* ptr) {
+    if (!ptr) return 0;
+
+    if (heap_page_is_slab((uint32_t)ptr)) {
+        heap_slab_t* slab = (heap_slab_t*)((uint32_t)ptr & ~(HEAP_PAGE_SIZE - 1));
+        return slab->magic == HEAP_SLAB_MAGIC ? g_class_sizes[slab->class_index] : 0;
     }
-    
-    // Update heap_top and return aligned pointer
-    heap_top += total_size;
-    
-    // Zero the allocated memory to prevent garbage data
-    uint8_t* ptr = (uint8_t*)aligned;
-    for (size_t i = 0; i < size; i++) {
-        ptr[i] = 0;
+
+    heap_block_t* block = (heap_block_t*)((uint8_t*)ptr - HEAP_HEADER_SIZE);
+    if (block->magic != HEAP_MAGIC_USED) return 0;
+    return heap_block_size(block) - HEAP_HEADER_SIZE;
+}
+
+void heap_get_stats(heap_stats_t* stats) {
+    if (!stats) return;
+    if (!heap_initialized) heap_init();
+
+    uint32_t flags = heap_lock();
+    *stats = g_heap_stats;
+
+    stats->free_bytes = 0;
+    stats->largest_free = 0;
+    stats->free_blocks = 0;
+    for (uint32_t bin = 0; bin < HEAP_BINS; bin++) {
+        for (heap_free_block_t* free = g_bins[bin]; free; free = free->next) {
+            uint32_t size = heap_block_size(&free->header);
+            stats->free_bytes += size;
+            stats->free_blocks++;
+            if (size > stats->largest_free) stats->largest_free = size;
+        }
+    }
+
+    for (uint32_t i = 0; i < HEAP_SIZE_CLASSES; i++) {
+        stats->class_size[i] = g_classes[i].size;
+        stats->class_in_use[i] = g_classes[i].in_use;
+        stats->class_pages[i] = g_classes[i].pages;
+    }
+    heap_unlock(flags);
+
+    stats->fragmentation = 0;
+    if (stats->free_bytes >= 100) {
+        uint32_t largest_pct = stats->largest_free / (stats->free_bytes / 100);
+        stats->fragmentation = largest_pct >= 100 ? 0 : 100 - largest_pct;
     }
-    
-    return (void*)aligned;
 }
 
+void heap_print_stats(void) {
+    heap_stats_t stats;
+    heap_get_stats(&stats);
 
+    gfx_print("=== Kernel Heap Statistics ===\n");
+    gfx_print("Regions: ");
+    gfx_print_decimal(stats.region_count);
+    gfx_print("  managed: ");
+    gfx_print_decimal(stats.total_bytes / 1024);
+    gfx_print(" KB\nUsed: ");
+    gfx_print_decimal(stats.used_bytes / 1024);
+    gfx_print(" KB  free: ");
+    gfx_print_decimal(stats.free_bytes / 1024);
+    gfx_print(" KB in ");
+    gfx_print_decimal(stats.free_blocks);
+    gfx_print(" blocks\nLargest free block: ");
+    gfx_print_decimal(stats.largest_free / 1024);
+    gfx_print(" KB  fragmentation: ");
+    gfx_print_decimal(stats.fragmentation);
+    gfx_print("%\n");
 
+    gfx_print("Slab pages: ");
+    gfx_print_decimal(stats.slab_pages);
+    gfx_print(" (");
+    gfx_print_decimal(stats.slab_pages_free);
+    gfx_print(" cached empty)\n");
+
+    gfx_print("Allocs small/large: ");
+    gfx_print_decimal(stats.small_allocs);
+    gfx_print("/");
+    gfx_print_decimal(stats.large_allocs);
+    gfx_print("  frees: ");
+    gfx_print_decimal(stats.frees);
+    gfx_print("  failed: ");
+    gfx_print_decimal(stats.failed_allocs);
+    gfx_print("\n\nClass   In use  Pages\n");
+
+    for (uint32_t i = 0; i < HEAP_SIZE_CLASSES; i++) {
+        if (stats.class_pages[i] == 0 && stats.class_in_use[i] == 0) continue;
+        gfx_print_decimal(stats.class_size[i]);
+        gfx_print("\t");
+        gfx_print_decimal(stats.class_in_use[i]);
+        gfx_print("\t");
+        gfx_print_decimal(stats.class_pages[i]);
+        gfx_print("\n");
+    }
+}
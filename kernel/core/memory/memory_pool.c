@@ -1,6 +1,6 @@
 /**
  * QARMA - Memory Pool Manager Implementation
- * 
+ *
  * Integrates PMM/VMM with subsystem memory management
  */
 
@@ -10,31 +10,105 @@
 #include "graphics/graphics.h"
 #include "config.h"
 #include "pmm/pmm.h"
+#include "vmm/vmm.h"
 #include "heap.h"
+#include "object_cache.h"
+#include "core/atomic.h"
+
+#define POOL_SLOT_MAGIC     0x504F4F4Cu     // "POOL"
+#define POOL_CHUNK_TAG      0x1u            // Page map entry points to a chunk
+#define POOL_MAP_LEAF_BITS  10
+
+// Header in front of every sub-allocated object
+typedef struct {
+    uint32_t magic;
+    uint16_t class_index;
+    uint16_t owner;
+    uint32_t size;                   // Requested size
+    uint32_t reserved;
+} pool_slot_header_t;
 
 // Global memory pools
 static memory_pool_t g_pools[SUBSYSTEM_MAX];
 static memory_pool_stats_t g_stats = {0};
 static bool g_initialized = false;
+static object_cache_t* g_block_cache = NULL;
+
+// Two-level radix map: page number -> chunk (tagged) or block
+static void** g_page_map[1u << (20 - POOL_MAP_LEAF_BITS)];
+
+static inline uint32_t pool_lock(memory_pool_t* pool) {
+    uint32_t flags;
+    __asm__ volatile("pushfl; popl %0; cli" : "=r"(flags) :: "memory");
+    while (atomic_xchg_u32(&pool->lock, 1)) {
+        cpu_relax();
+    }
+    return flags;
+}
+
+static inline void pool_unlock(memory_pool_t* pool, uint32_t flags) {
+    atomic_store_u32(&pool->lock, 0);
+    if (flags & 0x200) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
+
+/**
+ * Page map helpers
+ */
+static void** pool_map_slot(uint32_t addr, bool create) {
+    uint32_t page = addr / PAGE_SIZE;
+    uint32_t top = page >> POOL_MAP_LEAF_BITS;
+    void** leaf = g_page_map[top];
+
+    if (!leaf) {
+        if (!create) return NULL;
+        leaf = (void**)heap_zalloc(sizeof(void*) << POOL_MAP_LEAF_BITS);
+        if (!leaf) return NULL;
+        void** seen = (void**)atomic_cmpxchg_ptr((void* volatile*)&g_page_map[top], NULL, leaf);
+        if (seen) {
+            heap_free(leaf);
+            leaf = seen;
+        }
+    }
+    return &leaf[page & ((1u << POOL_MAP_LEAF_BITS) - 1)];
+}
+
+static bool pool_map_range(uint32_t addr, uint32_t size, void* value) {
+    for (uint32_t offset = 0; offset < size; offset += PAGE_SIZE) {
+        void** slot = pool_map_slot(addr + offset, value != NULL);
+        if (slot) *slot = value;
+        else if (value) return false;
+    }
+    return true;
+}
+
+static inline void* pool_map_lookup(void* ptr) {
+    void** slot = pool_map_slot((uint32_t)ptr, false);
+    return slot ? *slot : NULL;
+}
+
+static inline uint32_t pool_class_for(size_t size) {
+    uint32_t index = 0;
+    while ((32u << index) < size + sizeof(pool_slot_header_t)) index++;
+    return index;
+}
 
 /**
  * Initialize memory pool manager
  */
 void memory_pool_init(void) {
     if (g_initialized) return;
-    
+
     gfx_print("Initializing Memory Pool Manager...\n");
     SERIAL_LOG("=== Memory Pool Manager Init ===\n");
-    
+
     // Initialize all subsystem pools
     for (uint32_t i = 0; i < SUBSYSTEM_MAX; i++) {
+        memset(&g_pools[i], 0, sizeof(memory_pool_t));
         g_pools[i].subsystem = (subsystem_id_t)i;
-        g_pools[i].total_allocated = 0;
-        g_pools[i].peak_usage = 0;
-        g_pools[i].allocation_count = 0;
-        g_pools[i].blocks = NULL;
         g_pools[i].enforce_limits = true;
-        
+
         // Set default limits and NUMA preferences
         switch (i) {
             case SUBSYSTEM_KERNEL:
@@ -63,13 +137,13 @@ void memory_pool_init(void) {
                 break;
         }
     }
-    
-    // Get PMM stats
-    extern void pmm_print_stats(void);  // Will update this to return struct
-    
+
+    // Tracking blocks come from their own cache
+    g_block_cache = object_cache_create("memory_block_t", sizeof(memory_block_t), 0, NULL);
+
     g_initialized = true;
     gfx_print("Memory Pool Manager initialized.\n");
-    
+
     // Display initial pool configuration
     gfx_print("  VIDEO pool: max ");
     gfx_print_hex(g_pools[SUBSYSTEM_VIDEO].max_allocation / (1024*1024));
@@ -77,113 +151,234 @@ void memory_pool_init(void) {
 }
 
 /**
- * Allocate memory from a subsystem pool
+ * Back a new arena chunk. Low chunks are identity mapped and physically
+ * contiguous; without 'low' the chunk may be high pages mapped through
+ * the VMM once the low zone runs dry.
  */
-void* memory_pool_alloc(subsystem_id_t subsystem, size_t size, uint32_t flags) {
-    if (!g_initialized || subsystem >= SUBSYSTEM_MAX) return NULL;
-    
-    memory_pool_t* pool = &g_pools[subsystem];
-    
-    // Check limits
-    if (pool->enforce_limits && 
-        pool->total_allocated + size > pool->max_allocation) {
-        return NULL;  // Exceeded pool limit
+static bool pool_chunk_alloc(memory_chunk_t* chunk, bool low) {
+    chunk->mapped = false;
+    chunk->base = pmm_alloc_pages_zone(MEMORY_POOL_CHUNK_ORDER, PMM_ZONE_LOW);
+    if (!chunk->base && !low) {
+        chunk->base = (uint32_t)vmm_alloc_pages(1u << MEMORY_POOL_CHUNK_ORDER);
+        chunk->mapped = chunk->base != 0;
     }
-    
-    // For large allocations without proper VMM support, fall back to heap
-    // This is a temporary solution until we have proper contiguous physical allocation
+    return chunk->base != 0;
+}
+
+static void pool_chunk_release(memory_chunk_t* chunk) {
+    if (chunk->mapped) vmm_free_pages((void*)chunk->base, 1u << MEMORY_POOL_CHUNK_ORDER);
+    else pmm_free_pages(chunk->base, MEMORY_POOL_CHUNK_ORDER);
+}
+
+/**
+ * Sub-allocate from the pool's arena (pool lock held)
+ */
+static void* pool_arena_alloc(memory_pool_t* pool, size_t size, bool low) {
+    uint32_t class_index = pool_class_for(size);
+    uint32_t slot_size = 32u << class_index;
+    void** free_slots = pool->free_slots[low];
+    pool_slot_header_t* header = (pool_slot_header_t*)free_slots[class_index];
+
+    if (header) {
+        free_slots[class_index] = *(void**)header;
+    } else {
+        // Carve from the newest chunk, or take a new one
+        memory_chunk_t* chunk = pool->carving[low];
+        uint32_t chunk_bytes = PAGE_SIZE << MEMORY_POOL_CHUNK_ORDER;
+        if (!chunk || chunk->used + slot_size > chunk_bytes) {
+            memory_chunk_t* fresh = (memory_chunk_t*)heap_alloc(sizeof(memory_chunk_t));
+            if (!fresh) return NULL;
+
+            bool ok = pool_chunk_alloc(fresh, low);
+            if (!ok || !pool_map_range(fresh->base, chunk_bytes, (void*)((uint32_t)fresh | POOL_CHUNK_TAG))) {
+                if (ok) pool_chunk_release(fresh);
+                heap_free(fresh);
+                SERIAL_LOG("Memory Pool: no memory for arena chunk\n");
+                return NULL;
+            }
+
+            fresh->owner = pool->subsystem;
+            fresh->used = 0;
+            fresh->low = low;
+            fresh->next = pool->chunks;
+            pool->chunks = fresh;
+            pool->carving[low] = fresh;
+            pool->chunk_count++;
+            g_stats.used_physical_pages += 1u << MEMORY_POOL_CHUNK_ORDER;
+            chunk = fresh;
+        }
+
+        header = (pool_slot_header_t*)(chunk->base + chunk->used);
+        chunk->used += slot_size;
+    }
+
+    header->magic = POOL_SLOT_MAGIC;
+    header->class_index = (uint16_t)class_index;
+    header->owner = (uint16_t)pool->subsystem;
+    header->size = size;
+    pool->small_count++;
+    return header + 1;
+}
+
+/**
+ * Page-granular allocation (pool lock held)
+ */
+static memory_block_t* pool_block_alloc(memory_pool_t* pool, size_t size, uint32_t flags) {
+    memory_block_t* block = (memory_block_t*)object_cache_alloc(g_block_cache);
+    if (!block) return NULL;
+
+    size_t bytes = ALIGN_UP(size, PAGE_SIZE);
     void* virtual_addr = NULL;
     uint32_t physical_addr = 0;
-    
-    if (size > 64 * 1024) {
-        // Large allocation - use kernel heap
-        SERIAL_LOG("Memory Pool: Attempting large allocation via heap: ");
-        char size_buf[16];
-        uint32_t temp = size / 1024;
-        int idx = 0;
-        if (temp == 0) size_buf[idx++] = '0';
-        else {
-            char digits[16];
-            int d = 0;
-            while (temp > 0) { digits[d++] = '0' + (temp % 10); temp /= 10; }
-            for (int i = d-1; i >= 0; i--) size_buf[idx++] = digits[i];
+    uint32_t order = 0;
+    bool from_heap = false;
+
+    if (flags & (POOL_FLAG_CONTIGUOUS | POOL_FLAG_DMA_CAPABLE)) {
+        // Physically contiguous and identity mapped: a single buddy block
+        order = pmm_order_for_size(bytes);
+        if (((size_t)PAGE_SIZE << order) >= bytes) {
+            physical_addr = pmm_alloc_pages_zone(order, PMM_ZONE_LOW);
         }
-        size_buf[idx] = '\0';
-        SERIAL_LOG(size_buf);
-        SERIAL_LOG(" KB\n");
-        
-        virtual_addr = heap_alloc(size);
-        if (!virtual_addr) {
-            SERIAL_LOG("Memory Pool: heap_alloc FAILED for large allocation\n");
+        if (!physical_addr) {
+            SERIAL_LOG("Memory Pool: no contiguous run for request\n");
+            object_cache_free(g_block_cache, block);
             return NULL;
         }
-        SERIAL_LOG("Memory Pool: heap_alloc succeeded\n");
-        // For heap allocations, physical address is the same (identity mapped)
-        physical_addr = (uint32_t)virtual_addr;
+        virtual_addr = (void*)physical_addr;
+        bytes = PAGE_SIZE << order;
     } else {
-        // Small allocation - use PMM
-        physical_addr = pmm_alloc_page();
-        if (physical_addr == 0) {
-            SERIAL_LOG("Memory Pool: pmm_alloc_page failed\n");
+        // Only virtually contiguous; the heap grows through the VMM
+        virtual_addr = heap_alloc_aligned(bytes, PAGE_SIZE);
+        if (!virtual_addr) {
+            SERIAL_LOG("Memory Pool: heap allocation FAILED for large request\n");
+            object_cache_free(g_block_cache, block);
             return NULL;
         }
-        virtual_addr = (void*)physical_addr;
+        physical_addr = vmm_is_initialized() ? vmm_get_physical_address((uint32_t)virtual_addr)
+                                             : (uint32_t)virtual_addr;
+        from_heap = true;
     }
-    
-    // Zero-initialize if requested
-    if (flags & POOL_FLAG_ZERO_INIT) {
-        memset(virtual_addr, 0, size);
-    }
-    
-    // Create tracking block
-    memory_block_t* block = (memory_block_t*)heap_alloc(sizeof(memory_block_t));
-    if (!block) {
-        // Cleanup - free the allocated memory
-        if (size > 64 * 1024) {
-            heap_free(virtual_addr);
-        } else {
-            pmm_free_page(physical_addr);
-        }
+
+    if (!pool_map_range((uint32_t)virtual_addr, bytes, block)) {
+        if (from_heap) heap_free(virtual_addr);
+        else pmm_free_pages(physical_addr, order);
+        object_cache_free(g_block_cache, block);
         return NULL;
     }
-    
+
     block->virtual_addr = virtual_addr;
     block->physical_addr = physical_addr;
     block->size = size;
-    block->from_heap = (size > 64 * 1024); // Track allocation source
     block->flags = flags;
-    block->owner = subsystem;
+    block->owner = pool->subsystem;
     block->numa_node = pool->preferred_numa;
-    
+    block->from_heap = from_heap;
+    block->order = order;
+
     // Add to pool's block list
+    block->prev = NULL;
     block->next = pool->blocks;
+    if (pool->blocks) pool->blocks->prev = block;
     pool->blocks = block;
-    
+
+    g_stats.used_physical_pages += bytes / PAGE_SIZE;
+    return block;
+}
+
+/**
+ * Allocate memory from a subsystem pool
+ */
+void* memory_pool_alloc(subsystem_id_t subsystem, size_t size, uint32_t flags) {
+    if (!g_initialized || subsystem >= SUBSYSTEM_MAX || size == 0) return NULL;
+
+    memory_pool_t* pool = &g_pools[subsystem];
+    uint32_t irq = pool_lock(pool);
+
+    // Check limits
+    if (pool->enforce_limits &&
+        pool->total_allocated + size > pool->max_allocation) {
+        pool_unlock(pool, irq);
+        return NULL;  // Exceeded pool limit
+    }
+
+    // Arena slots never cross a chunk; low chunks are contiguous and
+    // identity mapped, so they satisfy CONTIGUOUS and DMA_CAPABLE
+    void* virtual_addr;
+    if (size <= MEMORY_POOL_SMALL_MAX) {
+        bool low = (flags & (POOL_FLAG_CONTIGUOUS | POOL_FLAG_DMA_CAPABLE)) != 0;
+        virtual_addr = pool_arena_alloc(pool, size, low);
+    } else {
+        memory_block_t* block = pool_block_alloc(pool, size, flags);
+        virtual_addr = block ? block->virtual_addr : NULL;
+    }
+
+    if (!virtual_addr) {
+        pool_unlock(pool, irq);
+        return NULL;
+    }
+
     // Update stats
     pool->total_allocated += size;
     pool->allocation_count++;
     if (pool->total_allocated > pool->peak_usage) {
         pool->peak_usage = pool->total_allocated;
     }
-    
-    uint32_t pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+
     g_stats.subsystem_allocated[subsystem] += size;
     g_stats.subsystem_blocks[subsystem]++;
-    g_stats.used_physical_pages += pages;
     g_stats.used_virtual_space += size;
-    
+    pool_unlock(pool, irq);
+
+    // Zero-initialize if requested
+    if (flags & POOL_FLAG_ZERO_INIT) {
+        memset(virtual_addr, 0, size);
+    }
+
     return virtual_addr;
 }
 
+/**
+ * Allocate with an alignment; anything above 16 bytes gets whole pages
+ */
+void* memory_pool_alloc_aligned(subsystem_id_t subsystem, size_t size, size_t alignment, uint32_t flags) {
+    if (alignment > PAGE_SIZE || (alignment & (alignment - 1))) return NULL;
+    if (alignment > 16 && size <= MEMORY_POOL_SMALL_MAX) {
+        size = MEMORY_POOL_SMALL_MAX + 1;
+    }
+    return memory_pool_alloc(subsystem, size, flags);
+}
+
+void* memory_pool_alloc_pages(subsystem_id_t subsystem, uint32_t page_count, uint32_t flags) {
+    if (page_count == 0) return NULL;
+    return memory_pool_alloc(subsystem, page_count * PAGE_SIZE, flags);
+}
+
+void* memory_pool_alloc_numa(subsystem_id_t subsystem, size_t size, uint32_t numa_node, uint32_t flags) {
+    (void)numa_node; // Single node until SRAT parsing exists
+    return memory_pool_alloc(subsystem, size, flags | POOL_FLAG_NUMA_LOCAL);
+}
+
+/**
+ * Physically contiguous buffer; returns the bus address through physical_addr_out
+ */
+void* memory_pool_alloc_dma(subsystem_id_t subsystem, size_t size, uint32_t* physical_addr_out) {
+    void* ptr = memory_pool_alloc(subsystem, size,
+                                  POOL_FLAG_CONTIGUOUS | POOL_FLAG_DMA_CAPABLE | POOL_FLAG_ZERO_INIT);
+    if (ptr && physical_addr_out) {
+        *physical_addr_out = (uint32_t)ptr;    // Identity mapped
+    }
+    return ptr;
+}
+
 /**
  * Allocate large buffer (optimized for big allocations like PNG buffers)
  */
 void* memory_pool_alloc_large(subsystem_id_t subsystem, size_t size, uint32_t numa_node) {
     (void)numa_node; // Will use later for NUMA optimization
-    
-    // Large allocations should be contiguous and zero-initialized
-    return memory_pool_alloc(subsystem, size, 
-                            POOL_FLAG_CONTIGUOUS | POOL_FLAG_ZERO_INIT);
+
+    // Decoder buffers only need to be virtually contiguous; keep the
+    // identity-mapped zone for real DMA users
+    return memory_pool_alloc(subsystem, size, POOL_FLAG_ZERO_INIT);
 }
 
 /**
@@ -191,47 +386,123 @@ void* memory_pool_alloc_large(subsystem_id_t subsystem, size_t size, uint32_t nu
  */
 void memory_pool_free(subsystem_id_t subsystem, void* ptr) {
     if (!g_initialized || !ptr || subsystem >= SUBSYSTEM_MAX) return;
-    
-    memory_pool_t* pool = &g_pools[subsystem];
-    memory_block_t* prev = NULL;
-    memory_block_t* block = pool->blocks;
-    
-    // Find the block
-    while (block) {
-        if (block->virtual_addr == ptr) {
-            // Found it, remove from list
-            if (prev) {
-                prev->next = block->next;
-            } else {
-                pool->blocks = block->next;
-            }
-            
-            // Calculate pages for stats
-            uint32_t pages = (block->size + PAGE_SIZE - 1) / PAGE_SIZE;
-            
-            // Free memory based on allocation source
-            if (block->from_heap) {
-                heap_free(block->virtual_addr);
-            } else {
-                pmm_free_page(block->physical_addr);
-            }
-            
-            // Update stats
-            pool->total_allocated -= block->size;
-            pool->allocation_count--;
-            g_stats.subsystem_allocated[subsystem] -= block->size;
-            g_stats.subsystem_blocks[subsystem]--;
-            g_stats.used_physical_pages -= pages;
-            g_stats.used_virtual_space -= block->size;
-            
-            // Free the tracking block
-            heap_free(block);
+
+    void* entry = pool_map_lookup(ptr);
+    if (!entry) {
+        SERIAL_LOG_HEX("Memory Pool: free of unknown pointer ", (uint32_t)ptr);
+        return;
+    }
+
+    if ((uint32_t)entry & POOL_CHUNK_TAG) {
+        memory_chunk_t* chunk = (memory_chunk_t*)((uint32_t)entry & ~POOL_CHUNK_TAG);
+        pool_slot_header_t* header = (pool_slot_header_t*)ptr - 1;
+        if (header->magic != POOL_SLOT_MAGIC) {
+            SERIAL_LOG_HEX("Memory Pool: invalid or double free ", (uint32_t)ptr);
             return;
         }
-        
-        prev = block;
-        block = block->next;
+
+        memory_pool_t* pool = &g_pools[chunk->owner];
+        uint32_t irq = pool_lock(pool);
+        size_t size = header->size;
+        header->magic = 0;
+        void** free_slots = pool->free_slots[chunk->low];
+        *(void**)header = free_slots[header->class_index];
+        free_slots[header->class_index] = header;
+        pool->small_count--;
+
+        pool->total_allocated -= size;
+        pool->allocation_count--;
+        g_stats.subsystem_allocated[chunk->owner] -= size;
+        g_stats.subsystem_blocks[chunk->owner]--;
+        g_stats.used_virtual_space -= size;
+        pool_unlock(pool, irq);
+        return;
     }
+
+    memory_block_t* block = (memory_block_t*)entry;
+    if (block->virtual_addr != ptr) {
+        SERIAL_LOG_HEX("Memory Pool: free of interior pointer ", (uint32_t)ptr);
+        return;
+    }
+
+    memory_pool_t* pool = &g_pools[block->owner];
+    uint32_t irq = pool_lock(pool);
+
+    // Remove from the pool's list
+    if (block->prev) block->prev->next = block->next;
+    else pool->blocks = block->next;
+    if (block->next) block->next->prev = block->prev;
+
+    size_t bytes = block->from_heap ? ALIGN_UP(block->size, PAGE_SIZE) : ((size_t)PAGE_SIZE << block->order);
+    pool_map_range((uint32_t)block->virtual_addr, bytes, NULL);
+
+    // Free memory based on allocation source
+    if (block->from_heap) {
+        heap_free(block->virtual_addr);
+    } else {
+        pmm_free_pages(block->physical_addr, block->order);
+    }
+
+    // Update stats
+    pool->total_allocated -= block->size;
+    pool->allocation_count--;
+    g_stats.subsystem_allocated[block->owner] -= block->size;
+    g_stats.subsystem_blocks[block->owner]--;
+    g_stats.used_physical_pages -= bytes / PAGE_SIZE;
+    g_stats.used_virtual_space -= block->size;
+    pool_unlock(pool, irq);
+
+    // Free the tracking block
+    object_cache_free(g_block_cache, block);
+}
+
+/**
+ * Reset a pool's limits and preferences
+ */
+memory_pool_t* memory_pool_create(subsystem_id_t subsystem, size_t max_size, uint32_t numa_node) {
+    if (!g_initialized || subsystem >= SUBSYSTEM_MAX) return NULL;
+
+    memory_pool_t* pool = &g_pools[subsystem];
+    pool->max_allocation = max_size;
+    pool->preferred_numa = numa_node;
+    pool->enforce_limits = max_size != 0;
+    return pool;
+}
+
+/**
+ * Release everything a pool owns, including its arena chunks
+ */
+void memory_pool_destroy(memory_pool_t* pool) {
+    if (!g_initialized || !pool) return;
+
+    while (pool->blocks) {
+        memory_pool_free(pool->subsystem, pool->blocks->virtual_addr);
+    }
+
+    uint32_t irq = pool_lock(pool);
+    uint32_t chunk_bytes = PAGE_SIZE << MEMORY_POOL_CHUNK_ORDER;
+    memory_chunk_t* chunk = pool->chunks;
+    while (chunk) {
+        memory_chunk_t* next = chunk->next;
+        pool_map_range(chunk->base, chunk_bytes, NULL);
+        pool_chunk_release(chunk);
+        heap_free(chunk);
+        g_stats.used_physical_pages -= 1u << MEMORY_POOL_CHUNK_ORDER;
+        chunk = next;
+    }
+
+    g_stats.subsystem_allocated[pool->subsystem] -= pool->total_allocated;
+    g_stats.subsystem_blocks[pool->subsystem] -= pool->small_count;
+    g_stats.used_virtual_space -= pool->total_allocated;
+
+    pool->chunks = NULL;
+    memset(pool->carving, 0, sizeof(pool->carving));
+    pool->chunk_count = 0;
+    pool->small_count = 0;
+    pool->total_allocated = 0;
+    pool->allocation_count = 0;
+    memset(pool->free_slots, 0, sizeof(pool->free_slots));
+    pool_unlock(pool, irq);
 }
 
 /**
@@ -247,10 +518,10 @@ size_t memory_pool_get_allocated(subsystem_id_t subsystem) {
  */
 size_t memory_pool_get_available(subsystem_id_t subsystem) {
     if (!g_initialized || subsystem >= SUBSYSTEM_MAX) return 0;
-    
+
     memory_pool_t* pool = &g_pools[subsystem];
     if (pool->total_allocated >= pool->max_allocation) return 0;
-    
+
     return pool->max_allocation - pool->total_allocated;
 }
 
@@ -263,22 +534,15 @@ uint32_t memory_pool_get_block_count(subsystem_id_t subsystem) {
 }
 
 /**
- * Find block by pointer
+ * Find the tracking block covering ptr (NULL for arena sub-allocations,
+ * which have no block of their own)
  */
 memory_block_t* memory_pool_find_block(void* ptr) {
     if (!g_initialized || !ptr) return NULL;
-    
-    for (uint32_t i = 0; i < SUBSYSTEM_MAX; i++) {
-        memory_block_t* block = g_pools[i].blocks;
-        while (block) {
-            if (block->virtual_addr == ptr) {
-                return block;
-            }
-            block = block->next;
-        }
-    }
-    
-    return NULL;
+
+    void* entry = pool_map_lookup(ptr);
+    if (!entry || ((uint32_t)entry & POOL_CHUNK_TAG)) return NULL;
+    return (memory_block_t*)entry;
 }
 
 /**
@@ -293,18 +557,18 @@ memory_pool_stats_t* memory_pool_get_stats(void) {
  */
 void memory_pool_print_stats(subsystem_id_t subsystem) {
     if (!g_initialized || subsystem >= SUBSYSTEM_MAX) return;
-    
+
     extern const char* subsystem_id_to_string(subsystem_id_t);
     memory_pool_t* pool = &g_pools[subsystem];
-    
+
     SERIAL_LOG_HEX("[MEMPOOL] Stats - allocated: ", pool->total_allocated / 1024);
     SERIAL_LOG_HEX(" KB, peak: ", pool->peak_usage / 1024);
     SERIAL_LOG(" KB\n");
-    
+
     gfx_print("=== Memory Pool: ");
     gfx_print(subsystem_id_to_string(subsystem));
     gfx_print(" ===\n");
-    
+
     gfx_print("Current: ");
     gfx_print_hex(pool->total_allocated / 1024);
     gfx_print(" KB  Peak: ");
@@ -312,12 +576,18 @@ void memory_pool_print_stats(subsystem_id_t subsystem) {
     gfx_print(" KB  Limit: ");
     gfx_print_hex(pool->max_allocation / 1024);
     gfx_print(" KB\n");
-    
+
     gfx_print("Active allocations: ");
     gfx_print_hex(pool->allocation_count);
     gfx_print("  Blocks: ");
     gfx_print_hex(g_stats.subsystem_blocks[subsystem]);
     gfx_print("\n");
+
+    gfx_print("Arena chunks: ");
+    gfx_print_hex(pool->chunk_count);
+    gfx_print("  Sub-allocations: ");
+    gfx_print_hex(pool->small_count);
+    gfx_print("\n");
 }
 
 /**
@@ -326,13 +596,13 @@ void memory_pool_print_stats(subsystem_id_t subsystem) {
 void memory_pool_print_all_stats(void) {
     SERIAL_LOG("[MEMPOOL] print_all_stats called\n");
     gfx_print("=== Memory Pool Manager Statistics ===\n");
-    
+
     gfx_print("Physical pages used: ");
     gfx_print_hex(g_stats.used_physical_pages);
     gfx_print("\nVirtual space used: ");
     gfx_print_hex(g_stats.used_virtual_space / 1024);
     gfx_print(" KB\n\n");
-    
+
     for (uint32_t i = 0; i < SUBSYSTEM_MAX; i++) {
         // Show stats if currently allocated OR if peak usage > 0
         if (g_pools[i].allocation_count > 0 || g_pools[i].peak_usage > 0) {
@@ -341,5 +611,37 @@ void memory_pool_print_all_stats(void) {
             gfx_print("\n");
         }
     }
+
+    object_cache_print_all_stats();
     SERIAL_LOG("[MEMPOOL] print_all_stats finished\n");
 }
+
+/**
+ * Human readable flag list (static buffer)
+ */
+const char* memory_pool_flags_to_string(uint32_t flags) {
+    static char buffer[80];
+    static const struct { uint32_t flag; const char* name; } names[] = {
+        { POOL_FLAG_NUMA_LOCAL,  "NUMA " },
+        { POOL_FLAG_CONTIGUOUS,  "CONTIG " },
+        { POOL_FLAG_CACHEABLE,   "CACHE " },
+        { POOL_FLAG_EXECUTABLE,  "EXEC " },
+        { POOL_FLAG_DMA_CAPABLE, "DMA " },
+        { POOL_FLAG_ZERO_INIT,   "ZERO " },
+    };
+
+    uint32_t pos = 0;
+    for (uint32_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (!(flags & names[i].flag)) continue;
+        for (const char* c = names[i].name; *c && pos < sizeof(buffer) - 1; c++) {
+            buffer[pos++] = *c;
+        }
+    }
+    if (pos == 0) {
+        buffer[pos++] = '-';
+    } else {
+        pos--;  // Drop trailing space
+    }
+    buffer[pos] = '\0';
+    return buffer;
+}
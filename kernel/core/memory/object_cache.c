@@ -0,0 +1,262 @@
+/**
+ * QARMA - Object Caches
+ *
+ * Magazine layer on top of the kernel heap (after Bonwick's slab
+ * allocator). A cache grows by carving one heap chunk into constructed
+ * objects and packing them into full magazines in the depot.
+ */
+
+#include "object_cache.h"
+#include "heap.h"
+#include "core/kernel.h"
+#include "core/atomic.h"
+#include "core/string.h"
+#include "graphics/graphics.h"
+#include "config.h"
+
+#define OBJECT_CACHE_CHUNK_BYTES    (16 * 1024)
+#define OBJECT_CACHE_MIN_OBJECTS    32
+
+static object_cache_t g_caches[OBJECT_CACHE_MAX];
+static volatile uint32_t g_cache_count = 0;
+static volatile uint32_t g_registry_lock = 0;
+
+static inline uint32_t object_cache_irq_save(void) {
+    uint32_t flags;
+    __asm__ volatile("pushfl; popl %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void object_cache_irq_restore(uint32_t flags) {
+    if (flags & 0x200) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
+
+static inline void depot_lock(object_cache_t* cache) {
+    while (atomic_xchg_u32(&cache->lock, 1)) {
+        cpu_relax();
+    }
+}
+
+static inline void depot_unlock(object_cache_t* cache) {
+    atomic_store_u32(&cache->lock, 0);
+}
+
+/**
+ * Register a new cache. 'align' of 0 means pointer alignment.
+ */
+object_cache_t* object_cache_create(const char* name, size_t size, size_t align, object_ctor_t ctor) {
+    if (size == 0) return NULL;
+    if (align < sizeof(void*)) align = sizeof(void*);
+    if (align & (align - 1)) return NULL;
+
+    while (atomic_xchg_u32(&g_registry_lock, 1)) {
+        cpu_relax();
+    }
+    if (g_cache_count >= OBJECT_CACHE_MAX) {
+        atomic_store_u32(&g_registry_lock, 0);
+        SERIAL_LOG("OBJCACHE: too many caches\n");
+        return NULL;
+    }
+    object_cache_t* cache = &g_caches[g_cache_count];
+    memset(cache, 0, sizeof(object_cache_t));
+
+    size_t name_len = strlen(name);
+    if (name_len >= OBJECT_CACHE_NAME_LEN) name_len = OBJECT_CACHE_NAME_LEN - 1;
+    memcpy(cache->name, name, name_len);
+    cache->name[name_len] = '\0';
+
+    cache->object_size = size;
+    cache->align = align;
+    cache->ctor = ctor;
+
+    // Publish only once fully initialized
+    atomic_fence();
+    g_cache_count++;
+    atomic_store_u32(&g_registry_lock, 0);
+    return cache;
+}
+
+/**
+ * Carve a fresh chunk into constructed objects packed into magazines
+ * on the depot full list (depot lock held)
+ */
+static bool object_cache_grow(object_cache_t* cache) {
+    size_t stride = ALIGN_UP(cache->object_size, cache->align);
+    uint32_t count = OBJECT_CACHE_CHUNK_BYTES / stride;
+    if (count < OBJECT_CACHE_MIN_OBJECTS) count = OBJECT_CACHE_MIN_OBJECTS;
+
+    uint8_t* chunk = (uint8_t*)heap_alloc_aligned(stride * count, cache->align);
+    if (!chunk) return false;
+
+    uint32_t carved = 0;
+    while (carved < count) {
+        object_magazine_t* mag = (object_magazine_t*)heap_alloc(sizeof(object_magazine_t));
+        if (!mag) break;
+
+        mag->rounds = 0;
+        while (mag->rounds < OBJECT_CACHE_MAGAZINE_SIZE && carved < count) {
+            void* object = chunk + carved * stride;
+            if (cache->ctor) cache->ctor(object);
+            mag->objects[mag->rounds++] = object;
+            carved++;
+        }
+        mag->next = cache->full;
+        cache->full = mag;
+        cache->full_count++;
+    }
+
+    // Without magazines to hold them the remaining objects are unreachable
+    if (carved == 0) {
+        heap_free(chunk);
+        return false;
+    }
+
+    cache->total_objects += carved;
+    cache->chunks++;
+    return true;
+}
+
+void* object_cache_alloc(object_cache_t* cache) {
+    if (!cache) return NULL;
+
+    uint32_t flags = object_cache_irq_save();
+    object_cache_cpu_t* cpu = &cache->cpus[smp_current_cpu()];
+
+    if (!cpu->loaded || cpu->loaded->rounds == 0) {
+        if (cpu->previous && cpu->previous->rounds > 0) {
+            object_magazine_t* tmp = cpu->loaded;
+            cpu->loaded = cpu->previous;
+            cpu->previous = tmp;
+        } else {
+            // Both empty: trade an empty magazine for a full one
+            depot_lock(cache);
+            if (!cache->full && !object_cache_grow(cache)) {
+                cache->failed_allocs++;
+                depot_unlock(cache);
+                object_cache_irq_restore(flags);
+                return NULL;
+            }
+
+            object_magazine_t* full = cache->full;
+            cache->full = full->next;
+            cache->full_count--;
+
+            if (cpu->previous) {
+                cpu->previous->next = cache->empty;
+                cache->empty = cpu->previous;
+                cache->empty_count++;
+            }
+            cpu->previous = cpu->loaded;
+            cpu->loaded = full;
+            cache->depot_hits++;
+            depot_unlock(cache);
+        }
+    }
+
+    void* object = cpu->loaded->objects[--cpu->loaded->rounds];
+    cpu->allocs++;
+    object_cache_irq_restore(flags);
+    return object;
+}
+
+void object_cache_free(object_cache_t* cache, void* object) {
+    if (!cache || !object) return;
+
+    uint32_t flags = object_cache_irq_save();
+    object_cache_cpu_t* cpu = &cache->cpus[smp_current_cpu()];
+
+    if (!cpu->loaded || cpu->loaded->rounds == OBJECT_CACHE_MAGAZINE_SIZE) {
+        if (cpu->previous && cpu->previous->rounds == 0) {
+            object_magazine_t* tmp = cpu->loaded;
+            cpu->loaded = cpu->previous;
+            cpu->previous = tmp;
+        } else {
+            // Both full (or missing): trade a full magazine for an empty one
+            depot_lock(cache);
+            object_magazine_t* empty = cache->empty;
+            if (empty) {
+                cache->empty = empty->next;
+                cache->empty_count--;
+            } else {
+                empty = (object_magazine_t*)heap_alloc(sizeof(object_magazine_t));
+                if (!empty) {
+                    depot_unlock(cache);
+                    object_cache_irq_restore(flags);
+                    SERIAL_LOG("OBJCACHE: no magazine for free, object leaked\n");
+                    return;
+                }
+            }
+            empty->rounds = 0;
+
+            if (cpu->previous) {
+                cpu->previous->next = cache->full;
+                cache->full = cpu->previous;
+                cache->full_count++;
+            }
+            cpu->previous = cpu->loaded;
+            cpu->loaded = empty;
+            cache->depot_hits++;
+            depot_unlock(cache);
+        }
+    }
+
+    cpu->loaded->objects[cpu->loaded->rounds++] = object;
+    cpu->frees++;
+    object_cache_irq_restore(flags);
+}
+
+/**
+ * Objects currently handed out (approximate while other CPUs are active)
+ */
+uint32_t object_cache_in_use(object_cache_t* cache) {
+    uint32_t allocs = 0, frees = 0;
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+        allocs += cache->cpus[i].allocs;
+        frees += cache->cpus[i].frees;
+    }
+    return allocs - frees;
+}
+
+void object_cache_print_stats(object_cache_t* cache) {
+    if (!cache) return;
+
+    uint32_t allocs = 0;
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+        allocs += cache->cpus[i].allocs;
+    }
+
+    gfx_print(cache->name);
+    gfx_print(": size ");
+    gfx_print_decimal(cache->object_size);
+    gfx_print("  in use ");
+    gfx_print_decimal(object_cache_in_use(cache));
+    gfx_print("/");
+    gfx_print_decimal(cache->total_objects);
+    gfx_print("  allocs ");
+    gfx_print_decimal(allocs);
+    gfx_print("  depot ");
+    gfx_print_decimal(cache->depot_hits);
+    gfx_print("  mags ");
+    gfx_print_decimal(cache->full_count);
+    gfx_print("f/");
+    gfx_print_decimal(cache->empty_count);
+    gfx_print("e");
+    if (cache->failed_allocs) {
+        gfx_print("  failed ");
+        gfx_print_decimal(cache->failed_allocs);
+    }
+    gfx_print("\n");
+}
+
+void object_cache_print_all_stats(void) {
+    gfx_print("=== Object Caches ===\n");
+    if (g_cache_count == 0) {
+        gfx_print("(none)\n");
+        return;
+    }
+    for (uint32_t i = 0; i < g_cache_count; i++) {
+        object_cache_print_stats(&g_caches[i]);
+    }
+}
@@ -1,65 +1,460 @@
 #include "pmm.h"
 #include "config.h"
 #include "../memory.h"
+#include "core/smp.h"
+#include "core/atomic.h"
+#include "graphics/graphics.h"
 
-#define MAX_PHYSICAL_PAGES 32768  // Example: 128MB / 4KB
-static uint8_t page_bitmap[MAX_PHYSICAL_PAGES / 8];
+#define PMM_NONE            0xFFFFFFFFu
+#define PMM_ORDER_USED      0xFF        // Page is not the head of a free block
+#define PMM_LOW_PAGES       (PMM_LOW_LIMIT / PMM_PAGE_SIZE)
+#define PMM_PCP_MAX         32          // Per-CPU cache capacity (pages)
+#define PMM_PCP_BATCH       16          // Pages moved per refill/drain
 
-static inline void set_bit(uint32_t bit) {
-    page_bitmap[bit / 8] |= (1 << (bit % 8));
+extern uint8_t kernel_image_end[];
+
+typedef struct {
+    uint32_t next;
+    uint32_t prev;
+} pmm_link_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t pages[PMM_PCP_MAX];
+} pmm_pcp_t;
+
+// Per-page metadata, placed in physical memory right after the kernel
+static pmm_link_t* g_links = NULL;
+static uint8_t* g_order = NULL;
+static uint32_t g_page_count = 0;
+static uint32_t g_reserved_end = 0;     // Pages below this are never handed out
+
+static uint32_t g_free_head[PMM_ZONE_COUNT][PMM_MAX_ORDER + 1];
+static uint32_t g_free_count[PMM_ZONE_COUNT][PMM_MAX_ORDER + 1];
+static pmm_pcp_t g_pcp[SMP_MAX_CPUS][PMM_ZONE_COUNT];
+
+static pmm_stats_t g_stats;
+static volatile uint32_t g_pmm_lock = 0;
+
+static inline uint32_t pmm_lock(void) {
+    uint32_t flags;
+    __asm__ volatile("pushfl; popl %0; cli" : "=r"(flags) :: "memory");
+    while (atomic_xchg_u32(&g_pmm_lock, 1)) {
+        cpu_relax();
+    }
+    return flags;
 }
 
-static inline void clear_bit(uint32_t bit) {
-    page_bitmap[bit / 8] &= ~(1 << (bit % 8));
+static inline void pmm_unlock(uint32_t flags) {
+    atomic_store_u32(&g_pmm_lock, 0);
+    if (flags & 0x200) {
+        __asm__ volatile("sti" ::: "memory");
+    }
 }
 
-static inline int test_bit(uint32_t bit) {
-    return page_bitmap[bit / 8] & (1 << (bit % 8));
+static inline uint32_t pmm_irq_save(void) {
+    uint32_t flags;
+    __asm__ volatile("pushfl; popl %0; cli" : "=r"(flags) :: "memory");
+    return flags;
 }
 
-void pmm_init(void) {
-    memset(page_bitmap, 0xFF, sizeof(page_bitmap)); // Mark all as used
-    // Later: mark usable regions from BIOS/multiboot
+static inline void pmm_irq_restore(uint32_t flags) {
+    if (flags & 0x200) {
+        __asm__ volatile("sti" ::: "memory");
+    }
 }
 
-uint32_t pmm_alloc_page(void) {
-    for (uint32_t i = 0; i < MAX_PHYSICAL_PAGES; ++i) {
-        if (!test_bit(i)) {
-            set_bit(i);
-            return i * 0x1000;
+static uint32_t pmm_pcp_alloc(uint32_t zone);
+
+static inline uint32_t pmm_zone_of(uint32_t page) {
+    return page < PMM_LOW_PAGES ? PMM_ZONE_LOW : PMM_ZONE_HIGH;
+}
+
+// ────────────────
+// Buddy free lists (caller holds the lock)
+// ────────────────
+static void pmm_list_insert(uint32_t page, uint32_t order) {
+    uint32_t zone = pmm_zone_of(page);
+    uint32_t head = g_free_head[zone][order];
+
+    g_links[page].prev = PMM_NONE;
+    g_links[page].next = head;
+    if (head != PMM_NONE) g_links[head].prev = page;
+    g_free_head[zone][order] = page;
+    g_free_count[zone][order]++;
+    g_order[page] = (uint8_t)order;
+
+    g_stats.free_pages += 1u << order;
+    g_stats.zone_free[zone] += 1u << order;
+}
+
+static void pmm_list_remove(uint32_t page, uint32_t order) {
+    uint32_t zone = pmm_zone_of(page);
+    pmm_link_t* link = &g_links[page];
+
+    if (link->prev != PMM_NONE) g_links[link->prev].next = link->next;
+    else g_free_head[zone][order] = link->next;
+    if (link->next != PMM_NONE) g_links[link->next].prev = link->prev;
+    g_free_count[zone][order]--;
+    g_order[page] = PMM_ORDER_USED;
+
+    g_stats.free_pages -= 1u << order;
+    g_stats.zone_free[zone] -= 1u << order;
+}
+
+/**
+ * Return a block and merge it with its buddies as far as possible
+ */
+static void pmm_buddy_free(uint32_t page, uint32_t order) {
+    while (order < PMM_MAX_ORDER) {
+        uint32_t buddy = page ^ (1u << order);
+        if (buddy >= g_page_count || g_order[buddy] != order) break;
+        pmm_list_remove(buddy, order);
+        page &= ~(1u << order);
+        order++;
+    }
+    pmm_list_insert(page, order);
+}
+
+static uint32_t pmm_buddy_alloc(uint32_t order, uint32_t zone) {
+    for (uint32_t k = order; k <= PMM_MAX_ORDER; k++) {
+        uint32_t page = g_free_head[zone][k];
+        if (page == PMM_NONE) continue;
+
+        pmm_list_remove(page, k);
+
+        // Split, returning the upper halves
+        while (k > order) {
+            k--;
+            pmm_list_insert(page + (1u << k), k);
         }
+        return page;
     }
-    return 0; // Out of memory
+    return PMM_NONE;
 }
 
-void pmm_free_page(uint32_t addr) {
-    uint32_t page = addr / 0x1000;
-    clear_bit(page);
+/**
+ * Take one specific page out of whatever free block contains it
+ */
+static bool pmm_claim_page(uint32_t page) {
+    for (uint32_t k = 0; k <= PMM_MAX_ORDER; k++) {
+        uint32_t head = page & ~((1u << k) - 1);
+        if (g_order[head] != k) continue;
+
+        pmm_list_remove(head, k);
+        while (k > 0) {
+            k--;
+            uint32_t half = 1u << k;
+            if (page < head + half) {
+                pmm_list_insert(head + half, k);
+            } else {
+                pmm_list_insert(head, k);
+                head += half;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+// ────────────────
+// Setup
+// ────────────────
+void pmm_init(void) {
+    // Nothing is free until the memory map has been parsed
+    g_links = NULL;
+    g_order = NULL;
+    g_page_count = 0;
+    g_reserved_end = 0;
+    memset(&g_stats, 0, sizeof(g_stats));
+    memset(g_free_count, 0, sizeof(g_free_count));
+    memset(g_pcp, 0, sizeof(g_pcp));
+    for (uint32_t z = 0; z < PMM_ZONE_COUNT; z++) {
+        for (uint32_t k = 0; k <= PMM_MAX_ORDER; k++) {
+            g_free_head[z][k] = PMM_NONE;
+        }
+    }
+}
+
+/**
+ * Size the allocator for memory up to 'highest_addr'. The page metadata
+ * goes right after the kernel image, in the usable memory-map region
+ * that holds it (ending at 'usable_end'), and must stay inside the
+ * identity map; coverage shrinks to what fits. Everything below the
+ * metadata's end stays reserved.
+ */
+bool pmm_setup(uint64_t highest_addr, uint32_t usable_end) {
+    if (highest_addr > 0x100000000ULL) highest_addr = 0x100000000ULL;
+    uint32_t pages = (uint32_t)(highest_addr >> 12);
+
+    uint32_t meta_start = ALIGN_UP((uint32_t)kernel_image_end, PMM_PAGE_SIZE);
+    uint32_t meta_limit = usable_end < PMM_LOW_LIMIT ? usable_end : PMM_LOW_LIMIT;
+    uint32_t per_page = sizeof(pmm_link_t) + sizeof(uint8_t);
+    if (meta_start + PMM_PAGE_SIZE >= meta_limit) {
+        SERIAL_LOG_HEX("PMM: no room for metadata after the kernel at ", meta_start);
+        return false;
+    }
+
+    uint32_t max_pages = (meta_limit - meta_start - PMM_PAGE_SIZE) / per_page;
+    if (pages > max_pages) {
+        SERIAL_LOG_DEC("PMM: page metadata limited to pages ", max_pages);
+        pages = max_pages;
+    }
+
+    g_links = (pmm_link_t*)meta_start;
+    g_order = (uint8_t*)(meta_start + pages * sizeof(pmm_link_t));
+    uint32_t meta_end = ALIGN_UP((uint32_t)(g_order + pages), PMM_PAGE_SIZE);
+
+    memset(g_order, PMM_ORDER_USED, pages);
+    g_page_count = pages;
+    g_reserved_end = meta_end / PMM_PAGE_SIZE;
+
+    g_stats.highest_page = pages;
+    g_stats.metadata_bytes = meta_end - meta_start;
+
+    SERIAL_LOG_HEX("PMM: kernel end ", (uint32_t)kernel_image_end);
+    SERIAL_LOG_DEC("PMM: pages covered ", pages);
+    return true;
 }
 
+/**
+ * Add a usable range to the free lists (kernel image and metadata are
+ * clipped out)
+ */
 void pmm_mark_region_free(uint32_t start_addr, uint32_t length) {
-    uint32_t start_page = start_addr / 0x1000;
-    uint32_t num_pages = length / 0x1000;
-    for (uint32_t i = 0; i < num_pages; ++i) {
-        clear_bit(start_page + i);
+    uint32_t start = (start_addr + PMM_PAGE_SIZE - 1) / PMM_PAGE_SIZE;
+    uint32_t end = (uint32_t)(((uint64_t)start_addr + length) >> 12);
+    if (start < g_reserved_end) start = g_reserved_end;
+    if (end > g_page_count) end = g_page_count;
+    if (start >= end) return;
+
+    uint32_t flags = pmm_lock();
+    uint32_t page = start;
+    while (page < end) {
+        // Largest aligned block that fits in what is left
+        uint32_t order = 0;
+        while (order < PMM_MAX_ORDER &&
+               (page & ((2u << order) - 1)) == 0 &&
+               page + (2u << order) <= end) {
+            order++;
+        }
+        // Skip pages already on a free list
+        bool already_free = false;
+        for (uint32_t k = 0; k <= PMM_MAX_ORDER && !already_free; k++) {
+            already_free = g_order[page & ~((1u << k) - 1)] == k;
+        }
+        if (already_free) {
+            page++;
+            continue;
+        }
+        if (order > 0) {
+            // Only free whole blocks whose pages are all currently used
+            for (uint32_t i = 1; i < (1u << order); i++) {
+                if (g_order[page + i] != PMM_ORDER_USED) { order = 0; break; }
+            }
+        }
+        pmm_buddy_free(page, order);
+        g_stats.managed_pages += 1u << order;
+        page += 1u << order;
     }
+    pmm_unlock(flags);
 }
 
 void pmm_mark_region_used(uint32_t start_addr, uint32_t length) {
-    uint32_t start_page = start_addr / 0x1000;
-    uint32_t num_pages = length / 0x1000;
-    for (uint32_t i = 0; i < num_pages; ++i) {
-        set_bit(start_page + i);
+    uint32_t start = start_addr / PMM_PAGE_SIZE;
+    uint32_t end = (uint32_t)(((uint64_t)start_addr + length + PMM_PAGE_SIZE - 1) >> 12);
+    if (end > g_page_count) end = g_page_count;
+
+    uint32_t flags = pmm_lock();
+    for (uint32_t page = start; page < end; page++) {
+        if (pmm_claim_page(page)) g_stats.managed_pages--;
     }
+    pmm_unlock(flags);
+}
+
+// ────────────────
+// Allocation
+// ────────────────
+uint32_t pmm_order_for_size(uint32_t size) {
+    uint32_t order = 0;
+    while (order < PMM_MAX_ORDER && ((uint32_t)PMM_PAGE_SIZE << order) < size) {
+        order++;
+    }
+    return order;
+}
+
+/**
+ * Contiguous 2^order pages from one zone only; 0 on failure
+ */
+uint32_t pmm_alloc_pages_zone(uint32_t order, uint32_t zone) {
+    if (order > PMM_MAX_ORDER || zone >= PMM_ZONE_COUNT) return 0;
+    if (order == 0) return pmm_pcp_alloc(zone);
+
+    uint32_t flags = pmm_lock();
+    uint32_t page = pmm_buddy_alloc(order, zone);
+    if (page != PMM_NONE) atomic_inc_u32(&g_stats.allocs);
+    pmm_unlock(flags);
+
+    return page == PMM_NONE ? 0 : page * PMM_PAGE_SIZE;
+}
+
+/**
+ * Contiguous 2^order pages, identity-mapped memory first
+ */
+uint32_t pmm_alloc_pages(uint32_t order) {
+    uint32_t addr = pmm_alloc_pages_zone(order, PMM_ZONE_LOW);
+    if (!addr) addr = pmm_alloc_pages_zone(order, PMM_ZONE_HIGH);
+    if (!addr) atomic_inc_u32(&g_stats.failed_allocs);
+    return addr;
+}
+
+void pmm_free_pages(uint32_t addr, uint32_t order) {
+    uint32_t page = addr / PMM_PAGE_SIZE;
+    if (page < g_reserved_end || page >= g_page_count || order > PMM_MAX_ORDER) return;
+
+    uint32_t flags = pmm_lock();
+    if (g_order[page] != PMM_ORDER_USED) {
+        SERIAL_LOG_HEX("PMM: double free of page ", addr);
+    } else {
+        pmm_buddy_free(page, order);
+        atomic_inc_u32(&g_stats.frees);
+    }
+    pmm_unlock(flags);
+}
+
+/**
+ * Single page through the per-CPU cache of a zone
+ */
+static uint32_t pmm_pcp_alloc(uint32_t zone) {
+    uint32_t flags = pmm_irq_save();
+    pmm_pcp_t* pcp = &g_pcp[smp_current_cpu()][zone];
+
+    if (pcp->count == 0) {
+        uint32_t lock_flags = pmm_lock();
+        while (pcp->count < PMM_PCP_BATCH) {
+            uint32_t page = pmm_buddy_alloc(0, zone);
+            if (page == PMM_NONE) break;
+            pcp->pages[pcp->count++] = page;
+        }
+        atomic_xadd_u32(&g_stats.cached_pages, pcp->count);
+        pmm_unlock(lock_flags);
+    } else {
+        atomic_inc_u32(&g_stats.cache_hits);
+    }
+
+    uint32_t page = PMM_NONE;
+    if (pcp->count > 0) {
+        page = pcp->pages[--pcp->count];
+        atomic_dec_u32(&g_stats.cached_pages);
+        atomic_inc_u32(&g_stats.allocs);
+    }
+    pmm_irq_restore(flags);
+
+    return page == PMM_NONE ? 0 : page * PMM_PAGE_SIZE;
+}
+
+uint32_t pmm_alloc_page(void) {
+    uint32_t addr = pmm_pcp_alloc(PMM_ZONE_LOW);
+    if (!addr) addr = pmm_pcp_alloc(PMM_ZONE_HIGH);
+    if (!addr) atomic_inc_u32(&g_stats.failed_allocs);
+    return addr;
+}
+
+void pmm_free_page(uint32_t addr) {
+    uint32_t page = addr / PMM_PAGE_SIZE;
+    if (page < g_reserved_end || page >= g_page_count) return;
+
+    uint32_t flags = pmm_irq_save();
+    pmm_pcp_t* pcp = &g_pcp[smp_current_cpu()][pmm_zone_of(page)];
+
+    if (pcp->count == PMM_PCP_MAX) {
+        uint32_t lock_flags = pmm_lock();
+        for (uint32_t i = 0; i < PMM_PCP_BATCH; i++) {
+            pmm_buddy_free(pcp->pages[--pcp->count], 0);
+        }
+        atomic_xadd_u32(&g_stats.cached_pages, (uint32_t)-PMM_PCP_BATCH);
+        pmm_unlock(lock_flags);
+    }
+
+    pcp->pages[pcp->count++] = page;
+    atomic_inc_u32(&g_stats.cached_pages);
+    atomic_inc_u32(&g_stats.frees);
+    pmm_irq_restore(flags);
+}
+
+// ────────────────
+// Statistics
+// ────────────────
+void pmm_get_stats(pmm_stats_t* stats) {
+    if (!stats) return;
+
+    uint32_t flags = pmm_lock();
+    *stats = g_stats;
+    for (uint32_t k = 0; k <= PMM_MAX_ORDER; k++) {
+        stats->order_blocks[k] = g_free_count[PMM_ZONE_LOW][k] + g_free_count[PMM_ZONE_HIGH][k];
+    }
+    pmm_unlock(flags);
 }
 
 void pmm_print_stats(void) {
-    uint32_t used = 0;
-    for (uint32_t i = 0; i < MAX_PHYSICAL_PAGES; ++i) {
-        if (test_bit(i)) used++;
-    }
-    SERIAL_LOG("PMM:");
-    SERIAL_LOG_HEX(" %u pages used, ", used);
-    SERIAL_LOG_HEX(" %u free",  MAX_PHYSICAL_PAGES - used);
-    SERIAL_LOG_HEX(", %u total", MAX_PHYSICAL_PAGES);
-}
\ No newline at end of file
+    pmm_stats_t stats;
+    pmm_get_stats(&stats);
+
+    gfx_print("=== Physical Memory (buddy) ===\n");
+    gfx_print("Managed: ");
+    gfx_print_decimal(stats.managed_pages * 4);
+    gfx_print(" KB  free: ");
+    gfx_print_decimal(stats.free_pages * 4);
+    gfx_print(" KB  cached: ");
+    gfx_print_decimal(stats.cached_pages * 4);
+    gfx_print(" KB\nLow zone free: ");
+    gfx_print_decimal(stats.zone_free[PMM_ZONE_LOW] * 4);
+    gfx_print(" KB  high zone free: ");
+    gfx_print_decimal(stats.zone_free[PMM_ZONE_HIGH] * 4);
+    gfx_print(" KB\nHighest page: ");
+    gfx_print_hex(stats.highest_page * PMM_PAGE_SIZE);
+    gfx_print("  metadata: ");
+    gfx_print_decimal(stats.metadata_bytes / 1024);
+    gfx_print(" KB\nAllocs: ");
+    gfx_print_decimal(stats.allocs);
+    gfx_print("  frees: ");
+    gfx_print_decimal(stats.frees);
+    gfx_print("  cache hits: ");
+    gfx_print_decimal(stats.cache_hits);
+    gfx_print("  failed: ");
+    gfx_print_decimal(stats.failed_allocs);
+    gfx_print("\n");
+
+    SERIAL_LOG_DEC("PMM: free pages ", stats.free_pages);
+}
+
+void pmm_dump_free_lists(void) {
+    uint32_t flags = pmm_lock();
+    uint32_t counts[PMM_ZONE_COUNT][PMM_MAX_ORDER + 1];
+    uint32_t first[PMM_ZONE_COUNT][PMM_MAX_ORDER + 1];
+    for (uint32_t z = 0; z < PMM_ZONE_COUNT; z++) {
+        for (uint32_t k = 0; k <= PMM_MAX_ORDER; k++) {
+            counts[z][k] = g_free_count[z][k];
+            first[z][k] = g_free_head[z][k];
+        }
+    }
+    pmm_unlock(flags);
+
+    gfx_print("Order  Size     Low    High   First(low)\n");
+    for (uint32_t k = 0; k <= PMM_MAX_ORDER; k++) {
+        gfx_print_decimal(k);
+        gfx_print("\t");
+        gfx_print_decimal(4u << k);
+        gfx_print("K\t");
+        gfx_print_decimal(counts[PMM_ZONE_LOW][k]);
+        gfx_print("\t");
+        gfx_print_decimal(counts[PMM_ZONE_HIGH][k]);
+        gfx_print("\t");
+        if (first[PMM_ZONE_LOW][k] != PMM_NONE) {
+            gfx_print_hex(first[PMM_ZONE_LOW][k] * PMM_PAGE_SIZE);
+        } else {
+            gfx_print("-");
+        }
+        gfx_print("\n");
+    }
+}
@@ -5,7 +5,7 @@
 //#include "overlay.h"
 
 #define PAGE_SIZE 0x1000
-#define IDENTITY_PDE_COUNT 8
+#define IDENTITY_PDE_COUNT (PMM_LOW_LIMIT >> 22)   // 4MB per page table
 #define EARLY_PAGETABLE_POOL 16
 
 static uint32_t page_directory[1024] __attribute__((aligned(4096)));
@@ -37,7 +37,9 @@ void* vmm_alloc_pages(size_t num_pages) {
     void* base = (void*)vmm_next_virtual_addr;
 
     for (size_t i = 0; i < num_pages; ++i) {
-        uint32_t phys = pmm_alloc_page();
+        // Mapped memory does not need to be identity mapped; spare the low zone
+        uint32_t phys = pmm_alloc_pages_zone(0, PMM_ZONE_HIGH);
+        if (!phys) phys = pmm_alloc_page();
         if (!phys) return NULL;
 
         vmm_map_page(vmm_next_virtual_addr, phys, PAGE_PRESENT | PAGE_WRITE);
@@ -50,6 +52,15 @@ void* vmm_alloc_pages(size_t num_pages) {
     return base;
 }
 
+// Like vmm_alloc_pages, but the page below the block is left unmapped so
+// running off its bottom faults. Needs paging; NULL before it is on.
+void* vmm_alloc_guarded_pages(size_t num_pages) {
+    if (!vmm_initialized || !paging_enabled || num_pages == 0) return NULL;
+
+    vmm_next_virtual_addr += PAGE_SIZE;  // Guard page, never mapped
+    return vmm_alloc_pages(num_pages);
+}
+
 void vmm_free_pages(void* addr, size_t num_pages) {
     if (!vmm_initialized || !addr || num_pages == 0) return;
 
@@ -204,7 +215,7 @@ void vmm_init(void) {
         page_directory[i] = 0;
     }
 
-    // Identity-map the first 32MB (loader + kernel + early tables)
+    // Identity-map the low zone (loader + kernel + PMM metadata + early tables)
     for (int pde = 0; pde < IDENTITY_PDE_COUNT; pde++) {
         for (int entry = 0; entry < 1024; entry++) {
             uint32_t phys_page = (pde * 1024u + entry) * PAGE_SIZE;
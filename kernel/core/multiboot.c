@@ -16,6 +16,8 @@
 #include "core/memory/pmm/pmm.h"
 
 
+extern uint8_t kernel_image_end[];
+
 static multiboot_info_t* g_multiboot_info = NULL;
 
 void multiboot_parse_info(uint32_t magic, multiboot_info_t* mbi) {
@@ -155,23 +157,56 @@ void multiboot_detect_vbe_framebuffer(multiboot_info_t* mbi) {
 void multiboot_parse_memory_map(multiboot_info_t* mbi) {
     if (!(mbi->flags & MULTIBOOT_FLAG_MMAP)) return;
 
-    //pmm_init();
-    multiboot_memory_map_t* mmap = (multiboot_memory_map_t*)mbi->mmap_addr;
+    multiboot_memory_map_t* mmap_start = (multiboot_memory_map_t*)mbi->mmap_addr;
     multiboot_memory_map_t* mmap_end = (multiboot_memory_map_t*)(mbi->mmap_addr + mbi->mmap_length);
+    multiboot_memory_map_t* mmap;
+
+    // First pass: size the page allocator for the highest usable address and
+    // find where the RAM holding the kernel image ends (PMM metadata goes there)
+    uint64_t highest = 0;
+    uint32_t image_end = (uint32_t)kernel_image_end;
+    uint32_t usable_end = 0;
+    for (mmap = mmap_start; mmap < mmap_end;
+         mmap = (multiboot_memory_map_t*)((uint32_t)mmap + mmap->size + sizeof(mmap->size))) {
+        if (mmap->type == MULTIBOOT_MEMORY_AVAILABLE && mmap->addr < 0x100000000ULL) {
+            uint64_t end = mmap->addr + mmap->len;
+            if (end > 0x100000000ULL) end = 0x100000000ULL;
+            if (end > highest) highest = end;
+            if (mmap->addr <= image_end && image_end < end) {
+                usable_end = (end == 0x100000000ULL) ? 0xFFFFF000u : (uint32_t)end;
+            }
+        }
+    }
+    if (!pmm_setup(highest, usable_end)) {
+        debug_buffer_append("PMM setup failed\n");
+        return;
+    }
 
-    while (mmap < mmap_end) {
+    // Second pass: hand usable memory above 1MB to the buddy allocator
+    // (the kernel image and the PMM metadata are reserved by pmm_setup)
+    for (mmap = mmap_start; mmap < mmap_end;
+         mmap = (multiboot_memory_map_t*)((uint32_t)mmap + mmap->size + sizeof(mmap->size))) {
         if (mmap->type == MULTIBOOT_MEMORY_AVAILABLE && mmap->addr < 0x100000000ULL) {
-            uint32_t start = (uint32_t)mmap->addr;
-            uint32_t length = (uint32_t)mmap->len;
-            uint32_t page_start = (start + 0xFFF) & ~0xFFF;
-            uint32_t page_end = (start + length) & ~0xFFF;
+            uint64_t end = mmap->addr + mmap->len;
+            if (end > 0x100000000ULL) end = 0x100000000ULL;
+            uint64_t page_start = (mmap->addr + 0xFFF) & ~0xFFFULL;
+            uint64_t page_end = end & ~0xFFFULL;
             if (page_start < 0x100000) page_start = 0x100000;
-            if (page_end > page_start) pmm_mark_region_free(page_start, page_end - page_start);
+            if (page_end > page_start) {
+                pmm_mark_region_free((uint32_t)page_start, (uint32_t)(page_end - page_start));
+            }
         }
-        mmap = (multiboot_memory_map_t*)((uint32_t)mmap + mmap->size + sizeof(mmap->size));
     }
 
-    pmm_mark_region_used(0x100000, 0x400000);  // Reserve kernel space
+    // Page tables, DMA buffers and early heap expansion all assume LOW pages
+    pmm_stats_t stats;
+    pmm_get_stats(&stats);
+    if (stats.zone_free[PMM_ZONE_LOW] == 0) {
+        SERIAL_LOG("PMM: no free pages below the identity-map limit\n");
+        kernel_panic("PMM low zone is empty");
+    }
+
+    debug_buffer_append_dec("Usable memory (MB): ", (uint32_t)(highest >> 20));
     debug_buffer_append("Memory map parsed and PMM initialized\n");
 }
 
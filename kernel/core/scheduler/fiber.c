@@ -0,0 +1,564 @@
+#include "fiber.h"
+#include "../kernel.h"
+#include "../memory/object_cache.h"
+#include "../ktime.h"
+#include "../timer.h"
+#include "../sleep.h"
+#include "../smp.h"
+#include "../atomic.h"
+#include "../string.h"
+#include "config.h"
+
+/* Written at the lowest word of every fiber stack; checked whenever the
+   fiber switches out */
+#define FIBER_STACK_CANARY  0x46494245
+
+/* Fiber that owns a timer node */
+#define FIBER_FROM_TIMER(node) \
+    ((fiber_t*)((char*)(node) - __builtin_offsetof(fiber_t, timer)))
+
+/* Per-CPU executor */
+typedef struct {
+    spinlock_t lock;                /* Ready queue, timers and fiber states */
+    fiber_t *ready_head;
+    fiber_t *ready_tail;
+    uint32_t nr_ready;
+    timer_wheel_t timers;           /* Keyed on fiber_now() */
+    fiber_t *current;               /* Fiber being run, NULL between fibers */
+    uint32_t sched_esp;             /* Executor stack while a stackful fiber runs */
+    uint32_t nr_fibers;
+    uint32_t resumes;
+} __attribute__((aligned(64))) fiber_executor_t;
+
+static fiber_executor_t fiber_exec[SMP_MAX_CPUS];
+static object_cache_t *fiber_cache = NULL;
+static object_cache_t *fiber_stack_cache = NULL;
+static volatile uint32_t fiber_next_id = 1;
+static volatile uint32_t fiber_spawned = 0;
+static volatile uint32_t fiber_stacks_in_use = 0;
+static volatile uint32_t fiber_overflows = 0;
+static bool fiber_initialized = false;
+
+static void fiber_trampoline(void);
+
+/* Scheduler ticks since boot, from ktime so they move with IRQs masked */
+static inline uint32_t fiber_now(void)
+{
+    return (uint32_t)ktime_div_u32(ktime_get(), NSEC_PER_SEC / TIMER_HZ);
+}
+
+static inline uint32_t fiber_ms_to_ticks(uint32_t ms)
+{
+    return (ms + MS_PER_TICK - 1) / MS_PER_TICK;
+}
+
+static inline fiber_executor_t* fiber_this_exec(void)
+{
+    uint32_t cpu = smp_current_cpu();
+    return &fiber_exec[cpu < SMP_MAX_CPUS ? cpu : 0];
+}
+
+void fiber_init(void)
+{
+    if (fiber_initialized) {
+        return;
+    }
+
+    fiber_cache = object_cache_create("fiber", sizeof(fiber_t), 16, NULL);
+    fiber_stack_cache = object_cache_create("fiber_stack", FIBER_STACK_SIZE, 16, NULL);
+    if (!fiber_cache || !fiber_stack_cache) {
+        SERIAL_LOG("FIBER: Failed to create caches\n");
+        return;
+    }
+
+    uint32_t now = fiber_now();
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        fiber_executor_t *exec = &fiber_exec[cpu];
+        spin_lock_init(&exec->lock, "fiber_exec");
+        exec->ready_head = exec->ready_tail = NULL;
+        exec->nr_ready = 0;
+        timer_wheel_init(&exec->timers, now);
+        exec->current = NULL;
+        exec->nr_fibers = 0;
+        exec->resumes = 0;
+    }
+
+    fiber_initialized = true;
+    SERIAL_LOG("FIBER: Executors initialized\n");
+}
+
+/* ──────────── Executor queues ──────────── */
+
+/* exec is locked */
+static void fiber_enqueue(fiber_executor_t *exec, fiber_t *fiber)
+{
+    fiber->next = NULL;
+    if (exec->ready_tail) {
+        exec->ready_tail->next = fiber;
+    } else {
+        exec->ready_head = fiber;
+    }
+    exec->ready_tail = fiber;
+    exec->nr_ready++;
+}
+
+/* exec is locked */
+static fiber_t* fiber_dequeue(fiber_executor_t *exec)
+{
+    fiber_t *fiber = exec->ready_head;
+    if (fiber) {
+        exec->ready_head = fiber->next;
+        if (!exec->ready_head) {
+            exec->ready_tail = NULL;
+        }
+        fiber->next = NULL;
+        exec->nr_ready--;
+    }
+    return fiber;
+}
+
+/**
+ * End a wait. A fiber that is running right now is only marked ready;
+ * the executor requeues it once it switches out. exec is locked.
+ */
+static void fiber_make_ready(fiber_executor_t *exec, fiber_t *fiber)
+{
+    if (fiber->state != FIBER_STATE_WAITING) {
+        return;
+    }
+    if (timer_wheel_pending(&fiber->timer)) {
+        timer_wheel_remove(&exec->timers, &fiber->timer);
+    }
+    fiber->state = FIBER_STATE_READY;
+    if (exec->current != fiber) {
+        fiber_enqueue(exec, fiber);
+    }
+}
+
+static void fiber_timer_fire(timer_wheel_node_t *node)
+{
+    fiber_t *fiber = FIBER_FROM_TIMER(node);
+    fiber_make_ready(&fiber_exec[fiber->cpu], fiber);
+}
+
+/* ──────────── Spawning ──────────── */
+
+static fiber_t* fiber_alloc(uint32_t cpu, const char *name)
+{
+    if (!fiber_initialized) {
+        return NULL;
+    }
+
+    /* Only CPUs running their core loop drive an executor */
+    smp_cpu_t *info = cpu < SMP_MAX_CPUS ? smp_get_cpu(cpu) : NULL;
+    if (!info || !info->online) {
+        cpu = 0;
+    }
+
+    fiber_t *fiber = (fiber_t*)object_cache_alloc(fiber_cache);
+    if (!fiber) {
+        return NULL;
+    }
+    memset(fiber, 0, sizeof(*fiber));
+    fiber->id = atomic_xadd_u32(&fiber_next_id, 1);
+    fiber->name = name ? name : "fiber";
+    fiber->cpu = cpu;
+    return fiber;
+}
+
+static void fiber_free(fiber_t *fiber)
+{
+    if (fiber->stack) {
+        object_cache_free(fiber_stack_cache, fiber->stack);
+        atomic_dec_u32(&fiber_stacks_in_use);
+    }
+    object_cache_free(fiber_cache, fiber);
+}
+
+static void fiber_start(fiber_t *fiber)
+{
+    fiber_executor_t *exec = &fiber_exec[fiber->cpu];
+    fiber->state = FIBER_STATE_READY;
+
+    uint32_t flags = spin_lock_irqsave(&exec->lock);
+    exec->nr_fibers++;
+    fiber_enqueue(exec, fiber);
+    spin_unlock_irqrestore(&exec->lock, flags);
+
+    atomic_inc_u32(&fiber_spawned);
+}
+
+fiber_t* fiber_spawn_on(uint32_t cpu, const char *name, fiber_fn_t fn, void *arg)
+{
+    if (!fn) {
+        return NULL;
+    }
+    fiber_t *fiber = fiber_alloc(cpu, name);
+    if (!fiber) {
+        return NULL;
+    }
+
+    uint32_t *stack = (uint32_t*)object_cache_alloc(fiber_stack_cache);
+    if (!stack) {
+        object_cache_free(fiber_cache, fiber);
+        return NULL;
+    }
+    atomic_inc_u32(&fiber_stacks_in_use);
+    stack[0] = FIBER_STACK_CANARY;
+
+    /* Initial frame popped by fiber_switch: four callee-saved registers,
+       then a return into the trampoline, which finds a null return
+       address above it */
+    uint32_t *sp = (uint32_t*)((uint8_t*)stack + FIBER_STACK_SIZE);
+    *--sp = 0;
+    *--sp = (uint32_t)fiber_trampoline;
+    *--sp = 0;                      /* ebp */
+    *--sp = 0;                      /* ebx */
+    *--sp = 0;                      /* esi */
+    *--sp = 0;                      /* edi */
+
+    fiber->stack = stack;
+    fiber->esp = (uint32_t)sp;
+    fiber->entry = fn;
+    fiber->arg = arg;
+    fiber_start(fiber);
+    return fiber;
+}
+
+fiber_t* fiber_spawn(const char *name, fiber_fn_t fn, void *arg)
+{
+    return fiber_spawn_on(smp_current_cpu(), name, fn, arg);
+}
+
+fiber_t* fiber_spawn_poll_on(uint32_t cpu, const char *name, fiber_poll_fn_t poll, void *arg)
+{
+    if (!poll) {
+        return NULL;
+    }
+    fiber_t *fiber = fiber_alloc(cpu, name);
+    if (!fiber) {
+        return NULL;
+    }
+    fiber->poll = poll;
+    fiber->arg = arg;
+    fiber_start(fiber);
+    return fiber;
+}
+
+fiber_t* fiber_spawn_poll(const char *name, fiber_poll_fn_t poll, void *arg)
+{
+    return fiber_spawn_poll_on(smp_current_cpu(), name, poll, arg);
+}
+
+/* ──────────── Events ──────────── */
+
+void fiber_event_init(fiber_event_t *ev, const char *name)
+{
+    spin_lock_init(&ev->lock, name);
+    ev->head = ev->tail = NULL;
+    ev->signaled = 0;
+}
+
+/* ev is locked */
+static void fiber_event_unlink(fiber_event_t *ev, fiber_t *fiber)
+{
+    if (fiber->wait_prev) {
+        fiber->wait_prev->wait_next = fiber->wait_next;
+    } else {
+        ev->head = fiber->wait_next;
+    }
+    if (fiber->wait_next) {
+        fiber->wait_next->wait_prev = fiber->wait_prev;
+    } else {
+        ev->tail = fiber->wait_prev;
+    }
+    fiber->wait_next = fiber->wait_prev = NULL;
+    fiber->event = NULL;
+}
+
+/**
+ * Set the event and wake every waiter; returns how many were woken. Safe
+ * from interrupt handlers and from any CPU.
+ */
+uint32_t fiber_event_signal(fiber_event_t *ev)
+{
+    uint32_t woken = 0;
+    uint32_t flags = spin_lock_irqsave(&ev->lock);
+    ev->signaled = 1;
+
+    fiber_t *fiber;
+    while ((fiber = ev->head) != NULL) {
+        fiber_event_unlink(ev, fiber);
+
+        fiber_executor_t *exec = &fiber_exec[fiber->cpu];
+        spin_lock(&exec->lock);
+        fiber_make_ready(exec, fiber);
+        spin_unlock(&exec->lock);
+        woken++;
+    }
+
+    spin_unlock_irqrestore(&ev->lock, flags);
+    return woken;
+}
+
+void fiber_event_reset(fiber_event_t *ev)
+{
+    atomic_store_u32(&ev->signaled, 0);
+}
+
+/**
+ * Leave the event list of a fiber about to resume. Still being on it
+ * means the timeout, not a signal, ended the wait.
+ */
+static void fiber_event_detach(fiber_t *fiber)
+{
+    fiber_event_t *ev = fiber->event;
+    if (!ev) {
+        return;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&ev->lock);
+    if (fiber->event == ev) {
+        fiber_event_unlink(ev, fiber);
+        fiber->timed_out = true;
+    }
+    spin_unlock_irqrestore(&ev->lock, flags);
+}
+
+/* ──────────── Waiting ──────────── */
+
+/**
+ * Park the fiber until ms have passed; 0 just yields
+ */
+void fiber_wait_ms(fiber_t *fiber, uint32_t ms)
+{
+    if (!ms) {
+        return;
+    }
+
+    fiber_executor_t *exec = &fiber_exec[fiber->cpu];
+    uint32_t flags = spin_lock_irqsave(&exec->lock);
+    fiber->state = FIBER_STATE_WAITING;
+    timer_wheel_add(&exec->timers, &fiber->timer, fiber_now() + fiber_ms_to_ticks(ms));
+    spin_unlock_irqrestore(&exec->lock, flags);
+}
+
+/**
+ * Park the fiber on ev, with an optional timeout. The fiber is queued
+ * and marked waiting under the event lock, so a signal racing with the
+ * caller's switch-out still finds it.
+ */
+bool fiber_wait_event(fiber_t *fiber, fiber_event_t *ev, uint32_t timeout_ms)
+{
+    uint32_t flags = spin_lock_irqsave(&ev->lock);
+    if (ev->signaled) {
+        spin_unlock_irqrestore(&ev->lock, flags);
+        fiber->timed_out = false;
+        return false;
+    }
+
+    fiber->timed_out = false;
+    fiber->event = ev;
+    fiber->wait_next = NULL;
+    fiber->wait_prev = ev->tail;
+    if (ev->tail) {
+        ev->tail->wait_next = fiber;
+    } else {
+        ev->head = fiber;
+    }
+    ev->tail = fiber;
+
+    fiber_executor_t *exec = &fiber_exec[fiber->cpu];
+    spin_lock(&exec->lock);
+    fiber->state = FIBER_STATE_WAITING;
+    if (timeout_ms) {
+        timer_wheel_add(&exec->timers, &fiber->timer, fiber_now() + fiber_ms_to_ticks(timeout_ms));
+    }
+    spin_unlock(&exec->lock);
+
+    spin_unlock_irqrestore(&ev->lock, flags);
+    return true;
+}
+
+/* ──────────── Stackful fibers ──────────── */
+
+fiber_t* fiber_current(void)
+{
+    if (!fiber_initialized) {
+        return NULL;
+    }
+    return fiber_this_exec()->current;
+}
+
+/* The running stackful fiber, or NULL */
+static fiber_t* fiber_current_stackful(void)
+{
+    fiber_t *fiber = fiber_current();
+    return fiber && fiber->stack ? fiber : NULL;
+}
+
+/* Back to the executor; returns when the fiber is resumed */
+static void fiber_suspend(fiber_t *fiber)
+{
+    if (((uint32_t*)fiber->stack)[0] != FIBER_STACK_CANARY) {
+        atomic_inc_u32(&fiber_overflows);
+        SERIAL_LOG("FIBER: Stack overflow detected\n");
+    }
+    fiber_switch(&fiber->esp, fiber_exec[fiber->cpu].sched_esp);
+}
+
+/* First frame of every stackful fiber */
+static void fiber_trampoline(void)
+{
+    fiber_t *fiber = fiber_current();
+    fiber->entry(fiber->arg);
+
+    fiber->state = FIBER_STATE_DEAD;
+    fiber_suspend(fiber);
+    /* Never resumed */
+}
+
+void fiber_yield(void)
+{
+    fiber_t *fiber = fiber_current_stackful();
+    if (fiber) {
+        fiber_suspend(fiber);
+    }
+}
+
+void fiber_sleep(uint32_t ms)
+{
+    fiber_t *fiber = fiber_current_stackful();
+    if (!fiber) {
+        sleep_ms(ms);
+        return;
+    }
+    fiber_wait_ms(fiber, ms);
+    fiber_suspend(fiber);
+}
+
+/**
+ * Wait until ev is set; false if the timeout passed first. Outside a
+ * stackful fiber the caller polls the event.
+ */
+bool fiber_await(fiber_event_t *ev, uint32_t timeout_ms)
+{
+    fiber_t *fiber = fiber_current_stackful();
+    if (!fiber) {
+        ktime_t deadline = timeout_ms ? ktime_get() + (uint64_t)timeout_ms * NSEC_PER_MSEC : 0;
+        while (!atomic_load_u32(&ev->signaled)) {
+            if (deadline && ktime_get() >= deadline) {
+                return false;
+            }
+            cpu_relax();
+        }
+        return true;
+    }
+
+    if (!fiber_wait_event(fiber, ev, timeout_ms)) {
+        return true;
+    }
+    fiber_suspend(fiber);
+    return !fiber->timed_out;
+}
+
+/* ──────────── Executor ──────────── */
+
+/* Run one dequeued fiber until it switches out */
+static void fiber_resume(fiber_executor_t *exec, fiber_t *fiber)
+{
+    fiber_event_detach(fiber);
+
+    if (fiber->poll) {
+        if (fiber->poll(fiber, fiber->arg) == FIBER_DONE) {
+            fiber->state = FIBER_STATE_DEAD;
+        }
+    } else {
+        fiber_switch(&exec->sched_esp, fiber->esp);
+    }
+
+    bool dead = fiber->state == FIBER_STATE_DEAD;
+
+    uint32_t flags = spin_lock_irqsave(&exec->lock);
+    exec->current = NULL;
+    if (dead) {
+        if (timer_wheel_pending(&fiber->timer)) {
+            timer_wheel_remove(&exec->timers, &fiber->timer);
+        }
+        exec->nr_fibers--;
+    } else if (fiber->state != FIBER_STATE_WAITING) {
+        /* Yielded, or woken before it got to switch out */
+        fiber->state = FIBER_STATE_READY;
+        fiber_enqueue(exec, fiber);
+    }
+    spin_unlock_irqrestore(&exec->lock, flags);
+
+    if (dead) {
+        fiber_event_detach(fiber);
+        fiber_free(fiber);
+    }
+}
+
+/**
+ * Run each fiber that is ready on entry once, after firing expired
+ * timers. Fibers that yield again wait for the next call, so a caller
+ * polling in a loop is never starved. Does nothing from inside a fiber.
+ */
+uint32_t fiber_run_pending(void)
+{
+    if (!fiber_initialized) {
+        return 0;
+    }
+    fiber_executor_t *exec = fiber_this_exec();
+    if (exec->current || (!exec->nr_ready && !exec->timers.pending)) {
+        return 0;
+    }
+
+    uint32_t now = fiber_now();
+    uint32_t flags = spin_lock_irqsave(&exec->lock);
+    if (exec->timers.pending) {
+        timer_wheel_advance(&exec->timers, now, fiber_timer_fire);
+    } else {
+        exec->timers.now = now + 1;     /* Nothing to fire: skip ahead */
+    }
+    uint32_t budget = exec->nr_ready;
+    spin_unlock_irqrestore(&exec->lock, flags);
+
+    uint32_t ran = 0;
+    while (ran < budget) {
+        flags = spin_lock_irqsave(&exec->lock);
+        fiber_t *fiber = fiber_dequeue(exec);
+        if (fiber) {
+            fiber->state = FIBER_STATE_RUNNING;
+            exec->current = fiber;
+            exec->resumes++;
+        }
+        spin_unlock_irqrestore(&exec->lock, flags);
+
+        if (!fiber) {
+            break;
+        }
+        fiber_resume(exec, fiber);
+        ran++;
+    }
+    return ran;
+}
+
+void fiber_get_stats(fiber_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    if (!fiber_initialized) {
+        return;
+    }
+
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        fiber_executor_t *exec = &fiber_exec[cpu];
+        stats->live_fibers += exec->nr_fibers;
+        stats->ready_fibers += exec->nr_ready;
+        stats->waiting_timers += exec->timers.pending;
+        stats->resumes += exec->resumes;
+    }
+    stats->spawned = fiber_spawned;
+    stats->stacks_in_use = fiber_stacks_in_use;
+    stats->stack_overflows = fiber_overflows;
+}
@@ -0,0 +1,38 @@
+; fiber_switch.asm - Cooperative context switch for fibers
+; Fibers only switch at calls into the fiber runtime, so only the
+; callee-saved registers and the stack pointer need saving; segments,
+; flags and the caller-saved registers are left alone.
+
+[BITS 32]
+
+SECTION .text
+
+global fiber_switch
+
+;
+; fiber_switch(uint32_t *save_esp, uint32_t new_esp)
+; Save the current context on its stack and resume the one at new_esp
+;
+; Parameters:
+;   [esp+4] = where to store the current stack pointer
+;   [esp+8] = stack pointer of the context to resume
+;
+; Frame left on a suspended stack (lowest address first):
+;   edi, esi, ebx, ebp, return address
+;
+fiber_switch:
+    mov eax, [esp + 4]
+    mov edx, [esp + 8]
+
+    push ebp
+    push ebx
+    push esi
+    push edi
+    mov [eax], esp
+
+    mov esp, edx
+    pop edi
+    pop esi
+    pop ebx
+    pop ebp
+    ret
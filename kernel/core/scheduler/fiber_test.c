@@ -0,0 +1,367 @@
+/**
+ * QARMA - Fiber Test
+ *
+ * Runs thousands of poll fibers and a few hundred stackful ones through
+ * the executors, exercises sleeps, event waits and timeouts, then checks
+ * every pooled stack came back. Finishes by timing a fiber switch
+ * against task_switch_context_asm, both ping-ponging between two
+ * contexts with interrupts off, and a full yield through the executor.
+ */
+
+#include "fiber.h"
+#include "task_manager.h"
+#include "../kernel.h"
+#include "../ktime.h"
+#include "../smp.h"
+#include "../atomic.h"
+#include "../string.h"
+#include "graphics/graphics.h"
+#include "config.h"
+
+#define FIBER_TEST_POLL         2000    /* Poll fibers on this CPU */
+#define FIBER_TEST_YIELDS       4       /* Resumes each poll fiber needs */
+#define FIBER_TEST_STACKFUL     256
+#define FIBER_TEST_PER_AP       32      /* Stackful fibers placed on each AP */
+#define FIBER_TEST_WAITERS      64
+#define FIBER_TEST_TIMEOUT_MS   5000
+#define FIBER_TEST_BENCH_ROUNDS 10000
+
+/* From task_switch.asm */
+extern void task_switch_context_asm(task_t *from_task, task_t *to_task);
+
+static uint8_t g_poll_steps[FIBER_TEST_POLL];
+static volatile uint32_t g_done = 0;
+static volatile uint32_t g_corrupted = 0;
+static volatile uint32_t g_arrived = 0;
+static volatile uint32_t g_woken = 0;
+static volatile uint32_t g_timeouts = 0;
+static fiber_event_t g_event = FIBER_EVENT_INIT("fiber_test");
+static fiber_event_t g_never = FIBER_EVENT_INIT("fiber_test_never");
+
+/* Drive this CPU's executor until *value reaches target */
+static bool fiber_test_drain(volatile uint32_t *value, uint32_t target)
+{
+    ktime_t deadline = ktime_get() + (uint64_t)FIBER_TEST_TIMEOUT_MS * NSEC_PER_MSEC;
+    while (atomic_load_u32(value) < target) {
+        if (ktime_get() >= deadline) {
+            return false;
+        }
+        if (!fiber_run_pending()) {
+            cpu_relax();
+        }
+    }
+    return true;
+}
+
+static uint32_t fiber_test_report(const char *label, uint32_t got, uint32_t want)
+{
+    gfx_print("  ");
+    gfx_print(label);
+    gfx_print(": ");
+    gfx_print_decimal(got);
+    gfx_print("/");
+    gfx_print_decimal(want);
+    gfx_print(got == want ? "  OK\n" : "  FAIL\n");
+    return got == want ? 0 : 1;
+}
+
+/* ──────────── Functional phases ──────────── */
+
+static int fiber_test_poll(fiber_t *fiber, void *arg)
+{
+    uint32_t index = (uint32_t)arg;
+
+    FIBER_BEGIN(fiber);
+    while (++g_poll_steps[index] < FIBER_TEST_YIELDS) {
+        FIBER_YIELD(fiber);
+    }
+    atomic_inc_u32(&g_done);
+    FIBER_END(fiber);
+}
+
+/* Locals must survive every switch */
+static void fiber_test_stackful(void *arg)
+{
+    uint32_t seed = (uint32_t)arg * 2654435761u;
+    volatile uint32_t local[8];
+    for (uint32_t i = 0; i < 8; i++) {
+        local[i] = seed + i;
+    }
+
+    fiber_yield();
+    fiber_sleep(20);
+    fiber_yield();
+
+    for (uint32_t i = 0; i < 8; i++) {
+        if (local[i] != seed + i) {
+            atomic_inc_u32(&g_corrupted);
+            break;
+        }
+    }
+    atomic_inc_u32(&g_done);
+}
+
+static void fiber_test_waiter(void *arg)
+{
+    (void)arg;
+    atomic_inc_u32(&g_arrived);
+    if (fiber_await(&g_event, 2000)) {
+        atomic_inc_u32(&g_woken);
+    }
+    atomic_inc_u32(&g_done);
+}
+
+static int fiber_test_timeout(fiber_t *fiber, void *arg)
+{
+    (void)arg;
+
+    FIBER_BEGIN(fiber);
+    FIBER_AWAIT(fiber, &g_never, 30);
+    if (fiber_timed_out(fiber)) {
+        atomic_inc_u32(&g_timeouts);
+    }
+    atomic_inc_u32(&g_done);
+    FIBER_END(fiber);
+}
+
+static uint32_t fiber_test_poll_phase(void)
+{
+    g_done = 0;
+    uint32_t spawned = 0;
+    for (uint32_t i = 0; i < FIBER_TEST_POLL; i++) {
+        g_poll_steps[i] = 0;
+        if (fiber_spawn_poll("test_poll", fiber_test_poll, (void*)i)) {
+            spawned++;
+        }
+    }
+    fiber_test_drain(&g_done, spawned);
+    return fiber_test_report("poll fibers", g_done, FIBER_TEST_POLL);
+}
+
+static uint32_t fiber_test_stackful_phase(void)
+{
+    g_done = 0;
+    g_corrupted = 0;
+    uint32_t spawned = 0;
+    for (uint32_t i = 0; i < FIBER_TEST_STACKFUL; i++) {
+        if (fiber_spawn("test_stack", fiber_test_stackful, (void*)i)) {
+            spawned++;
+        }
+    }
+
+    /* Some on every AP, which runs them from its core loop */
+    for (uint32_t cpu = 1; cpu < smp_cpu_count(); cpu++) {
+        smp_cpu_t *info = smp_get_cpu(cpu);
+        if (!info || !info->online) {
+            continue;
+        }
+        for (uint32_t i = 0; i < FIBER_TEST_PER_AP; i++) {
+            if (fiber_spawn_on(cpu, "test_remote", fiber_test_stackful, (void*)(cpu * 1000 + i))) {
+                spawned++;
+            }
+        }
+    }
+
+    fiber_test_drain(&g_done, spawned);
+    uint32_t errors = fiber_test_report("stackful fibers", g_done, spawned);
+    return errors + fiber_test_report("intact stacks", spawned - g_corrupted, spawned);
+}
+
+static uint32_t fiber_test_event_phase(void)
+{
+    g_done = 0;
+    g_arrived = 0;
+    g_woken = 0;
+    g_timeouts = 0;
+    fiber_event_reset(&g_event);
+
+    uint32_t spawned = 0;
+    for (uint32_t i = 0; i < FIBER_TEST_WAITERS; i++) {
+        if (fiber_spawn("test_wait", fiber_test_waiter, NULL)) {
+            spawned++;
+        }
+    }
+    fiber_test_drain(&g_arrived, spawned);
+
+    uint32_t signaled = fiber_event_signal(&g_event);
+    bool timeout_spawned = fiber_spawn_poll("test_timeout", fiber_test_timeout, NULL) != NULL;
+    fiber_test_drain(&g_done, spawned + (timeout_spawned ? 1 : 0));
+
+    uint32_t errors = fiber_test_report("event waiters woken", g_woken, FIBER_TEST_WAITERS);
+    errors += fiber_test_report("woken by signal", signaled, FIBER_TEST_WAITERS);
+    return errors + fiber_test_report("timed out waits", g_timeouts, 1);
+}
+
+/* ──────────── Switch latency ──────────── */
+
+static uint32_t g_bench_main_esp;
+static uint32_t g_bench_peer_esp;
+static task_t g_bench_main_task;
+static task_t g_bench_peer_task;
+static uint8_t g_bench_stack[FIBER_STACK_SIZE] __attribute__((aligned(16)));
+
+static void fiber_bench_peer(void)
+{
+    for (;;) {
+        fiber_switch(&g_bench_peer_esp, g_bench_main_esp);
+    }
+}
+
+static void task_bench_peer(void)
+{
+    for (;;) {
+        task_switch_context_asm(&g_bench_peer_task, &g_bench_main_task);
+    }
+}
+
+static inline uint32_t fiber_bench_irq_save(void)
+{
+    uint32_t flags;
+    __asm__ volatile("pushfl; popl %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void fiber_bench_irq_restore(uint32_t flags)
+{
+    if (flags & 0x200) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
+
+/* Cycles per switch of a fiber_switch ping-pong */
+static uint32_t fiber_bench_switch(void)
+{
+    uint32_t *sp = (uint32_t*)(g_bench_stack + sizeof(g_bench_stack));
+    *--sp = 0;
+    *--sp = (uint32_t)fiber_bench_peer;
+    for (uint32_t i = 0; i < 4; i++) {
+        *--sp = 0;
+    }
+    g_bench_peer_esp = (uint32_t)sp;
+
+    uint32_t flags = fiber_bench_irq_save();
+    uint64_t start = ktime_get_cycles();
+    for (uint32_t i = 0; i < FIBER_TEST_BENCH_ROUNDS; i++) {
+        fiber_switch(&g_bench_main_esp, g_bench_peer_esp);
+    }
+    uint64_t cycles = ktime_get_cycles() - start;
+    fiber_bench_irq_restore(flags);
+
+    return (uint32_t)ktime_div_u32(cycles, 2 * FIBER_TEST_BENCH_ROUNDS);
+}
+
+/* Cycles per switch of a task_switch_context_asm ping-pong */
+static uint32_t fiber_bench_task_switch(void)
+{
+    cpu_context_t *ctx = &g_bench_peer_task.context;
+    memset(ctx, 0, sizeof(*ctx));
+    __asm__ volatile("mov %%cs, %0" : "=r"(ctx->cs));
+    __asm__ volatile("mov %%ds, %0" : "=r"(ctx->ds));
+    __asm__ volatile("mov %%es, %0" : "=r"(ctx->es));
+    __asm__ volatile("mov %%fs, %0" : "=r"(ctx->fs));
+    __asm__ volatile("mov %%gs, %0" : "=r"(ctx->gs));
+    __asm__ volatile("mov %%ss, %0" : "=r"(ctx->ss));
+
+    /* The peer starts as if called, with a null return address */
+    uint32_t *sp = (uint32_t*)(g_bench_stack + sizeof(g_bench_stack));
+    *--sp = 0;
+    ctx->esp = (uint32_t)sp;
+    ctx->eip = (uint32_t)task_bench_peer;
+    ctx->eflags = 0x2;                  /* Interrupts off */
+
+    uint32_t flags = fiber_bench_irq_save();
+    uint64_t start = ktime_get_cycles();
+    for (uint32_t i = 0; i < FIBER_TEST_BENCH_ROUNDS; i++) {
+        task_switch_context_asm(&g_bench_main_task, &g_bench_peer_task);
+    }
+    uint64_t cycles = ktime_get_cycles() - start;
+    fiber_bench_irq_restore(flags);
+
+    return (uint32_t)ktime_div_u32(cycles, 2 * FIBER_TEST_BENCH_ROUNDS);
+}
+
+static void fiber_bench_yielder(void *arg)
+{
+    (void)arg;
+    for (uint32_t i = 0; i < FIBER_TEST_BENCH_ROUNDS; i++) {
+        fiber_yield();
+    }
+    atomic_inc_u32(&g_done);
+}
+
+static int fiber_bench_poller(fiber_t *fiber, void *arg)
+{
+    (void)fiber;
+    uint32_t *rounds = (uint32_t*)arg;
+    if (++*rounds < FIBER_TEST_BENCH_ROUNDS) {
+        return FIBER_PENDING;
+    }
+    atomic_inc_u32(&g_done);
+    return FIBER_DONE;
+}
+
+/* Cycles per executor resume of a lone fiber, stackful or poll */
+static uint32_t fiber_bench_executor(bool stackful)
+{
+    static uint32_t rounds;
+    rounds = 0;
+    g_done = 0;
+
+    fiber_t *fiber = stackful ? fiber_spawn("bench_yield", fiber_bench_yielder, NULL)
+                              : fiber_spawn_poll("bench_poll", fiber_bench_poller, &rounds);
+    if (!fiber) {
+        return 0;
+    }
+
+    uint64_t start = ktime_get_cycles();
+    fiber_test_drain(&g_done, 1);
+    uint64_t cycles = ktime_get_cycles() - start;
+    return (uint32_t)ktime_div_u32(cycles, FIBER_TEST_BENCH_ROUNDS);
+}
+
+static void fiber_bench_print(const char *label, uint32_t cycles)
+{
+    gfx_print("  ");
+    gfx_print(label);
+    gfx_print(": ");
+    gfx_print_decimal(cycles);
+    gfx_print(" cycles\n");
+}
+
+static void fiber_test_bench(void)
+{
+    if (!ktime_has_tsc()) {
+        gfx_print("No TSC; switch latency not measured\n");
+        return;
+    }
+
+    gfx_print("Switch latency (");
+    gfx_print_decimal(FIBER_TEST_BENCH_ROUNDS);
+    gfx_print(" round trips):\n");
+    fiber_bench_print("task_switch_context_asm", fiber_bench_task_switch());
+    fiber_bench_print("fiber_switch           ", fiber_bench_switch());
+    fiber_bench_print("executor yield         ", fiber_bench_executor(true));
+    fiber_bench_print("executor poll          ", fiber_bench_executor(false));
+}
+
+void fiber_test(void)
+{
+    gfx_print("\n=== Fiber Test ===\n");
+    fiber_init();
+
+    fiber_stats_t before, after;
+    fiber_get_stats(&before);
+
+    uint32_t errors = fiber_test_poll_phase();
+    errors += fiber_test_stackful_phase();
+    errors += fiber_test_event_phase();
+
+    fiber_get_stats(&after);
+    errors += fiber_test_report("stacks in use", after.stacks_in_use, before.stacks_in_use);
+    errors += fiber_test_report("stack overflows", after.stack_overflows, before.stack_overflows);
+
+    fiber_test_bench();
+
+    gfx_print(errors ? "Fiber test FAILED\n" : "Fiber test passed\n");
+    SERIAL_LOG(errors ? "FIBER_TEST: FAILED\n" : "FIBER_TEST: passed\n");
+}
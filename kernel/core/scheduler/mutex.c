@@ -0,0 +1,114 @@
+#include "mutex.h"
+#include "../smp.h"
+
+/* Spin iterations on a running owner before sleeping */
+#define MUTEX_SPIN_LIMIT 1000
+
+void mutex_init(mutex_t *mutex, const char *name)
+{
+    mutex->locked = 0;
+    mutex->owner = NULL;
+    wait_queue_init(&mutex->waiters, name);
+#ifdef LOCK_STATS
+    mutex->name = name;
+    mutex->stats = (lock_stats_t){0};
+#endif
+}
+
+static bool mutex_try_acquire(void *arg)
+{
+    mutex_t *mutex = (mutex_t*)arg;
+    if (atomic_load_u32(&mutex->locked) ||
+        atomic_cmpxchg_u32(&mutex->locked, 0, 1) != 0) {
+        return false;
+    }
+    mutex->owner = task_current();
+    return true;
+}
+
+/**
+ * Spin while the owner is running on another CPU; true if the mutex was
+ * taken meanwhile
+ */
+static bool mutex_spin_on_owner(mutex_t *mutex)
+{
+    task_t *self = task_current();
+    for (uint32_t spins = 0; spins < MUTEX_SPIN_LIMIT; spins++) {
+        task_t *owner = mutex->owner;
+        if (!owner || owner == self || owner->state != TASK_STATE_RUNNING) {
+            break;
+        }
+        if (mutex_try_acquire(mutex)) {
+            return true;
+        }
+        cpu_relax();
+    }
+    return mutex_try_acquire(mutex);
+}
+
+static bool mutex_lock_slow(mutex_t *mutex, uint32_t timeout_ms)
+{
+#ifdef LOCK_STATS
+    uint64_t start = ktime_get_cycles();
+#endif
+    bool acquired = mutex_spin_on_owner(mutex) ||
+                    wait_event(&mutex->waiters, mutex_try_acquire, mutex, timeout_ms);
+#ifdef LOCK_STATS
+    if (acquired) {
+        lock_stats_record_wait(&mutex->stats, start);
+    }
+#endif
+    return acquired;
+}
+
+void mutex_lock(mutex_t *mutex)
+{
+    if (mutex_trylock(mutex)) {
+        return;
+    }
+    mutex_lock_slow(mutex, WAIT_FOREVER);
+}
+
+/**
+ * Take the mutex, giving up after timeout_ms; false on timeout
+ */
+bool mutex_lock_timeout(mutex_t *mutex, uint32_t timeout_ms)
+{
+    if (mutex_trylock(mutex)) {
+        return true;
+    }
+    return mutex_lock_slow(mutex, timeout_ms);
+}
+
+bool mutex_trylock(mutex_t *mutex)
+{
+    if (!mutex_try_acquire(mutex)) {
+        return false;
+    }
+#ifdef LOCK_STATS
+    mutex->stats.acquisitions++;
+#endif
+    return true;
+}
+
+void mutex_unlock(mutex_t *mutex)
+{
+    mutex->owner = NULL;
+    atomic_store_u32(&mutex->locked, 0);
+    wake_up_one(&mutex->waiters);
+}
+
+bool mutex_is_locked(const mutex_t *mutex)
+{
+    return mutex->locked != 0;
+}
+
+const lock_stats_t* mutex_stats(const mutex_t *mutex)
+{
+#ifdef LOCK_STATS
+    return &mutex->stats;
+#else
+    (void)mutex;
+    return NULL;
+#endif
+}
@@ -0,0 +1,126 @@
+#include "sched_stats.h"
+#include "../ktime.h"
+#include "../string.h"
+#include "graphics/graphics.h"
+
+/* Bucket for a latency in microseconds */
+static inline uint32_t sched_hist_bucket(uint32_t us)
+{
+    uint32_t bucket = us ? 32 - __builtin_clz(us) : 0;
+    return bucket < SCHED_HIST_BUCKETS ? bucket : SCHED_HIST_BUCKETS - 1;
+}
+
+/* Exclusive upper bound of a bucket in microseconds */
+static inline uint32_t sched_hist_bucket_limit(uint32_t bucket)
+{
+    return 1u << bucket;
+}
+
+void sched_hist_add(sched_hist_t *hist, uint64_t ns)
+{
+    uint64_t us64 = ktime_to_us(ns);
+    uint32_t us = us64 > UINT32_MAX ? UINT32_MAX : (uint32_t)us64;
+
+    hist->buckets[sched_hist_bucket(us)]++;
+    hist->count++;
+    hist->total_ns += ns;
+    if (us > hist->max_us) {
+        hist->max_us = us;
+    }
+}
+
+void sched_hist_merge(sched_hist_t *into, const sched_hist_t *from)
+{
+    for (uint32_t i = 0; i < SCHED_HIST_BUCKETS; i++) {
+        into->buckets[i] += from->buckets[i];
+    }
+    into->count += from->count;
+    into->total_ns += from->total_ns;
+    if (from->max_us > into->max_us) {
+        into->max_us = from->max_us;
+    }
+}
+
+uint32_t sched_hist_percentile(const sched_hist_t *hist, uint32_t percent)
+{
+    if (!hist->count) {
+        return 0;
+    }
+
+    /* Rank of the sample, rounded up so p99 of 10 samples is the 10th */
+    uint32_t rank = (uint32_t)ktime_div_u32((uint64_t)hist->count * percent + 99, 100);
+    uint32_t seen = 0;
+    for (uint32_t i = 0; i < SCHED_HIST_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            uint32_t limit = sched_hist_bucket_limit(i);
+            return i == SCHED_HIST_BUCKETS - 1 || limit > hist->max_us ? hist->max_us : limit;
+        }
+    }
+    return hist->max_us;
+}
+
+uint32_t sched_hist_mean_us(const sched_hist_t *hist)
+{
+    return hist->count ? (uint32_t)ktime_to_us(ktime_div_u32(hist->total_ns, hist->count)) : 0;
+}
+
+void sched_latency_reset(sched_latency_t *lat)
+{
+    memset(lat, 0, sizeof(*lat));
+}
+
+void sched_latency_merge(sched_latency_t *into, const sched_latency_t *from)
+{
+    sched_hist_merge(&into->wakeup, &from->wakeup);
+    sched_hist_merge(&into->wait, &from->wait);
+    sched_hist_merge(&into->overrun, &from->overrun);
+    into->voluntary += from->voluntary;
+    into->involuntary += from->involuntary;
+}
+
+void sched_hist_print(const char *label, const sched_hist_t *hist)
+{
+    gfx_print(label);
+    gfx_print(" n=");
+    gfx_print_decimal(hist->count);
+    gfx_print(" mean=");
+    gfx_print_decimal(sched_hist_mean_us(hist));
+    gfx_print(" p50=");
+    gfx_print_decimal(sched_hist_percentile(hist, 50));
+    gfx_print(" p99=");
+    gfx_print_decimal(sched_hist_percentile(hist, 99));
+    gfx_print(" max=");
+    gfx_print_decimal(hist->max_us);
+    gfx_print("us\n   ");
+
+    /* Bucket counts up to the last non-empty one */
+    uint32_t last = 0;
+    for (uint32_t i = 0; i < SCHED_HIST_BUCKETS; i++) {
+        if (hist->buckets[i]) {
+            last = i;
+        }
+    }
+    for (uint32_t i = 0; i <= last && hist->count; i++) {
+        gfx_print(" <");
+        gfx_print_decimal(sched_hist_bucket_limit(i));
+        gfx_print(":");
+        gfx_print_decimal(hist->buckets[i]);
+    }
+    gfx_print("\n");
+}
+
+void sched_latency_print_summary(const sched_latency_t *lat)
+{
+    gfx_print(" wake p99 ");
+    gfx_print_decimal(sched_hist_percentile(&lat->wakeup, 99));
+    gfx_print(" wait p99 ");
+    gfx_print_decimal(sched_hist_percentile(&lat->wait, 99));
+    gfx_print(" overrun max ");
+    gfx_print_decimal(lat->overrun.max_us);
+    gfx_print("us sw ");
+    gfx_print_decimal(lat->voluntary);
+    gfx_print("v/");
+    gfx_print_decimal(lat->involuntary);
+    gfx_print("i");
+}
@@ -1,34 +1,84 @@
 #include "task_manager.h"
 #include "../kernel.h"
 #include "../memory/heap.h"
+#include "../memory/object_cache.h"
 #include "../timer.h"
+#include "../ktime.h"
+#include "../apic.h"
+#include "../smp.h"
+#include "../atomic.h"
+#include "../core_manager.h"
+#include "../softirq.h"
+#include "subsystem_registry.h"
+#include "fiber.h"
+#include "task_stack.h"
+#include "graphics/graphics.h"
 #include "config.h"
 #include "../string.h"
 
-/* Task manager global state */
+static object_cache_t *task_cache = NULL;
+
+/* Task manager global state (shared by every CPU) */
 static struct {
     bool initialized;
-    uint32_t next_task_id;
-    task_t *current_task;
+    volatile uint32_t lock;         /* Guards the blocked and terminated queues */
+    volatile uint32_t next_task_id;
+    uint32_t nr_cpus;               /* Run queues in use */
     task_manager_stats_t stats;
     
-    /* Ready queues per priority level */
-    task_t *ready_queue_head[5];
-    task_t *ready_queue_tail[5];
-    
     /* Other state queues */
     task_t *blocked_queue;
-    task_t *sleeping_queue;
     task_t *terminated_queue;
     
-    /* Idle task */
-    task_t *idle_task;
-    
     /* Scheduler state */
     bool scheduler_enabled;
-    uint32_t preempt_ticks;
 } task_mgr;
 
+/* Per-CPU run queue. Each CPU only picks tasks from its own queue; idle
+   and under-loaded CPUs pull work from the busiest one. Lock order: run
+   queues in CPU order, then task_mgr.lock. */
+typedef struct {
+    volatile uint32_t lock;
+    uint32_t cpu;
+    bool online;                    /* Accepts tasks */
+    ktimer_t tick_timer;            /* Scheduler tick of an application processor */
+    task_t *current_task;
+    task_t *idle_task;
+    task_t *switch_prev;            /* Task being switched out, see task_finish_switch() */
+    
+    /* Ready queues per priority level; bit N of ready_bitmap is set
+       while ready queue N is non-empty */
+    task_t *ready_queue_head[TASK_PRIORITY_COUNT];
+    task_t *ready_queue_tail[TASK_PRIORITY_COUNT];
+    uint32_t ready_bitmap;
+    uint32_t nr_ready;              /* Every ready task, deadline list included */
+    
+    /* Deadline class: ready jobs with budget left, earliest deadline
+       first, ahead of every priority queue */
+    task_t *dl_head;
+    uint32_t dl_bw;                 /* Admitted bandwidth, TASK_DL_BW_ONE = 100% */
+    uint32_t nr_dl_tasks;           /* Tasks admitted here */
+    ktimer_t dl_timer;              /* Budget exhaustion of the running job */
+    uint32_t dl_overruns;
+    uint32_t dl_misses;
+    
+    /* Sleeping tasks of this CPU, keyed on wake_time */
+    timer_wheel_t sleep_wheel;
+    
+    /* Load balancing */
+    uint32_t next_balance;          /* Tick of the next pull attempt */
+    uint32_t balance_failed;        /* Pulls in a row that found only cache-hot tasks */
+    
+    uint32_t preempt_ticks;
+    uint32_t context_switches;
+    uint32_t scheduler_calls;
+    uint32_t migrations;
+    
+    sched_latency_t latency;        /* Every task that ran here */
+} __attribute__((aligned(64))) task_rq_t;
+
+static task_rq_t task_rq[SMP_MAX_CPUS];
+
 /* Default stack size for tasks */
 #define DEFAULT_STACK_SIZE (8192)  /* 8KB default stack */
 #define IDLE_STACK_SIZE (2048)     /* 2KB for idle task */
@@ -42,21 +92,548 @@ static const uint32_t priority_time_slices[] = {
     [TASK_PRIORITY_IDLE]     = 1     /* 1 tick for idle */
 };
 
+/* Load balancing (in timer ticks) */
+#define TASK_BALANCE_INTERVAL       10  /* Periodic pull on a busy CPU */
+#define TASK_IDLE_BALANCE_INTERVAL  1   /* Pull attempts while idle */
+#define TASK_MIGRATION_COST         2   /* Tasks that ran this recently are cache-hot */
+#define TASK_BALANCE_HOT_RETRIES    4   /* Failed pulls before hot tasks may move */
+
+/* Scheduler tick period of the per-CPU deadline timer */
+#define TASK_TICK_NS (NSEC_PER_SEC / TIMER_HZ)
+
+/* Task that owns a sleep_node */
+#define TASK_FROM_SLEEP_NODE(node) \
+    ((task_t*)((char*)(node) - __builtin_offsetof(task_t, sleep_node)))
+
 /* Forward declarations */
 static task_t* task_alloc(void);
 static void task_free(task_t *task);
 static void task_queue_add(task_t **head, task_t **tail, task_t *task);
 static void task_queue_remove(task_t **head, task_t **tail, task_t *task);
-static task_t* task_queue_pop(task_t **head, task_t **tail);
-static task_t* task_select_next(void);
-static void task_add_to_ready_queue(task_t *task);
-static void task_remove_from_ready_queue(task_t *task);
+static task_t* task_select_next(task_rq_t *rq);
+static void task_wake_expired(timer_wheel_node_t *node);
+static void task_make_runnable(task_rq_t *rq, task_t *task);
+static void task_add_to_ready_queue(task_rq_t *rq, task_t *task);
+static void task_remove_from_ready_queue(task_rq_t *rq, task_t *task, bool still_waiting);
+static bool task_balance(task_rq_t *rq, uint32_t now);
+static void task_finish_switch(void);
+static void task_tick_timer(ktimer_t *timer);
+static void task_dl_budget_timer(ktimer_t *timer);
+static void task_dl_release_timer(ktimer_t *timer);
+static void task_bootstrap(void);
 static int idle_task_entry(void *data);
 static void task_setup_initial_stack(task_t *task, task_entry_func_t entry_point, void *user_data);
 
 /* Assembly function from task_switch.asm */
 extern void task_switch_context_asm(task_t *from_task, task_t *to_task);
 
+/* The timer tick touches the queues from interrupt context */
+static inline uint32_t task_irq_save(void)
+{
+    uint32_t flags;
+    __asm__ volatile("pushfl; popl %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void task_irq_restore(uint32_t flags)
+{
+    if (flags & 0x200) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
+
+/* Milliseconds to timer ticks, rounded up */
+static inline uint32_t task_ms_to_ticks(uint32_t milliseconds)
+{
+    return milliseconds >= 1000000 ? (milliseconds / 1000) * TIMER_HZ
+                                   : (milliseconds * TIMER_HZ + 999) / 1000;
+}
+
+/* Highest priority (lowest number) with a ready task; ready_bitmap != 0 */
+static inline task_priority_t task_ready_priority(task_rq_t *rq)
+{
+    return (task_priority_t)__builtin_ctz(rq->ready_bitmap);
+}
+
+/* Spinlocks; callers have interrupts disabled */
+static inline void task_spin_lock(volatile uint32_t *lock)
+{
+    while (atomic_xchg_u32(lock, 1)) {
+        while (atomic_load_u32(lock)) {
+            cpu_relax();
+        }
+    }
+}
+
+static inline void task_spin_unlock(volatile uint32_t *lock)
+{
+    atomic_store_u32(lock, 0);
+}
+
+static inline void task_rq_lock(task_rq_t *rq)
+{
+    task_spin_lock(&rq->lock);
+}
+
+static inline void task_rq_unlock(task_rq_t *rq)
+{
+    task_spin_unlock(&rq->lock);
+}
+
+/* Lock two run queues in CPU order */
+static void task_rq_double_lock(task_rq_t *a, task_rq_t *b)
+{
+    if (a == b) {
+        task_rq_lock(a);
+    } else if (a->cpu < b->cpu) {
+        task_rq_lock(a);
+        task_rq_lock(b);
+    } else {
+        task_rq_lock(b);
+        task_rq_lock(a);
+    }
+}
+
+static void task_rq_double_unlock(task_rq_t *a, task_rq_t *b)
+{
+    task_rq_unlock(a);
+    if (a != b) {
+        task_rq_unlock(b);
+    }
+}
+
+/* Run queue of the calling CPU */
+static inline task_rq_t* task_this_rq(void)
+{
+    uint32_t cpu = smp_current_cpu();
+    return &task_rq[cpu < task_mgr.nr_cpus ? cpu : 0];
+}
+
+/* Lock the run queue a task belongs to; task->cpu only changes with
+   both the old and the new queue locked */
+static task_rq_t* task_rq_lock_task(task_t *task)
+{
+    for (;;) {
+        task_rq_t *rq = &task_rq[task->cpu];
+        task_rq_lock(rq);
+        if (rq->cpu == task->cpu) {
+            return rq;
+        }
+        task_rq_unlock(rq);
+    }
+}
+
+/* Runnable tasks on a queue, counting the running one but not idle */
+static inline uint32_t task_rq_load(const task_rq_t *rq)
+{
+    const task_t *current = rq->current_task;
+    return rq->nr_ready + (current && !(current->flags & TASK_FLAG_IDLE) ? 1 : 0);
+}
+
+/**
+ * Whether core_manager lets a subsystem's tasks onto a core. Free cores
+ * and the subsystem's own cores always admit it; cores reserved for or
+ * allocated to another subsystem only when that subsystem shares them, or
+ * allows preemption by a higher priority subsystem.
+ */
+static bool task_core_admits(uint32_t cpu, uint32_t subsystem)
+{
+    subsystem_id_t owner = core_get_owner(cpu);
+    if (owner >= SUBSYSTEM_MAX || (uint32_t)owner == subsystem) {
+        return true;
+    }
+    
+    subsystem_policy_t *policy = core_manager_get_policy(owner);
+    if (!policy || policy->allow_sharing) {
+        return true;
+    }
+    
+    subsystem_policy_t *mine = subsystem < SUBSYSTEM_MAX ?
+        core_manager_get_policy((subsystem_id_t)subsystem) : NULL;
+    return policy->allow_preemption && mine && mine->priority < policy->priority;
+}
+
+static bool task_cpu_allowed(const task_t *task, uint32_t cpu)
+{
+    return (task->affinity_mask & TASK_CPU_BIT(cpu)) && task_core_admits(cpu, task->subsystem);
+}
+
+/**
+ * Pick the least loaded online CPU a task may run on, preferring the one
+ * it last ran on when loads are equal. Falls back to any online CPU in the
+ * affinity mask, then parks the task on the boot CPU's queue, which
+ * application processors drain as they come online.
+ */
+static uint32_t task_select_cpu(const task_t *task)
+{
+    uint32_t best = UINT32_MAX;
+    uint32_t best_load = UINT32_MAX;
+    uint32_t fallback = UINT32_MAX;
+    
+    for (uint32_t cpu = 0; cpu < task_mgr.nr_cpus; cpu++) {
+        task_rq_t *rq = &task_rq[cpu];
+        if (!rq->online || !(task->affinity_mask & TASK_CPU_BIT(cpu))) {
+            continue;
+        }
+        if (fallback == UINT32_MAX) {
+            fallback = cpu;
+        }
+        if (!task_core_admits(cpu, task->subsystem)) {
+            continue;
+        }
+        
+        uint32_t load = task_rq_load(rq);
+        if (load < best_load || (load == best_load && cpu == task->cpu)) {
+            best = cpu;
+            best_load = load;
+        }
+    }
+    
+    if (best != UINT32_MAX) return best;
+    return fallback != UINT32_MAX ? fallback : 0;
+}
+
+/**
+ * Move a ready task between run queues (both locked)
+ */
+static void task_move(task_t *task, task_rq_t *src, task_rq_t *dst)
+{
+    task_remove_from_ready_queue(src, task, true);
+    task->cpu = dst->cpu;
+    task_add_to_ready_queue(dst, task);
+}
+
+/**
+ * Move a ready task to the best CPU it may run on; false if it stays
+ */
+static bool task_migrate(task_t *task)
+{
+    uint32_t target = task_select_cpu(task);
+    task_rq_t *src = &task_rq[task->cpu];
+    task_rq_t *dst = &task_rq[target];
+    if (src == dst) {
+        return false;
+    }
+    
+    bool moved = false;
+    task_rq_double_lock(src, dst);
+    if (task->cpu == src->cpu && task->state == TASK_STATE_READY && !task->on_cpu) {
+        task_move(task, src, dst);
+        dst->migrations++;
+        moved = true;
+    }
+    task_rq_double_unlock(src, dst);
+    return moved;
+}
+
+/* ──────────── Latency tracing ──────────── */
+
+/* Switching to a task: record how long it waited, and since its wakeup */
+static void task_trace_switch_in(task_rq_t *rq, task_t *task, ktime_t now)
+{
+    if (task->ready_since && now > task->ready_since) {
+        ktime_t waited = now - task->ready_since;
+        sched_hist_add(&task->latency.wait, waited);
+        sched_hist_add(&rq->latency.wait, waited);
+        if (task->woken) {
+            sched_hist_add(&task->latency.wakeup, waited);
+            sched_hist_add(&rq->latency.wakeup, waited);
+        }
+    }
+    task->ready_since = 0;
+    task->woken = false;
+    task->run_start = now;
+}
+
+/**
+ * Switching away from a task. Preempted while still runnable counts as
+ * involuntary, along with how far it ran past its slice.
+ */
+static void task_trace_switch_out(task_rq_t *rq, task_t *task, bool voluntary, ktime_t now)
+{
+    if (voluntary) {
+        task->latency.voluntary++;
+        rq->latency.voluntary++;
+        return;
+    }
+    task->latency.involuntary++;
+    rq->latency.involuntary++;
+    
+    ktime_t slice = (ktime_t)task->time_slice * TASK_TICK_NS;
+    if (task->run_start && now > task->run_start + slice) {
+        ktime_t overrun = now - task->run_start - slice;
+        sched_hist_add(&task->latency.overrun, overrun);
+        sched_hist_add(&rq->latency.overrun, overrun);
+    }
+}
+
+/* ──────────── Deadline class ──────────── */
+
+/* Admitted and with budget left in the current job */
+static inline bool task_dl_active(const task_t *task)
+{
+    return (task->flags & TASK_FLAG_DEADLINE) && task->dl.budget > 0;
+}
+
+/* Whether the earliest ready deadline job should take the CPU from 'current' */
+static inline bool task_dl_preempts(const task_rq_t *rq, const task_t *current)
+{
+    return rq->dl_head && (!current || !task_dl_active(current) ||
+                           rq->dl_head->dl.abs_deadline < current->dl.abs_deadline);
+}
+
+/* Start a job released at 'release' with a full budget */
+static void task_dl_new_job(task_t *task, ktime_t release)
+{
+    task->dl.release = release;
+    task->dl.abs_deadline = release + task->dl.deadline;
+    task->dl.budget = (int64_t)task->dl.runtime;
+    task->dl.jobs++;
+}
+
+/**
+ * Begin charging the running job of 'task'; the budget timer fires when
+ * it runs out. Only the task's own CPU can arm that timer, others leave
+ * it to the next scheduler tick. rq is locked.
+ */
+static void task_dl_start(task_rq_t *rq, task_t *task, ktime_t now)
+{
+    task->dl.exec_start = now;
+    if (smp_current_cpu() == rq->cpu) {
+        ktimer_start(&rq->dl_timer, now + (ktime_t)task->dl.budget);
+    }
+}
+
+/**
+ * Charge the running job for the time since task_dl_start(). A job out of
+ * budget is an overrun: the task falls back to its priority class until
+ * its next release, which the release timer turns into a new job. Returns
+ * true on an overrun. rq is locked; runs on the task's CPU.
+ */
+static bool task_dl_charge(task_rq_t *rq, task_t *task, ktime_t now)
+{
+    if (!task->dl.exec_start) {
+        return false;
+    }
+    task->dl.budget -= (int64_t)(now - task->dl.exec_start);
+    task->dl.exec_start = now;
+    if (task->dl.budget > 0) {
+        return false;
+    }
+    
+    task->dl.exec_start = 0;
+    task->dl.overruns++;
+    rq->dl_overruns++;
+    ktime_t next = task->dl.release + task->dl.period;
+    ktimer_start(&task->dl.timer, next > now ? next : now);
+    return true;
+}
+
+/* Stop charging a task leaving the CPU; rq is locked */
+static void task_dl_stop(task_rq_t *rq, task_t *task, ktime_t now)
+{
+    task_dl_charge(rq, task, now);
+    task->dl.exec_start = 0;
+}
+
+/**
+ * A deadline task becomes runnable outside its release timer. Its current
+ * job stands only if the budget left fits before the deadline at the
+ * admitted density (constant bandwidth server rule); otherwise it starts
+ * a new job now, so sleeping never buys extra bandwidth.
+ */
+static void task_dl_wakeup(task_t *task, ktime_t now)
+{
+    /* Out of budget: the release timer refills it */
+    if (task->dl.budget <= 0) {
+        return;
+    }
+    if (now >= task->dl.abs_deadline) {
+        task_dl_new_job(task, now);
+        return;
+    }
+    
+    /* budget / (abs_deadline - now) > runtime / deadline, in microseconds
+       scaled by 1024 so the products fit 64 bits */
+    uint64_t left = (uint64_t)task->dl.budget >> 10;
+    uint64_t window = (task->dl.abs_deadline - now) >> 10;
+    if (left * (task->dl.deadline >> 10) > window * (task->dl.runtime >> 10)) {
+        task_dl_new_job(task, now);
+    }
+}
+
+/**
+ * Budget timer: the running job may have used its budget up. Runs in
+ * interrupt context on the CPU that armed it.
+ */
+static void task_dl_budget_timer(ktimer_t *timer)
+{
+    task_rq_t *rq = (task_rq_t*)timer->data;
+    if (smp_current_cpu() != rq->cpu) {
+        return;
+    }
+    
+    task_rq_lock(rq);
+    task_t *current = rq->current_task;
+    bool overrun = false;
+    if (current && current->dl.exec_start) {
+        ktime_t now = ktime_get();
+        overrun = task_dl_charge(rq, current, now);
+        if (!overrun) {
+            ktimer_start(&rq->dl_timer, now + (ktime_t)current->dl.budget);
+        }
+    }
+    task_rq_unlock(rq);
+    
+    if (overrun) {
+        task_schedule();
+    }
+}
+
+/**
+ * Release timer: the next period has begun. Refill the budget, move a
+ * task that was running at its priority back onto the deadline list and
+ * wake one parked in task_wait_period().
+ */
+static void task_dl_release_timer(ktimer_t *timer)
+{
+    task_t *task = (task_t*)timer->data;
+    uint32_t flags = task_irq_save();
+    task_rq_t *rq = task_rq_lock_task(task);
+    
+    if (task->state == TASK_STATE_TERMINATED || task->state == TASK_STATE_ZOMBIE) {
+        task_rq_unlock(rq);
+        task_irq_restore(flags);
+        return;
+    }
+    
+    task_dl_new_job(task, timer->expires);
+    if (task->state == TASK_STATE_READY) {
+        task_remove_from_ready_queue(rq, task, true);
+        task_add_to_ready_queue(rq, task);
+    } else if (task == rq->current_task && !task->dl.exec_start) {
+        task_dl_start(rq, task, ktime_get());
+    }
+    
+    if (task->dl.waiting && task->state == TASK_STATE_BLOCKED) {
+        timer_wheel_remove(&rq->sleep_wheel, &task->sleep_node);
+        task_make_runnable(rq, task);
+    }
+    task->dl.waiting = false;
+    bool preempt = rq == task_this_rq() && task_dl_preempts(rq, rq->current_task);
+    task_rq_unlock(rq);
+    task_irq_restore(flags);
+    
+    if (preempt) {
+        task_schedule();
+    }
+}
+
+/**
+ * Admit a created task to the deadline class on the CPU, among those it
+ * may use, with the most bandwidth left, and pin it there
+ */
+int task_set_deadline(task_t *task, uint32_t runtime_us, uint32_t deadline_us, uint32_t period_us)
+{
+    if (!task || task->state != TASK_STATE_CREATED || (task->flags & TASK_FLAG_IDLE) ||
+        runtime_us == 0 || runtime_us > deadline_us || deadline_us > period_us) {
+        return -1;
+    }
+    
+    uint32_t bw = (uint32_t)ktime_div_u32((uint64_t)runtime_us << TASK_DL_BW_SHIFT, period_us);
+    uint32_t flags = task_irq_save();
+    
+    /* Re-admission gives back what the task held */
+    if (task->flags & TASK_FLAG_DEADLINE) {
+        task_rq_t *old = &task_rq[task->dl.cpu];
+        task_rq_lock(old);
+        old->dl_bw -= task->dl.bw;
+        old->nr_dl_tasks--;
+        task_rq_unlock(old);
+        task->flags &= ~TASK_FLAG_DEADLINE;
+    }
+    
+    /* Only CPUs that schedule: the boot CPU's queue never comes online */
+    task_rq_t *best = NULL;
+    for (uint32_t cpu = 0; cpu < task_mgr.nr_cpus; cpu++) {
+        task_rq_t *rq = &task_rq[cpu];
+        if (rq->online && task_cpu_allowed(task, cpu) &&
+            rq->dl_bw + bw <= TASK_DL_BW_LIMIT && (!best || rq->dl_bw < best->dl_bw)) {
+            best = rq;
+        }
+    }
+    
+    /* Checked and claimed under the lock: another admission may have raced */
+    bool admitted = false;
+    if (best) {
+        task_rq_lock(best);
+        if (best->dl_bw + bw <= TASK_DL_BW_LIMIT) {
+            best->dl_bw += bw;
+            best->nr_dl_tasks++;
+            admitted = true;
+        }
+        task_rq_unlock(best);
+    }
+    task_irq_restore(flags);
+    
+    if (!admitted) {
+        SERIAL_LOG("TASK: Deadline admission refused\n");
+        return -1;
+    }
+    
+    task->dl.runtime = (ktime_t)runtime_us * NSEC_PER_USEC;
+    task->dl.deadline = (ktime_t)deadline_us * NSEC_PER_USEC;
+    task->dl.period = (ktime_t)period_us * NSEC_PER_USEC;
+    task->dl.bw = bw;
+    task->dl.cpu = best->cpu;
+    task->dl.budget = 0;
+    task->dl.exec_start = 0;
+    task->dl.queued = false;
+    task->dl.waiting = false;
+    ktimer_init(&task->dl.timer, task_dl_release_timer, task);
+    
+    task->affinity_mask = TASK_CPU_BIT(best->cpu);
+    task->cpu = best->cpu;
+    task->flags |= TASK_FLAG_DEADLINE;
+    return 0;
+}
+
+/**
+ * End the calling task's current job and sleep until the next release.
+ * Returns -1 (after a yield) if the caller is not a deadline task.
+ */
+int task_wait_period(void)
+{
+    task_t *task = task_current();
+    if (!task || !(task->flags & TASK_FLAG_DEADLINE)) {
+        task_yield();
+        return -1;
+    }
+    
+    uint32_t flags = task_irq_save();
+    task_rq_t *rq = task_rq_lock_task(task);
+    ktime_t now = ktime_get();
+    task_dl_stop(rq, task, now);
+    if (now > task->dl.abs_deadline) {
+        task->dl.misses++;
+        rq->dl_misses++;
+    }
+    
+    /* A job that overran a whole period resumes at once */
+    ktime_t next = task->dl.release + task->dl.period;
+    task->dl.waiting = true;
+    task->dl.budget = 0;
+    task_rq_unlock(rq);
+    
+    /* Blocked before the timer is armed, so its wakeup cannot be lost */
+    task_block_prepare(task, 0);
+    ktimer_start(&task->dl.timer, next > now ? next : now);
+    task_irq_restore(flags);
+    
+    task_schedule();
+    return 0;
+}
+
 /**
  * Initialize the task manager system
  */
@@ -67,30 +644,47 @@ void task_manager_init(void)
     /* Clear task manager state */
     memset(&task_mgr, 0, sizeof(task_mgr));
     
-    /* Initialize queues */
-    for (int i = 0; i < 5; i++) {
-        task_mgr.ready_queue_head[i] = NULL;
-        task_mgr.ready_queue_tail[i] = NULL;
+    if (!task_cache) {
+        task_cache = object_cache_create("task_t", sizeof(task_t), 16, NULL);
+    }
+    
+    /* One run queue per processor; application processors bring theirs
+       online from their idle loop (task_cpu_run) */
+    task_mgr.nr_cpus = smp_cpu_count();
+    if (task_mgr.nr_cpus == 0 || task_mgr.nr_cpus > SMP_MAX_CPUS) {
+        task_mgr.nr_cpus = task_mgr.nr_cpus ? SMP_MAX_CPUS : 1;
+    }
+    memset(task_rq, 0, sizeof(task_rq));
+    for (uint32_t cpu = 0; cpu < task_mgr.nr_cpus; cpu++) {
+        task_rq[cpu].cpu = cpu;
+        timer_wheel_init(&task_rq[cpu].sleep_wheel, get_ticks());
+        ktimer_init(&task_rq[cpu].tick_timer, task_tick_timer, &task_rq[cpu]);
+        ktimer_init(&task_rq[cpu].dl_timer, task_dl_budget_timer, &task_rq[cpu]);
     }
     
     task_mgr.blocked_queue = NULL;
-    task_mgr.sleeping_queue = NULL;
     task_mgr.terminated_queue = NULL;
     
     /* Start with task ID 1 (0 reserved for kernel) */
     task_mgr.next_task_id = 1;
-    task_mgr.current_task = NULL;
     task_mgr.scheduler_enabled = true;
-    task_mgr.preempt_ticks = 0;
     
     /* Mark as initialized */
     task_mgr.initialized = true;
     
-    /* Create idle task */
-    task_mgr.idle_task = task_create("idle", idle_task_entry, NULL, 
-                                     TASK_PRIORITY_IDLE, TASK_FLAG_KERNEL);
-    if (task_mgr.idle_task) {
-        task_start(task_mgr.idle_task);
+    /* Create the boot CPU's idle task; it is the queue's fallback and
+       never sits on a ready queue. The boot CPU runs the shell, not
+       tasks, so its queue stays offline: nothing is placed on it or
+       pulled to it, and tasks parked there before an application
+       processor came online get pulled away */
+    task_rq_t *rq = task_this_rq();
+    task_t *idle = task_create("idle", idle_task_entry, NULL,
+                               TASK_PRIORITY_IDLE, TASK_FLAG_KERNEL | TASK_FLAG_IDLE);
+    if (idle) {
+        idle->affinity_mask = TASK_CPU_BIT(rq->cpu);
+        idle->cpu = rq->cpu;
+        idle->state = TASK_STATE_READY;
+        rq->idle_task = idle;
         SERIAL_LOG("TASK: Idle task created and started\\n");
     }
     
@@ -121,7 +715,7 @@ task_t* task_create(const char *name, task_entry_func_t entry_point,
     }
     
     /* Initialize task fields */
-    task->task_id = task_mgr.next_task_id++;
+    task->task_id = atomic_xadd_u32(&task_mgr.next_task_id, 1);
     
     /* Copy name safely */
     size_t name_len = strlen(name);
@@ -139,7 +733,7 @@ task_t* task_create(const char *name, task_entry_func_t entry_point,
     
     /* Allocate stack */
     size_t stack_size = (flags & TASK_FLAG_KERNEL) ? DEFAULT_STACK_SIZE : DEFAULT_STACK_SIZE;
-    if (task == task_mgr.idle_task) {
+    if (flags & TASK_FLAG_IDLE) {
         stack_size = IDLE_STACK_SIZE;
     }
     
@@ -149,7 +743,7 @@ task_t* task_create(const char *name, task_entry_func_t entry_point,
         task_free(task);
         return NULL;
     }
-    task->stack_size = stack_size;
+    task->stack_size = task_stack_class_size(stack_size);
     
     /* Set up initial context and stack */
     task_setup_initial_stack(task, entry_point, user_data);
@@ -176,24 +770,31 @@ task_t* task_create(const char *name, task_entry_func_t entry_point,
     task->user_data = user_data;
     
     /* Initialize family relationships */
-    task->parent = task_mgr.current_task;  /* Current task is parent */
+    task_t *current = task_current();
+    task->parent = current;  /* Current task is parent */
     task->first_child = NULL;
     task->next_sibling = NULL;
     
     /* Add to parent's children if there's a current task */
-    if (task_mgr.current_task) {
-        task->next_sibling = task_mgr.current_task->first_child;
-        task_mgr.current_task->first_child = task;
+    if (current) {
+        task->next_sibling = current->first_child;
+        current->first_child = task;
     }
     
     /* Initialize queue pointers */
     task->next = NULL;
     task->prev = NULL;
     
+    /* Any CPU, no core reservation; placed by task_start() */
+    task->affinity_mask = TASK_AFFINITY_ALL;
+    task->subsystem = TASK_SUBSYSTEM_NONE;
+    task->cpu = task_this_rq()->cpu;
+    task->on_cpu = 0;
+    
     /* Update statistics */
-    task_mgr.stats.total_tasks++;
-    task_mgr.stats.active_tasks++;
-    task_mgr.stats.tasks_by_priority[priority]++;
+    atomic_inc_u32(&task_mgr.stats.total_tasks);
+    atomic_inc_u32(&task_mgr.stats.active_tasks);
+    atomic_inc_u32(&task_mgr.stats.tasks_by_priority[priority]);
     
     SERIAL_LOG_HEX("TASK: Created task ID=", task->task_id);
     SERIAL_LOG(" name=");
@@ -214,194 +815,726 @@ static void task_setup_initial_stack(task_t *task, task_entry_func_t entry_point
     /* Set up stack pointer at end of stack */
     uint32_t *stack_ptr = (uint32_t*)((char*)task->stack_base + task->stack_size);
     
-    /* Push initial values onto stack for context switch */
-    *(--stack_ptr) = (uint32_t)entry_point;  /* Return address (EIP) */
-    *(--stack_ptr) = 0;                       /* EBP */
-    *(--stack_ptr) = 0;                       /* EDI */
-    *(--stack_ptr) = 0;                       /* ESI */
-    *(--stack_ptr) = 0;                       /* EDX */
-    *(--stack_ptr) = 0;                       /* ECX */
-    *(--stack_ptr) = 0;                       /* EBX */
-    *(--stack_ptr) = (uint32_t)user_data;    /* EAX (first parameter) */
+    /* Tasks start in task_bootstrap(), which finishes the switch that
+       brought them in and calls entry_point(user_data) */
+    (void)entry_point;
+    (void)user_data;
+    *(--stack_ptr) = 0;                       /* Return address of task_bootstrap */
+    
+    /* Set initial context for task switching */
+    task->context.esp = (uint32_t)stack_ptr;
+    task->context.eip = (uint32_t)task_bootstrap;
+    task->context.eflags = 0x002;  /* Interrupts enabled by task_bootstrap */
+}
+
+/**
+ * Start a task (move from CREATED to READY state) on the least loaded
+ * CPU it may run on
+ */
+int task_start(task_t *task)
+{
+    if (!task || task->state != TASK_STATE_CREATED) {
+        return -1;
+    }
+    
+    uint32_t flags = task_irq_save();
+    task->last_run_tick = get_ticks() - TASK_MIGRATION_COST;  /* Nothing cached yet */
+    task_rq_t *rq = &task_rq[task_select_cpu(task)];
+    task_rq_lock(rq);
+    task->cpu = rq->cpu;
+    task->state = TASK_STATE_READY;
+    if (task->flags & TASK_FLAG_DEADLINE) {
+        task_dl_new_job(task, ktime_get());
+    }
+    task_add_to_ready_queue(rq, task);
+    task_rq_unlock(rq);
+    task_irq_restore(flags);
+    
+    SERIAL_LOG_HEX("TASK: Started task ID=", task->task_id);
+    SERIAL_LOG_DEC(" cpu=", task->cpu);
+    SERIAL_LOG("\\n");
+    
+    return 0;
+}
+
+/**
+ * Main scheduler function - select and switch to next task on this CPU
+ */
+void task_schedule(void)
+{
+    if (!task_mgr.initialized || !task_mgr.scheduler_enabled) {
+        return;
+    }
+    
+    /* Clean up any terminated tasks */
+    task_cleanup_terminated();
+    
+    uint32_t flags = task_irq_save();
+    task_rq_t *rq = task_this_rq();
+    uint32_t now = get_ticks();
+    rq->scheduler_calls++;
+    
+    task_t *prev_task = rq->current_task;
+    bool prev_idle = !prev_task || (prev_task->flags & TASK_FLAG_IDLE);
+    
+    /* About to go idle: pull work from the busiest CPU first */
+    if (rq->online && !rq->nr_ready && (prev_idle || prev_task->state != TASK_STATE_RUNNING)) {
+        task_balance(rq, now);
+    }
+    
+    task_rq_lock(rq);
+    bool prev_runnable = prev_task && prev_task->state == TASK_STATE_RUNNING;
+    bool prev_yielded = prev_task && prev_task->yielded;
+    if (prev_task) {
+        prev_task->yielded = false;
+    }
+    
+    /* Charge a deadline job for its run so far; an overrun demotes it */
+    ktime_t ktime_now = ktime_get();
+    if (prev_task && prev_task->dl.exec_start) {
+        task_dl_charge(rq, prev_task, ktime_now);
+    }
+    
+    /* A running task keeps the CPU unless an earlier deadline job or, for
+       a task outside the deadline class, an equal or higher priority task
+       is ready */
+    if (prev_runnable && !task_dl_preempts(rq, prev_task) &&
+        (task_dl_active(prev_task) || !rq->ready_bitmap ||
+         prev_task->priority < task_ready_priority(rq))) {
+        prev_task->time_remaining = prev_task->time_slice;
+        prev_task->run_start = ktime_now;
+        task_rq_unlock(rq);
+        task_irq_restore(flags);
+        return;
+    }
+    
+    /* Tasks whose affinity changed while they slept or ran are pushed
+       to a CPU they may use instead of running here */
+    while (rq->ready_bitmap) {
+        task_t *head = rq->ready_queue_head[task_ready_priority(rq)];
+        if (head->affinity_mask & TASK_CPU_BIT(rq->cpu)) {
+            break;
+        }
+        task_rq_unlock(rq);
+        bool moved = task_migrate(head);
+        task_rq_lock(rq);
+        if (!moved) {
+            break;
+        }
+    }
+    
+    /* Select next task to run */
+    task_t *next_task = task_select_next(rq);
+    if (!next_task) {
+        /* Fallback to idle task */
+        next_task = rq->idle_task;
+        if (!next_task) {
+            task_rq_unlock(rq);
+            task_irq_restore(flags);
+            SERIAL_LOG("TASK: CRITICAL - No tasks available!\\n");
+            return;
+        }
+    }
+    
+    /* Perform actual task switching */
+    if (next_task == prev_task) {
+        next_task->state = TASK_STATE_RUNNING;
+        next_task->run_start = ktime_now;
+        task_rq_unlock(rq);
+        task_irq_restore(flags);
+        return;
+    }
+    
+    /* Update task states */
+    if (prev_task) {
+        if (prev_task->dl.exec_start) {
+            task_dl_stop(rq, prev_task, ktime_now);
+        }
+        if (!prev_idle) {
+            task_trace_switch_out(rq, prev_task, !prev_runnable || prev_yielded, ktime_now);
+        }
+        if (prev_runnable) {
+            prev_task->state = TASK_STATE_READY;
+            if (!(prev_task->flags & TASK_FLAG_IDLE)) {
+                task_add_to_ready_queue(rq, prev_task);
+            }
+        }
+        prev_task->last_run_tick = now;
+    }
+    
+    next_task->state = TASK_STATE_RUNNING;
+    next_task->cpu = rq->cpu;
+    if (task_dl_active(next_task)) {
+        task_dl_start(rq, next_task, ktime_now);
+    }
+    if (!(next_task->flags & TASK_FLAG_IDLE)) {
+        task_trace_switch_in(rq, next_task, ktime_now);
+    }
+    
+    /* Update current task pointer */
+    rq->current_task = next_task;
+    rq->switch_prev = prev_task;
+    
+    /* Reset time slice */
+    next_task->time_remaining = next_task->time_slice;
+    rq->context_switches++;
+    task_rq_unlock(rq);
+    
+    /* Application processors only take scheduler ticks while a real task
+       runs; the boot CPU keeps the PIT */
+    if (rq->cpu != 0 && !(next_task->flags & TASK_FLAG_IDLE) &&
+        lapic_timer_khz() && !ktimer_pending(&rq->tick_timer)) {
+        ktimer_start(&rq->tick_timer, ktime_get() + TASK_TICK_NS);
+    }
+    
+    /* The task may have just been switched out by another CPU that is
+       still saving its registers */
+    while (atomic_load_u32(&next_task->on_cpu)) {
+        cpu_relax();
+    }
+    next_task->on_cpu = 1;
+    
+    /* Perform context switch; we resume here, possibly on another CPU */
+    task_switch_context(prev_task, next_task);
+    task_finish_switch();
+    task_irq_restore(flags);
+}
+
+/**
+ * Context switch between tasks (hot path: no logging)
+ */
+void task_switch_context(task_t *from_task, task_t *to_task)
+{
+    if (!to_task) {
+        return;
+    }
+    
+    /* Arm the lazy FPU trap unless to_task's state is still loaded */
+    fpu_switch(to_task->cpu, &to_task->fpu);
+    
+    /* Call assembly context switch function */
+    task_switch_context_asm(from_task, to_task);
+}
+
+/**
+ * Runs first on the CPU after a switch: the previous task's registers are
+ * saved now, so other CPUs may pick it up or free it
+ */
+static void task_finish_switch(void)
+{
+    task_rq_t *rq = task_this_rq();
+    task_t *prev = rq->switch_prev;
+    rq->switch_prev = NULL;
+    if (prev) {
+        atomic_store_u32(&prev->on_cpu, 0);
+    }
+}
+
+/**
+ * First code run by a new task (interrupts still disabled)
+ */
+static void task_bootstrap(void)
+{
+    task_finish_switch();
+    task_t *task = task_current();
+    __asm__ volatile("sti" ::: "memory");
+    
+    int exit_code = ((task_entry_func_t)task->entry_point)(task->user_data);
+    task_exit(exit_code);
+}
+
+/**
+ * Terminate the calling task
+ */
+void task_exit(int exit_code)
+{
+    (void)exit_code;
+    task_terminate(task_current());
+    
+    /* Not reached: task_terminate() switched away for good */
+    for (;;) {
+        __asm__ volatile("hlt");
+    }
+}
+
+/**
+ * Timer wheel callback: a sleeping task's wake_time has passed. The wheel
+ * belongs to task->cpu, whose queue is locked.
+ */
+static void task_wake_expired(timer_wheel_node_t *node)
+{
+    task_t *task = TASK_FROM_SLEEP_NODE(node);
+    task_make_runnable(&task_rq[task->cpu], task);
+}
+
+/**
+ * Return a sleeping or blocked task to its run queue, which is locked. A
+ * task that gave up its CPU but has not switched out yet simply keeps
+ * running: task_schedule() sees it runnable again.
+ */
+static void task_make_runnable(task_rq_t *rq, task_t *task)
+{
+    if (task->state == TASK_STATE_BLOCKED) {
+        task_spin_lock(&task_mgr.lock);
+        task_queue_remove(&task_mgr.blocked_queue, NULL, task);
+        task_spin_unlock(&task_mgr.lock);
+    }
+    
+    if (task == rq->current_task) {
+        task->state = TASK_STATE_RUNNING;
+        return;
+    }
+    if ((task->flags & TASK_FLAG_DEADLINE) && !task->dl.waiting) {
+        task_dl_wakeup(task, ktime_get());
+    }
+    task->state = TASK_STATE_READY;
+    task->woken = true;
+    task_add_to_ready_queue(rq, task);
+}
+
+/**
+ * Timer tick handler - handle preemption, sleeping tasks and periodic
+ * load balancing for the calling CPU
+ */
+void task_timer_tick(void)
+{
+    if (!task_mgr.initialized || !task_mgr.scheduler_enabled) {
+        return;
+    }
+    
+    task_rq_t *rq = task_this_rq();
+    uint32_t now = get_ticks();
+    
+    /* Wake sleepers that are due; constant work however many are sleeping */
+    task_rq_lock(rq);
+    timer_wheel_advance(&rq->sleep_wheel, now, task_wake_expired);
+    task_rq_unlock(rq);
+    
+    /* Idle application processors take no ticks; the boot CPU wakes
+       their sleepers (advancing a wheel twice for a tick is harmless) */
+    for (uint32_t cpu = 0; rq->cpu == 0 && cpu < task_mgr.nr_cpus; cpu++) {
+        task_rq_t *other = &task_rq[cpu];
+        if (other == rq || !other->online || !other->sleep_wheel.pending) {
+            continue;
+        }
+        task_rq_lock(other);
+        timer_wheel_advance(&other->sleep_wheel, now, task_wake_expired);
+        task_rq_unlock(other);
+    }
+    
+    if (rq->online && (int32_t)(now - rq->next_balance) >= 0) {
+        task_balance(rq, now);
+    }
+    
+    /* A tick nested in a bottom-half run must not switch away from it:
+       the run stays marked active on this CPU until it returns */
+    task_t *current = rq->current_task;
+    if (current && !softirq_active()) {
+        /* Charge a running deadline job: the budget timer may be on
+           another CPU's queue if this one has no APIC timer */
+        bool overrun = false;
+        if (current->dl.exec_start) {
+            task_rq_lock(rq);
+            overrun = task_dl_charge(rq, current, ktime_get());
+            task_rq_unlock(rq);
+        }
+        
+        /* Preempt at once for an earlier deadline, a woken task of higher
+           priority or a job that ran out of budget */
+        if (overrun || task_dl_preempts(rq, current) ||
+            (!task_dl_active(current) && rq->ready_bitmap &&
+             task_ready_priority(rq) < current->priority)) {
+            task_schedule();
+        } else if (current->time_remaining > 0) {
+            current->time_remaining--;
+            
+            /* Check if time slice expired */
+            if (current->time_remaining == 0) {
+                /* Force reschedule */
+                task_schedule();
+            }
+        }
+    }
+    
+    /* Increment preemption counter */
+    rq->preempt_ticks++;
+}
+
+/**
+ * Deadline timer callback standing in for the PIT on an application
+ * processor. Re-arms only while a non-idle task runs, so an idle CPU
+ * stops taking timer interrupts.
+ */
+static void task_tick_timer(ktimer_t *timer)
+{
+    task_rq_t *rq = (task_rq_t*)timer->data;
+    
+    /* Fell back to the boot CPU's queue: its PIT tick covers it */
+    if (smp_current_cpu() != rq->cpu) {
+        return;
+    }
+    
+    task_t *current = rq->current_task;
+    if (current && !(current->flags & TASK_FLAG_IDLE)) {
+        ktime_t now = ktime_get();
+        ktime_t next = timer->expires + TASK_TICK_NS;
+        ktimer_start(timer, next > now ? next : now + TASK_TICK_NS);
+    }
+    task_timer_tick();
+}
+
+/**
+ * Pop the earliest deadline job, else the next task from the highest
+ * priority non-empty ready queue (round-robin within a priority); rq is
+ * locked
+ */
+static task_t* task_select_next(task_rq_t *rq)
+{
+    if (rq->dl_head) {
+        task_t *task = rq->dl_head;
+        task_remove_from_ready_queue(rq, task, true);
+        return task;
+    }
+    if (!rq->ready_bitmap) {
+        return NULL;
+    }
+    
+    task_priority_t priority = task_ready_priority(rq);
+    task_t *task = rq->ready_queue_head[priority];
+    task_remove_from_ready_queue(rq, task, true);
+    return task;
+}
+
+/**
+ * First task on 'src' that may move to 'dst': allowed there, not running
+ * and, unless pulls keep failing, not cache-hot. Both queues are locked.
+ */
+static task_t* task_find_migratable(task_rq_t *src, task_rq_t *dst, uint32_t now)
+{
+    bool allow_hot = dst->balance_failed >= TASK_BALANCE_HOT_RETRIES;
+    uint32_t bitmap = src->ready_bitmap;
+    
+    while (bitmap) {
+        uint32_t priority = __builtin_ctz(bitmap);
+        bitmap &= bitmap - 1;
+        
+        /* Oldest first: the head has waited longest and is coldest */
+        for (task_t *task = src->ready_queue_head[priority]; task; task = task->next) {
+            if (task->on_cpu || !task_cpu_allowed(task, dst->cpu)) {
+                continue;
+            }
+            if (!allow_hot && now - task->last_run_tick < TASK_MIGRATION_COST) {
+                continue;
+            }
+            return task;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Pull one task from the busiest CPU if that narrows the imbalance.
+ * Loads are sampled without locks; the pull itself locks both queues.
+ * Called with interrupts disabled and no run queue locked.
+ */
+static bool task_balance(task_rq_t *rq, uint32_t now)
+{
+    uint32_t local = task_rq_load(rq);
+    rq->next_balance = now + (local ? TASK_BALANCE_INTERVAL : TASK_IDLE_BALANCE_INTERVAL);
+    
+    /* Moving one task only helps when the gap is at least two; tasks
+       parked on an offline queue are taken whatever the gap */
+    task_rq_t *busiest = NULL;
+    uint32_t busiest_load = local + 1;
+    for (uint32_t cpu = 0; cpu < task_mgr.nr_cpus; cpu++) {
+        task_rq_t *other = &task_rq[cpu];
+        if (other == rq || !other->nr_ready) {
+            continue;
+        }
+        if (!other->online) {
+            busiest = other;
+            break;
+        }
+        uint32_t load = task_rq_load(other);
+        if (load > busiest_load) {
+            busiest = other;
+            busiest_load = load;
+        }
+    }
+    if (!busiest) {
+        return false;
+    }
+    
+    task_rq_double_lock(rq, busiest);
+    task_t *task = task_find_migratable(busiest, rq, now);
+    if (task) {
+        task_move(task, busiest, rq);
+        rq->migrations++;
+        rq->balance_failed = 0;
+    } else {
+        rq->balance_failed++;
+    }
+    task_rq_double_unlock(rq, busiest);
+    return task != NULL;
+}
+
+/**
+ * Application processor idle hook, called from its parallel scheduler
+ * loop whenever that has no work. The first call turns the loop itself
+ * into the CPU's idle task and brings its run queue online; later calls
+ * run whatever is ready locally or can be pulled, and return once the
+ * queue has drained.
+ */
+void task_cpu_run(void)
+{
+    if (!task_mgr.initialized || !task_mgr.scheduler_enabled) {
+        return;
+    }
+    
+    uint32_t cpu = smp_current_cpu();
+    if (cpu >= task_mgr.nr_cpus) {
+        return;
+    }
+    task_rq_t *rq = &task_rq[cpu];
+    
+    if (!rq->idle_task) {
+        task_t *idle = task_alloc();
+        if (!idle) {
+            return;
+        }
+        idle->task_id = atomic_xadd_u32(&task_mgr.next_task_id, 1);
+        memcpy(idle->name, "idle", 5);
+        idle->state = TASK_STATE_RUNNING;
+        idle->priority = TASK_PRIORITY_IDLE;
+        idle->flags = TASK_FLAG_KERNEL | TASK_FLAG_IDLE;
+        idle->time_slice = idle->time_remaining = priority_time_slices[TASK_PRIORITY_IDLE];
+        idle->affinity_mask = TASK_CPU_BIT(cpu);
+        idle->subsystem = TASK_SUBSYSTEM_NONE;
+        idle->cpu = cpu;
+        idle->on_cpu = 1;
+        
+        uint32_t flags = task_irq_save();
+        task_rq_lock(rq);
+        rq->idle_task = idle;
+        rq->current_task = idle;
+        rq->online = true;
+        task_rq_unlock(rq);
+        task_irq_restore(flags);
+    }
+    
+    /* Only the idle loop itself may run the queue */
+    if (rq->current_task != rq->idle_task) {
+        return;
+    }
+    if (!rq->nr_ready && (int32_t)(get_ticks() - rq->next_balance) < 0) {
+        return;
+    }
+    task_schedule();
+}
+
+/**
+ * Voluntary yield CPU to other tasks
+ */
+void task_yield(void)
+{
+    task_t *current = task_current();
+    if (current) {
+        current->time_remaining = 0;
+        current->yielded = true;
+        task_schedule();
+    }
+}
+
+/**
+ * Sleep for specified milliseconds
+ */
+void task_sleep(uint32_t milliseconds)
+{
+    task_t *task = task_current();
+    if (!task || milliseconds == 0) {
+        return;
+    }
+    
+    uint32_t flags = task_irq_save();
+    task_rq_t *rq = task_rq_lock_task(task);
+    task->wake_time = get_ticks() + task_ms_to_ticks(milliseconds);
+    task->state = TASK_STATE_SLEEPING;
+    timer_wheel_add(&rq->sleep_wheel, &task->sleep_node, task->wake_time);
+    task_rq_unlock(rq);
+    task_irq_restore(flags);
     
-    /* Set initial context for task switching */
-    task->context.esp = (uint32_t)stack_ptr;
-    task->context.eip = (uint32_t)entry_point;
-    task->context.eflags = 0x202;  /* Enable interrupts */
+    task_schedule();
 }
 
 /**
- * Start a task (move from CREATED to READY state)
+ * Wake a sleeping task before its deadline
  */
-int task_start(task_t *task)
+void task_wake(task_t *task)
 {
-    if (!task || task->state != TASK_STATE_CREATED) {
-        return -1;
+    if (!task) {
+        return;
     }
     
-    task->state = TASK_STATE_READY;
-    task_add_to_ready_queue(task);
-    
-    SERIAL_LOG_HEX("TASK: Started task ID=", task->task_id);
-    SERIAL_LOG("\\n");
-    
-    return 0;
+    uint32_t flags = task_irq_save();
+    task_rq_t *rq = task_rq_lock_task(task);
+    if (task->state == TASK_STATE_SLEEPING) {
+        timer_wheel_remove(&rq->sleep_wheel, &task->sleep_node);
+        task_make_runnable(rq, task);
+    }
+    task_rq_unlock(rq);
+    task_irq_restore(flags);
 }
 
 /**
- * Main scheduler function - select and switch to next task
+ * Mark a task blocked without switching away, optionally with a timeout
+ * (0 = none) after which it becomes runnable again. Blocking the current
+ * task takes effect at its next task_schedule(); a task_unblock() before
+ * then cancels it, so a waiter can publish itself, drop its own locks and
+ * only then schedule without losing a wakeup.
  */
-void task_schedule(void)
+void task_block_prepare(task_t *task, uint32_t timeout_ms)
 {
-    if (!task_mgr.initialized || !task_mgr.scheduler_enabled) {
+    if (!task || (task->flags & TASK_FLAG_IDLE)) {
         return;
     }
     
-    task_mgr.stats.scheduler_calls++;
-    
-    /* Clean up any terminated tasks */
-    task_cleanup_terminated();
-    
-    /* Select next task to run */
-    task_t *next_task = task_select_next();
-    if (!next_task) {
-        /* Fallback to idle task */
-        next_task = task_mgr.idle_task;
-        if (!next_task) {
-            SERIAL_LOG("TASK: CRITICAL - No tasks available!\\n");
-            return;
-        }
+    uint32_t flags = task_irq_save();
+    task_rq_t *rq = task_rq_lock_task(task);
+    if (task->state == TASK_STATE_READY) {
+        task_remove_from_ready_queue(rq, task, false);
+    } else if (task->state != TASK_STATE_RUNNING) {
+        task_rq_unlock(rq);
+        task_irq_restore(flags);
+        return;
     }
     
-    /* Perform actual task switching */
-    if (next_task != task_mgr.current_task) {
-        task_t *prev_task = task_mgr.current_task;
-        
-        /* Update task states */
-        if (prev_task) {
-            if (prev_task->state == TASK_STATE_RUNNING) {
-                prev_task->state = TASK_STATE_READY;
-                task_add_to_ready_queue(prev_task);
-            }
-        }
-        
-        next_task->state = TASK_STATE_RUNNING;
-        task_remove_from_ready_queue(next_task);
-        
-        /* Update current task pointer */
-        task_mgr.current_task = next_task;
-        
-        /* Reset time slice */
-        next_task->time_remaining = next_task->time_slice;
-        
-        /* Perform context switch */
-        task_switch_context(prev_task, next_task);
-        
-        task_mgr.stats.context_switches++;
+    task->state = TASK_STATE_BLOCKED;
+    if (timeout_ms) {
+        task->wake_time = get_ticks() + task_ms_to_ticks(timeout_ms);
+        timer_wheel_add(&rq->sleep_wheel, &task->sleep_node, task->wake_time);
     }
+    task_spin_lock(&task_mgr.lock);
+    task_queue_add(&task_mgr.blocked_queue, NULL, task);
+    task_spin_unlock(&task_mgr.lock);
+    
+    task_rq_unlock(rq);
+    task_irq_restore(flags);
 }
 
 /**
- * Context switch between tasks
+ * Block a task until task_unblock(); the current task switches away
  */
-void task_switch_context(task_t *from_task, task_t *to_task)
+void task_block(task_t *task)
 {
-    if (!to_task) {
-        SERIAL_LOG("TASK: ERROR - Cannot switch to NULL task\\n");
-        return;
+    task_block_prepare(task, 0);
+    if (task && task == task_current()) {
+        task_schedule();
     }
-    
-    SERIAL_LOG("TASK: Switching to task ");
-    SERIAL_LOG(to_task->name);
-    SERIAL_LOG("\\n");
-    
-    /* Call assembly context switch function */
-    task_switch_context_asm(from_task, to_task);
 }
 
 /**
- * Timer tick handler - handle preemption and sleeping tasks
+ * Make a blocked task runnable; does nothing for any other state
  */
-void task_timer_tick(void)
+void task_unblock(task_t *task)
 {
-    if (!task_mgr.initialized || !task_mgr.scheduler_enabled) {
+    if (!task) {
         return;
     }
     
-    /* Check sleeping tasks */
-    task_t *task = task_mgr.sleeping_queue;
-    task_t *next;
-    while (task) {
-        next = task->next;
-        if (get_ticks() >= task->wake_time) {
-            /* Wake up this task */
-            task_queue_remove(&task_mgr.sleeping_queue, NULL, task);
-            task->state = TASK_STATE_READY;
-            task_add_to_ready_queue(task);
-        }
-        task = next;
-    }
-    
-    /* Handle preemption for current task */
-    if (task_mgr.current_task && task_mgr.current_task->time_remaining > 0) {
-        task_mgr.current_task->time_remaining--;
-        
-        /* Check if time slice expired */
-        if (task_mgr.current_task->time_remaining == 0) {
-            /* Force reschedule */
-            task_schedule();
-        }
+    uint32_t flags = task_irq_save();
+    task_rq_t *rq = task_rq_lock_task(task);
+    if (task->state == TASK_STATE_BLOCKED) {
+        timer_wheel_remove(&rq->sleep_wheel, &task->sleep_node);
+        task_make_runnable(rq, task);
     }
-    
-    /* Increment preemption counter */
-    task_mgr.preempt_ticks++;
+    task_rq_unlock(rq);
+    task_irq_restore(flags);
 }
 
 /**
- * Select next task to run based on priority scheduling with round-robin
+ * Restrict a task to the CPUs in cpu_mask. A ready task on a CPU outside
+ * the mask moves at once; a running or sleeping one when it is next queued.
  */
-static task_t* task_select_next(void)
+int task_set_affinity(task_t *task, uint64_t cpu_mask)
 {
-    /* Check ready queues from highest to lowest priority */
-    for (int i = 0; i < 5; i++) {
-        task_t *task = task_mgr.ready_queue_head[i];
-        if (task) {
-            /* Move to end for round-robin within priority */
-            task_queue_remove(&task_mgr.ready_queue_head[i], 
-                             &task_mgr.ready_queue_tail[i], task);
-            return task;
-        }
+    uint64_t present = task_mgr.nr_cpus >= 64 ? TASK_AFFINITY_ALL
+                                              : TASK_CPU_BIT(task_mgr.nr_cpus) - 1;
+    if (!task || (task->flags & TASK_FLAG_IDLE) || !(cpu_mask & present)) {
+        return -1;
     }
     
-    return task_mgr.idle_task;
+    uint32_t flags = task_irq_save();
+    task_rq_t *rq = task_rq_lock_task(task);
+    task->affinity_mask = cpu_mask;
+    bool misplaced = task->state == TASK_STATE_READY && !(cpu_mask & TASK_CPU_BIT(rq->cpu));
+    task_rq_unlock(rq);
+    
+    if (misplaced) {
+        task_migrate(task);
+    }
+    task_irq_restore(flags);
+    return 0;
+}
+
+uint64_t task_get_affinity(task_t *task)
+{
+    return task ? task->affinity_mask : 0;
 }
 
 /**
- * Voluntary yield CPU to other tasks
+ * Let a task use the cores core_manager reserved for 'subsystem'
+ * (a subsystem_id_t, or TASK_SUBSYSTEM_NONE)
  */
-void task_yield(void)
+int task_set_subsystem(task_t *task, uint32_t subsystem)
 {
-    if (task_mgr.current_task) {
-        task_mgr.current_task->time_remaining = 0;
-        task_schedule();
+    if (!task || (subsystem >= SUBSYSTEM_MAX && subsystem != TASK_SUBSYSTEM_NONE)) {
+        return -1;
     }
+    task->subsystem = subsystem;
+    return 0;
 }
 
+/* core_manager subsystem for each registry subsystem type */
+static const uint32_t subsystem_type_to_core[] = {
+    [SUBSYSTEM_TYPE_CORE]       = SUBSYSTEM_KERNEL,
+    [SUBSYSTEM_TYPE_DRIVER]     = SUBSYSTEM_IO,
+    [SUBSYSTEM_TYPE_GRAPHICS]   = SUBSYSTEM_VIDEO,
+    [SUBSYSTEM_TYPE_AUDIO]      = SUBSYSTEM_IO,
+    [SUBSYSTEM_TYPE_NETWORK]    = SUBSYSTEM_NETWORK,
+    [SUBSYSTEM_TYPE_AI]         = SUBSYSTEM_AI,
+    [SUBSYSTEM_TYPE_VIDEO]      = SUBSYSTEM_VIDEO,
+    [SUBSYSTEM_TYPE_FILESYSTEM] = SUBSYSTEM_IO,
+    [SUBSYSTEM_TYPE_QUANTUM]    = SUBSYSTEM_QUANTUM
+};
+
 /**
- * Sleep for specified milliseconds
+ * Run a task on behalf of a registered subsystem: honor the subsystem's
+ * cpu_affinity_mask (0 or 0xFF mean any CPU) and its core reservations
  */
-void task_sleep(uint32_t milliseconds)
+int task_bind_subsystem(task_t *task, uint16_t registry_id)
 {
-    if (!task_mgr.current_task || milliseconds == 0) {
-        return;
+    subsystem_t *subsystem = subsystem_lookup(registry_id);
+    if (!task || !subsystem) {
+        return -1;
     }
     
-    task_t *task = task_mgr.current_task;
-    task->wake_time = get_ticks() + milliseconds;
-    task->state = TASK_STATE_SLEEPING;
+    uint32_t type = subsystem->type;
+    task_set_subsystem(task, type < sizeof(subsystem_type_to_core) / sizeof(subsystem_type_to_core[0])
+                             ? subsystem_type_to_core[type] : TASK_SUBSYSTEM_NONE);
     
-    task_queue_add(&task_mgr.sleeping_queue, NULL, task);
-    task_schedule();
+    uint8_t mask = subsystem->cpu_affinity_mask;
+    return task_set_affinity(task, (mask == 0 || mask == 0xFF) ? TASK_AFFINITY_ALL : mask);
+}
+
+/**
+ * Runnable tasks on a CPU (ready plus running, idle excluded)
+ */
+uint32_t task_cpu_load(uint32_t cpu)
+{
+    if (!task_mgr.initialized || cpu >= task_mgr.nr_cpus) {
+        return 0;
+    }
+    return task_rq_load(&task_rq[cpu]);
 }
 
 /**
@@ -414,6 +1547,9 @@ static int idle_task_entry(void *data)
     SERIAL_LOG("TASK: Idle task started\\n");
     
     while (1) {
+        /* Background fibers of this CPU run before it halts */
+        fiber_run_pending();
+
         /* Halt CPU until next interrupt */
         __asm__ volatile ("hlt");
         
@@ -431,7 +1567,10 @@ static int idle_task_entry(void *data)
  */
 task_t* task_current(void)
 {
-    return task_mgr.current_task;
+    if (!task_mgr.initialized) {
+        return NULL;
+    }
+    return task_this_rq()->current_task;
 }
 
 /**
@@ -439,7 +1578,8 @@ task_t* task_current(void)
  */
 uint32_t task_get_current_id(void)
 {
-    return task_mgr.current_task ? task_mgr.current_task->task_id : 0;
+    task_t *current = task_current();
+    return current ? current->task_id : 0;
 }
 
 /**
@@ -447,7 +1587,12 @@ uint32_t task_get_current_id(void)
  */
 static task_t* task_alloc(void)
 {
-    return (task_t*)heap_alloc(sizeof(task_t));
+    task_t *task = (task_t*)object_cache_alloc(task_cache);
+    if (task) {
+        memset(task, 0, sizeof(task_t));
+        fpu_context_init(&task->fpu);
+    }
+    return task;
 }
 
 /**
@@ -456,29 +1601,25 @@ static task_t* task_alloc(void)
 static void task_free(task_t *task)
 {
     if (task) {
-        heap_free(task);
+        fpu_context_release(&task->fpu);
+        object_cache_free(task_cache, task);
     }
 }
 
 /**
- * Allocate stack memory for a task
+ * Allocate stack memory for a task (rounded up to a pool class)
  */
 void* task_allocate_stack(size_t stack_size)
 {
-    /* Align stack size to page boundary */
-    stack_size = (stack_size + 0xFFF) & ~0xFFF;
-    return heap_alloc(stack_size);
+    return task_stack_alloc(stack_size);
 }
 
 /**
- * Free stack memory
+ * Return a stack to the pool
  */
 void task_free_stack(void *stack_base, size_t stack_size)
 {
-    (void)stack_size;  /* Currently unused */
-    if (stack_base) {
-        heap_free(stack_base);
-    }
+    task_stack_free(stack_base, stack_size);
 }
 
 /**
@@ -488,6 +1629,17 @@ static void task_queue_add(task_t **head, task_t **tail, task_t *task)
 {
     if (!task) return;
     
+    if (!tail) {
+        /* Unordered list: push at the front */
+        task->prev = NULL;
+        task->next = *head;
+        if (*head) {
+            (*head)->prev = task;
+        }
+        *head = task;
+        return;
+    }
+    
     task->next = NULL;
     task->prev = *tail;
     
@@ -496,7 +1648,7 @@ static void task_queue_add(task_t **head, task_t **tail, task_t *task)
     } else {
         *head = task;
     }
-    if (tail) *tail = task;
+    *tail = task;
 }
 
 /**
@@ -522,67 +1674,118 @@ static void task_queue_remove(task_t **head, task_t **tail, task_t *task)
 }
 
 /**
- * Pop first task from queue
+ * Add task to appropriate ready queue based on priority (rq locked)
  */
-static task_t* task_queue_pop(task_t **head, task_t **tail)
+static void task_add_to_ready_queue(task_rq_t *rq, task_t *task)
 {
-    task_t *task = *head;
-    if (task) {
-        task_queue_remove(head, tail, task);
+    if (!task || task->priority >= TASK_PRIORITY_COUNT) return;
+    
+    /* Kept across migration, so the wait covers both queues */
+    if (!task->ready_since) {
+        task->ready_since = ktime_get();
+    }
+    
+    /* Jobs with budget left go on the deadline list, kept in deadline order */
+    if (task_dl_active(task)) {
+        task_t *prev = NULL;
+        task_t *next = rq->dl_head;
+        while (next && next->dl.abs_deadline <= task->dl.abs_deadline) {
+            prev = next;
+            next = next->next;
+        }
+        task->prev = prev;
+        task->next = next;
+        if (next) next->prev = task;
+        if (prev) {
+            prev->next = task;
+        } else {
+            rq->dl_head = task;
+        }
+        task->dl.queued = true;
+        rq->nr_ready++;
+        return;
     }
-    return task;
-}
-
-/**
- * Add task to appropriate ready queue based on priority
- */
-static void task_add_to_ready_queue(task_t *task)
-{
-    if (!task || task->priority >= 5) return;
     
-    task_queue_add(&task_mgr.ready_queue_head[task->priority],
-                   &task_mgr.ready_queue_tail[task->priority], task);
+    task_queue_add(&rq->ready_queue_head[task->priority],
+                   &rq->ready_queue_tail[task->priority], task);
+    rq->ready_bitmap |= 1u << task->priority;
+    rq->nr_ready++;
 }
 
 /**
- * Remove task from ready queue
+ * Remove task from ready queue (rq locked). still_waiting: the task goes
+ * straight back on a queue or is about to be switched in, so its wait
+ * keeps running; otherwise the wait ends here unsampled.
  */
-static void task_remove_from_ready_queue(task_t *task)
+static void task_remove_from_ready_queue(task_rq_t *rq, task_t *task, bool still_waiting)
 {
-    if (!task || task->priority >= 5) return;
+    if (!task || task->priority >= TASK_PRIORITY_COUNT) return;
     
-    task_queue_remove(&task_mgr.ready_queue_head[task->priority],
-                      &task_mgr.ready_queue_tail[task->priority], task);
+    if (!still_waiting) {
+        task->ready_since = 0;
+        task->woken = false;
+    }
+    
+    if (task->dl.queued) {
+        task_queue_remove(&rq->dl_head, NULL, task);
+        task->dl.queued = false;
+        rq->nr_ready--;
+        return;
+    }
+    
+    task_queue_remove(&rq->ready_queue_head[task->priority],
+                      &rq->ready_queue_tail[task->priority], task);
+    if (!rq->ready_queue_head[task->priority]) {
+        rq->ready_bitmap &= ~(1u << task->priority);
+    }
+    rq->nr_ready--;
 }
 
 /**
- * Clean up terminated tasks
+ * Clean up terminated tasks whose last CPU has finished switching away
  */
 void task_cleanup_terminated(void)
 {
+    if (!task_mgr.terminated_queue) {
+        return;
+    }
+    
+    /* Detach what can be freed, then free it outside the lock */
+    task_t *reap = NULL;
+    uint32_t flags = task_irq_save();
+    task_spin_lock(&task_mgr.lock);
     task_t *task = task_mgr.terminated_queue;
     while (task) {
         task_t *next = task->next;
+        if (!atomic_load_u32(&task->on_cpu)) {
+            task_queue_remove(&task_mgr.terminated_queue, NULL, task);
+            task_queue_add(&reap, NULL, task);
+        }
+        task = next;
+    }
+    task_spin_unlock(&task_mgr.lock);
+    task_irq_restore(flags);
+    
+    while (reap) {
+        task = reap;
+        reap = task->next;
+        
+        /* Update statistics */
+        atomic_dec_u32(&task_mgr.stats.active_tasks);
+        if (task->priority < TASK_PRIORITY_COUNT) {
+            atomic_dec_u32(&task_mgr.stats.tasks_by_priority[task->priority]);
+        }
         
         /* Free stack and task structure */
         if (task->stack_base) {
             task_free_stack(task->stack_base, task->stack_size);
         }
         task_free(task);
-        
-        /* Update statistics */
-        task_mgr.stats.active_tasks--;
-        if (task->priority < 5) {
-            task_mgr.stats.tasks_by_priority[task->priority]--;
-        }
-        
-        task = next;
     }
-    task_mgr.terminated_queue = NULL;
 }
 
 /**
- * Get task manager statistics
+ * Get task manager statistics (summed over every CPU)
  */
 void task_manager_get_stats(task_manager_stats_t *stats)
 {
@@ -593,19 +1796,47 @@ void task_manager_get_stats(task_manager_stats_t *stats)
     /* Copy current stats */
     stats->total_tasks = task_mgr.stats.total_tasks;
     stats->active_tasks = task_mgr.stats.active_tasks;
-    stats->context_switches = task_mgr.stats.context_switches;
-    stats->scheduler_calls = task_mgr.stats.scheduler_calls;
+    stats->context_switches = 0;
+    stats->scheduler_calls = 0;
+    stats->sleeping_tasks = 0;
+    stats->migrations = 0;
+    stats->online_cpus = 0;
+    stats->deadline_tasks = 0;
+    stats->deadline_overruns = 0;
+    stats->deadline_misses = 0;
+    for (int i = 0; i < TASK_PRIORITY_COUNT; i++) {
+        stats->tasks_by_priority[i] = 0;
+    }
     
-    /* Count tasks by priority */
-    for (int i = 0; i < 5; i++) {
-        uint32_t count = 0;
-        task_t *task = task_mgr.ready_queue_head[i];
-        while (task) {
-            count++;
-            task = task->next;
+    uint32_t flags = task_irq_save();
+    for (uint32_t cpu = 0; cpu < task_mgr.nr_cpus; cpu++) {
+        task_rq_t *rq = &task_rq[cpu];
+        
+        /* Offline queues may still hold tasks parked before a CPU came up */
+        task_rq_lock(rq);
+        if (rq->online) {
+            stats->online_cpus++;
         }
-        stats->tasks_by_priority[i] = count;
+        stats->context_switches += rq->context_switches;
+        stats->scheduler_calls += rq->scheduler_calls;
+        stats->sleeping_tasks += rq->sleep_wheel.pending;
+        stats->migrations += rq->migrations;
+        stats->deadline_tasks += rq->nr_dl_tasks;
+        stats->deadline_overruns += rq->dl_overruns;
+        stats->deadline_misses += rq->dl_misses;
+        
+        /* Count tasks by priority */
+        for (task_t *task = rq->dl_head; task; task = task->next) {
+            stats->tasks_by_priority[task->priority]++;
+        }
+        for (int i = 0; i < TASK_PRIORITY_COUNT; i++) {
+            for (task_t *task = rq->ready_queue_head[i]; task; task = task->next) {
+                stats->tasks_by_priority[i]++;
+            }
+        }
+        task_rq_unlock(rq);
     }
+    task_irq_restore(flags);
 }
 
 /**
@@ -613,69 +1844,324 @@ void task_manager_get_stats(task_manager_stats_t *stats)
  */
 int task_terminate(task_t *task)
 {
-    if (!task) return -1;
+    if (!task || (task->flags & TASK_FLAG_IDLE) ||
+        task->state == TASK_STATE_TERMINATED || task->state == TASK_STATE_ZOMBIE) {
+        return -1;
+    }
+    
+    uint32_t flags = task_irq_save();
+    task_rq_t *rq = task_rq_lock_task(task);
     
     /* Remove from current queue */
     switch (task->state) {
         case TASK_STATE_READY:
-            task_remove_from_ready_queue(task);
+            task_remove_from_ready_queue(rq, task, false);
             break;
         case TASK_STATE_BLOCKED:
+            timer_wheel_remove(&rq->sleep_wheel, &task->sleep_node);
+            task_spin_lock(&task_mgr.lock);
             task_queue_remove(&task_mgr.blocked_queue, NULL, task);
+            task_spin_unlock(&task_mgr.lock);
             break;
         case TASK_STATE_SLEEPING:
-            task_queue_remove(&task_mgr.sleeping_queue, NULL, task);
+            timer_wheel_remove(&rq->sleep_wheel, &task->sleep_node);
             break;
         default:
             break;
     }
     
-    /* Mark as terminated */
+    /* Mark as terminated; a task running elsewhere stops at its next
+       reschedule, and nothing is freed while its context is live */
+    bool self = task == rq->current_task && rq == task_this_rq();
     task->state = TASK_STATE_TERMINATED;
+    task_spin_lock(&task_mgr.lock);
     task_queue_add(&task_mgr.terminated_queue, NULL, task);
+    task_spin_unlock(&task_mgr.lock);
+    task_rq_unlock(rq);
+    
+    /* Give the deadline bandwidth back to the CPU that admitted it */
+    if (task->flags & TASK_FLAG_DEADLINE) {
+        ktimer_cancel(&task->dl.timer);
+        task_rq_t *dl_rq = &task_rq[task->dl.cpu];
+        task_rq_lock(dl_rq);
+        dl_rq->dl_bw -= task->dl.bw;
+        dl_rq->nr_dl_tasks--;
+        task_rq_unlock(dl_rq);
+    }
+    task_irq_restore(flags);
     
     /* If terminating current task, schedule next */
-    if (task == task_mgr.current_task) {
-        task_mgr.current_task = NULL;
+    if (self) {
         task_schedule();
     }
     
     return 0;
 }
 
+/* Lookup predicate for task_find_matching() */
+typedef bool (*task_match_fn_t)(task_t *task, void *arg);
+
 /**
- * Find task by ID
+ * Find a sleeping task (walks every timer wheel slot; debug use only)
  */
-task_t* task_find_by_id(uint32_t task_id)
+static task_t* task_find_in_slot(timer_wheel_node_t *node, task_match_fn_t match, void *arg)
+{
+    for (; node; node = node->next) {
+        task_t *task = TASK_FROM_SLEEP_NODE(node);
+        if (match(task, arg)) return task;
+    }
+    return NULL;
+}
+
+static task_t* task_find_sleeping(timer_wheel_t *wheel, task_match_fn_t match, void *arg)
+{
+    task_t *task;
+    
+    for (uint32_t i = 0; i < TIMER_WHEEL_ROOT_SIZE; i++) {
+        if ((task = task_find_in_slot(wheel->root[i], match, arg))) return task;
+    }
+    for (uint32_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (uint32_t i = 0; i < TIMER_WHEEL_LEVEL_SIZE; i++) {
+            if ((task = task_find_in_slot(wheel->levels[level][i], match, arg))) return task;
+        }
+    }
+    return NULL;
+}
+
+static task_t* task_find_on_rq(task_rq_t *rq, task_match_fn_t match, void *arg)
 {
     /* Check ready queues */
-    for (int i = 0; i < 5; i++) {
-        task_t *task = task_mgr.ready_queue_head[i];
-        while (task) {
-            if (task->task_id == task_id) return task;
-            task = task->next;
+    for (task_t *task = rq->dl_head; task; task = task->next) {
+        if (match(task, arg)) return task;
+    }
+    for (int i = 0; i < TASK_PRIORITY_COUNT; i++) {
+        for (task_t *task = rq->ready_queue_head[i]; task; task = task->next) {
+            if (match(task, arg)) return task;
         }
     }
     
     /* Check current task */
-    if (task_mgr.current_task && task_mgr.current_task->task_id == task_id) {
-        return task_mgr.current_task;
+    if (rq->current_task && match(rq->current_task, arg)) {
+        return rq->current_task;
     }
     
-    /* Check blocked and sleeping queues */
-    task_t *task = task_mgr.blocked_queue;
-    while (task) {
-        if (task->task_id == task_id) return task;
-        task = task->next;
+    return task_find_sleeping(&rq->sleep_wheel, match, arg);
+}
+
+/**
+ * First task, in any state short of terminated, that 'match' accepts. A
+ * predicate that never matches visits every task. 'lock' is false only
+ * on the fault path, where the faulting code may hold the locks.
+ */
+static task_t* task_find_matching(task_match_fn_t match, void *arg, bool lock)
+{
+    task_t *task = NULL;
+    uint32_t flags = task_irq_save();
+    
+    for (uint32_t cpu = 0; cpu < task_mgr.nr_cpus && !task; cpu++) {
+        if (lock) task_rq_lock(&task_rq[cpu]);
+        task = task_find_on_rq(&task_rq[cpu], match, arg);
+        if (lock) task_rq_unlock(&task_rq[cpu]);
     }
     
-    task = task_mgr.sleeping_queue;
-    while (task) {
-        if (task->task_id == task_id) return task;
-        task = task->next;
+    /* Check blocked queue */
+    if (lock) task_spin_lock(&task_mgr.lock);
+    for (task_t *blocked = task_mgr.blocked_queue; blocked && !task; blocked = blocked->next) {
+        if (match(blocked, arg)) task = blocked;
+    }
+    if (lock) task_spin_unlock(&task_mgr.lock);
+    
+    task_irq_restore(flags);
+    return task;
+}
+
+static bool task_match_id(task_t *task, void *arg)
+{
+    return task->task_id == *(uint32_t*)arg;
+}
+
+static bool task_match_name(task_t *task, void *arg)
+{
+    return strcmp(task->name, (const char*)arg) == 0;
+}
+
+static bool task_match_stack_guard(task_t *task, void *arg)
+{
+    return task_stack_in_guard(task->stack_base, *(uint32_t*)arg);
+}
+
+/**
+ * Find task by ID
+ */
+task_t* task_find_by_id(uint32_t task_id)
+{
+    return task_find_matching(task_match_id, &task_id, true);
+}
+
+/**
+ * Find task by name (the first one, if several share it)
+ */
+task_t* task_find_by_name(const char *name)
+{
+    if (!name || !task_mgr.initialized) {
+        return NULL;
+    }
+    return task_find_matching(task_match_name, (void*)name, true);
+}
+
+/**
+ * Task whose stack guard page contains addr, for the page fault handler
+ */
+task_t* task_find_by_stack_guard(uint32_t addr)
+{
+    if (!task_mgr.initialized) {
+        return NULL;
+    }
+    return task_find_matching(task_match_stack_guard, &addr, false);
+}
+
+/* ──────────── Debug dumps ──────────── */
+
+static const char *task_state_names[] = {
+    [TASK_STATE_CREATED]    = "created",
+    [TASK_STATE_READY]      = "ready",
+    [TASK_STATE_RUNNING]    = "running",
+    [TASK_STATE_BLOCKED]    = "blocked",
+    [TASK_STATE_SLEEPING]   = "sleeping",
+    [TASK_STATE_TERMINATED] = "terminated",
+    [TASK_STATE_ZOMBIE]     = "zombie"
+};
+
+/**
+ * One line per task: id, name, state, priority, CPU and the deepest
+ * point its stack has reached
+ */
+void task_dump_info(task_t *task)
+{
+    if (!task) {
+        return;
+    }
+    
+    gfx_print_decimal(task->task_id);
+    gfx_print(" ");
+    gfx_print(task->name);
+    gfx_print(" ");
+    gfx_print(task->state <= TASK_STATE_ZOMBIE ? task_state_names[task->state] : "?");
+    gfx_print(" prio ");
+    gfx_print_decimal(task->priority);
+    gfx_print(" cpu ");
+    gfx_print_decimal(task->cpu);
+    
+    if (task->stack_base) {
+        uint32_t used = task_stack_high_water(task->stack_base, task->stack_size);
+        gfx_print(" stack ");
+        gfx_print_decimal(used);
+        gfx_print("/");
+        gfx_print_decimal(task->stack_size);
+        gfx_print(" (");
+        gfx_print_decimal(used * 100 / task->stack_size);
+        gfx_print("%)");
+    }
+    if (task->flags & TASK_FLAG_DEADLINE) {
+        gfx_print(" dl ");
+        gfx_print_decimal((uint32_t)ktime_to_us(task->dl.runtime));
+        gfx_print("/");
+        gfx_print_decimal((uint32_t)ktime_to_us(task->dl.deadline));
+        gfx_print("/");
+        gfx_print_decimal((uint32_t)ktime_to_us(task->dl.period));
+        gfx_print("us jobs ");
+        gfx_print_decimal(task->dl.jobs);
+        gfx_print(" overruns ");
+        gfx_print_decimal(task->dl.overruns);
+        gfx_print(" misses ");
+        gfx_print_decimal(task->dl.misses);
+    }
+    gfx_print("\n");
+}
+
+static bool task_dump_visit(task_t *task, void *arg)
+{
+    (void)arg;
+    task_dump_info(task);
+    return false;
+}
+
+/**
+ * Dump every live task, then the stack pool the stacks come from
+ */
+void task_dump_all_tasks(void)
+{
+    if (!task_mgr.initialized) {
+        gfx_print("Task manager not initialized\n");
+        return;
+    }
+    
+    gfx_print("Tasks (id name state priority cpu stack peak/size):\n");
+    task_find_matching(task_dump_visit, NULL, true);
+    task_stack_print_stats();
+}
+
+static bool task_latency_visit(task_t *task, void *arg)
+{
+    if (*(bool*)arg) {
+        sched_latency_reset(&task->latency);
+        return false;
+    }
+    if (task->latency.wait.count || task->latency.voluntary || task->latency.involuntary) {
+        gfx_print("  ");
+        gfx_print_decimal(task->task_id);
+        gfx_print(" ");
+        gfx_print(task->name);
+        sched_latency_print_summary(&task->latency);
+        gfx_print("\n");
+    }
+    return false;
+}
+
+/**
+ * Latency histograms of every CPU's run queue, then a summary line per
+ * task; with reset, clear them all instead
+ */
+void task_dump_latency(bool reset)
+{
+    if (!task_mgr.initialized) {
+        gfx_print("Task manager not initialized\n");
+        return;
+    }
+    
+    for (uint32_t cpu = 0; cpu < task_mgr.nr_cpus; cpu++) {
+        task_rq_t *rq = &task_rq[cpu];
+        uint32_t flags = task_irq_save();
+        task_rq_lock(rq);
+        sched_latency_t latency = rq->latency;
+        if (reset) {
+            sched_latency_reset(&rq->latency);
+        }
+        task_rq_unlock(rq);
+        task_irq_restore(flags);
+        
+        if (reset || !rq->online) {
+            continue;
+        }
+        gfx_print("CPU ");
+        gfx_print_decimal(cpu);
+        gfx_print(": switches ");
+        gfx_print_decimal(latency.voluntary);
+        gfx_print(" voluntary, ");
+        gfx_print_decimal(latency.involuntary);
+        gfx_print(" involuntary\n");
+        sched_hist_print("  wakeup ", &latency.wakeup);
+        sched_hist_print("  wait   ", &latency.wait);
+        sched_hist_print("  overrun", &latency.overrun);
     }
     
-    return NULL;  /* Not found */
+    if (!reset) {
+        gfx_print("Tasks (id name, us):\n");
+    }
+    task_find_matching(task_latency_visit, &reset, true);
+    if (reset) {
+        gfx_print("Scheduler latency statistics cleared\n");
+    }
 }
 
 /* Shutdown function */
@@ -684,11 +2170,15 @@ void task_manager_shutdown(void)
     SERIAL_LOG("TASK: Shutting down task manager\\n");
     
     /* Terminate all tasks */
-    for (int i = 0; i < 5; i++) {
-        while (task_mgr.ready_queue_head[i]) {
-            task_t *task = task_queue_pop(&task_mgr.ready_queue_head[i], 
-                                         &task_mgr.ready_queue_tail[i]);
-            task_terminate(task);
+    for (uint32_t cpu = 0; cpu < task_mgr.nr_cpus; cpu++) {
+        task_rq_t *rq = &task_rq[cpu];
+        while (rq->dl_head) {
+            task_terminate(rq->dl_head);
+        }
+        for (int i = 0; i < TASK_PRIORITY_COUNT; i++) {
+            while (rq->ready_queue_head[i]) {
+                task_terminate(rq->ready_queue_head[i]);
+            }
         }
     }
     
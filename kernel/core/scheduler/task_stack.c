@@ -0,0 +1,194 @@
+#include "task_stack.h"
+#include "../kernel.h"
+#include "../spinlock.h"
+#include "../memory/heap.h"
+#include "../memory/vmm/vmm.h"
+#include "graphics/graphics.h"
+#include "config.h"
+
+/* Free stacks are chained through their lowest word */
+typedef struct task_stack_free {
+    struct task_stack_free *next;
+} task_stack_free_t;
+
+typedef struct {
+    spinlock_t lock;
+    task_stack_free_t *free_list;
+    task_stack_class_stats_t stats;
+} task_stack_class_t;
+
+static task_stack_class_t stack_classes[TASK_STACK_CLASSES] = {
+    { .lock = SPINLOCK_INIT("stack_4k"),  .stats = { .size = TASK_STACK_PAGE_SIZE << 0 } },
+    { .lock = SPINLOCK_INIT("stack_8k"),  .stats = { .size = TASK_STACK_PAGE_SIZE << 1 } },
+    { .lock = SPINLOCK_INIT("stack_16k"), .stats = { .size = TASK_STACK_PAGE_SIZE << 2 } },
+    { .lock = SPINLOCK_INIT("stack_32k"), .stats = { .size = TASK_STACK_PAGE_SIZE << 3 } },
+};
+
+/* Class serving a request, or TASK_STACK_CLASSES if none does */
+static uint32_t task_stack_class_index(size_t size)
+{
+    uint32_t index = 0;
+    while (index < TASK_STACK_CLASSES && stack_classes[index].stats.size < size) {
+        index++;
+    }
+    return index;
+}
+
+size_t task_stack_class_size(size_t size)
+{
+    uint32_t index = task_stack_class_index(size);
+    return index < TASK_STACK_CLASSES ? stack_classes[index].stats.size : 0;
+}
+
+static void task_stack_fill(uint32_t *from, uint32_t *to)
+{
+    while (from < to) {
+        *from++ = TASK_STACK_CANARY;
+    }
+}
+
+/**
+ * Carve a new stack: guarded VMM pages when paging is on, page-aligned
+ * heap memory before that
+ */
+static void* task_stack_create(task_stack_class_t *cls)
+{
+    uint32_t size = cls->stats.size;
+    void *base = vmm_alloc_guarded_pages(size / TASK_STACK_PAGE_SIZE);
+    bool guarded = base != NULL;
+    if (!base) {
+        base = heap_alloc_aligned(size, TASK_STACK_PAGE_SIZE);
+        if (!base) {
+            return NULL;
+        }
+    }
+
+    task_stack_fill((uint32_t*)base, (uint32_t*)((uint8_t*)base + size));
+
+    uint32_t flags = spin_lock_irqsave(&cls->lock);
+    cls->stats.created++;
+    if (guarded) {
+        cls->stats.guarded++;
+    }
+    spin_unlock_irqrestore(&cls->lock, flags);
+    return base;
+}
+
+void* task_stack_alloc(size_t size)
+{
+    uint32_t index = task_stack_class_index(size);
+    if (index >= TASK_STACK_CLASSES) {
+        SERIAL_LOG("TASK: Stack request above the largest class\n");
+        return NULL;
+    }
+    task_stack_class_t *cls = &stack_classes[index];
+
+    uint32_t flags = spin_lock_irqsave(&cls->lock);
+    task_stack_free_t *stack = cls->free_list;
+    if (stack) {
+        cls->free_list = stack->next;
+    }
+    spin_unlock_irqrestore(&cls->lock, flags);
+
+    if (stack) {
+        stack->next = (task_stack_free_t*)TASK_STACK_CANARY;
+    } else if (!(stack = task_stack_create(cls))) {
+        return NULL;
+    }
+
+    flags = spin_lock_irqsave(&cls->lock);
+    if (++cls->stats.in_use > cls->stats.peak_in_use) {
+        cls->stats.peak_in_use = cls->stats.in_use;
+    }
+    spin_unlock_irqrestore(&cls->lock, flags);
+    return stack;
+}
+
+/**
+ * Return a stack to its class. Only the part the task reached needs its
+ * canary restored, which keeps recycling cheap for shallow tasks.
+ */
+void task_stack_free(void *base, size_t size)
+{
+    if (!base) {
+        return;
+    }
+    uint32_t index = task_stack_class_index(size);
+    if (index >= TASK_STACK_CLASSES) {
+        return;
+    }
+    task_stack_class_t *cls = &stack_classes[index];
+    uint32_t class_size = cls->stats.size;
+
+    uint32_t depth = task_stack_high_water(base, class_size);
+    uint8_t *top = (uint8_t*)base + class_size;
+    task_stack_fill((uint32_t*)(top - depth), (uint32_t*)top);
+
+    uint32_t flags = spin_lock_irqsave(&cls->lock);
+    task_stack_free_t *stack = (task_stack_free_t*)base;
+    stack->next = cls->free_list;
+    cls->free_list = stack;
+    cls->stats.in_use--;
+    if (depth > cls->stats.peak_depth) {
+        cls->stats.peak_depth = depth;
+    }
+    spin_unlock_irqrestore(&cls->lock, flags);
+}
+
+/**
+ * Scan up from the bottom for the first overwritten canary word
+ */
+uint32_t task_stack_high_water(const void *base, size_t size)
+{
+    if (!base || !size) {
+        return 0;
+    }
+    const uint32_t *word = (const uint32_t*)base;
+    const uint32_t *top = (const uint32_t*)((const uint8_t*)base + size);
+    while (word < top && *word == TASK_STACK_CANARY) {
+        word++;
+    }
+    return (uint32_t)((const uint8_t*)top - (const uint8_t*)word);
+}
+
+bool task_stack_in_guard(const void *base, uint32_t addr)
+{
+    uint32_t bottom = (uint32_t)base;
+    return bottom && addr < bottom && addr >= bottom - TASK_STACK_PAGE_SIZE;
+}
+
+void task_stack_get_stats(uint32_t class_index, task_stack_class_stats_t *stats)
+{
+    if (class_index >= TASK_STACK_CLASSES) {
+        return;
+    }
+    task_stack_class_t *cls = &stack_classes[class_index];
+    uint32_t flags = spin_lock_irqsave(&cls->lock);
+    *stats = cls->stats;
+    spin_unlock_irqrestore(&cls->lock, flags);
+}
+
+void task_stack_print_stats(void)
+{
+    gfx_print("Stack pool (size: created/guarded, in use, peak, deepest):\n");
+    for (uint32_t i = 0; i < TASK_STACK_CLASSES; i++) {
+        task_stack_class_stats_t stats;
+        task_stack_get_stats(i, &stats);
+        if (!stats.created) {
+            continue;
+        }
+        gfx_print("  ");
+        gfx_print_decimal(stats.size / 1024);
+        gfx_print(" KB: ");
+        gfx_print_decimal(stats.created);
+        gfx_print("/");
+        gfx_print_decimal(stats.guarded);
+        gfx_print(", ");
+        gfx_print_decimal(stats.in_use);
+        gfx_print(", ");
+        gfx_print_decimal(stats.peak_in_use);
+        gfx_print(", ");
+        gfx_print_decimal(stats.peak_depth);
+        gfx_print(" bytes\n");
+    }
+}
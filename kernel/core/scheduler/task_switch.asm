@@ -21,16 +21,16 @@ global task_restore_context
 %define CTX_EDX     12
 %define CTX_ESI     16
 %define CTX_EDI     20
-%define CTX_EBP     24
-%define CTX_ESP     28
+%define CTX_ESP     24
+%define CTX_EBP     28
 %define CTX_EIP     32
 %define CTX_EFLAGS  36
-%define CTX_CS      40
-%define CTX_DS      44
-%define CTX_ES      48
-%define CTX_FS      52
-%define CTX_GS      56
-%define CTX_SS      60
+%define CTX_CS      40      ; Segment selectors are 16-bit fields
+%define CTX_DS      42
+%define CTX_ES      44
+%define CTX_FS      46
+%define CTX_GS      48
+%define CTX_SS      50
 
 ; Task structure offsets (must match task_t in task_manager.h)
 ; task_id(4) + name(32) + state(4) + priority(4) + flags(4) = 48 bytes
@@ -77,13 +77,15 @@ task_switch_context_asm:
     pop dword [eax + CTX_EBX]
     pop dword [eax + CTX_EAX]
     
-    ; Save stack pointer (after our function call)
-    mov [eax + CTX_ESP], esp
-    
     ; Save instruction pointer (return address)
     mov ecx, [esp]
     mov [eax + CTX_EIP], ecx
     
+    ; Save stack pointer as it is once that address has been popped;
+    ; the restore path pushes EIP again and returns through it
+    lea ecx, [esp + 4]
+    mov [eax + CTX_ESP], ecx
+    
     ; Save flags
     pushf
     pop dword [eax + CTX_EFLAGS]
@@ -137,8 +139,8 @@ task_switch_context_asm:
     push dword [ebx + CTX_EIP]      ; Push return address
     mov ebx, [ebx + CTX_EBX]
     
-    ; Enable interrupts and jump to new task
-    sti
+    ; Jump to new task. Interrupts stay as its saved EFLAGS left them:
+    ; the scheduler re-enables them once the switch is finished
     ret         ; Jump to EIP that we pushed
 
 ;
@@ -1,15 +1,43 @@
 #include "task_manager.h"
+#include "task_stack.h"
+#include "mutex.h"
+#include "wait_queue.h"
 #include "../kernel.h"
+#include "../atomic.h"
+#include "../ktime.h"
+#include "../smp.h"
 #include "config.h"
+#include "graphics/graphics.h"
 
 /* Test task functions */
 static int test_task_1(void *data);
 static int test_task_2(void *data);
 static int test_task_3(void *data);
+static int test_fpu_task(void *data);
+static void task_manager_test_fpu(void);
+static int test_dl_frame_task(void *data);
+static int test_dl_hog_task(void *data);
+static void task_manager_test_deadline(void);
+static int test_guard_task(void *data);
 
 /* Test data */
 static volatile int test_counter = 0;
-static volatile bool test_complete = false;
+static mutex_t test_counter_lock = MUTEX_INIT("test_counter");
+static completion_t test_done = COMPLETION_INIT("test_done");
+static volatile uint32_t fpu_tasks_left = 0;
+static volatile uint32_t fpu_mismatches = 0;
+static completion_t fpu_done = COMPLETION_INIT("fpu_done");
+
+/* Deadline test: a 60 Hz frame job under CPU hogs */
+#define DL_TEST_RUNTIME_US  4000
+#define DL_TEST_PERIOD_US   16666
+#define DL_TEST_WORK_US     2000
+#define DL_TEST_JOBS        30
+#define DL_TEST_HOGS        2
+static volatile uint32_t dl_stop_hogs = 0;
+static volatile uint32_t dl_hog_loops = 0;
+static volatile uint32_t dl_min_slack_us = 0;
+static completion_t dl_done = COMPLETION_INIT("dl_done");
 
 /**
  * Test the task manager functionality
@@ -43,11 +71,10 @@ void task_manager_test(void)
     
     SERIAL_LOG("TASK_TEST: Started test tasks\n");
     
-    /* Let tasks run for a while */
-    for (int i = 0; i < 100 && !test_complete; i++) {
-        task_schedule();
-        task_sleep(10);  /* 10ms delay */
-    }
+    /* Let tasks run until the last one signals (or a second passes) */
+    bool finished = wait_for_completion_timeout(&test_done, 1000);
+    SERIAL_LOG(finished ? "TASK_TEST: Tasks signalled completion\n"
+                        : "TASK_TEST: Timed out waiting for tasks\n");
     
     /* Print statistics */
     task_manager_stats_t stats;
@@ -66,6 +93,12 @@ void task_manager_test(void)
     SERIAL_LOG("  Scheduler calls: ");
     SERIAL_LOG_HEX("", stats.scheduler_calls);
     SERIAL_LOG("\n");
+    SERIAL_LOG("  Online CPUs: ");
+    SERIAL_LOG_HEX("", stats.online_cpus);
+    SERIAL_LOG("\n");
+    SERIAL_LOG("  Migrations: ");
+    SERIAL_LOG_HEX("", stats.migrations);
+    SERIAL_LOG("\n");
     SERIAL_LOG("  Test counter: ");
     SERIAL_LOG_HEX("", test_counter);
     SERIAL_LOG("\n");
@@ -75,9 +108,79 @@ void task_manager_test(void)
     task_terminate(task2);
     task_terminate(task3);
     
+    task_manager_test_fpu();
+    task_manager_test_deadline();
+    
     SERIAL_LOG("TASK_TEST: Test completed\n");
 }
 
+/**
+ * Tasks with different x87 rounding modes yield to each other; each must
+ * find its own control word every time it resumes
+ */
+static void task_manager_test_fpu(void)
+{
+    task_t *fpu_tasks[3];
+    
+    fpu_tasks_left = 3;
+    fpu_mismatches = 0;
+    for (uint32_t i = 0; i < 3; i++) {
+        fpu_tasks[i] = task_create("fpu", test_fpu_task, (void*)i,
+                                   TASK_PRIORITY_NORMAL, TASK_FLAG_PREEMPTIBLE);
+        if (!fpu_tasks[i]) {
+            SERIAL_LOG("TASK_TEST: ERROR - Failed to create FPU tasks\n");
+            return;
+        }
+    }
+    for (uint32_t i = 0; i < 3; i++) {
+        task_start(fpu_tasks[i]);
+    }
+    
+    bool finished = wait_for_completion_timeout(&fpu_done, 1000);
+    fpu_stats_t fstats;
+    fpu_get_stats(&fstats);
+    
+    SERIAL_LOG(finished && !fpu_mismatches ? "TASK_TEST: FPU state isolated\n"
+                                           : "TASK_TEST: FPU test FAILED\n");
+    SERIAL_LOG_HEX("  FPU mismatches: ", fpu_mismatches);
+    SERIAL_LOG_HEX("  FPU traps: ", fstats.traps);
+    SERIAL_LOG_HEX("  FPU saves: ", fstats.saves);
+    SERIAL_LOG_HEX("  FPU fast resumes: ", fstats.fast_resumes);
+    
+    for (uint32_t i = 0; i < 3; i++) {
+        task_terminate(fpu_tasks[i]);
+    }
+}
+
+/**
+ * FPU task: rounding mode i in bits 10-11 of the control word, plus a
+ * running sum that must come out exact
+ */
+static int test_fpu_task(void *data)
+{
+    uint16_t cw = (uint16_t)(0x037F | ((uint32_t)data << 10));
+    uint16_t seen;
+    volatile double sum = 0.0;
+    
+    __asm__ volatile("fldcw %0" :: "m"(cw));
+    for (int i = 0; i < 50; i++) {
+        sum += 0.5;
+        task_yield();
+        __asm__ volatile("fnstcw %0" : "=m"(seen));
+        if (seen != cw) {
+            atomic_inc_u32(&fpu_mismatches);
+        }
+    }
+    if (sum != 25.0) {
+        atomic_inc_u32(&fpu_mismatches);
+    }
+    
+    if (atomic_dec_and_test_u32(&fpu_tasks_left)) {
+        complete(&fpu_done);
+    }
+    return 0;
+}
+
 /**
  * Test task 1 - High priority
  */
@@ -95,7 +198,9 @@ static int test_task_1(void *data)
         SERIAL_LOG_HEX("", i);
         SERIAL_LOG("\n");
         
+        mutex_lock(&test_counter_lock);
         test_counter++;
+        mutex_unlock(&test_counter_lock);
         task_yield();
         task_sleep(20);
     }
@@ -124,7 +229,9 @@ static int test_task_2(void *data)
         SERIAL_LOG_HEX("", i);
         SERIAL_LOG("\n");
         
+        mutex_lock(&test_counter_lock);
         test_counter += 2;
+        mutex_unlock(&test_counter_lock);
         task_yield();
         task_sleep(30);
     }
@@ -153,7 +260,9 @@ static int test_task_3(void *data)
         SERIAL_LOG_HEX("", i);
         SERIAL_LOG("\n");
         
+        mutex_lock(&test_counter_lock);
         test_counter += 3;
+        mutex_unlock(&test_counter_lock);
         task_yield();
         task_sleep(50);
     }
@@ -162,6 +271,149 @@ static int test_task_3(void *data)
     SERIAL_LOG_HEX("", task_num);
     SERIAL_LOG(" (LOW) completed\n");
     
-    test_complete = true;
+    complete(&test_done);
+    return 0;
+}
+/**
+ * A periodic deadline task doing DL_TEST_WORK_US per frame must meet every
+ * deadline while higher priority hogs keep all CPUs busy, and admission
+ * must refuse more bandwidth than a CPU has
+ */
+static void task_manager_test_deadline(void)
+{
+    task_t *hogs[DL_TEST_HOGS];
+    
+    dl_stop_hogs = 0;
+    dl_hog_loops = 0;
+    dl_min_slack_us = 0;
+    
+    task_t *greedy = task_create("dl_greedy", test_dl_hog_task, NULL,
+                                 TASK_PRIORITY_NORMAL, TASK_FLAG_PREEMPTIBLE);
+    if (greedy) {
+        SERIAL_LOG(task_set_deadline(greedy, 9500, 10000, 10000) < 0
+                   ? "TASK_TEST: Deadline admission refused 95% as expected\n"
+                   : "TASK_TEST: Deadline admission FAILED to refuse 95%\n");
+        task_terminate(greedy);
+    }
+    
+    task_t *frame = task_create("dl_frame", test_dl_frame_task, NULL,
+                                TASK_PRIORITY_LOW, TASK_FLAG_PREEMPTIBLE);
+    if (!frame || task_set_deadline(frame, DL_TEST_RUNTIME_US, DL_TEST_PERIOD_US,
+                                    DL_TEST_PERIOD_US) < 0) {
+        SERIAL_LOG("TASK_TEST: ERROR - Failed to create deadline task\n");
+        return;
+    }
+    for (uint32_t i = 0; i < DL_TEST_HOGS; i++) {
+        hogs[i] = task_create("dl_hog", test_dl_hog_task, NULL,
+                              TASK_PRIORITY_HIGH, TASK_FLAG_PREEMPTIBLE);
+        if (hogs[i]) {
+            task_start(hogs[i]);
+        }
+    }
+    task_start(frame);
+    
+    bool finished = wait_for_completion_timeout(&dl_done, 2000);
+    dl_stop_hogs = 1;
+    
+    SERIAL_LOG(finished && !frame->dl.misses ? "TASK_TEST: Deadline jobs all on time\n"
+                                             : "TASK_TEST: Deadline test FAILED\n");
+    SERIAL_LOG_DEC("  Deadline jobs: ", frame->dl.jobs);
+    SERIAL_LOG_DEC("  Deadline misses: ", frame->dl.misses);
+    SERIAL_LOG_DEC("  Deadline overruns: ", frame->dl.overruns);
+    SERIAL_LOG_DEC("  Least slack before a deadline (us): ",
+                   dl_min_slack_us);
+    SERIAL_LOG_DEC("  Hog loops: ", dl_hog_loops);
+    
+    task_terminate(frame);
+    for (uint32_t i = 0; i < DL_TEST_HOGS; i++) {
+        if (hogs[i]) {
+            task_terminate(hogs[i]);
+        }
+    }
+}
+
+/**
+ * Frame task: fixed work per period, then wait for the next one
+ */
+static int test_dl_frame_task(void *data)
+{
+    (void)data;
+    task_t *self = task_current();
+    uint32_t min_slack_us = UINT32_MAX;
+    
+    for (int i = 0; i < DL_TEST_JOBS; i++) {
+        ktime_t end = ktime_get() + (ktime_t)DL_TEST_WORK_US * NSEC_PER_USEC;
+        while (ktime_get() < end) {
+            cpu_relax();
+        }
+        
+        ktime_t now = ktime_get();
+        uint32_t slack_us = now < self->dl.abs_deadline ?
+            (uint32_t)ktime_to_us(self->dl.abs_deadline - now) : 0;
+        if (slack_us < min_slack_us) {
+            min_slack_us = slack_us;
+        }
+        task_wait_period();
+    }
+    
+    dl_min_slack_us = min_slack_us;
+    complete(&dl_done);
+    return 0;
+}
+
+/**
+ * CPU hog: spins until told to stop, preempted only by the tick
+ */
+static int test_dl_hog_task(void *data)
+{
+    (void)data;
+    while (!dl_stop_hogs) {
+        atomic_inc_u32(&dl_hog_loops);
+        for (volatile int i = 0; i < 1000; i++) {
+        }
+    }
+    return 0;
+}
+
+/**
+ * Fault on a live task's guard page: the handler must get vector 14 and
+ * the error code, find the owner and halt
+ */
+void task_stack_guard_test(void)
+{
+    task_manager_init();
+    
+    task_t *task = task_create("guardtest", test_guard_task, NULL,
+                               TASK_PRIORITY_LOW, TASK_FLAG_PREEMPTIBLE);
+    if (!task) {
+        gfx_print("GUARD_TEST: could not create the task\n");
+        return;
+    }
+    
+    uint32_t guard = (uint32_t)task->stack_base - 1;
+    if (!task_stack_in_guard(task->stack_base, guard)) {
+        gfx_print("GUARD_TEST: stack has no guard page (paging off?)\n");
+        task_terminate(task);
+        return;
+    }
+    task_start(task);
+    
+    gfx_print("GUARD_TEST: expect a stack overflow report for task guardtest\n");
+    SERIAL_LOG_HEX("GUARD_TEST: writing guard page at ", guard);
+    *(volatile uint8_t*)guard = 0;
+    
+    gfx_print("GUARD_TEST: FAILED - the write did not fault\n");
+    task_terminate(task);
+}
+
+/**
+ * Keeps the guarded stack alive and findable while the test faults
+ */
+static int test_guard_task(void *data)
+{
+    (void)data;
+    for (;;) {
+        task_sleep(100);
+    }
     return 0;
-}
\ No newline at end of file
+}
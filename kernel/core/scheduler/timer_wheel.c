@@ -0,0 +1,137 @@
+#include "timer_wheel.h"
+#include "core/string.h"
+
+#define ROOT_MASK   (TIMER_WHEEL_ROOT_SIZE - 1)
+#define LEVEL_MASK  (TIMER_WHEEL_LEVEL_SIZE - 1)
+
+/* First bit of the tick count that indexes an outer level */
+#define LEVEL_SHIFT(level) (TIMER_WHEEL_ROOT_BITS + (level) * TIMER_WHEEL_LEVEL_BITS)
+
+/**
+ * Initialize an empty wheel whose first processed tick is 'now'
+ */
+void timer_wheel_init(timer_wheel_t *wheel, uint32_t now)
+{
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->now = now;
+}
+
+static void timer_wheel_link(timer_wheel_t *wheel, timer_wheel_node_t **slot, timer_wheel_node_t *node)
+{
+    node->prev = NULL;
+    node->next = *slot;
+    if (*slot) {
+        (*slot)->prev = node;
+    }
+    *slot = node;
+    node->slot = slot;
+    wheel->pending++;
+}
+
+/**
+ * Queue a node to fire once the wheel reaches tick 'expires'. Deadlines
+ * already in the past fire on the next advance.
+ */
+void timer_wheel_add(timer_wheel_t *wheel, timer_wheel_node_t *node, uint32_t expires)
+{
+    node->expires = expires;
+
+    uint32_t delta = expires - wheel->now;
+    if ((int32_t)delta < 0) {
+        timer_wheel_link(wheel, &wheel->root[wheel->now & ROOT_MASK], node);
+        return;
+    }
+    if (delta < TIMER_WHEEL_ROOT_SIZE) {
+        timer_wheel_link(wheel, &wheel->root[expires & ROOT_MASK], node);
+        return;
+    }
+
+    /* Out of range: park in the furthest slot, re-filed on cascade */
+    if (delta > TIMER_WHEEL_MAX_DELTA) {
+        expires = wheel->now + TIMER_WHEEL_MAX_DELTA;
+        delta = TIMER_WHEEL_MAX_DELTA;
+    }
+
+    uint32_t level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1u << LEVEL_SHIFT(level + 1))) {
+        level++;
+    }
+    uint32_t index = (expires >> LEVEL_SHIFT(level)) & LEVEL_MASK;
+    timer_wheel_link(wheel, &wheel->levels[level][index], node);
+}
+
+/**
+ * Cancel a queued node; does nothing if it is not queued
+ */
+void timer_wheel_remove(timer_wheel_t *wheel, timer_wheel_node_t *node)
+{
+    if (!node->slot) {
+        return;
+    }
+
+    if (node->prev) {
+        node->prev->next = node->next;
+    } else {
+        *node->slot = node->next;
+    }
+    if (node->next) {
+        node->next->prev = node->prev;
+    }
+
+    node->next = node->prev = NULL;
+    node->slot = NULL;
+    wheel->pending--;
+}
+
+/**
+ * Re-file every node of an outer slot one level closer to the root
+ */
+static uint32_t timer_wheel_cascade(timer_wheel_t *wheel, uint32_t level, uint32_t index)
+{
+    timer_wheel_node_t *node = wheel->levels[level][index];
+    wheel->levels[level][index] = NULL;
+
+    while (node) {
+        timer_wheel_node_t *next = node->next;
+        node->slot = NULL;
+        wheel->pending--;
+        timer_wheel_add(wheel, node, node->expires);
+        node = next;
+    }
+    return index;
+}
+
+/**
+ * Process every tick up to and including 'now', calling 'fire' for each
+ * node that expires. Nodes are unlinked before 'fire' runs, so the callback
+ * may queue them again.
+ */
+void timer_wheel_advance(timer_wheel_t *wheel, uint32_t now, timer_wheel_fn_t fire)
+{
+    while ((int32_t)(now - wheel->now) >= 0) {
+        uint32_t index = wheel->now & ROOT_MASK;
+
+        /* Root wrapped: pull the next slot of each outer level down */
+        if (index == 0) {
+            for (uint32_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+                uint32_t outer = (wheel->now >> LEVEL_SHIFT(level)) & LEVEL_MASK;
+                if (timer_wheel_cascade(wheel, level, outer) != 0) {
+                    break;
+                }
+            }
+        }
+
+        timer_wheel_node_t *node = wheel->root[index];
+        wheel->root[index] = NULL;
+        wheel->now++;
+
+        while (node) {
+            timer_wheel_node_t *next = node->next;
+            node->next = node->prev = NULL;
+            node->slot = NULL;
+            wheel->pending--;
+            fire(node);
+            node = next;
+        }
+    }
+}
@@ -0,0 +1,262 @@
+#include "wait_queue.h"
+#include "../smp.h"
+
+/**
+ * Initialize an empty wait queue
+ */
+void wait_queue_init(wait_queue_t *wq, const char *name)
+{
+    spin_lock_init(&wq->lock, name);
+    wq->head = NULL;
+    wq->tail = NULL;
+}
+
+/**
+ * Whether anyone is waiting (a hint; may change right after)
+ */
+bool wait_queue_active(wait_queue_t *wq)
+{
+    return wq->head != NULL;
+}
+
+/* The calling context may block: a scheduled task, not an idle loop */
+static task_t* wait_blockable_task(void)
+{
+    task_t *self = task_current();
+    if (!self || (self->flags & TASK_FLAG_IDLE)) {
+        return NULL;
+    }
+    return self;
+}
+
+static void wait_unlink(wait_queue_t *wq, wait_queue_entry_t *entry)
+{
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        wq->head = entry->next;
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        wq->tail = entry->prev;
+    }
+    entry->next = entry->prev = NULL;
+}
+
+/**
+ * Queue the caller and mark it blocked; it keeps running until
+ * wait_sleep(). A timeout makes the task runnable again once it passes.
+ */
+void wait_prepare(wait_queue_t *wq, wait_queue_entry_t *entry, uint32_t timeout_ms)
+{
+    entry->task = wait_blockable_task();
+    entry->woken = 0;
+    entry->next = NULL;
+
+    uint32_t flags = spin_lock_irqsave(&wq->lock);
+    entry->prev = wq->tail;
+    if (wq->tail) {
+        wq->tail->next = entry;
+    } else {
+        wq->head = entry;
+    }
+    wq->tail = entry;
+
+    if (entry->task) {
+        task_block_prepare(entry->task, timeout_ms);
+    }
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+/**
+ * Give up the CPU until woken or the deadline (0 = none) passes
+ */
+void wait_sleep(wait_queue_entry_t *entry, ktime_t deadline)
+{
+    if (entry->task) {
+        task_schedule();
+        return;
+    }
+
+    while (!atomic_load_u32(&entry->woken)) {
+        if (deadline && ktime_get() >= deadline) {
+            break;
+        }
+        cpu_relax();
+    }
+}
+
+/**
+ * Leave the queue after wait_sleep() or instead of it. Returns whether a
+ * waker dequeued the entry; if not, a pending block is cancelled.
+ */
+bool wait_finish(wait_queue_t *wq, wait_queue_entry_t *entry)
+{
+    uint32_t flags = spin_lock_irqsave(&wq->lock);
+    bool woken = entry->woken != 0;
+    if (!woken) {
+        wait_unlink(wq, entry);
+    }
+    spin_unlock_irqrestore(&wq->lock, flags);
+
+    if (!woken && entry->task) {
+        task_unblock(entry->task);
+    }
+    return woken;
+}
+
+/**
+ * Wait until cond(arg) holds, re-checking after every wakeup. The waiter
+ * is queued before the condition is tested, so a waker that changes the
+ * condition and then calls wake_up() always finds it.
+ */
+bool wait_event(wait_queue_t *wq, wait_cond_fn_t cond, void *arg, uint32_t timeout_ms)
+{
+    if (cond(arg)) {
+        return true;
+    }
+
+    ktime_t deadline = timeout_ms ? ktime_get() + (uint64_t)timeout_ms * NSEC_PER_MSEC : 0;
+    wait_queue_entry_t entry;
+
+    for (;;) {
+        uint32_t remaining_ms = 0;
+        if (deadline) {
+            ktime_t now = ktime_get();
+            if (now >= deadline) {
+                return cond(arg);
+            }
+            remaining_ms = (uint32_t)ktime_div_u32(deadline - now + NSEC_PER_MSEC - 1, NSEC_PER_MSEC);
+        }
+
+        wait_prepare(wq, &entry, remaining_ms);
+        if (cond(arg)) {
+            wait_finish(wq, &entry);
+            return true;
+        }
+        wait_sleep(&entry, deadline);
+        wait_finish(wq, &entry);
+
+        if (cond(arg)) {
+            return true;
+        }
+    }
+}
+
+/* Dequeue and wake up to 'count' waiters; wq is locked */
+static uint32_t wake_up_locked(wait_queue_t *wq, uint32_t count)
+{
+    uint32_t woken = 0;
+    while (wq->head && woken < count) {
+        wait_queue_entry_t *entry = wq->head;
+        task_t *task = entry->task;
+        wait_unlink(wq, entry);
+
+        /* A polling waiter may return, and its entry vanish, as soon
+           as it sees this */
+        atomic_store_u32(&entry->woken, 1);
+        if (task) {
+            task_unblock(task);
+        }
+        woken++;
+    }
+    return woken;
+}
+
+/**
+ * Always takes the lock: checking for waiters without it could miss one
+ * that queued itself just before testing the condition
+ */
+uint32_t wake_up(wait_queue_t *wq, uint32_t count)
+{
+    uint32_t flags = spin_lock_irqsave(&wq->lock);
+    uint32_t woken = wake_up_locked(wq, count);
+    spin_unlock_irqrestore(&wq->lock, flags);
+    return woken;
+}
+
+uint32_t wake_up_one(wait_queue_t *wq)
+{
+    return wake_up(wq, 1);
+}
+
+uint32_t wake_up_all(wait_queue_t *wq)
+{
+    return wake_up(wq, 0xFFFFFFFF);
+}
+
+/* ──────────── Completions ──────────── */
+
+void completion_init(completion_t *c, const char *name)
+{
+    wait_queue_init(&c->wait, name);
+    c->done = 0;
+}
+
+/**
+ * Rearm a completion for reuse; nobody may be waiting on it
+ */
+void completion_reinit(completion_t *c)
+{
+    c->done = 0;
+}
+
+void complete(completion_t *c)
+{
+    uint32_t flags = spin_lock_irqsave(&c->wait.lock);
+    if (c->done != COMPLETION_DONE_ALL) {
+        c->done++;
+    }
+    wake_up_locked(&c->wait, 1);
+    spin_unlock_irqrestore(&c->wait.lock, flags);
+}
+
+void complete_all(completion_t *c)
+{
+    uint32_t flags = spin_lock_irqsave(&c->wait.lock);
+    c->done = COMPLETION_DONE_ALL;
+    wake_up_locked(&c->wait, 0xFFFFFFFF);
+    spin_unlock_irqrestore(&c->wait.lock, flags);
+}
+
+bool completion_done(completion_t *c)
+{
+    return c->done != 0;
+}
+
+/**
+ * Consume one completion if there is one, without waiting
+ */
+bool try_wait_for_completion(completion_t *c)
+{
+    if (!c->done) {
+        return false;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&c->wait.lock);
+    bool done = c->done != 0;
+    if (done && c->done != COMPLETION_DONE_ALL) {
+        c->done--;
+    }
+    spin_unlock_irqrestore(&c->wait.lock, flags);
+    return done;
+}
+
+static bool completion_cond(void *arg)
+{
+    return try_wait_for_completion((completion_t*)arg);
+}
+
+void wait_for_completion(completion_t *c)
+{
+    wait_event(&c->wait, completion_cond, c, WAIT_FOREVER);
+}
+
+/**
+ * Wait for a completion; false if the timeout passed first
+ */
+bool wait_for_completion_timeout(completion_t *c, uint32_t timeout_ms)
+{
+    return wait_event(&c->wait, completion_cond, c, timeout_ms);
+}
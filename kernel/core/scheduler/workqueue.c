@@ -0,0 +1,187 @@
+#include "workqueue.h"
+#include "../kernel.h"
+#include "../smp.h"
+#include "../atomic.h"
+#include "graphics/graphics.h"
+#include "config.h"
+
+/* Items a worker runs before letting its executor's other fibers in */
+#define WORKQUEUE_BATCH     16
+
+static workqueue_t system_wq[SMP_MAX_CPUS];
+static bool workqueue_started = false;
+
+void work_init(work_t *work, work_fn_t fn, void *data)
+{
+    work->next = NULL;
+    work->fn = fn;
+    work->data = data;
+    work->pending = 0;
+}
+
+/**
+ * Run the items waiting on entry, at most a batch of them. The event is
+ * reset, under the queue lock, only once the queue is seen empty;
+ * queue_work() sets it after adding to an empty queue, so no item is
+ * left waiting on a cleared event.
+ */
+static void workqueue_run_batch(workqueue_t *wq)
+{
+    for (uint32_t ran = 0; ran < WORKQUEUE_BATCH; ran++) {
+        uint32_t flags = spin_lock_irqsave(&wq->lock);
+        work_t *work = wq->head;
+        if (work) {
+            wq->head = work->next;
+            if (!wq->head) {
+                wq->tail = NULL;
+            }
+            wq->depth--;
+            wq->stats.executed++;
+            work->next = NULL;
+            atomic_store_u32(&work->pending, 0);
+        }
+        if (!wq->head) {
+            fiber_event_reset(&wq->event);
+        }
+        spin_unlock_irqrestore(&wq->lock, flags);
+
+        if (!work) {
+            return;
+        }
+        work->fn(work);
+    }
+}
+
+static int workqueue_worker(fiber_t *fiber, void *arg)
+{
+    workqueue_t *wq = (workqueue_t*)arg;
+
+    FIBER_BEGIN(fiber);
+    for (;;) {
+        FIBER_AWAIT(fiber, &wq->event, 0);
+        workqueue_run_batch(wq);
+        FIBER_YIELD(fiber);
+    }
+    FIBER_END(fiber);
+}
+
+static bool workqueue_start(workqueue_t *wq, const char *name, uint32_t cpu)
+{
+    wq->name = name;
+    wq->cpu = cpu;
+    wq->worker = fiber_spawn_poll_on(cpu, name, workqueue_worker, wq);
+    if (!wq->worker) {
+        SERIAL_LOG("WQ: Failed to start worker fiber\n");
+        return false;
+    }
+    return true;
+}
+
+bool workqueue_create(workqueue_t *wq, const char *name, uint32_t cpu)
+{
+    if (!wq || cpu >= SMP_MAX_CPUS) {
+        return false;
+    }
+    spin_lock_init(&wq->lock, name);
+    wq->head = wq->tail = NULL;
+    wq->depth = 0;
+    wq->stats = (workqueue_stats_t){0};
+    fiber_event_init(&wq->event, name);
+    return workqueue_start(wq, name, cpu);
+}
+
+/**
+ * The system queues are static, so interrupt handlers may queue work
+ * before this runs; it only starts a worker on every online CPU
+ */
+void workqueue_init(void)
+{
+    if (workqueue_started) {
+        return;
+    }
+    for (uint32_t cpu = 0; cpu < smp_cpu_count() && cpu < SMP_MAX_CPUS; cpu++) {
+        smp_cpu_t *info = smp_get_cpu(cpu);
+        if (cpu != 0 && (!info || !info->online)) {
+            continue;
+        }
+        workqueue_start(&system_wq[cpu], "kworker", cpu);
+    }
+    workqueue_started = true;
+    SERIAL_LOG("WQ: System workqueues started\n");
+}
+
+bool queue_work(workqueue_t *wq, work_t *work)
+{
+    if (!wq || !work || !work->fn) {
+        return false;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&wq->lock);
+    if (work->pending) {
+        wq->stats.merged++;
+        spin_unlock_irqrestore(&wq->lock, flags);
+        return false;
+    }
+    work->pending = 1;
+    work->next = NULL;
+    bool was_empty = wq->head == NULL;
+    if (wq->tail) {
+        wq->tail->next = work;
+    } else {
+        wq->head = work;
+    }
+    wq->tail = work;
+    wq->stats.queued++;
+    if (++wq->depth > wq->stats.max_depth) {
+        wq->stats.max_depth = wq->depth;
+    }
+    spin_unlock_irqrestore(&wq->lock, flags);
+
+    if (was_empty) {
+        fiber_event_signal(&wq->event);
+    }
+    return true;
+}
+
+/* The CPU's system queue; CPUs without a worker share the boot CPU's */
+workqueue_t* workqueue_system(uint32_t cpu)
+{
+    if (cpu >= SMP_MAX_CPUS || (workqueue_started && !system_wq[cpu].worker)) {
+        cpu = 0;
+    }
+    return &system_wq[cpu];
+}
+
+bool schedule_work_on(uint32_t cpu, work_t *work)
+{
+    return queue_work(workqueue_system(cpu), work);
+}
+
+bool schedule_work(work_t *work)
+{
+    return queue_work(workqueue_system(smp_current_cpu()), work);
+}
+
+void workqueue_print_stats(void)
+{
+    gfx_print("Workqueues (cpu: queued/merged/executed, waiting, deepest):\n");
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        workqueue_t *wq = &system_wq[cpu];
+        if (!wq->worker && !wq->stats.queued) {
+            continue;
+        }
+        gfx_print("  ");
+        gfx_print_decimal(cpu);
+        gfx_print(": ");
+        gfx_print_decimal(wq->stats.queued);
+        gfx_print("/");
+        gfx_print_decimal(wq->stats.merged);
+        gfx_print("/");
+        gfx_print_decimal(wq->stats.executed);
+        gfx_print(", ");
+        gfx_print_decimal(wq->depth);
+        gfx_print(", ");
+        gfx_print_decimal(wq->stats.max_depth);
+        gfx_print(wq->worker ? "\n" : " (no worker)\n");
+    }
+}
@@ -1,10 +1,22 @@
 #include "sleep.h"
 #include "timer.h"
+#include "scheduler/task_manager.h"
+#include "scheduler/fiber.h"
 
-// Simple millisecond sleep using system tick counter
+// Millisecond sleep: tasks block on the scheduler's timer wheel; boot
+// code and idle loops, which cannot block, run this CPU's fibers and
+// halt until the deadline tick
 void sleep_ms(uint32_t ms) {
-    uint32_t target_ticks = get_ticks() + (ms / MS_PER_TICK);
-    while (get_ticks() < target_ticks) {
+    task_t* self = task_current();
+    if (self && !(self->flags & TASK_FLAG_IDLE)) {
+        task_sleep(ms);
+        return;
+    }
+
+    // Round up so short sleeps still wait, and compare wrap-safely
+    uint32_t target_ticks = get_ticks() + (ms + MS_PER_TICK - 1) / MS_PER_TICK;
+    while ((int32_t)(get_ticks() - target_ticks) < 0) {
+        fiber_run_pending();
         halt();  // HLT wrapper from timer.h
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,225 @@
+/**
+ * QARMA - Symmetric Multi-Processing
+ *
+ * Processor discovery comes from the MADT. Application processors are
+ * started one at a time through a real-mode trampoline copied to
+ * SMP_TRAMPOLINE_BASE; the trampoline reads its stack, page directory
+ * and entry point from a mailbox embedded in the copied image.
+ */
+
+#include "smp.h"
+#include "acpi.h"
+#include "apic.h"
+#include "core/kernel.h"
+#include "core/timer.h"
+#include "core/ktime.h"
+#include "core/interrupts.h"
+#include "core/memory/heap.h"
+#include "parallel/parallel_engine.h"
+#include "core/atomic.h"
+#include "core/string.h"
+#include "core/fpu.h"
+#include "config.h"
+
+// Trampoline image and mailbox (smp_trampoline.asm)
+extern uint8_t smp_trampoline_start[];
+extern uint8_t smp_trampoline_end[];
+extern uint8_t smp_tramp_cr3[];
+extern uint8_t smp_tramp_stack[];
+extern uint8_t smp_tramp_cpu[];
+extern uint8_t smp_tramp_entry[];
+
+// Address of a mailbox field inside the copied trampoline
+#define TRAMP_FIELD(sym) \
+    ((volatile uint32_t*)(SMP_TRAMPOLINE_BASE + ((uint32_t)(sym) - (uint32_t)smp_trampoline_start)))
+
+#define SMP_INIT_DELAY_US       10000
+#define SMP_SIPI_DELAY_US       200
+#define SMP_START_TIMEOUT_US    100000
+#define SMP_POLL_INTERVAL_US    100
+
+static smp_cpu_t g_cpus[SMP_MAX_CPUS];
+static uint32_t g_cpu_count = 1;
+static volatile uint32_t g_online_count = 1;
+static bool g_smp_enabled = false;
+static uint8_t g_apic_to_cpu[256];
+
+static inline uint32_t smp_read_cr0(void) {
+    uint32_t value;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(value));
+    return value;
+}
+
+static inline uint32_t smp_read_cr3(void) {
+    uint32_t value;
+    __asm__ volatile("mov %%cr3, %0" : "=r"(value));
+    return value;
+}
+
+/**
+ * Discover processors. Falls back to a single BSP entry when there is
+ * no usable MADT or local APIC.
+ */
+bool smp_init(void) {
+    memset(g_cpus, 0, sizeof(g_cpus));
+    memset(g_apic_to_cpu, 0, sizeof(g_apic_to_cpu));
+
+    g_cpu_count = 1;
+    g_online_count = 1;
+    g_smp_enabled = false;
+
+    g_cpus[0].cpu_index = 0;
+    g_cpus[0].is_bsp = true;
+    g_cpus[0].started = true;
+    g_cpus[0].online = true;
+
+    if (!acpi_init()) {
+        SERIAL_LOG("SMP: no MADT, running uniprocessor\n");
+        return false;
+    }
+
+    const acpi_madt_info_t* madt = acpi_get_madt_info();
+    if (!lapic_init(madt->lapic_address)) {
+        return false;
+    }
+    ioapic_init();
+
+    uint8_t bsp_apic_id = lapic_get_id();
+    g_cpus[0].apic_id = bsp_apic_id;
+
+    // BSP is always index 0; APs follow in MADT order
+    for (uint32_t i = 0; i < madt->lapic_count && g_cpu_count < SMP_MAX_CPUS; i++) {
+        const acpi_lapic_t* lapic = &madt->lapics[i];
+        if (lapic->apic_id == bsp_apic_id) {
+            g_cpus[0].acpi_id = lapic->acpi_processor_id;
+            continue;
+        }
+        if (!lapic->enabled) continue;
+
+        smp_cpu_t* cpu = &g_cpus[g_cpu_count];
+        cpu->cpu_index = g_cpu_count;
+        cpu->apic_id = lapic->apic_id;
+        cpu->acpi_id = lapic->acpi_processor_id;
+        g_apic_to_cpu[lapic->apic_id] = (uint8_t)g_cpu_count;
+        g_cpu_count++;
+    }
+
+    g_smp_enabled = true;
+    SERIAL_LOG_DEC("SMP: processors discovered ", g_cpu_count);
+    SERIAL_LOG_DEC("SMP: BSP APIC ID ", bsp_apic_id);
+    return true;
+}
+
+/**
+ * Start a single AP and wait for it to reach C code
+ */
+static bool smp_start_ap(smp_cpu_t* cpu) {
+    cpu->stack_size = SMP_AP_STACK_SIZE;
+    cpu->stack_base = (uint8_t*)heap_alloc_aligned(SMP_AP_STACK_SIZE, 16);
+    if (!cpu->stack_base) {
+        SERIAL_LOG("SMP: failed to allocate AP stack\n");
+        return false;
+    }
+
+    // Fill the mailbox for this AP
+    *TRAMP_FIELD(smp_tramp_cr3) = (smp_read_cr0() & 0x80000000u) ? smp_read_cr3() : 0;
+    *TRAMP_FIELD(smp_tramp_stack) = (uint32_t)(cpu->stack_base + cpu->stack_size);
+    *TRAMP_FIELD(smp_tramp_cpu) = cpu->cpu_index;
+    *TRAMP_FIELD(smp_tramp_entry) = (uint32_t)smp_ap_entry;
+    __asm__ volatile("" ::: "memory");
+
+    uint8_t vector = (uint8_t)(SMP_TRAMPOLINE_BASE >> 12);
+
+    lapic_send_init(cpu->apic_id);
+    timer_udelay(SMP_INIT_DELAY_US);
+
+    lapic_send_startup(cpu->apic_id, vector);
+    timer_udelay(SMP_SIPI_DELAY_US);
+    if (!cpu->started) {
+        lapic_send_startup(cpu->apic_id, vector);
+    }
+
+    for (uint32_t waited = 0; waited < SMP_START_TIMEOUT_US; waited += SMP_POLL_INTERVAL_US) {
+        if (cpu->started) return true;
+        timer_udelay(SMP_POLL_INTERVAL_US);
+    }
+    return cpu->started;
+}
+
+/**
+ * Start every discovered application processor. Must run after the
+ * IDT is loaded on the BSP, since APs share it.
+ */
+void smp_boot_aps(void) {
+    if (!g_smp_enabled || g_cpu_count <= 1) return;
+
+    uint32_t size = (uint32_t)(smp_trampoline_end - smp_trampoline_start);
+    memcpy((void*)SMP_TRAMPOLINE_BASE, smp_trampoline_start, size);
+
+    for (uint32_t i = 1; i < g_cpu_count; i++) {
+        smp_cpu_t* cpu = &g_cpus[i];
+        if (smp_start_ap(cpu)) {
+            // Wait for it to finish per-CPU setup before reusing the mailbox
+            while (!cpu->online) cpu_relax();
+            SERIAL_LOG_DEC("SMP: AP online, APIC ID ", cpu->apic_id);
+        } else {
+            SERIAL_LOG_DEC("SMP: AP failed to start, APIC ID ", cpu->apic_id);
+        }
+    }
+
+    SERIAL_LOG_DEC("SMP: processors online ", g_online_count);
+}
+
+/**
+ * First C code executed by an AP (interrupts disabled)
+ */
+void smp_ap_entry(uint32_t cpu_index) {
+    smp_cpu_t* cpu = &g_cpus[cpu_index];
+
+    fpu_init_cpu();
+    string_init_cpu();
+    gdt_init_ap(cpu_index);
+    idt_load();
+    lapic_enable();
+    ktimer_cpu_init();
+
+    cpu->started = true;
+
+    // Take ownership of this core's deque before the BSP sees us online
+    parallel_core_attach(cpu_index);
+
+    atomic_inc_u32(&g_online_count);
+    cpu->online = true;
+
+    // Hand the processor to its parallel scheduler core
+    parallel_core_loop(cpu_index);
+
+    for (;;) {
+        __asm__ volatile("cli; hlt");
+    }
+}
+
+uint32_t smp_cpu_count(void) {
+    return g_cpu_count;
+}
+
+uint32_t smp_online_count(void) {
+    return g_online_count;
+}
+
+/**
+ * Logical index of the calling processor
+ */
+uint32_t smp_current_cpu(void) {
+    if (!g_smp_enabled) return 0;
+    return g_apic_to_cpu[lapic_get_id()];
+}
+
+smp_cpu_t* smp_get_cpu(uint32_t cpu_index) {
+    if (cpu_index >= g_cpu_count) return NULL;
+    return &g_cpus[cpu_index];
+}
+
+bool smp_is_enabled(void) {
+    return g_smp_enabled;
+}
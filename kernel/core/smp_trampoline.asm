@@ -0,0 +1,85 @@
+; QARMA - Application Processor Trampoline
+; Copied to SMP_TRAMPOLINE_BASE by smp_boot_aps(). The AP starts here in
+; real mode at SMP_TRAMPOLINE_BASE:0, loads a flat GDT, enters protected
+; mode, optionally enables paging and calls smp_ap_entry(cpu_index).
+
+SMP_TRAMPOLINE_BASE equ 0x8000
+
+; Absolute address of a label once the image has been copied
+%define TRAMP(label) (SMP_TRAMPOLINE_BASE + (label) - smp_trampoline_start)
+
+global smp_trampoline_start
+global smp_trampoline_end
+global smp_tramp_cr3
+global smp_tramp_stack
+global smp_tramp_cpu
+global smp_tramp_entry
+
+section .text
+
+[BITS 16]
+smp_trampoline_start:
+    cli
+    cld
+    xor ax, ax
+    mov ds, ax
+
+    lgdt [TRAMP(tramp_gdt_ptr)]
+
+    mov eax, cr0
+    or eax, 1                   ; PE
+    mov cr0, eax
+
+    jmp dword 0x08:TRAMP(tramp_protected)
+
+[BITS 32]
+tramp_protected:
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+
+    ; Share the BSP page directory when paging is on
+    mov eax, [TRAMP(smp_tramp_cr3)]
+    test eax, eax
+    jz .no_paging
+    mov cr3, eax
+    mov eax, cr0
+    or eax, 0x80000000          ; PG
+    mov cr0, eax
+.no_paging:
+
+    mov esp, [TRAMP(smp_tramp_stack)]
+    xor ebp, ebp
+
+    push dword [TRAMP(smp_tramp_cpu)]
+    mov eax, [TRAMP(smp_tramp_entry)]
+    call eax
+
+.halt:
+    cli
+    hlt
+    jmp .halt
+
+; Flat 4 GB code/data segments, same selectors as the kernel GDT
+align 8
+tramp_gdt:
+    dq 0x0000000000000000
+    dq 0x00CF9A000000FFFF       ; 0x08: ring 0 code
+    dq 0x00CF92000000FFFF       ; 0x10: ring 0 data
+tramp_gdt_end:
+
+tramp_gdt_ptr:
+    dw tramp_gdt_end - tramp_gdt - 1
+    dd TRAMP(tramp_gdt)
+
+; Mailbox, filled by smp_boot_aps() before each SIPI
+align 4
+smp_tramp_cr3:      dd 0
+smp_tramp_stack:    dd 0
+smp_tramp_cpu:      dd 0
+smp_tramp_entry:    dd 0
+
+smp_trampoline_end:
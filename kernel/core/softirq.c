@@ -0,0 +1,131 @@
+/**
+ * QARMA - Softirqs (interrupt bottom halves)
+ */
+
+#include "softirq.h"
+#include "smp.h"
+#include "atomic.h"
+#include "graphics/graphics.h"
+
+typedef struct {
+    volatile uint32_t pending;          // Bit per softirq_vector_t
+    volatile uint32_t active;           // Bottom halves running on this CPU
+    softirq_stats_t stats;
+} __attribute__((aligned(64))) softirq_cpu_t;
+
+static softirq_cpu_t g_softirq_cpus[SMP_MAX_CPUS];
+static softirq_fn_t g_softirq_handlers[SOFTIRQ_COUNT];
+
+static const char* const g_softirq_names[SOFTIRQ_COUNT] = {
+    [SOFTIRQ_INPUT] = "input",
+};
+
+static inline softirq_cpu_t* softirq_this_cpu(void) {
+    uint32_t cpu = smp_current_cpu();
+    return &g_softirq_cpus[cpu < SMP_MAX_CPUS ? cpu : 0];
+}
+
+void softirq_register(softirq_vector_t nr, softirq_fn_t fn) {
+    if (nr < SOFTIRQ_COUNT) {
+        g_softirq_handlers[nr] = fn;
+    }
+}
+
+void softirq_raise(softirq_vector_t nr) {
+    if (nr < SOFTIRQ_COUNT) {
+        atomic_or_u32(&softirq_this_cpu()->pending, 1u << nr);
+    }
+}
+
+bool softirq_active(void) {
+    return softirq_this_cpu()->active != 0;
+}
+
+ktime_t irq_enter(void) {
+    return ktime_get();
+}
+
+/**
+ * Run the pending bottom halves with interrupts enabled. Entered and
+ * left with interrupts disabled, so taking the bitmap cannot race a
+ * top half on this CPU.
+ */
+static void softirq_run(softirq_cpu_t* c) {
+    c->active = 1;
+    c->stats.runs++;
+    ktime_t start = ktime_get();
+
+    uint32_t pending;
+    uint32_t passes = 0;
+    while ((pending = atomic_xchg_u32(&c->pending, 0)) != 0) {
+        __asm__ volatile("sti" ::: "memory");
+        while (pending) {
+            uint32_t nr = __builtin_ctz(pending);
+            pending &= pending - 1;
+            c->stats.handled[nr]++;
+            if (g_softirq_handlers[nr]) {
+                g_softirq_handlers[nr]();
+            }
+        }
+        __asm__ volatile("cli" ::: "memory");
+
+        if (++passes == SOFTIRQ_MAX_RESTART) {
+            if (c->pending) {
+                c->stats.deferred++;
+            }
+            break;
+        }
+    }
+
+    sched_hist_add(&c->stats.softirq, ktime_get() - start);
+    c->active = 0;
+}
+
+void irq_exit(ktime_t entered) {
+    softirq_cpu_t* c = softirq_this_cpu();
+    ktime_t now = ktime_get();
+
+    c->stats.irqs++;
+    if (now > entered) {
+        sched_hist_add(&c->stats.irq_off, now - entered);
+    }
+
+    if (c->pending && !c->active) {
+        softirq_run(c);
+    }
+}
+
+void softirq_get_stats(uint32_t cpu, softirq_stats_t* stats) {
+    if (cpu < SMP_MAX_CPUS) {
+        *stats = g_softirq_cpus[cpu].stats;
+    }
+}
+
+void softirq_print_stats(void) {
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        softirq_stats_t stats;
+        softirq_get_stats(cpu, &stats);
+        if (!stats.irqs) {
+            continue;
+        }
+
+        gfx_print("CPU ");
+        gfx_print_decimal(cpu);
+        gfx_print(": ");
+        gfx_print_decimal(stats.irqs);
+        gfx_print(" interrupts, ");
+        gfx_print_decimal(stats.runs);
+        gfx_print(" softirq runs, ");
+        gfx_print_decimal(stats.deferred);
+        gfx_print(" cut short\n ");
+        for (uint32_t nr = 0; nr < SOFTIRQ_COUNT; nr++) {
+            gfx_print(" ");
+            gfx_print(g_softirq_names[nr]);
+            gfx_print(" ");
+            gfx_print_decimal(stats.handled[nr]);
+        }
+        gfx_print("\n");
+        sched_hist_print("  irq off", &stats.irq_off);
+        sched_hist_print("  softirq", &stats.softirq);
+    }
+}
@@ -0,0 +1,172 @@
+/**
+ * QARMA - Spinlocks
+ *
+ * Contended paths of the ticket and MCS locks, and lock statistics.
+ */
+
+#include "spinlock.h"
+#include "smp.h"
+#include "core/ktime.h"
+#include "graphics/graphics.h"
+
+void spin_lock_init(spinlock_t* lock, const char* name) {
+    lock->ticket = 0;
+#ifdef LOCK_STATS
+    lock->name = name;
+    lock->stats = (lock_stats_t){0};
+#else
+    (void)name;
+#endif
+}
+
+/**
+ * Wait for our ticket to come up
+ */
+void spin_lock_slow(spinlock_t* lock, uint16_t ticket) {
+#ifdef LOCK_STATS
+    uint64_t start = ktime_get_cycles();
+#endif
+    while ((uint16_t)atomic_load_u32(&lock->ticket) != ticket) {
+        cpu_relax();
+    }
+#ifdef LOCK_STATS
+    lock_stats_record_wait(&lock->stats, start);
+#endif
+}
+
+/**
+ * Take the lock only if it is free right now
+ */
+bool spin_trylock(spinlock_t* lock) {
+    uint32_t word = atomic_load_u32(&lock->ticket);
+    if ((uint16_t)word != (uint16_t)(word >> 16)) {
+        return false;
+    }
+    if (atomic_cmpxchg_u32(&lock->ticket, word, word + SPIN_TICKET_NEXT) != word) {
+        return false;
+    }
+#ifdef LOCK_STATS
+    lock->stats.acquisitions++;
+#endif
+    return true;
+}
+
+const lock_stats_t* spin_lock_stats(const spinlock_t* lock) {
+#ifdef LOCK_STATS
+    return &lock->stats;
+#else
+    (void)lock;
+    return NULL;
+#endif
+}
+
+// ────────────────
+// MCS queue lock
+// ────────────────
+
+void mcs_lock_init(mcs_lock_t* lock, const char* name) {
+    lock->tail = NULL;
+#ifdef LOCK_STATS
+    lock->name = name;
+    lock->stats = (lock_stats_t){0};
+#else
+    (void)name;
+#endif
+}
+
+/**
+ * Queue behind the current tail and spin on our own node until the
+ * previous holder hands the lock over
+ */
+void mcs_lock(mcs_lock_t* lock, mcs_node_t* node) {
+    node->next = NULL;
+    node->locked = 1;
+
+    mcs_node_t* prev = (mcs_node_t*)atomic_xchg_u32((volatile uint32_t*)&lock->tail, (uint32_t)node);
+    if (prev) {
+#ifdef LOCK_STATS
+        uint64_t start = ktime_get_cycles();
+#endif
+        prev->next = node;
+        while (atomic_load_u32(&node->locked)) {
+            cpu_relax();
+        }
+#ifdef LOCK_STATS
+        lock_stats_record_wait(&lock->stats, start);
+#endif
+        return;
+    }
+#ifdef LOCK_STATS
+    lock->stats.acquisitions++;
+#endif
+}
+
+bool mcs_trylock(mcs_lock_t* lock, mcs_node_t* node) {
+    node->next = NULL;
+    node->locked = 0;
+    if (atomic_cmpxchg_u32((volatile uint32_t*)&lock->tail, 0, (uint32_t)node) != 0) {
+        return false;
+    }
+#ifdef LOCK_STATS
+    lock->stats.acquisitions++;
+#endif
+    return true;
+}
+
+void mcs_unlock(mcs_lock_t* lock, mcs_node_t* node) {
+    mcs_node_t* next = node->next;
+    if (!next) {
+        // No successor yet: release, unless one is between xchg and link
+        if (atomic_cmpxchg_u32((volatile uint32_t*)&lock->tail, (uint32_t)node, 0) == (uint32_t)node) {
+            return;
+        }
+        while (!(next = node->next)) {
+            cpu_relax();
+        }
+    }
+    atomic_store_u32(&next->locked, 0);
+}
+
+const lock_stats_t* mcs_lock_stats(const mcs_lock_t* lock) {
+#ifdef LOCK_STATS
+    return &lock->stats;
+#else
+    (void)lock;
+    return NULL;
+#endif
+}
+
+// ────────────────
+// Statistics
+// ────────────────
+
+/**
+ * Account a contended acquisition; the caller holds the lock
+ */
+void lock_stats_record_wait(lock_stats_t* stats, uint64_t start_cycles) {
+    uint64_t waited = ktime_get_cycles() - start_cycles;
+    stats->acquisitions++;
+    stats->contended++;
+    stats->wait_cycles += waited;
+    if (waited > stats->max_wait_cycles) {
+        stats->max_wait_cycles = waited;
+    }
+}
+
+void lock_stats_print(const char* name, const lock_stats_t* stats) {
+    if (!stats) return;
+
+    gfx_print(name ? name : "(lock)");
+    gfx_print(": acquired ");
+    gfx_print_decimal(stats->acquisitions);
+    gfx_print(", contended ");
+    gfx_print_decimal(stats->contended);
+    if (stats->contended) {
+        gfx_print(", avg wait ");
+        gfx_print_decimal((uint32_t)ktime_div_u32(stats->wait_cycles, stats->contended));
+        gfx_print(" cycles, max ");
+        gfx_print_decimal((uint32_t)stats->max_wait_cycles);
+        gfx_print(" cycles");
+    }
+    gfx_print("\n");
+}
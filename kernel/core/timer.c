@@ -1,8 +1,11 @@
 #include "timer.h"
 #include "core/io.h"
+#include "core/ktime.h"
 
 #define PIT_COMMAND_PORT 0x43
 #define PIT_CHANNEL0_PORT 0x40
+#define PIT_CHANNEL2_PORT 0x42
+#define PIT_GATE_PORT     0x61
 
 // PIT input frequency is 1193182 Hz
 #define PIT_BASE_FREQUENCY 1193182u
@@ -29,6 +32,40 @@ void init_timer(uint32_t frequency) {
     outb(PIT_CHANNEL0_PORT, high);
 }
 
+/**
+ * Busy-wait using PIT channel 2 in one-shot mode. Works with interrupts
+ * disabled and before the tick handler is installed, which is what the
+ * AP INIT/SIPI sequence needs.
+ */
+void timer_udelay(uint32_t microseconds) {
+    while (microseconds > 0) {
+        uint32_t chunk = microseconds > 50000 ? 50000 : microseconds;
+        uint32_t count = (PIT_BASE_FREQUENCY / 1000u) * chunk / 1000u;
+        if (count == 0) count = 1;
+        if (count > 0xFFFF) count = 0xFFFF;
+
+        // Gate on, speaker off
+        uint8_t gate = inb(PIT_GATE_PORT);
+        outb(PIT_GATE_PORT, (gate & ~0x02) | 0x01);
+
+        // Channel 2, lobyte/hibyte, mode 0 (interrupt on terminal count)
+        outb(PIT_COMMAND_PORT, 0xB0);
+        outb(PIT_CHANNEL2_PORT, count & 0xFF);
+        outb(PIT_CHANNEL2_PORT, (count >> 8) & 0xFF);
+
+        // Restart the count by toggling the gate
+        gate = inb(PIT_GATE_PORT);
+        outb(PIT_GATE_PORT, gate & ~0x01);
+        outb(PIT_GATE_PORT, gate | 0x01);
+
+        // OUT2 goes high at terminal count
+        while (!(inb(PIT_GATE_PORT) & 0x20)) {
+            __asm__ volatile ("pause");
+        }
+
+        microseconds -= chunk;
+    }
+}
 
 double get_system_time_seconds(uint32_t frequency) {
     if (frequency == 0) return 0.0;
@@ -37,7 +74,8 @@ double get_system_time_seconds(uint32_t frequency) {
 
 uint64_t get_system_time_millis(uint32_t frequency) {
     if (frequency == 0) return 0;
-    return ((uint32_t)system_ticks * 1000U) / frequency;
+    // 64-bit product: ticks * 1000 passes 2^32 after ~50 days at 100 Hz
+    return ktime_div_u32((uint64_t)system_ticks * 1000U, frequency);
 }
 
 
@@ -17,7 +17,7 @@
 static e1000_device_t* e1000_dev = NULL;
 
 // Define memory allocation wrappers
-#define kmalloc(size) heap_alloc(size)
+#define kmalloc(size) heap_zalloc(size)
 #define pci_config_read_word pci_read_config_word
 #define pci_config_read_dword pci_read_config_dword
 
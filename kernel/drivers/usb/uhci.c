@@ -7,6 +7,7 @@
 #include "graphics/graphics.h"
 #include "config.h"
 #include "core/pci.h"
+#include "core/atomic.h"
 
 /* Debug helper: when enabled, force an immediate diagnostic dump after
  * enqueueing descriptors so emulator captures contain controller-visible
@@ -21,6 +22,7 @@ static inline uint32_t vaddr_to_phys(void *vaddr);
 /* Forward I/O prototypes (definitions appear later) */
 static inline uint16_t uhci_inw(uint16_t port);
 static inline void uhci_outw(uint16_t port, uint16_t value);
+static void uhci_irq_work(work_t *work);
 
 /* Port manipulation helpers that properly handle RWC (Read-Write-Clear) bits.
  * RWC bits (CSC, PEC) are cleared when you write 1 to them. */
@@ -165,6 +167,8 @@ int uhci_init_controller(uint8_t bus, uint8_t slot, uint8_t func, uint16_t io_ba
     uhci->bus = bus;
     uhci->slot = slot;  
     uhci->func = func;
+    uhci->irq_status = 0;
+    work_init(&uhci->irq_work, uhci_irq_work, uhci);
     
     GFX_LOG_MIN("UHCI: Initializing controller at I/O base ");
     GFX_LOG_HEX("", io_base);
@@ -1323,10 +1327,23 @@ int uhci_interrupt_transfer(uhci_controller_t *uhci, usb_device_t *device, uint8
     return 0;
 }
 
+/* Top half: acknowledge the controller and leave the rest to irq_work */
 void uhci_interrupt_handler(uhci_controller_t *uhci) {
     uint16_t status = uhci_inw(uhci->io_base + UHCI_USBSTS);
+    status &= UHCI_STS_USBINT | UHCI_STS_ERROR;
+    if (!status) return;
 
-    if (!(status & (UHCI_STS_USBINT | UHCI_STS_ERROR))) return;
+    /* Write-one-to-clear */
+    uhci_outw(uhci->io_base + UHCI_USBSTS, status);
+    atomic_or_u32(&uhci->irq_status, status);
+    schedule_work(&uhci->irq_work);
+}
+
+/* Bottom half, from the system workqueue */
+static void uhci_irq_work(work_t *work) {
+    uhci_controller_t *uhci = (uhci_controller_t *)work->data;
+    uint32_t status = atomic_xchg_u32(&uhci->irq_status, 0);
+    if (!status) return;
 
     if (status & UHCI_STS_USBINT) SERIAL_LOG("UHCI: USB interrupt occurred\n");
     if (status & UHCI_STS_ERROR) SERIAL_LOG("UHCI: USB error interrupt\n");
@@ -1421,9 +1438,6 @@ void uhci_interrupt_handler(uhci_controller_t *uhci) {
         }
     }
 
-    /* Clear interrupt/status bits we've observed */
-    if (status & UHCI_STS_USBINT) uhci_outw(uhci->io_base + UHCI_USBSTS, UHCI_STS_USBINT);
-    if (status & UHCI_STS_ERROR) uhci_outw(uhci->io_base + UHCI_USBSTS, UHCI_STS_ERROR);
 }
 
 // Bulk transfer implementation
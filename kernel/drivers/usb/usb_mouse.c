@@ -5,6 +5,7 @@
 #include "core/memory/heap.h"
 #include "config.h"
 #include "graphics/graphics.h"
+#include "graphics/framebuffer.h"
 
 // Global USB mouse device
 static usb_hid_device_t *g_usb_mouse = NULL;
@@ -112,7 +113,7 @@ int usb_mouse_attach_interface(usb_device_t *device, usb_interface_descriptor_t
     SERIAL_LOG("USB Mouse: Attaching mouse interface\n");
     
     // Allocate HID device structure
-    g_usb_mouse = (usb_hid_device_t *)heap_alloc(sizeof(usb_hid_device_t));
+    g_usb_mouse = (usb_hid_device_t *)heap_zalloc(sizeof(usb_hid_device_t));
     if (!g_usb_mouse) {
         SERIAL_LOG("USB Mouse: Failed to allocate HID device structure\n");
         return -1;
@@ -234,7 +235,7 @@ void usb_mouse_start_polling(void) {
     polling_started = true;
     
     // Allocate DMA-capable buffer for mouse reports from heap (identity-mapped)
-    usb_mouse_report_t *report_buffer = (usb_mouse_report_t *)heap_alloc(sizeof(usb_mouse_report_t));
+    usb_mouse_report_t *report_buffer = (usb_mouse_report_t *)heap_zalloc(sizeof(usb_mouse_report_t));
     if (!report_buffer) {
         SERIAL_LOG("USB Mouse: Failed to allocate DMA buffer\n");
         return;
@@ -301,6 +302,7 @@ void usb_mouse_process_report(usb_mouse_report_t *report) {
     if (mouse_state.y < 0) mouse_state.y = 0;
     if (mouse_state.x >= (int32_t)fb_width) mouse_state.x = fb_width - 1;
     if (mouse_state.y >= (int32_t)fb_height) mouse_state.y = fb_height - 1;
+    fb_set_pointer(mouse_state.x, mouse_state.y, true);
     
     // Update button states
     mouse_state.left_pressed = (report->buttons & 0x01) != 0;
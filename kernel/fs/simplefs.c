@@ -104,12 +104,11 @@ static int simplefs_mount(blockdev_t* dev, vfs_node_t* mountpoint) {
  * Create a VFS node for a file
  */
 static vfs_node_t* simplefs_create_node(const char* name, uint32_t size, uint32_t offset) {
-    vfs_node_t* node = (vfs_node_t*)malloc(sizeof(vfs_node_t));
+    vfs_node_t* node = vfs_node_alloc();
     if (!node) {
         return NULL;
     }
     
-    memset(node, 0, sizeof(vfs_node_t));
     strncpy(node->name, name, 63);
     node->type = VFS_TYPE_FILE;
     node->size = size;
@@ -1,5 +1,6 @@
 #include "vfs.h"
 #include "core/string.h"
+#include "core/memory/object_cache.h"
 
 // Forward declaration for simplefs
 extern void simplefs_init(void);
@@ -8,6 +9,7 @@ extern void ramdisk_init(void);
 #define MAX_FS_DRIVERS 8
 static struct fs_driver* fs_drivers[MAX_FS_DRIVERS];
 static int fs_driver_count = 0;
+static object_cache_t* vfs_node_cache = 0;
 
 static vfs_node_t vfs_root = {
     .name = "/",
@@ -28,6 +30,19 @@ void vfs_register_fs(struct fs_driver* fs) {
 }
 
 
+vfs_node_t* vfs_node_alloc(void) {
+    if (!vfs_node_cache) {
+        vfs_node_cache = object_cache_create("vfs_node_t", sizeof(vfs_node_t), 0, 0);
+    }
+    vfs_node_t* node = (vfs_node_t*)object_cache_alloc(vfs_node_cache);
+    if (node) memset(node, 0, sizeof(vfs_node_t));
+    return node;
+}
+
+void vfs_node_free(vfs_node_t* node) {
+    if (node) object_cache_free(vfs_node_cache, node);
+}
+
 // Find FS driver by name
 static struct fs_driver* find_fs_driver(const char* name) {
     for (int i = 0; i < fs_driver_count; ++i) {
@@ -116,8 +131,8 @@ int vfs_mount(const char* devname, const char* fstype, const char* mountpoint) {
     }
 
     // Create mountpoint node (only supports mounting at root for now)
-    vfs_node_t* mp = (vfs_node_t*)malloc(sizeof(vfs_node_t));
-    memset(mp, 0, sizeof(vfs_node_t));
+    vfs_node_t* mp = vfs_node_alloc();
+    if (!mp) return -4;
     strncpy(mp->name, mountpoint[0] == '/' ? mountpoint + 1 : mountpoint, 63);
     mp->type = VFS_TYPE_DIR;
     mp->parent = &vfs_root;
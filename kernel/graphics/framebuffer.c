@@ -13,10 +13,16 @@
 #include "core/memory/heap.h"
 #include "qarma_win_handle/qarma_win_handle.h"
 #include "qarma_win_handle/qarma_window_manager.h"
+#include "core/atomic.h"
+#include "core/smp.h"
+#include "graphics/blit.h"
+#include "core/timer.h"
+#include "core/memory/vmm/vmm.h"
 
 // Debug functions now handled by config.h macros
 
 // Forward declarations
+static void fb_present_rect(const fb_rect_t* r);
 void framebuffer_scroll(void);
 void framebuffer_draw_char(uint32_t x, uint32_t y, char c, rgb_color_t fg, rgb_color_t bg);
 void draw_scaled_text_centered(int cx, int y, const char* text, int scale, rgb_color_t fg, rgb_color_t bg);
@@ -32,7 +38,8 @@ static uint32_t* framebuffer_ptr = NULL;
 uint32_t* fb_ptr = NULL;
 // Backing store for composition
 static uint32_t* backing_store = NULL;
-static bool fb_dirty = false;
+// RAM back buffer the compositor renders frames into (same layout as VRAM)
+static uint32_t* back_buffer = NULL;
 uint32_t fb_width = 0;
 uint32_t fb_height = 0;
 uint32_t fb_pitch = 0;
@@ -114,14 +121,14 @@ void framebuffer_init(void) {
     info->cursor_x = 0;
     info->cursor_y = 0;
 
-    // Allocate backing store for composition
+    // Allocate backing store for composition (same layout as the framebuffer)
     size_t pixels = fb_width * fb_height;
-    size_t backing_store_size = pixels * sizeof(uint32_t);
+    size_t backing_store_size = fb_height * fb_pitch;
     SERIAL_LOG_DEC("FB_INIT: Need ", backing_store_size);
     SERIAL_LOG_DEC(" bytes for ", pixels);
     SERIAL_LOG(" pixels\n");
     
-    backing_store = (uint32_t*)heap_alloc(backing_store_size);
+    backing_store = (uint32_t*)heap_zalloc(backing_store_size);
     SERIAL_LOG_DEC("FB_INIT: Backing store allocated at ", (uint32_t)(uintptr_t)backing_store);
     if(!backing_store) {
         SERIAL_LOG_MIN("FB_INIT: Backing store allocation failed!\n");
@@ -141,6 +148,13 @@ void framebuffer_init(void) {
         }
     }
 
+    back_buffer = (uint32_t*)heap_alloc(backing_store_size);
+    if (back_buffer) {
+        memcpy(back_buffer, backing_store, backing_store_size);
+    } else {
+        SERIAL_LOG_MIN("FB_INIT: Back buffer allocation failed, compositor disabled\n");
+    }
+
     // DEBUG: Force draw some test characters directly to verify framebuffer works
     framebuffer_draw_char(0, 0, 'T', (rgb_color_t){255,255,255,255}, (rgb_color_t){0,0,0,255});
     framebuffer_draw_char(8, 0, 'E', (rgb_color_t){255,255,255,255}, (rgb_color_t){0,0,0,255});
@@ -263,67 +277,36 @@ void fb_draw_rect_to_buffer(uint32_t* buffer, QARMA_DIMENSION size, int x, int y
 }
 
 void framebuffer_blit_window(QARMA_WIN_HANDLE* win) {
-    for (int y = 0; y < win->size.height; ++y) {
-        for (int x = 0; x < win->size.width; ++x) {
-            int dst_x = win->x + x;
-            int dst_y = win->y + y;
-            if (IN_BOUNDS(dst_x, fb_width) && IN_BOUNDS(dst_y, fb_height)) {
-                uint32_t src = win->pixel_buffer[y * win->size.width + x];
-                framebuffer_blend_pixel(dst_x, dst_y, src);
-            }
-        }
-    }
-}
+    // Clip once against the screen, then blend whole rows
+    int x0 = MAX(win->x, 0);
+    int y0 = MAX(win->y, 0);
+    int x1 = MIN(win->x + win->size.width, (int)fb_width);
+    int y1 = MIN(win->y + win->size.height, (int)fb_height);
+    if (x0 >= x1 || y0 >= y1) return;
 
+    if (!back_buffer) return;
 
-void fb_compose_all(void) {
-    if (!framebuffer_ptr || !backing_store) return;
-
-    // Step 1: Copy backing store to framebuffer
-    memcpy(framebuffer_ptr, backing_store, fb_height * fb_pitch);
-
-    // Step 2: Composite each window
-    for (uint32_t i = 0; i < qarma_window_manager.count; ++i) {
-        QARMA_WIN_HANDLE* win = qarma_window_manager.windows[i];
-        if (!win || !(win->flags & QARMA_FLAG_VISIBLE)) continue;
-
-        if (win->vtable && win->vtable->render) {
-            win->vtable->render(win);  // Draw into win->pixel_buffer
-        }
-
-        framebuffer_blit_window(win);  // Composite onto framebuffer
-    }
-
-    fb_dirty = false;
+    // Blend in RAM, then stream the result out; VRAM is never read back
+    uint32_t pitch_pixels = fb_pitch / 4;
+    blit_rect_over(back_buffer + y0 * pitch_pixels + x0, pitch_pixels,
+                   win->pixel_buffer + (y0 - win->y) * win->size.width + (x0 - win->x),
+                   win->size.width, x1 - x0, y1 - y0);
+    fb_rect_t area = { x0, y0, x1 - x0, y1 - y0 };
+    fb_present_rect(&area);
 }
 
+
 void framebuffer_blend_pixel(int x, int y, uint32_t src) {
     if (!IN_BOUNDS(x, fb_width) || !IN_BOUNDS(y, fb_height)) return;
 
-    uint32_t pitch_pixels = fb_pitch / 4;
-    uint32_t offset = y * pitch_pixels + x;
-
-    uint32_t dst = framebuffer_ptr[offset];
-
-    // Extract RGBA from source
-    uint8_t src_r = src & 0xFF;
-    uint8_t src_g = (src >> 8) & 0xFF;
-    uint8_t src_b = (src >> 16) & 0xFF;
-    uint8_t src_a = (src >> 24) & 0xFF;
+    if (!back_buffer) return;
 
-    // Extract RGB from destination
-    uint8_t dst_r = dst & 0xFF;
-    uint8_t dst_g = (dst >> 8) & 0xFF;
-    uint8_t dst_b = (dst >> 16) & 0xFF;
-
-    float alpha = src_a / 255.0f;
-
-    // Blend
-    uint8_t out_r = (uint8_t)(src_r * alpha + dst_r * (1 - alpha));
-    uint8_t out_g = (uint8_t)(src_g * alpha + dst_g * (1 - alpha));
-    uint8_t out_b = (uint8_t)(src_b * alpha + dst_b * (1 - alpha));
-
-    framebuffer_ptr[offset] = out_r | (out_g << 8) | (out_b << 16) | (0xFF << 24);
+    uint32_t offset = y * (fb_pitch / 4) + x;
+    uint32_t alpha = src >> 24;
+    if (alpha == 0) return;
+    back_buffer[offset] = alpha == 0xFF ? src : blit_blend_pixel(back_buffer[offset], src);
+    fb_rect_t area = { x, y, 1, 1 };
+    fb_present_rect(&area);
 }
 
 void splash_clear(rgb_color_t bg) {
@@ -332,6 +315,7 @@ void splash_clear(rgb_color_t bg) {
         for (uint32_t x = 0; x < fb_width; x++) {
             uint32_t offset = (y * fb_pitch + x * (fb_bpp / 8)) / 4;
             if (backing_store) backing_store[offset] = pixel;
+            if (back_buffer) back_buffer[offset] = pixel;
             framebuffer_ptr[offset] = pixel;
         }
     }
@@ -356,6 +340,7 @@ void splash_box(uint32_t w, uint32_t h, rgb_color_t color) {
             uint32_t py = y0 + y;
             uint32_t offset = (py * fb_pitch + px * (fb_bpp / 8)) / 4;
             if (backing_store) backing_store[offset] = pixel;
+            if (back_buffer) back_buffer[offset] = pixel;
             framebuffer_ptr[offset] = pixel;
         }
     }
@@ -520,40 +505,585 @@ void framebuffer_test(void) {
     framebuffer_draw_pixel(2, 1, red);
 }
 
-// Compose the screen from backing store + windows
-void fb_compose(void) {
-    if (!framebuffer_ptr) return;
-    if (!fb_dirty) return;
+// ============================================================================
+// Compositor
+//
+// Screen updates are driven by a damage list: disjoint screen rectangles
+// that must be rebuilt from the backing store and the windows above it.
+// Windows feed it by setting 'dirty' (re-render, whole window damaged),
+// by reporting a changed sub-rectangle with fb_damage_window(), or simply
+// by moving, appearing or disappearing. Everything outside the damaged
+// rectangles is left untouched in the framebuffer.
+// ============================================================================
+
+typedef struct {
+    QARMA_WIN_HANDLE* win;
+    fb_rect_t bounds;
+} fb_composed_window_t;
+
+typedef struct {
+    fb_rect_t rects[FB_MAX_DAMAGE_RECTS];
+    uint32_t count;
+} fb_region_t;
+
+static fb_region_t g_damage = {0};
+static volatile uint32_t g_damage_lock = 0;
+
+// Windows as they were on screen after the previous compose
+static fb_composed_window_t g_composed[QARMA_MAX_WINDOWS];
+static uint32_t g_composed_count = 0;
+
+static fb_compose_stats_t g_compose_stats = {0};
+
+// Pointer sprite ('X' outline, '.' fill)
+static const char* const g_pointer_shape[FB_POINTER_HEIGHT] = {
+    "X       ",
+    "XX      ",
+    "X.X     ",
+    "X..X    ",
+    "X...X   ",
+    "X....X  ",
+    "X.....X ",
+    "X......X",
+    "X...XXXX",
+    "X..X    ",
+    "X.X     ",
+    "XX      ",
+};
+static int g_pointer_x = 0;
+static int g_pointer_y = 0;
+static bool g_pointer_visible = false;
+
+static inline uint32_t fb_damage_acquire(void) {
+    uint32_t flags;
+    __asm__ volatile("pushfl; popl %0; cli" : "=r"(flags) :: "memory");
+    while (atomic_xchg_u32(&g_damage_lock, 1)) {
+        cpu_relax();
+    }
+    return flags;
+}
 
-    
-extern QARMA_WINDOW_MANAGER qarma_window_manager;
+static inline void fb_damage_release(uint32_t flags) {
+    atomic_store_u32(&g_damage_lock, 0);
+    if (flags & 0x200) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
 
-    if (backing_store) {
-        // Copy backing store to framebuffer
-        for (uint32_t y = 0; y < fb_height; y++) {
-            for (uint32_t x = 0; x < fb_width; x++) {
-                uint32_t offset = (y * fb_pitch + x * (fb_bpp / 8)) / 4;
-                framebuffer_ptr[offset] = backing_store[offset];
+static inline bool fb_rect_empty(const fb_rect_t* r) {
+    return r->width <= 0 || r->height <= 0;
+}
+
+static inline bool fb_rect_intersect(const fb_rect_t* a, const fb_rect_t* b, fb_rect_t* out) {
+    int x0 = MAX(a->x, b->x);
+    int y0 = MAX(a->y, b->y);
+    int x1 = MIN(a->x + a->width, b->x + b->width);
+    int y1 = MIN(a->y + a->height, b->y + b->height);
+    if (x1 <= x0 || y1 <= y0) return false;
+    if (out) {
+        out->x = x0;
+        out->y = y0;
+        out->width = x1 - x0;
+        out->height = y1 - y0;
+    }
+    return true;
+}
+
+static inline fb_rect_t fb_rect_union(const fb_rect_t* a, const fb_rect_t* b) {
+    int x0 = MIN(a->x, b->x);
+    int y0 = MIN(a->y, b->y);
+    int x1 = MAX(a->x + a->width, b->x + b->width);
+    int y1 = MAX(a->y + a->height, b->y + b->height);
+    return (fb_rect_t){ x0, y0, x1 - x0, y1 - y0 };
+}
+
+static inline bool fb_rect_contains(const fb_rect_t* outer, const fb_rect_t* inner) {
+    return inner->x >= outer->x && inner->y >= outer->y &&
+           inner->x + inner->width <= outer->x + outer->width &&
+           inner->y + inner->height <= outer->y + outer->height;
+}
+
+static inline bool fb_rect_equal(const fb_rect_t* a, const fb_rect_t* b) {
+    return a->x == b->x && a->y == b->y && a->width == b->width && a->height == b->height;
+}
+
+static fb_rect_t fb_clip_to_screen(int x, int y, int width, int height) {
+    fb_rect_t screen = { 0, 0, (int)fb_width, (int)fb_height };
+    fb_rect_t r = { x, y, width, height };
+    fb_rect_t clipped = { 0, 0, 0, 0 };
+    fb_rect_intersect(&r, &screen, &clipped);
+    return clipped;
+}
+
+/**
+ * Add a rectangle to a region. Overlapping rectangles are merged so every
+ * pixel is composed at most once per frame; when the list is full the new
+ * rectangle joins the entry it grows the least.
+ */
+static void fb_region_add(fb_region_t* region, fb_rect_t r) {
+    if (fb_rect_empty(&r)) return;
+
+    uint32_t i = 0;
+    while (i < region->count) {
+        if (fb_rect_contains(&region->rects[i], &r)) return;
+        if (fb_rect_intersect(&region->rects[i], &r, NULL)) {
+            r = fb_rect_union(&region->rects[i], &r);
+            region->rects[i] = region->rects[--region->count];
+            i = 0;  // The grown rectangle may now overlap earlier entries
+            continue;
+        }
+        i++;
+    }
+
+    if (region->count < FB_MAX_DAMAGE_RECTS) {
+        region->rects[region->count++] = r;
+        return;
+    }
+
+    uint32_t best = 0;
+    uint32_t best_area = UINT32_MAX;
+    for (i = 0; i < region->count; i++) {
+        fb_rect_t u = fb_rect_union(&region->rects[i], &r);
+        uint32_t area = (uint32_t)u.width * (uint32_t)u.height;
+        if (area < best_area) {
+            best_area = area;
+            best = i;
+        }
+    }
+    r = fb_rect_union(&region->rects[best], &r);
+    region->rects[best] = region->rects[--region->count];
+    fb_region_add(region, r);
+}
+
+// Damage list insert (lock held)
+static inline void fb_damage_add_locked(fb_rect_t r) {
+    fb_region_add(&g_damage, r);
+}
+
+void fb_damage_rect(int x, int y, int width, int height) {
+    fb_rect_t r = fb_clip_to_screen(x, y, width, height);
+    if (fb_rect_empty(&r)) return;
+
+    uint32_t flags = fb_damage_acquire();
+    fb_damage_add_locked(r);
+    fb_damage_release(flags);
+}
+
+/**
+ * Report a changed area of a window's pixel buffer (window coordinates)
+ */
+void fb_damage_window(QARMA_WIN_HANDLE* win, int x, int y, int width, int height) {
+    if (!win) return;
+    fb_rect_t local = { 0, 0, win->size.width, win->size.height };
+    fb_rect_t r = { x, y, width, height };
+    if (!fb_rect_intersect(&local, &r, &r)) return;
+    fb_damage_rect(win->x + r.x, win->y + r.y, r.width, r.height);
+}
+
+void fb_mark_dirty(void) {
+    fb_damage_rect(0, 0, (int)fb_width, (int)fb_height);
+}
+
+/**
+ * Move or hide the pointer; only the old and new sprite areas are damaged
+ */
+void fb_set_pointer(int x, int y, bool visible) {
+    if (g_pointer_visible == visible && g_pointer_x == x && g_pointer_y == y) return;
+
+    uint32_t flags = fb_damage_acquire();
+    if (g_pointer_visible) {
+        fb_damage_add_locked(fb_clip_to_screen(g_pointer_x, g_pointer_y, FB_POINTER_WIDTH, FB_POINTER_HEIGHT));
+    }
+    g_pointer_x = x;
+    g_pointer_y = y;
+    g_pointer_visible = visible;
+    if (visible) {
+        fb_damage_add_locked(fb_clip_to_screen(x, y, FB_POINTER_WIDTH, FB_POINTER_HEIGHT));
+    }
+    fb_damage_release(flags);
+}
+
+static inline bool fb_window_composited(QARMA_WIN_HANDLE* win) {
+    return win && (win->flags & QARMA_FLAG_VISIBLE) && win->pixel_buffer;
+}
+
+static inline fb_rect_t fb_window_bounds(QARMA_WIN_HANDLE* win) {
+    return fb_clip_to_screen(win->x, win->y, win->size.width, win->size.height);
+}
+
+/**
+ * Render dirty windows and turn window changes since the last frame into
+ * damage: new, moved, re-rendered and removed windows
+ */
+static void fb_collect_window_damage(bool render_all) {
+    fb_composed_window_t current[QARMA_MAX_WINDOWS];
+    uint32_t current_count = 0;
+
+    for (uint32_t i = 0; i < qarma_window_manager.count; i++) {
+        QARMA_WIN_HANDLE* win = qarma_window_manager.windows[i];
+        if (!fb_window_composited(win)) continue;
+
+        fb_rect_t bounds = fb_window_bounds(win);
+        const fb_composed_window_t* previous = NULL;
+        for (uint32_t j = 0; j < g_composed_count; j++) {
+            if (g_composed[j].win == win) {
+                previous = &g_composed[j];
+                break;
             }
         }
 
-        // Render windows onto the framebuffer
-        for (uint32_t i = 0; i < qarma_window_manager.count; ++i) {
-            QARMA_WIN_HANDLE *win = qarma_window_manager.windows[i];
-            if (win && (win->flags & QARMA_FLAG_VISIBLE) && win->vtable && win->vtable->render) {
-                if (win->vtable->render) {
-                    win->vtable->render(win);  // render into win->pixel_buffer
-                }
-                framebuffer_blit_window(win);  // composite onto framebuffer
+        bool damaged = !previous || win->dirty || render_all;
+        if (previous && !fb_rect_equal(&previous->bounds, &bounds)) {
+            fb_damage_rect(previous->bounds.x, previous->bounds.y,
+                           previous->bounds.width, previous->bounds.height);
+            damaged = true;
+        }
+
+        if (win->dirty || !previous || render_all) {
+            if (win->vtable && win->vtable->render) {
+                win->vtable->render(win);  // Draw into win->pixel_buffer
+            }
+            win->dirty = false;
+        }
+        if (damaged) {
+            fb_damage_rect(bounds.x, bounds.y, bounds.width, bounds.height);
+        }
+
+        current[current_count].win = win;
+        current[current_count].bounds = bounds;
+        current_count++;
+    }
+
+    // Whatever was under a window that is gone must be restored
+    for (uint32_t j = 0; j < g_composed_count; j++) {
+        bool present = false;
+        for (uint32_t i = 0; i < current_count; i++) {
+            if (current[i].win == g_composed[j].win) {
+                present = true;
+                break;
             }
         }
-    }   
+        if (!present) {
+            fb_damage_rect(g_composed[j].bounds.x, g_composed[j].bounds.y,
+                           g_composed[j].bounds.width, g_composed[j].bounds.height);
+        }
+    }
 
-    fb_dirty = false;
+    memcpy(g_composed, current, current_count * sizeof(fb_composed_window_t));
+    g_composed_count = current_count;
 }
 
-void fb_mark_dirty(void) {
-    fb_dirty = true;
+// Is 'area' hidden behind an opaque window stacked above index 'below'?
+static bool fb_area_occluded(const fb_rect_t* area, uint32_t below) {
+    for (uint32_t i = below + 1; i < g_composed_count; i++) {
+        if ((g_composed[i].win->flags & QARMA_FLAG_OPAQUE) &&
+            fb_rect_contains(&g_composed[i].bounds, area)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void fb_blit_window_clipped(QARMA_WIN_HANDLE* win, const fb_rect_t* area) {
+    uint32_t pitch_pixels = fb_pitch / 4;
+    int stride = win->size.width;
+
+    for (int y = area->y; y < area->y + area->height; y++) {
+        const uint32_t* src = win->pixel_buffer + (y - win->y) * stride + (area->x - win->x);
+        uint32_t* dst = back_buffer + y * pitch_pixels + area->x;
+
+        if (win->flags & QARMA_FLAG_OPAQUE) {
+            blit_span_opaque(dst, src, area->width);
+        } else {
+            blit_span_over(dst, src, area->width);
+        }
+    }
+}
+
+static void fb_draw_pointer_clipped(const fb_rect_t* area) {
+    uint32_t pitch_pixels = fb_pitch / 4;
+    fb_rect_t sprite = { g_pointer_x, g_pointer_y, FB_POINTER_WIDTH, FB_POINTER_HEIGHT };
+    fb_rect_t clip;
+    if (!fb_rect_intersect(&sprite, area, &clip)) return;
+
+    for (int y = clip.y; y < clip.y + clip.height; y++) {
+        const char* row = g_pointer_shape[y - g_pointer_y];
+        for (int x = clip.x; x < clip.x + clip.width; x++) {
+            char c = row[x - g_pointer_x];
+            if (c == 'X') back_buffer[y * pitch_pixels + x] = 0xFF000000;
+            else if (c == '.') back_buffer[y * pitch_pixels + x] = 0xFFFFFFFF;
+        }
+    }
+}
+
+/**
+ * Rebuild one damaged rectangle in the back buffer: backing store, then
+ * the windows that are not hidden behind an opaque window, then the pointer
+ */
+static void fb_compose_rect(const fb_rect_t* r) {
+    uint32_t pitch_pixels = fb_pitch / 4;
+
+    // Start at the topmost opaque window covering the whole rectangle
+    uint32_t first = 0;
+    bool covered = false;
+    for (uint32_t i = g_composed_count; i-- > 0;) {
+        if ((g_composed[i].win->flags & QARMA_FLAG_OPAQUE) &&
+            fb_rect_contains(&g_composed[i].bounds, r)) {
+            first = i;
+            covered = true;
+            break;
+        }
+    }
+
+    if (!covered) {
+        for (int y = r->y; y < r->y + r->height; y++) {
+            uint32_t offset = y * pitch_pixels + r->x;
+            memcpy(&back_buffer[offset], &backing_store[offset], r->width * sizeof(uint32_t));
+        }
+    }
+    g_compose_stats.windows_culled += first;
+
+    for (uint32_t i = first; i < g_composed_count; i++) {
+        fb_rect_t area;
+        if (!fb_rect_intersect(&g_composed[i].bounds, r, &area)) continue;
+        if (fb_area_occluded(&area, i)) {
+            g_compose_stats.windows_culled++;
+            continue;
+        }
+        fb_blit_window_clipped(g_composed[i].win, &area);
+    }
+
+    if (g_pointer_visible) {
+        fb_draw_pointer_clipped(r);
+    }
+
+    g_compose_stats.pixels_composed += (uint32_t)r->width * (uint32_t)r->height;
+}
+
+// ============================================================================
+// Presentation
+//
+// Frames are composed in back_buffer and only ever written to VRAM. COPY
+// mode streams each damaged rectangle into the visible page. FLIP mode
+// (Bochs VBE / QEMU std VGA) keeps two or three pages in VRAM: each page
+// remembers the rectangles it is missing, the next hidden page is brought
+// up to date from the back buffer and the display start moves to it via
+// the VBE Y offset register. Both wait for vertical retrace first.
+// ============================================================================
+
+#define VBE_DISPI_IOPORT_INDEX      0x01CE
+#define VBE_DISPI_IOPORT_DATA       0x01CF
+#define VBE_DISPI_INDEX_ID          0x0
+#define VBE_DISPI_INDEX_XRES        0x1
+#define VBE_DISPI_INDEX_YRES        0x2
+#define VBE_DISPI_INDEX_BPP         0x3
+#define VBE_DISPI_INDEX_VIRT_WIDTH  0x6
+#define VBE_DISPI_INDEX_VIRT_HEIGHT 0x7
+#define VBE_DISPI_INDEX_Y_OFFSET    0x9
+#define VBE_DISPI_ID_MIN            0xB0C0
+#define VBE_DISPI_ID_MAX            0xB0CF
+
+#define VGA_INPUT_STATUS_1          0x3DA
+#define VGA_STATUS_VRETRACE         0x08
+#define FB_VBLANK_SPIN_LIMIT        10000
+
+static fb_present_mode_t g_present_mode = FB_PRESENT_COPY;
+static uint32_t g_flip_pages = 1;
+static uint32_t g_front_page = 0;
+static fb_region_t g_page_stale[FB_MAX_FLIP_PAGES];
+static uint32_t g_last_frame_slot = UINT32_MAX;
+
+static inline uint16_t bga_read(uint16_t index) {
+    outw(VBE_DISPI_IOPORT_INDEX, index);
+    return inw(VBE_DISPI_IOPORT_DATA);
+}
+
+static inline void bga_write(uint16_t index, uint16_t value) {
+    outw(VBE_DISPI_IOPORT_INDEX, index);
+    outw(VBE_DISPI_IOPORT_DATA, value);
+}
+
+static inline uint32_t* fb_page(uint32_t page) {
+    return framebuffer_ptr + page * fb_height * (fb_pitch / 4);
+}
+
+// Wait for vertical retrace; bounded so a display that does not emulate
+// the status bit never stalls the compositor
+static void fb_wait_vblank(void) {
+    for (uint32_t spin = 0; spin < FB_VBLANK_SPIN_LIMIT; spin++) {
+        if (inb(VGA_INPUT_STATUS_1) & VGA_STATUS_VRETRACE) return;
+        cpu_relax();
+    }
+}
+
+// Stream one rectangle of the back buffer into a VRAM page
+static void fb_copy_to_page(uint32_t page, const fb_rect_t* r) {
+    uint32_t pitch_pixels = fb_pitch / 4;
+    uint32_t* vram = fb_page(page);
+    uint32_t offset = r->y * pitch_pixels + r->x;
+
+    if (r->x == 0 && r->width == (int)fb_width) {
+        // Full-width rectangles are one contiguous run
+        memcpy(&vram[offset], &back_buffer[offset], (r->height - 1) * fb_pitch + fb_width * sizeof(uint32_t));
+    } else {
+        for (int y = 0; y < r->height; y++, offset += pitch_pixels) {
+            memcpy(&vram[offset], &back_buffer[offset], r->width * sizeof(uint32_t));
+        }
+    }
+    g_compose_stats.pixels_presented += (uint32_t)r->width * (uint32_t)r->height;
+}
+
+// Show a rectangle drawn outside a frame on the visible page right away
+static void fb_present_rect(const fb_rect_t* r) {
+    fb_copy_to_page(g_front_page, r);
+    for (uint32_t page = 0; page < g_flip_pages; page++) {
+        if (page != g_front_page) fb_region_add(&g_page_stale[page], *r);
+    }
+}
+
+static void fb_present_region(const fb_region_t* damage) {
+    if (g_present_mode == FB_PRESENT_FLIP) {
+        for (uint32_t page = 0; page < g_flip_pages; page++) {
+            for (uint32_t i = 0; i < damage->count; i++) {
+                fb_region_add(&g_page_stale[page], damage->rects[i]);
+            }
+        }
+
+        uint32_t target = (g_front_page + 1) % g_flip_pages;
+        for (uint32_t i = 0; i < g_page_stale[target].count; i++) {
+            fb_copy_to_page(target, &g_page_stale[target].rects[i]);
+        }
+        g_page_stale[target].count = 0;
+
+        fb_wait_vblank();
+        bga_write(VBE_DISPI_INDEX_Y_OFFSET, (uint16_t)(target * fb_height));
+        g_front_page = target;
+    } else {
+        fb_wait_vblank();
+        for (uint32_t i = 0; i < damage->count; i++) {
+            fb_copy_to_page(0, &damage->rects[i]);
+        }
+    }
+    g_compose_stats.presents++;
+}
+
+/**
+ * Number of VRAM pages the Bochs VBE adapter can flip between in the
+ * current mode, or 1 when the adapter is absent or the mode is not its own
+ */
+static uint32_t bga_probe_pages(void) {
+    uint16_t id = bga_read(VBE_DISPI_INDEX_ID);
+    if (id < VBE_DISPI_ID_MIN || id > VBE_DISPI_ID_MAX) return 1;
+    if (bga_read(VBE_DISPI_INDEX_XRES) != fb_width || bga_read(VBE_DISPI_INDEX_YRES) != fb_height ||
+        bga_read(VBE_DISPI_INDEX_BPP) != 32 || bga_read(VBE_DISPI_INDEX_VIRT_WIDTH) * 4u != fb_pitch) {
+        return 1;
+    }
+
+    // Bochs honours the requested virtual height; QEMU sizes it from VRAM
+    bga_write(VBE_DISPI_INDEX_VIRT_HEIGHT, (uint16_t)(fb_height * FB_MAX_FLIP_PAGES));
+    uint32_t pages = bga_read(VBE_DISPI_INDEX_VIRT_HEIGHT) / fb_height;
+    return MIN(pages, (uint32_t)FB_MAX_FLIP_PAGES);
+}
+
+// Only the first page is mapped at boot (see vmm_map_framebuffer)
+static void fb_map_flip_pages(uint32_t pages) {
+    if (!vmm_is_initialized()) return;  // Paging is off, VRAM is reachable as is
+
+    uint32_t base = (uint32_t)(uintptr_t)framebuffer_ptr;
+    uint32_t page_bytes = fb_height * fb_pitch;
+    for (uint32_t addr = (base + page_bytes) & ~0xFFFu; addr < base + pages * page_bytes; addr += 0x1000) {
+        vmm_map_page(addr, addr, PAGE_WRITE);
+    }
+}
+
+bool fb_set_present_mode(fb_present_mode_t mode) {
+    if (!framebuffer_ptr || !back_buffer) return false;
+    if (mode == g_present_mode) return true;
+
+    fb_rect_t screen = { 0, 0, (int)fb_width, (int)fb_height };
+    if (mode == FB_PRESENT_FLIP) {
+        uint32_t pages = bga_probe_pages();
+        if (pages < 2) {
+            SERIAL_LOG("FB: page flipping unavailable, presenting by copy\n");
+            return false;
+        }
+        fb_map_flip_pages(pages);
+
+        // Every page is refreshed from the back buffer before it is shown
+        for (uint32_t page = 0; page < pages; page++) {
+            g_page_stale[page].count = 0;
+            fb_region_add(&g_page_stale[page], screen);
+        }
+        g_flip_pages = pages;
+        g_front_page = 0;
+        g_present_mode = FB_PRESENT_FLIP;
+        SERIAL_LOG_DEC("FB: page flipping across VRAM pages: ", pages);
+        SERIAL_LOG("\n");
+        return true;
+    }
+
+    // Back to a single page: bring page 0 up to date, then show it
+    fb_copy_to_page(0, &screen);
+    fb_wait_vblank();
+    bga_write(VBE_DISPI_INDEX_Y_OFFSET, 0);
+    g_front_page = 0;
+    g_flip_pages = 1;
+    g_present_mode = FB_PRESENT_COPY;
+    return true;
+}
+
+fb_present_mode_t fb_get_present_mode(void) {
+    return g_present_mode;
+}
+
+uint32_t fb_get_flip_pages(void) {
+    return g_flip_pages;
+}
+
+static void fb_compose_damage(bool render_all, bool paced) {
+    if (!framebuffer_ptr || !backing_store || !back_buffer) return;
+
+    fb_collect_window_damage(render_all);
+
+    // One frame per QARMA_TICK_RATE slot, presented just after the tick;
+    // damage reported in between waits for the next slot
+    uint32_t slot = get_ticks() * QARMA_TICK_RATE / TIMER_HZ;
+    if (paced && slot == g_last_frame_slot) {
+        if (g_damage.count) g_compose_stats.frames_deferred++;
+        return;
+    }
+
+    // Take the frame's damage; new reports land in the next frame
+    fb_region_t damage;
+    uint32_t flags = fb_damage_acquire();
+    damage = g_damage;
+    g_damage.count = 0;
+    fb_damage_release(flags);
+
+    if (damage.count == 0) return;
+    g_last_frame_slot = slot;
+
+    for (uint32_t i = 0; i < damage.count; i++) {
+        fb_compose_rect(&damage.rects[i]);
+    }
+    fb_present_region(&damage);
+    g_compose_stats.frames++;
+    g_compose_stats.rects += damage.count;
+}
+
+// Compose only what changed since the last frame
+void fb_compose(void) {
+    fb_compose_damage(false, true);
+}
+
+// Re-render every window and rebuild the whole screen now
+void fb_compose_all(void) {
+    fb_mark_dirty();
+    fb_compose_damage(true, false);
+}
+
+void fb_get_compose_stats(fb_compose_stats_t* stats) {
+    if (stats) *stats = g_compose_stats;
 }
 
 // Simple rectangle drawing functions for popup support
@@ -576,31 +1106,16 @@ void fb_draw_rect(int x, int y, int width, int height, uint32_t color) {
 
 
 void fb_draw_rect_alpha(int x, int y, int width, int height, QARMA_COLOR color) {
-    uint32_t pitch_pixels = fb_pitch / 4;
-
-    for (int j = 0; j < height; ++j) {
-        for (int i = 0; i < width; ++i) {
-            int px = x + i;
-            int py = y + j;
+    int x0 = MAX(x, 0);
+    int y0 = MAX(y, 0);
+    int x1 = MIN(x + width, (int)fb_width);
+    int y1 = MIN(y + height, (int)fb_height);
+    if (x0 >= x1 || y0 >= y1) return;
 
-            if (IN_BOUNDS(px, fb_width) && IN_BOUNDS(py, fb_height)) {
-                uint32_t offset = py * pitch_pixels + px;
-                uint32_t dst = fb_ptr[offset];
-
-                // Extract destination RGB
-                uint8_t dst_r = dst & 0xFF;
-                uint8_t dst_g = (dst >> 8) & 0xFF;
-                uint8_t dst_b = (dst >> 16) & 0xFF;
-
-                // Blend
-                float alpha = color.a / 255.0f;
-                uint8_t out_r = (uint8_t)(color.r * alpha + dst_r * (1 - alpha));
-                uint8_t out_g = (uint8_t)(color.g * alpha + dst_g * (1 - alpha));
-                uint8_t out_b = (uint8_t)(color.b * alpha + dst_b * (1 - alpha));
-
-                fb_ptr[offset] = out_r | (out_g << 8) | (out_b << 16) | (0xFF << 24);
-            }
-        }
+    uint32_t pitch_pixels = fb_pitch / 4;
+    uint32_t pixel = color.r | (color.g << 8) | (color.b << 16) | ((uint32_t)color.a << 24);
+    for (int py = y0; py < y1; py++) {
+        blit_span_fill(fb_ptr + py * pitch_pixels + x0, pixel, x1 - x0);
     }
 }
 
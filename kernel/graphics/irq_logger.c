@@ -1,5 +1,6 @@
 #include "irq_logger.h"
 #include "message_box.h"
+#include "core/scheduler/workqueue.h"
 #include <string.h>
 
 // Simple single-producer (IRQ), single-consumer (non-IRQ) ring buffer
@@ -89,3 +90,22 @@ void irq_log_flush_to_serial(void) {
         irq_tail = (irq_tail + 1) % IRQLOG_SLOTS;
     }
 }
+
+bool irq_log_pending(void) {
+    return irq_tail != irq_head;
+}
+
+static void irq_log_flush_work(work_t *work) {
+    (void)work;
+    irq_log_flush_to_serial();
+}
+
+static work_t irq_log_work = WORK_INIT(irq_log_flush_work, NULL);
+
+// Hand queued lines to the system workqueue, which writes them to serial
+// outside the interrupt. Cheap when nothing is queued or a flush is pending.
+void irq_log_schedule_flush(void) {
+    if (irq_log_pending()) {
+        schedule_work_on(0, &irq_log_work);
+    }
+}
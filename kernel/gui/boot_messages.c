@@ -45,11 +45,12 @@ BootMessagesWindow* boot_messages_create(int x, int y, int width, int height) {
     bmw->main_window->y = y;
     bmw->main_window->size.width = width;
     bmw->main_window->size.height = height;
+    bmw->main_window->flags |= QARMA_FLAG_OPAQUE;  // Render fills the whole buffer
     
     // Reallocate pixel buffer if size changed from default
-    extern void* heap_alloc(size_t size);
+    extern void* heap_zalloc(size_t size);
     size_t buffer_size = width * height * sizeof(uint32_t);
-    bmw->main_window->pixel_buffer = heap_alloc(buffer_size);
+    bmw->main_window->pixel_buffer = heap_zalloc(buffer_size);
     if (!bmw->main_window->pixel_buffer) {
         SERIAL_LOG("[BOOT_MESSAGES] Failed to allocate pixel buffer\n");
         free(bmw);
@@ -34,9 +34,9 @@ StatusBar* status_bar_create(int x, int y, int width, int height) {
     bar->border_color = STATUS_BAR_BORDER_COLOR;
     
     // Allocate pixel buffer
-    extern void* heap_alloc(size_t size);
+    extern void* heap_zalloc(size_t size);
     size_t buffer_size = width * height * sizeof(uint32_t);
-    bar->pixel_buffer = heap_alloc(buffer_size);
+    bar->pixel_buffer = heap_zalloc(buffer_size);
     if (!bar->pixel_buffer) {
         SERIAL_LOG("[STATUS_BAR] Failed to allocate pixel buffer\n");
         free(bar);
@@ -49,7 +49,8 @@ StatusBar* status_bar_create(int x, int y, int width, int height) {
 
 void status_bar_destroy(StatusBar* bar) {
     if (!bar) return;
-    // Note: heap_alloc doesn't have a free function yet, so we just free the struct
+    extern void heap_free(void* ptr);
+    heap_free(bar->pixel_buffer);
     free(bar);
 }
 
@@ -21,7 +21,11 @@ void cmd_help(int argc, char** argv) {
     gfx_print("  clear   - Clear the screen\n");
     gfx_print("  version - Show system version\n");
     gfx_print("  cores   - Show CPU core allocation map\n");
+    gfx_print("  schedlat - Scheduler latency histograms ('reset' clears)\n");
+    gfx_print("  irqstat - Interrupt-off time, softirqs and workqueues\n");
     gfx_print("  mempool - Show memory pool statistics\n");
+    gfx_print("  heap    - Show kernel heap usage and fragmentation\n");
+    gfx_print("  pmm     - Show physical page allocator and free lists\n");
     gfx_print("  splash  - Display splash screen from CD-ROM\n");
     gfx_print("  kbd     - Keyboard control (enable/disable/status)\n");
     gfx_print("  pci     - Scan and display PCI devices\n");
@@ -33,6 +37,14 @@ void cmd_help(int argc, char** argv) {
     gfx_print("  ifdown  - Bring network interface down\n");
     gfx_print("  ping    - Send ICMP echo request to host\n");
     gfx_print("  pipeline- Test execution pipeline system\n");
+    gfx_print("  pipebench - Benchmark streamed and batched pipelines\n");
+    gfx_print("  wqtest  - Stress test the work-stealing deques\n");
+    gfx_print("  graphtest - Run dependency graphs through the parallel engine\n");
+    gfx_print("  pfortest - Test parallel_for/parallel_reduce against serial loops\n");
+    gfx_print("  futuretest - Test futures, continuations and cancellation\n");
+    gfx_print("  fibers  - Test fibers and time their switches\n");
+    gfx_print("  tasks   - List tasks and their stack usage\n");
+    gfx_print("  guardtest - Fault on a task's stack guard page (halts)\n");
     gfx_print("  window  - Create a test window\n");
     gfx_print("  winloop - Run window/mouse update loop\n");
     gfx_print("  reboot  - Restart the system\n");
@@ -141,6 +153,20 @@ void cmd_cores(int argc, char** argv) {
     gfx_print("\n");
 }
 
+void cmd_schedlat(int argc, char** argv) {
+    extern void task_dump_latency(bool reset);
+    task_dump_latency(argc > 1 && strcmp(argv[1], "reset") == 0);
+}
+
+void cmd_irqstat(int argc, char** argv) {
+    (void)argc; (void)argv;
+    
+    extern void softirq_print_stats(void);
+    extern void workqueue_print_stats(void);
+    softirq_print_stats();
+    workqueue_print_stats();
+}
+
 void cmd_mempool(int argc, char** argv) {
     (void)argc; (void)argv;
     
@@ -151,6 +177,22 @@ void cmd_mempool(int argc, char** argv) {
     memory_pool_print_all_stats();
 }
 
+void cmd_heap(int argc, char** argv) {
+    (void)argc; (void)argv;
+    
+    extern void heap_print_stats(void);
+    heap_print_stats();
+}
+
+void cmd_pmm(int argc, char** argv) {
+    (void)argc; (void)argv;
+    
+    extern void pmm_print_stats(void);
+    extern void pmm_dump_free_lists(void);
+    pmm_print_stats();
+    pmm_dump_free_lists();
+}
+
 void cmd_vmm(int argc, char** argv) {
     (void)argc; (void)argv;
     
@@ -243,9 +285,13 @@ static const simple_command_t commands[] = {
     {"exit", cmd_exit},
     {"kbd", cmd_kbd},
     {"mempool", cmd_mempool},
+    {"heap", cmd_heap},
+    {"pmm", cmd_pmm},
     {"vmm", cmd_vmm},
     {"pci", cmd_pci},
     {"cores", cmd_cores},
+    {"schedlat", cmd_schedlat},
+    {"irqstat", cmd_irqstat},
     {"splash", cmd_splash},
     {"ifconfig", cmd_ifconfig},
     {"ifup", cmd_ifup},
@@ -253,6 +299,14 @@ static const simple_command_t commands[] = {
     {"ping", cmd_ping},
     {"arp", cmd_arp},
     {"pipeline", cmd_pipeline},
+    {"pipebench", cmd_pipebench},
+    {"wqtest", cmd_wqtest},
+    {"graphtest", cmd_graphtest},
+    {"pfortest", cmd_pfortest},
+    {"futuretest", cmd_futuretest},
+    {"fibers", cmd_fibers},
+    {"tasks", cmd_tasks},
+    {"guardtest", cmd_guardtest},
     {"window", cmd_window},
     {"winloop", cmd_winloop},
     // {"mouse", cmd_mouse},
@@ -459,6 +513,64 @@ void cmd_pipeline(int argc, char** argv) {
     pipeline_example_test();
 }
 
+void cmd_pipebench(int argc, char** argv) {
+    (void)argc; (void)argv;
+    
+    extern void pipeline_stream_test(void);
+    extern void pipeline_batch_test(void);
+    pipeline_stream_test();
+    pipeline_batch_test();
+}
+
+void cmd_wqtest(int argc, char** argv) {
+    (void)argc; (void)argv;
+    
+    extern void work_queue_stress_test(void);
+    work_queue_stress_test();
+}
+
+void cmd_graphtest(int argc, char** argv) {
+    (void)argc; (void)argv;
+    
+    extern void task_graph_test(void);
+    task_graph_test();
+}
+
+void cmd_pfortest(int argc, char** argv) {
+    (void)argc; (void)argv;
+    
+    extern void parallel_loop_test(void);
+    parallel_loop_test();
+}
+
+void cmd_futuretest(int argc, char** argv) {
+    (void)argc; (void)argv;
+    
+    extern void future_test(void);
+    future_test();
+}
+
+void cmd_fibers(int argc, char** argv) {
+    (void)argc; (void)argv;
+    
+    extern void fiber_test(void);
+    fiber_test();
+}
+
+void cmd_tasks(int argc, char** argv) {
+    (void)argc; (void)argv;
+    
+    extern void task_dump_all_tasks(void);
+    task_dump_all_tasks();
+}
+
+void cmd_guardtest(int argc, char** argv) {
+    (void)argc; (void)argv;
+    
+    extern void task_stack_guard_test(void);
+    task_stack_guard_test();
+}
+
 void cmd_window(int argc, char** argv) {
     (void)argc; (void)argv;
     
@@ -5,6 +5,9 @@
 #include "graphics/graphics.h"
 #include "core/io.h"
 #include "graphics/irq_logger.h"
+#include "core/softirq.h"
+#include "core/scheduler/workqueue.h"
+#include "core/string.h"
 
 // Global flag for detecting any keypress
 volatile bool key_pressed = false;
@@ -179,6 +182,8 @@ bool keyboard_peek_char(char *out) {
 }
 
 
+static void keyboard_softirq(void);
+
 bool keyboard_init(void) {
     GFX_LOG_MIN("Initializing keyboard subsystem...\n");
 
@@ -194,6 +199,9 @@ bool keyboard_init(void) {
     // Clear all modifier states
     memset(&kb_state.modifiers, 0, sizeof(key_modifiers_t));
 
+    // IRQ1 only queues scancodes; they are processed on the way out
+    softirq_register(SOFTIRQ_INPUT, keyboard_softirq);
+
     // --- Enable keyboard IRQs on the 8042 controller ---
     // Read command byte
     outb(KEYBOARD_COMMAND_PORT, 0x20); // 0x20 = Read Command Byte
@@ -209,7 +217,8 @@ bool keyboard_init(void) {
 
 
 
-void keyboard_handler(regs_t* regs, uint8_t scancode) {
+// Everything IRQ1 does past reading the scancode
+static void keyboard_dispatch(uint8_t scancode) {
 
     // Set global flag for any keypress detection
     if (!(scancode & KEY_RELEASE)) {
@@ -226,19 +235,65 @@ void keyboard_handler(regs_t* regs, uint8_t scancode) {
     }
     
     keyboard_process_scancode(scancode);    
+}
 
-    //gfx_print_decimal(scancode);
-    // Debug: Show first few interrupts
-    // if (interrupt_count <= 5) {
-    //     gfx_print("Keyboard interrupt #");
-    //     gfx_print_decimal(interrupt_count);
-    //     gfx_print("\n");
-    // }
-            // if (int_no >= 40) outb(0xA0, 0x20); // Slave PIC
+void keyboard_handler(regs_t* regs, uint8_t scancode) {
+    keyboard_dispatch(scancode);
     keyboard_send_eoi(regs->int_no);
+}
+
+// The command line being executed. Decoding keys stays in the input
+// softirq; the command itself runs from the system workqueue, outside
+// interrupt context, and only one at a time.
+static char kbd_command_line[KEYBOARD_BUFFER_SIZE];
+static volatile uint32_t kbd_command_busy = 0;
+
+static void keyboard_command_work(work_t* work) {
+    (void)work;
+    execute_command(kbd_command_line);
+    show_prompt("/");
+    kbd_command_busy = 0;
+}
+
+static work_t kbd_command_work = WORK_INIT(keyboard_command_work, NULL);
 
-        // if (int_no >= 32 && int_no < 48) {
+static void keyboard_queue_command(const char* line) {
+    if (kbd_command_busy) {
+        gfx_print("Busy: previous command still running\n");
+        return;
+    }
+    kbd_command_busy = 1;
+    strncpy(kbd_command_line, line, KEYBOARD_BUFFER_SIZE - 1);
+    kbd_command_line[KEYBOARD_BUFFER_SIZE - 1] = '\0';
+    schedule_work(&kbd_command_work);
+}
+
+// Scancodes between the IRQ1 top half and the input softirq. One producer
+// and one consumer, both on the CPU that takes IRQ1.
+#define KBD_IRQ_RING_SIZE 64
+
+static volatile uint8_t kbd_irq_ring[KBD_IRQ_RING_SIZE];
+static volatile uint32_t kbd_irq_head = 0;
+static volatile uint32_t kbd_irq_tail = 0;
+static uint32_t kbd_irq_dropped = 0;
+
+static void keyboard_softirq(void) {
+    while (kbd_irq_tail != kbd_irq_head) {
+        uint8_t scancode = kbd_irq_ring[kbd_irq_tail % KBD_IRQ_RING_SIZE];
+        kbd_irq_tail++;
+        keyboard_dispatch(scancode);
+    }
+}
 
+// IRQ1 top half (interrupts disabled)
+void keyboard_irq_enqueue(uint8_t scancode) {
+    if (kbd_irq_head - kbd_irq_tail >= KBD_IRQ_RING_SIZE) {
+        kbd_irq_dropped++;
+        return;
+    }
+    kbd_irq_ring[kbd_irq_head % KBD_IRQ_RING_SIZE] = scancode;
+    kbd_irq_head++;
+    softirq_raise(SOFTIRQ_INPUT);
 }
 
 void keyboard_send_eoi(uint32_t int_no) {
@@ -372,18 +427,17 @@ void keyboard_handle_key_press(uint8_t scancode) {
             // Print newline
             gfx_print("\n");
             
-            // Process the command if there's input
+            // Commands run from the workqueue, which shows the next prompt
             if (kb_state.buffer_count > 0) {
-                execute_command(kb_state.input_buffer);
+                keyboard_queue_command(kb_state.input_buffer);
+            } else {
+                show_prompt("/");
             }
             
             // Clear input buffer for next command
             keyboard_clear_buffer();
             
-            // Show prompt for next command
-            show_prompt("/");
-            
-            SERIAL_LOG("Enter pressed, command processed\n");
+            SERIAL_LOG("Enter pressed, command queued\n");
             return;
             
         case KEY_PGUP:
@@ -16,7 +16,7 @@ irqkeyboard:
     mov es, ax
     mov fs, ax
     mov gs, ax
-
+    cld                  ; C code (rep movs/stos) assumes DF=0
 
     push esp
     call keyboard_service_handler
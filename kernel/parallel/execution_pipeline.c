@@ -7,6 +7,9 @@
 #include "execution_pipeline.h"
 #include "graphics/graphics.h"
 #include "core/string.h"
+#include "core/ktime.h"
+#include "core/atomic.h"
+#include "parallel/parallel_engine.h"
 
 extern void* heap_alloc(size_t size);
 extern void heap_free(void* ptr);
@@ -15,7 +18,7 @@ extern void heap_free(void* ptr);
 // Global State
 // ────────────────────────────────────────────────────────────────────────────
 
-static core_pipeline_manager_t core_managers[4];  // Support up to 4 cores
+static core_pipeline_manager_t core_managers[MAX_PIPELINE_CORES];
 static uint32_t num_cores = 0;
 static uint32_t next_pipeline_id = 1;
 
@@ -27,7 +30,7 @@ void pipeline_system_init(void) {
     extern uint32_t get_cpu_core_count(void);
     num_cores = get_cpu_core_count();
     
-    if (num_cores > 4) num_cores = 4;  // Limit to 4 for now
+    if (num_cores > MAX_PIPELINE_CORES) num_cores = MAX_PIPELINE_CORES;
     
     gfx_print("Initializing execution pipeline system...\n");
     gfx_print("Cores detected: ");
@@ -104,6 +107,8 @@ execution_node_t* node_create(glyph_function_t* func) {
     node->function = func;
     node->completed = false;
     node->result_code = 0;
+    node->stream_core = UINT32_MAX;
+    node->batch_size = PIPELINE_BATCH_SIZE;
     
     return node;
 }
@@ -149,6 +154,8 @@ void pipeline_destroy(execution_pipeline_t* pipeline) {
         node = next;
     }
     
+    checkpoint_destroy(pipeline->batch_checkpoint);
+    
     // Remove from core manager
     core_pipeline_manager_t* mgr = get_core_pipeline_manager(pipeline->core_id);
     if (mgr) {
@@ -197,8 +204,7 @@ void pipeline_execute(execution_pipeline_t* pipeline) {
     pipeline->is_complete = false;
     pipeline->has_error = false;
     
-    // TODO: Get actual cycle counter
-    uint64_t start_cycles = 0;  // rdtsc() on x86
+    uint64_t start_cycles = ktime_get_cycles();
     
     execution_node_t* node = pipeline->head;
     void* data = NULL;  // Initial input
@@ -211,7 +217,7 @@ void pipeline_execute(execution_pipeline_t* pipeline) {
     
     while (node && !pipeline->has_error) {
         // Execute this node's function
-        node->start_cycles = 0;  // rdtsc()
+        node->start_cycles = ktime_get_cycles();
         
         gfx_print("  [Node] Executing: ");
         gfx_print(node->function->semantic_name);
@@ -220,7 +226,7 @@ void pipeline_execute(execution_pipeline_t* pipeline) {
         // Call function with previous node's output
         data = node->function->func_ptr(data);
         
-        node->end_cycles = 0;  // rdtsc()
+        node->end_cycles = ktime_get_cycles();
         node->output_data = data;
         node->completed = true;
         
@@ -237,7 +243,7 @@ void pipeline_execute(execution_pipeline_t* pipeline) {
         node = node->next;
     }
     
-    uint64_t end_cycles = 0;  // rdtsc()
+    uint64_t end_cycles = ktime_get_cycles();
     pipeline->total_cycles = end_cycles - start_cycles;
     
     pipeline->is_running = false;
@@ -261,6 +267,550 @@ void pipeline_execute(execution_pipeline_t* pipeline) {
     }
 }
 
+// ────────────────────────────────────────────────────────────────────────────
+// Batched Execution
+// ────────────────────────────────────────────────────────────────────────────
+
+/**
+ * Cycles a batch should take; 0 until the TSC rate is known, which
+ * leaves batch sizes alone
+ */
+static uint32_t pipeline_batch_target_cycles(void) {
+    static uint32_t target = 0;
+    if (!target) {
+        target = ktime_tsc_khz() * PIPELINE_BATCH_TARGET_US / 1000;
+    }
+    return target;
+}
+
+/**
+ * Fold a batch's cost into the node's smoothed cost per item and size
+ * its next batch to take about PIPELINE_BATCH_TARGET_US
+ */
+static void pipeline_node_adapt(execution_node_t* node, uint64_t cycles, uint32_t count) {
+    uint32_t target = pipeline_batch_target_cycles();
+    if (!target || count == 0) return;
+    
+    uint64_t per_item = ktime_div_u32(cycles, count);
+    if (per_item == 0) per_item = 1;
+    if (per_item > target) per_item = target;
+    
+    // 3/4 old, 1/4 new: one slow batch does not collapse the size
+    node->item_cycles = node->item_cycles ?
+        (uint32_t)(((uint64_t)node->item_cycles * 3 + per_item) >> 2) : (uint32_t)per_item;
+    
+    uint32_t size = target / (node->item_cycles ? node->item_cycles : 1);
+    if (size < 1) size = 1;
+    if (size > PIPELINE_BATCH_MAX) size = PIPELINE_BATCH_MAX;
+    node->batch_size = size;
+}
+
+/**
+ * Batches and streams move items as pointers, so every node has to take
+ * and return one: a batch_ptr, or a SIG_PTR_TO_PTR func_ptr. Anything
+ * else would be called through the wrong type.
+ */
+static bool pipeline_batchable(execution_pipeline_t* pipeline) {
+    for (execution_node_t* node = pipeline->head; node; node = node->next) {
+        glyph_function_t* func = node->function;
+        if (!func || (!func->batch_ptr && (func->signature != SIG_PTR_TO_PTR || !func->func_ptr))) {
+            SERIAL_LOG("Pipeline: node is not pointer-to-pointer, cannot batch: ");
+            SERIAL_LOG(func ? func->semantic_name : "(none)");
+            SERIAL_LOG("\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Run one batch through a node's function. Results go to 'outputs' in
+ * input order, minus items that failed (NULL from a SIG_PTR_TO_PTR
+ * function); returns the results kept.
+ */
+static uint32_t pipeline_node_run_batch(execution_node_t* node, void* const* inputs, void** outputs,
+                                        uint32_t count, pipeline_stage_stats_t* stats) {
+    glyph_function_t* func = node->function;
+    
+    uint64_t start = ktime_get_cycles();
+    if (func->batch_ptr) {
+        func->batch_ptr(inputs, outputs, count);
+    } else {
+        void* (*item)(void*) = func->func_ptr;
+        for (uint32_t i = 0; i < count; i++) {
+            outputs[i] = item(inputs[i]);
+        }
+    }
+    uint64_t cycles = ktime_get_cycles() - start;
+    
+    uint32_t kept = count;
+    if (func->signature == SIG_PTR_TO_PTR) {
+        kept = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            if (outputs[i]) outputs[kept++] = outputs[i];
+        }
+        stats->errors += count - kept;
+    }
+    
+    stats->busy_cycles += cycles;
+    stats->items += kept;
+    stats->batches++;
+    pipeline_node_adapt(node, cycles, count);
+    return kept;
+}
+
+/**
+ * Checkpoint batched execution at K chunks or T microseconds, whichever
+ * comes first. The pipeline owns one checkpoint and rewrites it, so
+ * taking one costs a few stores.
+ */
+bool pipeline_set_checkpoint_interval(execution_pipeline_t* pipeline, uint32_t batches, uint32_t us) {
+    if (!pipeline) return false;
+    
+    if ((batches || us) && !pipeline->batch_checkpoint) {
+        pipeline->batch_checkpoint = (pipeline_checkpoint_t*)heap_alloc(sizeof(pipeline_checkpoint_t));
+        if (!pipeline->batch_checkpoint) return false;
+        memset(pipeline->batch_checkpoint, 0, sizeof(pipeline_checkpoint_t));
+    }
+    pipeline->checkpoint_batches = batches;
+    pipeline->checkpoint_us = us;
+    return true;
+}
+
+static void pipeline_batch_checkpoint(execution_pipeline_t* pipeline, uint32_t done, uint32_t produced) {
+    pipeline_checkpoint_t* checkpoint = pipeline->batch_checkpoint;
+    if (!checkpoint) return;
+    
+    checkpoint->pipeline_id = pipeline->pipeline_id;
+    checkpoint->original_core_id = pipeline->core_id;
+    checkpoint->current_node_index = pipeline->node_count;
+    checkpoint->intermediate_data = NULL;
+    checkpoint->items_done = done;
+    checkpoint->items_produced = produced;
+    checkpoint->checkpoint_timestamp = ktime_get();
+    pipeline->checkpoints_taken++;
+}
+
+/**
+ * Run inputs[done..count) through the chain a chunk at a time: each
+ * node takes the chunk in batches of its own size, ping-ponging between
+ * two scratch arrays, and the survivors land in outputs[produced..].
+ */
+static bool pipeline_run_batches(execution_pipeline_t* pipeline, void* const* inputs, void** outputs,
+                                 uint32_t done, uint32_t count, uint32_t* produced) {
+    uint32_t written = produced ? *produced : 0;
+    if (!pipeline || !pipeline->head || pipeline->is_running || (count && !inputs)) return false;
+    if (!pipeline_batchable(pipeline)) return false;
+    
+    void** scratch = (void**)heap_alloc(sizeof(void*) * PIPELINE_BATCH_MAX * 2);
+    if (!scratch) return false;
+    
+    pipeline->is_running = true;
+    pipeline->is_complete = false;
+    pipeline->has_error = false;
+    
+    for (execution_node_t* node = pipeline->head; node; node = node->next) {
+        memset(&node->stats, 0, sizeof(pipeline_stage_stats_t));
+        node->stream_core = UINT32_MAX;
+    }
+    
+    bool checkpoints = pipeline->batch_checkpoint &&
+                       (pipeline->checkpoint_batches || pipeline->checkpoint_us);
+    uint32_t chunks_since = 0;
+    ktime_t interval = (ktime_t)pipeline->checkpoint_us * NSEC_PER_USEC;
+    ktime_t last_checkpoint = ktime_get();
+    uint64_t start_cycles = ktime_get_cycles();
+    
+    while (done < count) {
+        uint32_t chunk = count - done < PIPELINE_BATCH_MAX ? count - done : PIPELINE_BATCH_MAX;
+        void** in = scratch;
+        void** out = scratch + PIPELINE_BATCH_MAX;
+        memcpy(in, inputs + done, sizeof(void*) * chunk);
+        
+        uint32_t items = chunk;
+        for (execution_node_t* node = pipeline->head; node && items; node = node->next) {
+            uint32_t kept = 0;
+            for (uint32_t pos = 0; pos < items; pos += node->batch_size) {
+                uint32_t batch = items - pos < node->batch_size ? items - pos : node->batch_size;
+                kept += pipeline_node_run_batch(node, in + pos, out + kept, batch, &node->stats);
+            }
+            void** swap = in;
+            in = out;
+            out = swap;
+            items = kept;
+        }
+        
+        if (outputs) memcpy(outputs + written, in, sizeof(void*) * items);
+        written += items;
+        done += chunk;
+        
+        if (checkpoints && done < count) {
+            chunks_since++;
+            ktime_t now = ktime_get();
+            if ((pipeline->checkpoint_batches && chunks_since >= pipeline->checkpoint_batches) ||
+                (pipeline->checkpoint_us && now - last_checkpoint >= interval)) {
+                pipeline_batch_checkpoint(pipeline, done, written);
+                chunks_since = 0;
+                last_checkpoint = now;
+            }
+        }
+    }
+    if (checkpoints) pipeline_batch_checkpoint(pipeline, done, written);
+    heap_free(scratch);
+    
+    uint32_t errors = 0;
+    for (execution_node_t* node = pipeline->head; node; node = node->next) {
+        node->completed = true;
+        errors += node->stats.errors;
+    }
+    
+    pipeline->current = NULL;
+    pipeline->total_cycles = ktime_get_cycles() - start_cycles;
+    pipeline->has_error = errors != 0;
+    pipeline->is_complete = !pipeline->has_error;
+    pipeline->is_running = false;
+    
+    core_pipeline_manager_t* mgr = get_core_pipeline_manager(pipeline->core_id);
+    if (mgr) {
+        mgr->total_pipelines_executed++;
+        mgr->total_cycles_used += pipeline->total_cycles;
+    }
+    
+    if (produced) *produced = written;
+    return pipeline->is_complete;
+}
+
+/**
+ * Run 'count' items through the pipeline on the calling core, batch by
+ * batch. Results keep their input order; items a node dropped (NULL
+ * from a SIG_PTR_TO_PTR function) are left out and mark the pipeline
+ * as failed.
+ */
+bool pipeline_execute_batch(execution_pipeline_t* pipeline, void* const* inputs, void** outputs,
+                            uint32_t count, uint32_t* produced) {
+    if (produced) *produced = 0;
+    return pipeline_run_batches(pipeline, inputs, outputs, 0, count, produced);
+}
+
+/**
+ * Carry on from a batched checkpoint of the same pipeline, given the
+ * same inputs and the outputs written up to it
+ */
+bool pipeline_resume_batch(execution_pipeline_t* pipeline, const pipeline_checkpoint_t* checkpoint,
+                           void* const* inputs, void** outputs, uint32_t count, uint32_t* produced) {
+    if (produced) *produced = 0;
+    if (!pipeline || !checkpoint || checkpoint->pipeline_id != pipeline->pipeline_id ||
+        checkpoint->items_done > count) {
+        return false;
+    }
+    
+    uint32_t written = checkpoint->items_produced;
+    bool ok = pipeline_run_batches(pipeline, inputs, outputs, checkpoint->items_done, count, &written);
+    if (produced) *produced = written;
+    return ok;
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// Streaming Execution
+// ────────────────────────────────────────────────────────────────────────────
+
+typedef struct pipeline_stream pipeline_stream_t;
+
+/**
+ * One node of a stream. Only one processor steps a stage at a time
+ * (claimed through 'busy'), which keeps each ring single-producer and
+ * single-consumer even while the caller stands in for a runner that
+ * has not started yet.
+ */
+typedef struct {
+    execution_node_t* node;
+    pipeline_ring_t* input;
+    pipeline_ring_t* output;
+    uint32_t core_id;                       // UINT32_MAX: run by the caller
+    volatile uint32_t busy;                 // Being stepped
+    volatile uint32_t pinned;               // Its core's runner has taken over
+    volatile uint32_t input_closed;         // Upstream has pushed its last item
+    volatile uint32_t finished;             // Input drained and passed on
+    void* carry[PIPELINE_BATCH_MAX];        // Results the output ring had no room for
+    uint32_t carry_count;
+    uint32_t carry_pos;
+    pipeline_stage_stats_t stats;
+} pipeline_stage_t;
+
+// Long-running engine task stepping the stages pinned to one core
+typedef struct {
+    pipeline_stream_t* stream;
+    uint32_t core_id;
+} pipeline_runner_t;
+
+struct pipeline_stream {
+    uint32_t stage_count;
+    pipeline_stage_t* stages;
+    pipeline_ring_t* rings;                 // stage_count + 1: feed, links, results
+    void** slots;
+    pipeline_runner_t* runners;
+    volatile uint32_t runners_active;       // Submitted and not yet completed
+    volatile uint32_t output_closed;        // Last stage finished
+};
+
+/**
+ * Move one batch through a stage: flush held-back results, then take up
+ * to a batch of input, run the function over it and pass results on.
+ * Returns the items moved.
+ */
+static uint32_t pipeline_stage_step(pipeline_stream_t* stream, uint32_t index) {
+    pipeline_stage_t* stage = &stream->stages[index];
+    if (stage->finished) return 0;
+    
+    // Backpressure: no new input until the last batch is out
+    if (stage->carry_pos < stage->carry_count) {
+        uint32_t pushed = pipeline_ring_push(stage->output, stage->carry + stage->carry_pos,
+                                             stage->carry_count - stage->carry_pos);
+        stage->carry_pos += pushed;
+        if (stage->carry_pos < stage->carry_count) {
+            stage->stats.output_stalls++;
+            return pushed;
+        }
+    }
+    
+    // Read before popping: items pushed before the close are then visible
+    bool closed = atomic_load_u32(&stage->input_closed) != 0;
+    
+    void* batch[PIPELINE_BATCH_MAX];
+    uint32_t count = pipeline_ring_pop(stage->input, batch, stage->node->batch_size);
+    if (count == 0) {
+        if (closed) {
+            stage->finished = 1;
+            if (index + 1 < stream->stage_count) {
+                atomic_store_u32(&stream->stages[index + 1].input_closed, 1);
+            } else {
+                atomic_store_u32(&stream->output_closed, 1);
+            }
+        } else {
+            stage->stats.input_stalls++;
+        }
+        return 0;
+    }
+    
+    uint32_t results = pipeline_node_run_batch(stage->node, batch, stage->carry, count, &stage->stats);
+    stage->carry_count = results;
+    stage->carry_pos = pipeline_ring_push(stage->output, stage->carry, results);
+    if (stage->carry_pos < results) {
+        stage->stats.output_stalls++;
+    }
+    return count;
+}
+
+static uint32_t pipeline_stage_try_step(pipeline_stream_t* stream, uint32_t index) {
+    pipeline_stage_t* stage = &stream->stages[index];
+    if (atomic_xchg_u32(&stage->busy, 1)) return 0;
+    
+    uint32_t moved = pipeline_stage_step(stream, index);
+    atomic_store_u32(&stage->busy, 0);
+    return moved;
+}
+
+static void pipeline_runner_task(void* data) {
+    pipeline_runner_t* runner = (pipeline_runner_t*)data;
+    pipeline_stream_t* stream = runner->stream;
+    
+    for (uint32_t i = 0; i < stream->stage_count; i++) {
+        if (stream->stages[i].core_id == runner->core_id) {
+            atomic_store_u32(&stream->stages[i].pinned, 1);
+        }
+    }
+    
+    for (;;) {
+        bool open = false;
+        uint32_t moved = 0;
+        for (uint32_t i = 0; i < stream->stage_count; i++) {
+            pipeline_stage_t* stage = &stream->stages[i];
+            if (stage->core_id != runner->core_id || stage->finished) continue;
+            moved += pipeline_stage_try_step(stream, i);
+            open = open || !stage->finished;
+        }
+        if (!open) break;
+        if (!moved) cpu_relax();
+    }
+}
+
+/**
+ * Completion hook: the stream stays until every runner has checked out
+ */
+static void pipeline_runner_done(parallel_task_t* task, uint32_t core_id) {
+    (void)core_id;
+    pipeline_stream_t* stream = ((pipeline_runner_t*)task->data)->stream;
+    
+    parallel_task_destroy(task);
+    atomic_dec_u32(&stream->runners_active);
+}
+
+static void pipeline_stream_free(pipeline_stream_t* stream) {
+    if (stream->stages) heap_free(stream->stages);
+    if (stream->rings) heap_free(stream->rings);
+    if (stream->slots) heap_free(stream->slots);
+    if (stream->runners) heap_free(stream->runners);
+    heap_free(stream);
+}
+
+static pipeline_stream_t* pipeline_stream_create(execution_pipeline_t* pipeline) {
+    uint32_t stages = pipeline->node_count;
+    pipeline_stream_t* stream = (pipeline_stream_t*)heap_alloc(sizeof(pipeline_stream_t));
+    if (!stream) return NULL;
+    memset(stream, 0, sizeof(pipeline_stream_t));
+    
+    stream->stage_count = stages;
+    stream->stages = (pipeline_stage_t*)heap_alloc(sizeof(pipeline_stage_t) * stages);
+    stream->rings = (pipeline_ring_t*)heap_alloc(sizeof(pipeline_ring_t) * (stages + 1));
+    stream->slots = (void**)heap_alloc(sizeof(void*) * PIPELINE_RING_SIZE * (stages + 1));
+    stream->runners = (pipeline_runner_t*)heap_alloc(sizeof(pipeline_runner_t) * stages);
+    if (!stream->stages || !stream->rings || !stream->slots || !stream->runners) {
+        pipeline_stream_free(stream);
+        return NULL;
+    }
+    memset(stream->stages, 0, sizeof(pipeline_stage_t) * stages);
+    
+    for (uint32_t i = 0; i <= stages; i++) {
+        pipeline_ring_init(&stream->rings[i], stream->slots + i * PIPELINE_RING_SIZE,
+                           PIPELINE_RING_SIZE);
+    }
+    
+    execution_node_t* node = pipeline->head;
+    for (uint32_t i = 0; i < stages; i++, node = node->next) {
+        stream->stages[i].node = node;
+        stream->stages[i].input = &stream->rings[i];
+        stream->stages[i].output = &stream->rings[i + 1];
+        stream->stages[i].core_id = UINT32_MAX;
+    }
+    return stream;
+}
+
+/**
+ * Pin stages to cores with an AP of their own, round robin, skipping
+ * the caller's; then start one runner per core used
+ */
+static void pipeline_stream_pin(pipeline_stream_t* stream) {
+    uint32_t own = smp_current_cpu();
+    uint32_t cores[MAX_PIPELINE_CORES];
+    uint32_t core_count = 0;
+    
+    for (uint32_t core = 1; core < get_cpu_core_count() && core < MAX_PIPELINE_CORES; core++) {
+        if (core != own && parallel_core_is_ap_driven(core)) {
+            cores[core_count++] = core;
+        }
+    }
+    if (core_count == 0) return;
+    
+    for (uint32_t i = 0; i < stream->stage_count; i++) {
+        stream->stages[i].core_id = cores[i % core_count];
+    }
+    
+    uint32_t runners = core_count < stream->stage_count ? core_count : stream->stage_count;
+    for (uint32_t i = 0; i < runners; i++) {
+        stream->runners[i].stream = stream;
+        stream->runners[i].core_id = cores[i];
+        
+        parallel_task_t* task = parallel_task_create("pipeline_stage", pipeline_runner_task,
+                                                     &stream->runners[i], sizeof(pipeline_runner_t));
+        if (!task) continue;    // The caller runs its stages instead
+        task->on_complete = pipeline_runner_done;
+        atomic_inc_u32(&stream->runners_active);
+        parallel_task_submit_on(task, cores[i]);
+    }
+}
+
+/**
+ * Stream 'count' items through the pipeline, every node on its own core
+ * when there are enough. The caller feeds the first node, collects the
+ * last node's results into 'outputs' (may be NULL) and runs any node
+ * whose runner has not started. Results keep their input order; items
+ * a node dropped (NULL from a SIG_PTR_TO_PTR function) are left out and
+ * mark the pipeline as failed.
+ */
+bool pipeline_stream(execution_pipeline_t* pipeline, void* const* inputs, void** outputs,
+                     uint32_t count, uint32_t* produced) {
+    if (produced) *produced = 0;
+    if (!pipeline || !pipeline->head || pipeline->is_running || (count && !inputs)) return false;
+    if (!pipeline_batchable(pipeline)) return false;
+    
+    pipeline_stream_t* stream = pipeline_stream_create(pipeline);
+    if (!stream) return false;
+    
+    pipeline->is_running = true;
+    pipeline->is_complete = false;
+    pipeline->has_error = false;
+    uint64_t start_cycles = ktime_get_cycles();
+    
+    pipeline_stream_pin(stream);
+    
+    uint32_t fed = 0;
+    uint32_t collected = 0;
+    pipeline_ring_t* feed = &stream->rings[0];
+    pipeline_ring_t* results = &stream->rings[stream->stage_count];
+    
+    for (;;) {
+        uint32_t moved = 0;
+        
+        if (fed < count) {
+            uint32_t pushed = pipeline_ring_push(feed, inputs + fed, count - fed);
+            fed += pushed;
+            moved += pushed;
+            if (fed == count) {
+                atomic_store_u32(&stream->stages[0].input_closed, 1);
+            }
+        } else if (count == 0) {
+            atomic_store_u32(&stream->stages[0].input_closed, 1);
+        }
+        
+        for (uint32_t i = 0; i < stream->stage_count; i++) {
+            if (!atomic_load_u32(&stream->stages[i].pinned)) {
+                moved += pipeline_stage_try_step(stream, i);
+            }
+        }
+        
+        bool closed = atomic_load_u32(&stream->output_closed) != 0;
+        void* batch[PIPELINE_BATCH_SIZE];
+        uint32_t got = pipeline_ring_pop(results, batch, PIPELINE_BATCH_SIZE);
+        for (uint32_t i = 0; i < got; i++) {
+            if (outputs) outputs[collected] = batch[i];
+            collected++;
+        }
+        moved += got;
+        
+        if (closed && got == 0) break;
+        if (!moved) cpu_relax();
+    }
+    
+    // Runners read the stream until they complete
+    while (atomic_load_u32(&stream->runners_active)) {
+        if (!parallel_help()) cpu_relax();
+    }
+    
+    uint32_t errors = 0;
+    for (uint32_t i = 0; i < stream->stage_count; i++) {
+        pipeline_stage_t* stage = &stream->stages[i];
+        stage->node->stats = stage->stats;
+        stage->node->stream_core = stage->core_id;
+        stage->node->completed = true;
+        errors += stage->stats.errors;
+    }
+    pipeline_stream_free(stream);
+    
+    pipeline->total_cycles = ktime_get_cycles() - start_cycles;
+    pipeline->has_error = errors != 0;
+    pipeline->is_complete = !pipeline->has_error;
+    pipeline->is_running = false;
+    
+    core_pipeline_manager_t* mgr = get_core_pipeline_manager(pipeline->core_id);
+    if (mgr) {
+        mgr->total_pipelines_executed++;
+        mgr->total_cycles_used += pipeline->total_cycles;
+    }
+    
+    if (produced) *produced = collected;
+    return pipeline->is_complete;
+}
+
 // ────────────────────────────────────────────────────────────────────────────
 // Checkpoint/Resume
 // ────────────────────────────────────────────────────────────────────────────
@@ -290,7 +840,7 @@ pipeline_checkpoint_t* pipeline_checkpoint(execution_pipeline_t* pipeline) {
         checkpoint->intermediate_data = pipeline->current->input_data;
     }
     
-    checkpoint->checkpoint_timestamp = 0;  // TODO: get system time
+    checkpoint->checkpoint_timestamp = ktime_get();
     
     gfx_print("[Checkpoint] Saved pipeline ");
     gfx_print_hex(pipeline->pipeline_id);
@@ -370,3 +920,37 @@ void pipeline_print_metrics(execution_pipeline_t* pipeline) {
     gfx_print_hex(pipeline->node_count);
     gfx_print("\n");
 }
+
+void pipeline_print_stage_stats(execution_pipeline_t* pipeline) {
+    if (!pipeline) return;
+    
+    gfx_print("\n=== Pipeline Stages ===\n");
+    uint32_t index = 0;
+    for (execution_node_t* node = pipeline->head; node; node = node->next, index++) {
+        pipeline_stage_stats_t* stats = &node->stats;
+        gfx_print("Stage ");
+        gfx_print_decimal(index);
+        gfx_print(" (");
+        gfx_print(node->function ? node->function->semantic_name : "?");
+        gfx_print(") core ");
+        if (node->stream_core == UINT32_MAX) gfx_print("caller");
+        else gfx_print_decimal(node->stream_core);
+        gfx_print(": ");
+        gfx_print_decimal(stats->items);
+        gfx_print(" items in ");
+        gfx_print_decimal(stats->batches);
+        gfx_print(" batches (now ");
+        gfx_print_decimal(node->batch_size);
+        gfx_print(" per call), ");
+        gfx_print_decimal((uint32_t)ktime_to_us(ktime_cycles_to_ns(stats->busy_cycles)));
+        gfx_print(" us busy\n");
+        
+        gfx_print("  stalls in/out: ");
+        gfx_print_decimal(stats->input_stalls);
+        gfx_print(" / ");
+        gfx_print_decimal(stats->output_stalls);
+        gfx_print(", errors: ");
+        gfx_print_decimal(stats->errors);
+        gfx_print("\n");
+    }
+}
@@ -0,0 +1,354 @@
+/**
+ * QARMA - Futures
+ *
+ * Settle-once results with continuations, combinators and parking
+ * waits (see parallel/future.h).
+ */
+
+#include "future.h"
+#include "core/kernel.h"
+#include "core/memory/heap.h"
+#include "core/memory/object_cache.h"
+#include "core/smp.h"
+#include "core/ktime.h"
+
+// future_then() bookkeeping, freed by its callback
+typedef struct {
+    future_callback_t callback;
+    future_t* target;
+    future_then_fn_t fn;
+    void* arg;
+} future_then_t;
+
+// when_all/when_any bookkeeping, freed by the last source's callback
+typedef struct future_combinator future_combinator_t;
+
+typedef struct {
+    future_callback_t callback;
+    future_combinator_t* combinator;
+} future_combinator_slot_t;
+
+struct future_combinator {
+    future_t* target;
+    bool any;                           // when_any rather than when_all
+    volatile uint32_t remaining;        // Sources not yet settled
+    volatile uint32_t failed;           // Sources that failed (when_any)
+    int32_t error;                      // Last failure seen (when_any)
+    future_combinator_slot_t slots[];
+};
+
+// parallel_async() task
+typedef struct {
+    parallel_task_t task;
+    future_t* future;
+    parallel_async_fn_t fn;
+    void* arg;
+    cancel_token_t* token;
+} parallel_async_t;
+
+static object_cache_t* g_future_cache = NULL;
+static object_cache_t* g_async_cache = NULL;
+
+void future_init(void) {
+    if (!g_future_cache) {
+        g_future_cache = object_cache_create("future_t", sizeof(future_t), 16, NULL);
+    }
+    if (!g_async_cache) {
+        g_async_cache = object_cache_create("parallel_async_t", sizeof(parallel_async_t), 16, NULL);
+    }
+}
+
+/**
+ * Create a pending future holding one reference for the caller
+ */
+future_t* future_create(void) {
+    future_t* future = (future_t*)object_cache_alloc(g_future_cache);
+    if (!future) return NULL;
+
+    future->state = FUTURE_PENDING;
+    future->refs = 1;
+    future->value = NULL;
+    future->error = 0;
+    future->callbacks = NULL;
+    spin_lock_init(&future->lock, "future");
+    wait_queue_init(&future->waiters, "future");
+    return future;
+}
+
+future_t* future_get(future_t* future) {
+    if (future) atomic_inc_u32(&future->refs);
+    return future;
+}
+
+void future_put(future_t* future) {
+    if (future && atomic_dec_and_test_u32(&future->refs)) {
+        object_cache_free(g_future_cache, future);
+    }
+}
+
+/**
+ * Settle a future: set its outcome, then run its callbacks in the order
+ * they were added and wake the parked waiters
+ */
+static bool future_settle(future_t* future, future_state_t state, void* value, int32_t error) {
+    if (!future) return false;
+
+    uint32_t flags = spin_lock_irqsave(&future->lock);
+    if (future->state != FUTURE_PENDING) {
+        spin_unlock_irqrestore(&future->lock, flags);
+        return false;
+    }
+    future->value = value;
+    future->error = error;
+    atomic_store_u32(&future->state, state);
+    future_callback_t* callbacks = future->callbacks;
+    future->callbacks = NULL;
+    spin_unlock_irqrestore(&future->lock, flags);
+
+    // Added most recent first
+    future_callback_t* ordered = NULL;
+    while (callbacks) {
+        future_callback_t* next = callbacks->next;
+        callbacks->next = ordered;
+        ordered = callbacks;
+        callbacks = next;
+    }
+    while (ordered) {
+        future_callback_t* next = ordered->next;
+        ordered->fn(future, ordered);
+        ordered = next;
+    }
+
+    wake_up_all(&future->waiters);
+    return true;
+}
+
+bool future_complete(future_t* future, void* value) {
+    return future_settle(future, FUTURE_COMPLETED, value, 0);
+}
+
+bool future_fail(future_t* future, int32_t error) {
+    return future_settle(future, FUTURE_FAILED, NULL, error ? error : -1);
+}
+
+bool future_cancel(future_t* future) {
+    return future_settle(future, FUTURE_CANCELLED, NULL, 0);
+}
+
+/**
+ * Pass a source's failure or cancellation on to a dependent future
+ */
+static void future_propagate(future_t* source, future_t* target) {
+    if (future_state(source) == FUTURE_FAILED) {
+        future_fail(target, source->error);
+    } else {
+        future_cancel(target);
+    }
+}
+
+/**
+ * Run a callback once the future settles: now, on the caller, if it
+ * already has
+ */
+void future_on_settled(future_t* future, future_callback_t* callback) {
+    uint32_t flags = spin_lock_irqsave(&future->lock);
+    if (future->state == FUTURE_PENDING) {
+        callback->next = future->callbacks;
+        future->callbacks = callback;
+        spin_unlock_irqrestore(&future->lock, flags);
+        return;
+    }
+    spin_unlock_irqrestore(&future->lock, flags);
+    callback->fn(future, callback);
+}
+
+static void future_then_run(future_t* source, future_callback_t* callback) {
+    future_then_t* then = (future_then_t*)callback;
+
+    if (future_state(source) == FUTURE_COMPLETED) {
+        future_complete(then->target, then->fn(source->value, then->arg));
+    } else {
+        future_propagate(source, then->target);
+    }
+    future_put(then->target);
+    heap_free(then);
+}
+
+future_t* future_then(future_t* source, future_then_fn_t fn, void* arg) {
+    if (!source || !fn) return NULL;
+
+    future_then_t* then = (future_then_t*)heap_alloc(sizeof(future_then_t));
+    future_t* target = future_create();
+    if (!then || !target) {
+        if (then) heap_free(then);
+        future_put(target);
+        return NULL;
+    }
+
+    then->callback.fn = future_then_run;
+    then->target = future_get(target);
+    then->fn = fn;
+    then->arg = arg;
+    future_on_settled(source, &then->callback);
+    return target;
+}
+
+static void future_combinator_run(future_t* source, future_callback_t* callback) {
+    future_combinator_t* comb = ((future_combinator_slot_t*)callback)->combinator;
+    future_t* target = comb->target;
+    future_state_t state = future_state(source);
+
+    if (comb->any) {
+        if (state == FUTURE_COMPLETED) {
+            future_complete(target, source->value);
+        } else if (state == FUTURE_FAILED) {
+            comb->error = source->error;
+            atomic_inc_u32(&comb->failed);
+        }
+    } else if (state != FUTURE_COMPLETED) {
+        future_propagate(source, target);
+    }
+
+    if (!atomic_dec_and_test_u32(&comb->remaining)) return;
+
+    // Last source: settle whatever is still open
+    if (!comb->any) {
+        future_complete(target, NULL);
+    } else if (comb->failed) {
+        future_fail(target, comb->error);
+    } else {
+        future_cancel(target);
+    }
+    future_put(target);
+    heap_free(comb);
+}
+
+static future_t* future_combine(future_t** sources, uint32_t count, bool any) {
+    future_t* target = future_create();
+    if (!target) return NULL;
+
+    if (count == 0) {
+        if (any) future_cancel(target);
+        else future_complete(target, NULL);
+        return target;
+    }
+
+    future_combinator_t* comb = (future_combinator_t*)heap_alloc(
+        sizeof(future_combinator_t) + count * sizeof(future_combinator_slot_t));
+    if (!comb) {
+        future_put(target);
+        return NULL;
+    }
+    comb->target = future_get(target);
+    comb->any = any;
+    comb->remaining = count;
+    comb->failed = 0;
+    comb->error = 0;
+
+    // The last source to settle frees comb, possibly inside this loop
+    for (uint32_t i = 0; i < count; i++) {
+        comb->slots[i].callback.fn = future_combinator_run;
+        comb->slots[i].combinator = comb;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        future_on_settled(sources[i], &comb->slots[i].callback);
+    }
+    return target;
+}
+
+future_t* future_when_all(future_t** sources, uint32_t count) {
+    return future_combine(sources, count, false);
+}
+
+future_t* future_when_any(future_t** sources, uint32_t count) {
+    return future_combine(sources, count, true);
+}
+
+static bool future_settled_cond(void* arg) {
+    return future_is_settled((future_t*)arg);
+}
+
+/**
+ * Wait until the future settles; false if the timeout passed first
+ */
+bool future_wait(future_t* future, uint32_t timeout_ms) {
+    if (!future) return false;
+
+    ktime_t deadline = timeout_ms ? ktime_get() + (uint64_t)timeout_ms * NSEC_PER_MSEC : 0;
+    while (!future_is_settled(future)) {
+        ktime_t now = ktime_get();
+        if (deadline && now >= deadline) return false;
+
+        // The work may be queued where only this processor will run it
+        if (parallel_help()) continue;
+
+        if (parallel_worker_count() > 1) {
+            // Nothing left here; the other processors finish the rest
+            uint32_t remaining_ms = deadline ?
+                (uint32_t)ktime_div_u32(deadline - now + NSEC_PER_MSEC - 1, NSEC_PER_MSEC) : 0;
+            return wait_event(&future->waiters, future_settled_cond, future, remaining_ms);
+        }
+        cpu_relax();
+    }
+    return true;
+}
+
+static void parallel_async_task(void* data) {
+    parallel_async_t* async = (parallel_async_t*)data;
+
+    if (cancel_requested(async->token)) {
+        future_cancel(async->future);
+        return;
+    }
+
+    void* value = async->fn(async->arg, async->token);
+    if (cancel_requested(async->token)) {
+        future_cancel(async->future);
+    } else {
+        future_complete(async->future, value);
+    }
+}
+
+/**
+ * Completion hook: drop the task's reference and return it to the cache
+ */
+static void parallel_async_done(parallel_task_t* task, uint32_t core_id) {
+    (void)core_id;
+    parallel_async_t* async = (parallel_async_t*)task->data;
+
+    future_put(async->future);
+    object_cache_free(g_async_cache, async);
+}
+
+future_t* parallel_async(const char* name, parallel_async_fn_t fn, void* arg,
+                         cancel_token_t* token) {
+    if (!fn || !g_async_cache) return NULL;
+
+    parallel_async_t* async = (parallel_async_t*)object_cache_alloc(g_async_cache);
+    future_t* future = future_create();
+    if (!async || !future) {
+        if (async) object_cache_free(g_async_cache, async);
+        future_put(future);
+        return NULL;
+    }
+
+    memset(&async->task, 0, sizeof(parallel_task_t));
+    size_t name_len = strlen(name);
+    if (name_len >= sizeof(async->task.name)) {
+        name_len = sizeof(async->task.name) - 1;
+    }
+    memcpy(async->task.name, name, name_len);
+    async->task.function = parallel_async_task;
+    async->task.data = async;
+    async->task.on_complete = parallel_async_done;
+    async->task.state = PARALLEL_TASK_READY;
+    async->task.priority = PARALLEL_PRIORITY_NORMAL;
+    async->task.assigned_core = UINT32_MAX;
+    async->future = future_get(future);
+    async->fn = fn;
+    async->arg = arg;
+    async->token = token;
+
+    parallel_task_submit(&async->task);
+    return future;
+}
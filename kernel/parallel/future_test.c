@@ -0,0 +1,150 @@
+/**
+ * QARMA - Future Test
+ *
+ * Async tasks with then() chains, when_all/when_any over a fan-out,
+ * failure and cancellation passing down a chain, and cancel tokens
+ * stopping tasks before they start. Meant to be run under multi-CPU
+ * QEMU as well (make run QEMU_CPUS=8).
+ */
+
+#include "future.h"
+#include "graphics/graphics.h"
+#include "config.h"
+
+#define FUTURE_TEST_FANOUT      32
+#define FUTURE_TEST_CHAIN       8
+#define FUTURE_TEST_TIMEOUT_MS  5000
+#define FUTURE_TEST_ERROR       42
+
+static volatile uint32_t g_ran = 0;
+
+static void* future_test_square(void* arg, cancel_token_t* token) {
+    (void)token;
+    uint32_t n = (uint32_t)arg;
+    atomic_inc_u32(&g_ran);
+    return (void*)(n * n);
+}
+
+static void* future_test_increment(void* value, void* arg) {
+    (void)arg;
+    return (void*)((uint32_t)value + 1);
+}
+
+static uint32_t future_test_check(const char* label, bool ok) {
+    gfx_print("  ");
+    gfx_print(label);
+    gfx_print(ok ? ": OK\n" : ": FAIL\n");
+    return ok ? 0 : 1;
+}
+
+/**
+ * async(7) -> +1 -> +1 ... ; expect 49 + chain length
+ */
+static uint32_t future_test_chain(void) {
+    future_t* head = parallel_async("future_square", future_test_square, (void*)7, NULL);
+    if (!head) return future_test_check("chain (allocation)", false);
+
+    future_t* tail = future_get(head);
+    for (uint32_t i = 0; i < FUTURE_TEST_CHAIN && tail; i++) {
+        future_t* next = future_then(tail, future_test_increment, NULL);
+        future_put(tail);
+        tail = next;
+    }
+
+    bool ok = tail && future_wait(tail, FUTURE_TEST_TIMEOUT_MS) &&
+              future_state(tail) == FUTURE_COMPLETED &&
+              (uint32_t)tail->value == 49 + FUTURE_TEST_CHAIN;
+    future_put(tail);
+    future_put(head);
+    return future_test_check("then chain", ok);
+}
+
+static uint32_t future_test_fanout(void) {
+    future_t* sources[FUTURE_TEST_FANOUT];
+    uint32_t count = 0;
+
+    g_ran = 0;
+    for (uint32_t i = 0; i < FUTURE_TEST_FANOUT; i++) {
+        sources[count] = parallel_async("future_square", future_test_square, (void*)i, NULL);
+        if (sources[count]) count++;
+    }
+
+    future_t* any = future_when_any(sources, count);
+    future_t* all = future_when_all(sources, count);
+    bool ok = count == FUTURE_TEST_FANOUT && any && all &&
+              future_wait(all, FUTURE_TEST_TIMEOUT_MS) &&
+              future_state(all) == FUTURE_COMPLETED &&
+              future_state(any) == FUTURE_COMPLETED;
+
+    // when_any's value must be one of the squares
+    bool any_ok = false;
+    for (uint32_t i = 0; ok && i < count; i++) {
+        if (future_state(sources[i]) != FUTURE_COMPLETED || (uint32_t)sources[i]->value != i * i) ok = false;
+        if ((uint32_t)any->value == i * i) any_ok = true;
+    }
+    ok = ok && any_ok && g_ran == FUTURE_TEST_FANOUT;
+
+    future_put(all);
+    future_put(any);
+    for (uint32_t i = 0; i < count; i++) {
+        future_put(sources[i]);
+    }
+    return future_test_check("when_all/when_any", ok);
+}
+
+static uint32_t future_test_failure(void) {
+    future_t* source = future_create();
+    future_t* then = source ? future_then(source, future_test_increment, NULL) : NULL;
+    future_t* pair[2] = { source, future_create() };
+    future_t* all = pair[1] ? future_when_all(pair, 2) : NULL;
+    future_t* any = pair[1] ? future_when_any(pair, 2) : NULL;
+
+    bool ok = then && all && any;
+    if (ok) {
+        future_fail(source, FUTURE_TEST_ERROR);
+        ok = future_state(then) == FUTURE_FAILED && then->error == FUTURE_TEST_ERROR &&
+             future_state(all) == FUTURE_FAILED && !future_is_settled(any);
+
+        // The other source decides when_any; settling twice changes nothing
+        future_cancel(pair[1]);
+        ok = ok && future_state(any) == FUTURE_FAILED && !future_complete(pair[1], NULL);
+    }
+
+    future_put(any);
+    future_put(all);
+    future_put(pair[1]);
+    future_put(then);
+    future_put(source);
+    return future_test_check("failure propagation", ok);
+}
+
+static uint32_t future_test_cancel(void) {
+    cancel_token_t token;
+    cancel_token_init(&token);
+    cancel_token_cancel(&token);
+
+    g_ran = 0;
+    future_t* task = parallel_async("future_square", future_test_square, (void*)3, &token);
+    future_t* then = task ? future_then(task, future_test_increment, NULL) : NULL;
+
+    bool ok = then && future_wait(then, FUTURE_TEST_TIMEOUT_MS) &&
+              future_state(task) == FUTURE_CANCELLED &&
+              future_state(then) == FUTURE_CANCELLED && g_ran == 0;
+
+    future_put(then);
+    future_put(task);
+    return future_test_check("cancel token", ok);
+}
+
+void future_test(void) {
+    gfx_print("\n=== Future Test ===\n");
+
+    uint32_t errors = 0;
+    errors += future_test_chain();
+    errors += future_test_fanout();
+    errors += future_test_failure();
+    errors += future_test_cancel();
+
+    gfx_print(errors ? "Future test FAILED\n" : "Future test passed\n");
+    SERIAL_LOG(errors ? "FUTURE_TEST: FAILED\n" : "FUTURE_TEST: passed\n");
+}
@@ -10,17 +10,28 @@
 #include "graphics/graphics.h"
 #include "core/memory.h"
 #include "core/memory/heap.h"
+#include "core/memory/object_cache.h"
+#include "core/smp.h"
+#include "core/atomic.h"
+#include "core/ktime.h"
+#include "parallel/parallel_loop.h"
+#include "parallel/future.h"
+#include "core/scheduler/task_manager.h"
+#include "core/scheduler/fiber.h"
+#include "config.h"
+#include "core/acpi.h"
 
 // Global parallel engine state
 static cpu_core_t* g_cpu_cores = NULL;
 static numa_node_t* g_numa_nodes = NULL;
+static object_cache_t* g_task_cache = NULL;
 static core_scheduler_t* g_core_schedulers = NULL;
 static parallel_engine_stats_t g_engine_stats = {0};
-static uint32_t g_next_task_id = 1;
+static volatile uint32_t g_next_task_id = 1;
 
 // Constants
 #define MAX_CORES 64
-#define WORK_QUEUE_SIZE 1024
+#define WORK_QUEUE_SIZE 1024            // Initial deque capacity (grows on demand)
 #define WORK_STEALING_THRESHOLD 4
 
 /**
@@ -35,9 +46,17 @@ void parallel_engine_init(void) {
     // Detect CPU topology (sets total_cores, active_cores, numa_nodes)
     detect_cpu_topology();
     
+    // Task descriptors are created and completed at a high rate
+    if (!g_task_cache) {
+        g_task_cache = object_cache_create("parallel_task_t", sizeof(parallel_task_t), 16, NULL);
+    }
+    
     // Initialize per-core schedulers
     parallel_scheduler_init();
     
+    parallel_loop_init();
+    future_init();
+    
     gfx_print("Parallel processing engine initialized.\n");
 }
 
@@ -69,25 +88,61 @@ void parallel_scheduler_init(void) {
         core_scheduler_t* scheduler = &g_core_schedulers[i];
         scheduler->core_id = i;
         
-        // Initialize work queue
-        work_queue_t* queue = &scheduler->local_queue;
-        queue->tasks = (parallel_task_t**)heap_alloc(sizeof(parallel_task_t*) * WORK_QUEUE_SIZE);
-        queue->capacity = WORK_QUEUE_SIZE;
-        queue->mask = WORK_QUEUE_SIZE - 1;  // Assuming power of 2
-        queue->head = 0;
-        queue->tail = 0;
+        // Initialize work-stealing deque
+        work_queue_init(&scheduler->local_queue, WORK_QUEUE_SIZE);
     }
     
     gfx_print("Parallel scheduler initialized.\n");
 }
 
 /**
- * Detect CPU topology using CPUID
+ * Detect CPU topology from the MADT (via the SMP layer), falling back to
+ * CPUID when no ACPI tables are available
  */
 void detect_cpu_topology(void) {
     uint32_t eax, ebx, ecx, edx;
     uint32_t logical_cores = 1;
     
+    if (smp_is_enabled()) {
+        logical_cores = smp_cpu_count();
+        if (logical_cores > MAX_CORES) logical_cores = MAX_CORES;
+        
+        g_engine_stats.total_cores = logical_cores;
+        g_engine_stats.active_cores = logical_cores;
+        g_engine_stats.numa_nodes = 1;  // No SRAT parsing yet
+        
+        gfx_print("MADT: ");
+        gfx_print_hex(logical_cores);
+        gfx_print(" processors\n");
+        
+        for (uint32_t i = 0; i < logical_cores; i++) {
+            cpu_core_t* core = (cpu_core_t*)heap_alloc(sizeof(cpu_core_t));
+            memset(core, 0, sizeof(cpu_core_t));
+            
+            core->core_id = i;
+            core->numa_node = 0;
+            core->online = true;
+            core->frequency = 3000;
+            core->cache_size_l1 = 32;
+            core->cache_size_l2 = 256;
+            core->cache_size_l3 = 8192;
+            
+            core->next = g_cpu_cores;
+            g_cpu_cores = core;
+        }
+        
+        numa_node_t* node = (numa_node_t*)heap_alloc(sizeof(numa_node_t));
+        memset(node, 0, sizeof(numa_node_t));
+        node->node_id = 0;
+        node->core_count = logical_cores;
+        node->total_memory = 16ULL * 1024 * 1024 * 1024;
+        node->available_memory = node->total_memory;
+        node->memory_bandwidth = 25600;
+        node->next = g_numa_nodes;
+        g_numa_nodes = node;
+        return;
+    }
+    
     // Get max basic CPUID function
     __asm__ volatile("cpuid"
                      : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
@@ -179,14 +234,14 @@ void detect_cpu_topology(void) {
  */
 parallel_task_t* parallel_task_create(const char* name, void (*function)(void*), 
                                      void* data, size_t data_size) {
-    parallel_task_t* task = (parallel_task_t*)heap_alloc(sizeof(parallel_task_t));
+    parallel_task_t* task = (parallel_task_t*)object_cache_alloc(g_task_cache);
     if (!task) {
         return NULL;
     }
     
     memset(task, 0, sizeof(parallel_task_t));
     
-    task->task_id = g_next_task_id++;
+    task->task_id = atomic_xadd_u32(&g_next_task_id, 1);
     task->function = function;
     task->data = data;
     task->data_size = data_size;
@@ -203,11 +258,21 @@ parallel_task_t* parallel_task_create(const char* name, void (*function)(void*),
     memcpy(task->name, name, name_len);
     task->name[name_len] = '\0';
     
-    g_engine_stats.total_tasks_created++;
+    atomic_inc_u32(&g_engine_stats.total_tasks_created);
     
     return task;
 }
 
+/**
+ * Return a task created by parallel_task_create (it must not be queued)
+ */
+void parallel_task_destroy(parallel_task_t* task) {
+    if (!task) return;
+    if (task->dependencies) heap_free(task->dependencies);
+    if (task->dependents) heap_free(task->dependents);
+    object_cache_free(g_task_cache, task);
+}
+
 /**
  * Submit task for execution
  */
@@ -215,62 +280,245 @@ void parallel_task_submit(parallel_task_t* task) {
     if (!task) return;
     
     // Select best core for this task
-    uint32_t best_core = select_best_core_for_task(task);
-    task->assigned_core = best_core;
+    parallel_task_submit_on(task, select_best_core_for_task(task));
+}
+
+/**
+ * Interrupts off on this CPU around owner-side deque operations. Besides
+ * the core loop, preemptible tasks on an AP submit and help too; with
+ * interrupts off they cannot be switched out, or migrate, between
+ * deciding they own a deque and finishing the push or pop.
+ */
+static inline uint32_t parallel_irq_save(void) {
+    uint32_t flags;
+    __asm__ volatile("pushfl; popl %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void parallel_irq_restore(uint32_t flags) {
+    if (flags & 0x200) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
+
+/**
+ * Is the calling processor the owner of this core's deque?
+ * AP-driven cores are owned by their AP, all others by the BSP tick.
+ * Only meaningful with interrupts off (parallel_irq_save).
+ */
+static bool parallel_core_is_local(uint32_t core_id) {
+    uint32_t cpu = smp_current_cpu();
+    if (g_core_schedulers[core_id].ap_driven) {
+        return cpu == core_id;
+    }
+    return cpu == 0;
+}
+
+/**
+ * Submit task to a specific core
+ */
+void parallel_task_submit_on(parallel_task_t* task, uint32_t core_id) {
+    if (!task || core_id >= MAX_CORES || core_id >= g_engine_stats.total_cores) return;
     
-    // Add to core's work queue
-    if (best_core < MAX_CORES) {
-        work_queue_push(&g_core_schedulers[best_core].local_queue, task);
-        g_engine_stats.tasks_in_flight++;
+    task->assigned_core = core_id;
+    atomic_inc_u32(&g_engine_stats.tasks_in_flight);
+    
+    // Only the owner may touch the bottom of a deque; everyone else posts
+    work_queue_t* queue = &g_core_schedulers[core_id].local_queue;
+    uint32_t flags = parallel_irq_save();
+    if (parallel_core_is_local(core_id)) {
+        work_queue_push(queue, task);
+    } else {
+        work_queue_post(queue, task);
     }
+    parallel_irq_restore(flags);
 }
 
 /**
- * Parallel engine tick - called from main kernel loop
+ * Run one task on a core and account for it. The task may have been
+ * freed by the time this returns (its graph's owner may be waiting on
+ * it), so nothing reads it after parallel_execute_task.
  */
-void parallel_engine_tick(void) {
-    // Update load balancing
-    adaptive_load_balance();
+static void parallel_run_task(core_scheduler_t* scheduler, parallel_task_t* task) {
+    // A task that waits on the engine runs others nested inside itself
+    parallel_task_t* outer = scheduler->current_task;
+    
+    scheduler->current_task = task;
+    parallel_execute_task(task, scheduler->core_id);
+    scheduler->current_task = outer;
+    scheduler->tasks_executed++;
+    
+    atomic_inc_u32(&g_engine_stats.total_tasks_completed);
+    atomic_dec_u32(&g_engine_stats.tasks_in_flight);
+}
+
+/**
+ * One pass over the cores the BSP drives; returns the tasks run
+ */
+static uint32_t parallel_tick_cores(void) {
+    uint32_t ran = 0;
     
     // Process tasks on each core (simplified - would be done in parallel)
     for (uint32_t core_id = 0; core_id < g_engine_stats.total_cores && core_id < MAX_CORES; core_id++) {
         core_scheduler_t* scheduler = &g_core_schedulers[core_id];
         
-        // If no current task, get next task
-        if (!scheduler->current_task) {
-            scheduler->current_task = parallel_get_next_task(core_id);
-        }
+        // Cores backed by a started AP drain their own queue
+        if (scheduler->ap_driven) continue;
         
-        // Execute current task
-        if (scheduler->current_task) {
-            parallel_execute_task(scheduler->current_task, core_id);
-            
-            // Check if task completed
-            if (scheduler->current_task->state == PARALLEL_TASK_COMPLETED ||
-                scheduler->current_task->state == PARALLEL_TASK_FAILED) {
-                
-                g_engine_stats.total_tasks_completed++;
-                g_engine_stats.tasks_in_flight--;
-                scheduler->tasks_executed++;
-                scheduler->current_task = NULL;
-            }
-        } else {
+        parallel_task_t* task = parallel_get_next_task(core_id);
+        if (!task) {
             // Core is idle, try work stealing
             if (scheduler->steal_attempts % WORK_STEALING_THRESHOLD == 0) {
                 uint32_t victim_core = (core_id + 1) % g_engine_stats.total_cores;
-                parallel_task_t* stolen_task = work_stealing_attempt(core_id, victim_core);
-                if (stolen_task) {
-                    scheduler->current_task = stolen_task;
+                task = work_stealing_attempt(core_id, victim_core);
+                if (task) {
                     scheduler->tasks_stolen++;
-                    g_engine_stats.work_stealing_events++;
+                    atomic_inc_u32(&g_engine_stats.work_stealing_events);
                 }
             }
             scheduler->steal_attempts++;
-            scheduler->idle_time++;
+            if (!task) {
+                scheduler->idle_time++;
+                continue;
+            }
+        }
+        
+        parallel_run_task(scheduler, task);
+        ran++;
+    }
+    return ran;
+}
+
+/**
+ * Parallel engine tick - called from main kernel loop
+ */
+void parallel_engine_tick(void) {
+    // Update load balancing
+    adaptive_load_balance();
+    
+    parallel_tick_cores();
+}
+
+/**
+ * Hand a core's deque over to the calling AP. Must run before the AP is
+ * reported online so the BSP never pushes to the bottom concurrently.
+ */
+void parallel_core_attach(uint32_t core_id) {
+    if (core_id >= MAX_CORES || core_id >= g_engine_stats.total_cores || !g_core_schedulers) return;
+    g_core_schedulers[core_id].ap_driven = true;
+    atomic_fence();
+}
+
+/**
+ * Pop or steal one task for an AP-driven core and run it
+ */
+static bool parallel_core_run_one(uint32_t core_id) {
+    core_scheduler_t* scheduler = &g_core_schedulers[core_id];
+    
+    // A helping task may have migrated since picking core_id: then it
+    // is no longer the owner and can only steal
+    uint32_t flags = parallel_irq_save();
+    parallel_task_t* task = smp_current_cpu() == core_id ? parallel_get_next_task(core_id) : NULL;
+    parallel_irq_restore(flags);
+    
+    // Local work exhausted: sweep the other cores once
+    if (!task) {
+        uint32_t cores = g_engine_stats.total_cores;
+        uint32_t victim = core_id;
+        for (uint32_t n = 1; n < cores && !task; n++) {
+            victim = (victim + 1) % cores;
+            scheduler->steal_attempts++;
+            task = work_stealing_attempt(core_id, victim);
+        }
+        if (!task) return false;
+        scheduler->tasks_stolen++;
+        atomic_inc_u32(&g_engine_stats.work_stealing_events);
+    }
+    
+    parallel_run_task(scheduler, task);
+    return true;
+}
+
+/**
+ * The core whose deque the calling processor owns: its own core for an
+ * AP running the engine, core 0 for the BSP, UINT32_MAX for anyone else
+ */
+uint32_t parallel_current_core(void) {
+    if (!g_core_schedulers) return UINT32_MAX;
+    
+    uint32_t cpu = smp_current_cpu();
+    if (cpu < MAX_CORES && cpu < g_engine_stats.total_cores && g_core_schedulers[cpu].ap_driven) {
+        return cpu;
+    }
+    return cpu == 0 ? 0 : UINT32_MAX;
+}
+
+/**
+ * Tasks waiting on a core's deque (not counting its inbox)
+ */
+uint32_t parallel_core_queue_size(uint32_t core_id) {
+    if (core_id >= MAX_CORES || !g_core_schedulers) return 0;
+    return work_queue_size(&g_core_schedulers[core_id].local_queue);
+}
+
+/**
+ * Is the core's deque drained by an AP of its own (not the BSP tick)?
+ */
+bool parallel_core_is_ap_driven(uint32_t core_id) {
+    return g_core_schedulers && core_id < MAX_CORES && core_id < g_engine_stats.total_cores &&
+           g_core_schedulers[core_id].ap_driven;
+}
+
+/**
+ * Processors executing parallel tasks: the BSP plus every attached AP
+ */
+uint32_t parallel_worker_count(void) {
+    uint32_t workers = 1;
+    for (uint32_t core_id = 1; core_id < g_engine_stats.total_cores && core_id < MAX_CORES; core_id++) {
+        if (g_core_schedulers && g_core_schedulers[core_id].ap_driven) workers++;
+    }
+    return workers;
+}
+
+/**
+ * Per-core scheduler loop, run by each application processor with
+ * interrupts disabled. Never returns.
+ */
+void parallel_core_loop(uint32_t core_id) {
+    if (core_id >= MAX_CORES || core_id >= g_engine_stats.total_cores || !g_core_schedulers) {
+        for (;;) __asm__ volatile("hlt");
+    }
+    
+    for (;;) {
+        if (!parallel_core_run_one(core_id)) {
+            g_core_schedulers[core_id].idle_time++;
+            // No parallel work: run any preemptive tasks queued on this
+            // CPU, then its fibers
+            task_cpu_run();
+            fiber_run_pending();
+            cpu_relax();
         }
     }
 }
 
+/**
+ * Run queued work for the calling processor while it waits on results
+ * the engine is computing; without this a waiter on a core nobody else
+ * drains would wait forever. Returns false if there was nothing to run.
+ */
+bool parallel_help(void) {
+    if (!g_core_schedulers) return false;
+    
+    uint32_t cpu = smp_current_cpu();
+    if (cpu < MAX_CORES && cpu < g_engine_stats.total_cores && g_core_schedulers[cpu].ap_driven) {
+        return parallel_core_run_one(cpu);
+    }
+    if (cpu == 0) {
+        return parallel_tick_cores() > 0;
+    }
+    return false;
+}
+
 /**
  * Get next task for a core
  */
@@ -278,31 +526,41 @@ parallel_task_t* parallel_get_next_task(uint32_t core_id) {
     if (core_id >= MAX_CORES) return NULL;
     
     core_scheduler_t* scheduler = &g_core_schedulers[core_id];
-    return work_queue_pop(&scheduler->local_queue);
+    parallel_task_t* task = work_queue_pop(&scheduler->local_queue);
+    
+    // Pull in anything other cores posted, then retry
+    if (!task && work_queue_drain_inbox(&scheduler->local_queue) > 0) {
+        task = work_queue_pop(&scheduler->local_queue);
+    }
+    return task;
 }
 
 /**
  * Execute a task on specified core
  */
 void parallel_execute_task(parallel_task_t* task, uint32_t core_id) {
-    (void)core_id; // Suppress unused parameter warning
-    if (!task || !task->function) return;
+    if (!task) return;
     
     task->state = PARALLEL_TASK_RUNNING;
     
-    // Record start time (simplified)
-    task->start_time = g_engine_stats.total_cpu_cycles;
+    task->start_time = ktime_get_cycles();
     
-    // Execute the task function
-    task->function(task->data);
+    // Execute the task function (graph join points may have none)
+    if (task->function) {
+        task->function(task->data);
+    }
     
-    // Record end time
-    task->end_time = g_engine_stats.total_cpu_cycles + 100;  // Simulate execution time
+    task->end_time = ktime_get_cycles();
     task->cpu_cycles_used = task->end_time - task->start_time;
     
     task->state = PARALLEL_TASK_COMPLETED;
     
     g_engine_stats.total_cpu_cycles += task->cpu_cycles_used;
+    
+    // Last: the hook may free the task or let its owner do so
+    if (task->on_complete) {
+        task->on_complete(task, core_id);
+    }
 }
 
 /**
@@ -336,8 +594,9 @@ uint32_t calculate_core_load(uint32_t core_id) {
     work_queue_t* queue = &scheduler->local_queue;
     
     // Simple load calculation based on queue size
-    uint32_t queue_size = (queue->tail - queue->head) & queue->mask;
-    return (queue_size * 100) / queue->capacity;
+    uint32_t queue_size = work_queue_size(queue);
+    if (queue_size >= WORK_QUEUE_SIZE) return 100;
+    return (queue_size * 100) / WORK_QUEUE_SIZE;
 }
 
 /**
@@ -385,8 +644,7 @@ void adaptive_load_balance(void) {
                     // Migrate task if possible (simplified)
                     parallel_task_t* task = work_queue_steal(&g_core_schedulers[i].local_queue);
                     if (task) {
-                        work_queue_push(&g_core_schedulers[j].local_queue, task);
-                        task->assigned_core = j;
+                        migrate_task(task, i, j);
                         break;
                     }
                 }
@@ -405,65 +663,219 @@ parallel_task_t* work_stealing_attempt(uint32_t stealing_core, uint32_t victim_c
 }
 
 /**
- * Push task to work queue
+ * Move an already-dequeued task to another core
+ */
+void migrate_task(parallel_task_t* task, uint32_t from_core, uint32_t to_core) {
+    (void)from_core;
+    if (!task || to_core >= MAX_CORES || to_core >= g_engine_stats.total_cores) return;
+    
+    task->assigned_core = to_core;
+    work_queue_t* queue = &g_core_schedulers[to_core].local_queue;
+    uint32_t flags = parallel_irq_save();
+    if (parallel_core_is_local(to_core)) {
+        work_queue_push(queue, task);
+    } else {
+        work_queue_post(queue, task);
+    }
+    parallel_irq_restore(flags);
+}
+
+static work_queue_buffer_t* work_queue_alloc_buffer(uint32_t capacity) {
+    work_queue_buffer_t* buffer = (work_queue_buffer_t*)heap_alloc(
+        sizeof(work_queue_buffer_t) + capacity * sizeof(parallel_task_t*));
+    if (!buffer) return NULL;
+    
+    buffer->capacity = capacity;
+    buffer->mask = capacity - 1;
+    buffer->retired = NULL;
+    return buffer;
+}
+
+/**
+ * Initialize a deque; capacity is rounded up to a power of two
+ */
+bool work_queue_init(work_queue_t* queue, uint32_t initial_capacity) {
+    if (!queue) return false;
+    
+    uint32_t capacity = 16;
+    while (capacity < initial_capacity) capacity <<= 1;
+    
+    queue->top = 0;
+    queue->bottom = 0;
+    queue->inbox = NULL;
+    queue->buffer = work_queue_alloc_buffer(capacity);
+    return queue->buffer != NULL;
+}
+
+/**
+ * Free a deque's buffer and every buffer it has outgrown. Only once no
+ * core can still steal from it.
+ */
+void work_queue_destroy(work_queue_t* queue) {
+    if (!queue) return;
+    
+    work_queue_buffer_t* buffer = queue->buffer;
+    while (buffer) {
+        work_queue_buffer_t* retired = buffer->retired;
+        heap_free(buffer);
+        buffer = retired;
+    }
+    queue->buffer = NULL;
+    queue->top = 0;
+    queue->bottom = 0;
+}
+
+/**
+ * Double the buffer (owner only). The old buffer stays reachable through
+ * 'retired' because a concurrent thief may still read a slot from it;
+ * the live range [top, bottom) is identical in both.
+ */
+static work_queue_buffer_t* work_queue_grow(work_queue_t* queue, work_queue_buffer_t* old,
+                                            uint32_t top, uint32_t bottom) {
+    work_queue_buffer_t* grown = work_queue_alloc_buffer(old->capacity * 2);
+    if (!grown) return NULL;
+    
+    for (uint32_t i = top; i != bottom; i++) {
+        grown->slots[i & grown->mask] = old->slots[i & old->mask];
+    }
+    grown->retired = old;
+    
+    atomic_store_u32((volatile uint32_t*)&queue->buffer, (uint32_t)grown);
+    return grown;
+}
+
+/**
+ * Push task at the bottom (owner only)
  */
 void work_queue_push(work_queue_t* queue, parallel_task_t* task) {
     if (!queue || !task) return;
     
-    uint32_t tail = atomic_load(&queue->tail);
-    uint32_t next_tail = (tail + 1) & queue->mask;
+    uint32_t bottom = queue->bottom;
+    uint32_t top = atomic_load_u32(&queue->top);
+    work_queue_buffer_t* buffer = queue->buffer;
     
-    // Check if queue is full
-    if (next_tail == atomic_load(&queue->head)) {
-        return;  // Queue full
+    if ((int32_t)(bottom - top) >= (int32_t)buffer->capacity) {
+        buffer = work_queue_grow(queue, buffer, top, bottom);
+        if (!buffer) {
+            SERIAL_LOG("PARALLEL: work queue grow failed, task dropped\n");
+            return;
+        }
     }
     
-    queue->tasks[tail] = task;
-    atomic_store(&queue->tail, next_tail);
+    buffer->slots[bottom & buffer->mask] = task;
+    
+    // TSO keeps the slot store ahead of the bottom store
+    atomic_store_u32(&queue->bottom, bottom + 1);
 }
 
 /**
- * Pop task from work queue (local end)
+ * Pop task from the bottom (owner only)
  */
 parallel_task_t* work_queue_pop(work_queue_t* queue) {
-    if (!queue) return NULL;
+    if (!queue || !queue->buffer) return NULL;
     
-    uint32_t head = atomic_load(&queue->head);
-    uint32_t tail = atomic_load(&queue->tail);
+    uint32_t bottom = queue->bottom - 1;
+    work_queue_buffer_t* buffer = queue->buffer;
+    queue->bottom = bottom;
     
-    if (head == tail) {
-        return NULL;  // Queue empty
+    // Publish the reservation before looking at top (store->load)
+    atomic_fence();
+    uint32_t top = atomic_load_u32(&queue->top);
+    
+    int32_t size = (int32_t)(bottom - top);
+    if (size < 0) {
+        // Empty
+        atomic_store_u32(&queue->bottom, top);
+        return NULL;
     }
     
-    parallel_task_t* task = queue->tasks[head];
-    atomic_store(&queue->head, (head + 1) & queue->mask);
+    parallel_task_t* task = buffer->slots[bottom & buffer->mask];
+    if (size > 0) {
+        return task;
+    }
     
+    // Last element: race thieves for it through top
+    if (atomic_cmpxchg_u32(&queue->top, top, top + 1) != top) {
+        task = NULL;
+    }
+    atomic_store_u32(&queue->bottom, top + 1);
     return task;
 }
 
 /**
- * Steal task from work queue (remote end)
+ * Steal task from the top (any core)
  */
 parallel_task_t* work_queue_steal(work_queue_t* queue) {
     if (!queue) return NULL;
     
-    uint32_t tail = atomic_load(&queue->tail);
-    uint32_t head = atomic_load(&queue->head);
+    uint32_t top = atomic_load_u32(&queue->top);
+    uint32_t bottom = atomic_load_u32(&queue->bottom);
     
-    if (head >= tail) {
-        return NULL;  // Queue empty or being modified
+    if ((int32_t)(bottom - top) <= 0) {
+        return NULL;  // Empty
     }
     
-    // Try to steal from tail end
-    uint32_t new_tail = (tail - 1) & queue->mask;
-    parallel_task_t* task = queue->tasks[new_tail];
+    work_queue_buffer_t* buffer = queue->buffer;
+    parallel_task_t* task = buffer->slots[top & buffer->mask];
     
-    // Atomic compare-exchange to ensure we got the task
-    if (atomic_compare_exchange(&queue->tail, tail, new_tail)) {
-        return task;
+    // Claim the slot; losing means the owner or another thief took it
+    if (atomic_cmpxchg_u32(&queue->top, top, top + 1) != top) {
+        return NULL;
+    }
+    
+    return task;
+}
+
+/**
+ * Post a task from a non-owner core; picked up by the owner on its next
+ * work_queue_drain_inbox()
+ */
+void work_queue_post(work_queue_t* queue, parallel_task_t* task) {
+    if (!queue || !task) return;
+    
+    parallel_task_t* head;
+    do {
+        head = queue->inbox;
+        task->next = head;
+    } while (atomic_cmpxchg_ptr((void* volatile*)&queue->inbox, head, task) != head);
+}
+
+/**
+ * Move posted tasks into the deque (owner only). Returns the count moved.
+ */
+uint32_t work_queue_drain_inbox(work_queue_t* queue) {
+    if (!queue || !queue->inbox) return 0;
+    
+    parallel_task_t* list = (parallel_task_t*)atomic_xchg_ptr((void* volatile*)&queue->inbox, NULL);
+    
+    // The inbox is LIFO; reverse so posts run in submission order
+    parallel_task_t* ordered = NULL;
+    while (list) {
+        parallel_task_t* next = list->next;
+        list->next = ordered;
+        ordered = list;
+        list = next;
     }
     
-    return NULL;  // Failed to steal
+    uint32_t moved = 0;
+    while (ordered) {
+        parallel_task_t* next = ordered->next;
+        ordered->next = NULL;
+        work_queue_push(queue, ordered);
+        ordered = next;
+        moved++;
+    }
+    return moved;
+}
+
+/**
+ * Approximate number of queued tasks (racy snapshot)
+ */
+uint32_t work_queue_size(work_queue_t* queue) {
+    if (!queue) return 0;
+    
+    int32_t size = (int32_t)(atomic_load_u32(&queue->bottom) - atomic_load_u32(&queue->top));
+    return size > 0 ? (uint32_t)size : 0;
 }
 
 /**
@@ -473,28 +885,21 @@ parallel_engine_stats_t* parallel_get_engine_stats(void) {
     return &g_engine_stats;
 }
 
-// Atomic operations (simplified implementations)
+// Atomic operations (thin wrappers over core/atomic.h)
 uint32_t atomic_compare_exchange(volatile uint32_t* ptr, uint32_t expected, uint32_t desired) {
-    // Simplified - would use actual atomic instructions
-    if (*ptr == expected) {
-        *ptr = desired;
-        return expected;
-    }
-    return *ptr;
+    return atomic_cmpxchg_u32(ptr, expected, desired);
 }
 
 uint32_t atomic_fetch_add(volatile uint32_t* ptr, uint32_t value) {
-    uint32_t old = *ptr;
-    *ptr += value;
-    return old;
+    return atomic_xadd_u32(ptr, value);
 }
 
 uint32_t atomic_load(volatile uint32_t* ptr) {
-    return *ptr;
+    return atomic_load_u32(ptr);
 }
 
 void atomic_store(volatile uint32_t* ptr, uint32_t value) {
-    *ptr = value;
+    atomic_store_u32(ptr, value);
 }
 
 /**
@@ -549,5 +954,6 @@ bool parallel_is_core_busy(uint32_t core_id) {
     
     // Core is busy if it has a current task or pending work
     return (scheduler->current_task != NULL) || 
-           (atomic_load(&scheduler->local_queue.head) != atomic_load(&scheduler->local_queue.tail));
+           (work_queue_size(&scheduler->local_queue) > 0) ||
+           (scheduler->local_queue.inbox != NULL);
 }
\ No newline at end of file
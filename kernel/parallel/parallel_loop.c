@@ -0,0 +1,193 @@
+/**
+ * QARMA - Data-parallel loops
+ *
+ * parallel_for/parallel_reduce with lazy binary range splitting
+ * (see parallel/parallel_loop.h).
+ */
+
+#include "parallel_loop.h"
+#include "core/kernel.h"
+#include "core/memory/object_cache.h"
+#include "core/smp.h"
+#include "core/atomic.h"
+#include "core/ktime.h"
+
+// One call; lives on the caller's stack until every range has run
+typedef struct parallel_loop {
+    parallel_for_fn_t body;             // parallel_for
+    parallel_reduce_fn_t reduce;        // parallel_reduce
+    parallel_combine_fn_t combine;
+    void* ctx;
+    uint64_t identity;
+    volatile uint64_t result;           // Partial results combined so far
+    uint32_t grain;                     // Smallest chunk; ranges under 2x stay whole
+    uint32_t chunk_cycles;              // Target chunk length, 0 without a TSC
+    bool can_split;                     // Someone else could run a split-off range
+    volatile uint32_t pending;          // Split-off ranges not yet completed
+} parallel_loop_t;
+
+// A split-off range, run as an engine task
+typedef struct {
+    parallel_task_t task;
+    parallel_loop_t* loop;
+    uint32_t begin;
+    uint32_t end;
+} parallel_range_t;
+
+static object_cache_t* g_range_cache = NULL;
+static parallel_loop_stats_t g_loop_stats = {0};
+
+static void parallel_range_run(parallel_loop_t* loop, uint32_t begin, uint32_t end);
+
+void parallel_loop_init(void) {
+    if (!g_range_cache) {
+        g_range_cache = object_cache_create("parallel_range_t", sizeof(parallel_range_t), 16, NULL);
+    }
+}
+
+static void parallel_range_task(void* data) {
+    parallel_range_t* range = (parallel_range_t*)data;
+    parallel_range_run(range->loop, range->begin, range->end);
+}
+
+/**
+ * Completion hook: the engine is done with the range, so it can go
+ * back to the cache before the caller is told
+ */
+static void parallel_range_done(parallel_task_t* task, uint32_t core_id) {
+    (void)core_id;
+    parallel_range_t* range = (parallel_range_t*)task->data;
+    parallel_loop_t* loop = range->loop;
+
+    object_cache_free(g_range_cache, range);
+    atomic_dec_u32(&loop->pending);
+}
+
+/**
+ * Give [begin, end) away as a task on the calling processor's core
+ */
+static bool parallel_range_spawn(parallel_loop_t* loop, uint32_t begin, uint32_t end, uint32_t core) {
+    parallel_range_t* range = (parallel_range_t*)object_cache_alloc(g_range_cache);
+    if (!range) return false;
+
+    memset(&range->task, 0, sizeof(parallel_task_t));
+    range->task.function = parallel_range_task;
+    range->task.data = range;
+    range->task.on_complete = parallel_range_done;
+    range->task.state = PARALLEL_TASK_READY;
+    range->task.priority = PARALLEL_PRIORITY_NORMAL;
+    memcpy(range->task.name, "parallel_range", sizeof("parallel_range"));
+    range->loop = loop;
+    range->begin = begin;
+    range->end = end;
+
+    atomic_inc_u32(&loop->pending);
+    atomic_inc_u32(&g_loop_stats.splits);
+    if (core != UINT32_MAX) {
+        parallel_task_submit_on(&range->task, core);
+    } else {
+        parallel_task_submit(&range->task);
+    }
+    return true;
+}
+
+static void parallel_loop_combine(parallel_loop_t* loop, uint64_t partial) {
+    for (;;) {
+        uint64_t seen = atomic_load_u64(&loop->result);
+        uint64_t merged = loop->combine(seen, partial, loop->ctx);
+        if (atomic_cmpxchg_u64(&loop->result, seen, merged) == seen) return;
+    }
+}
+
+/**
+ * Work through a range chunk by chunk, splitting off the upper half
+ * whenever this core's deque has run dry
+ */
+static void parallel_range_run(parallel_loop_t* loop, uint32_t begin, uint32_t end) {
+    uint32_t core = parallel_current_core();
+    uint32_t chunk = loop->grain;
+    uint64_t acc = loop->identity;
+
+    while (begin < end) {
+        if (loop->can_split && (end - begin) / 2 >= loop->grain &&
+            (core == UINT32_MAX || parallel_core_queue_size(core) == 0)) {
+            uint32_t mid = begin + (end - begin) / 2;
+            if (parallel_range_spawn(loop, mid, end, core)) {
+                end = mid;
+            }
+        }
+
+        uint32_t stop = end - begin > chunk ? begin + chunk : end;
+        uint64_t start = ktime_get_cycles();
+        if (loop->body) {
+            loop->body(begin, stop, loop->ctx);
+        } else {
+            acc = loop->reduce(begin, stop, acc, loop->ctx);
+        }
+        atomic_inc_u32(&g_loop_stats.chunks);
+
+        // Short chunks: check for idle cores less often
+        if (loop->chunk_cycles && ktime_get_cycles() - start < loop->chunk_cycles &&
+            chunk < 0x80000000u) {
+            chunk *= 2;
+        }
+        begin = stop;
+    }
+
+    if (loop->reduce) {
+        parallel_loop_combine(loop, acc);
+    }
+}
+
+/**
+ * Run the whole range from the caller, then help until the split-off
+ * ranges are done
+ */
+static void parallel_loop_run(parallel_loop_t* loop, uint32_t begin, uint32_t end, uint32_t grain) {
+    uint32_t workers = parallel_worker_count();
+
+    if (grain == PARALLEL_GRAIN_AUTO) {
+        grain = (end - begin) / (workers * PARALLEL_LOOP_SPLITS_PER_WORKER);
+    }
+    loop->grain = grain ? grain : 1;
+    loop->chunk_cycles = ktime_tsc_khz() * PARALLEL_LOOP_CHUNK_US / 1000;
+    loop->can_split = g_range_cache != NULL && workers > 1;
+    loop->pending = 0;
+    loop->result = loop->identity;
+    g_loop_stats.loops++;
+
+    parallel_range_run(loop, begin, end);
+
+    while (atomic_load_u32(&loop->pending)) {
+        if (!parallel_help()) {
+            cpu_relax();
+        }
+    }
+}
+
+void parallel_for(uint32_t begin, uint32_t end, uint32_t grain,
+                  parallel_for_fn_t fn, void* ctx) {
+    if (!fn || begin >= end) return;
+
+    parallel_loop_t loop = {0};
+    loop.body = fn;
+    loop.ctx = ctx;
+    parallel_loop_run(&loop, begin, end, grain);
+}
+
+uint64_t parallel_reduce(uint32_t begin, uint32_t end, uint32_t grain, uint64_t identity,
+                         parallel_reduce_fn_t fn, parallel_combine_fn_t combine, void* ctx) {
+    if (!fn || !combine || begin >= end) return identity;
+
+    parallel_loop_t loop = {0};
+    loop.reduce = fn;
+    loop.combine = combine;
+    loop.ctx = ctx;
+    loop.identity = identity;
+    parallel_loop_run(&loop, begin, end, grain);
+    return loop.result;
+}
+
+parallel_loop_stats_t* parallel_loop_get_stats(void) {
+    return &g_loop_stats;
+}
@@ -0,0 +1,156 @@
+/**
+ * QARMA - Data-parallel Loop Test
+ *
+ * Fills a framebuffer-sized buffer with parallel_for and checksums it
+ * with parallel_reduce, against serial loops over the same data. Every
+ * index must be visited exactly once and the sums must match; a nested
+ * parallel_for inside a loop body checks that joins help rather than
+ * wait on work only they could run. Meant to be run under multi-CPU
+ * QEMU as well (make run QEMU_CPUS=8).
+ */
+
+#include "parallel_loop.h"
+#include "graphics/graphics.h"
+#include "core/memory/heap.h"
+#include "core/ktime.h"
+#include "config.h"
+
+#define PFOR_TEST_WIDTH         640
+#define PFOR_TEST_HEIGHT        480
+#define PFOR_TEST_PIXELS        (PFOR_TEST_WIDTH * PFOR_TEST_HEIGHT)
+#define PFOR_TEST_NESTED        64
+
+static uint32_t* g_pixels;
+static uint8_t* g_visits;
+
+static inline uint32_t pfor_test_pattern(uint32_t i) {
+    return (i * 2654435761u) ^ (i >> 3);
+}
+
+static void pfor_test_fill(uint32_t begin, uint32_t end, void* ctx) {
+    (void)ctx;
+    for (uint32_t i = begin; i < end; i++) {
+        g_pixels[i] = pfor_test_pattern(i);
+        g_visits[i]++;
+    }
+}
+
+static uint64_t pfor_test_sum(uint32_t begin, uint32_t end, uint64_t acc, void* ctx) {
+    (void)ctx;
+    for (uint32_t i = begin; i < end; i++) {
+        acc += g_pixels[i];
+    }
+    return acc;
+}
+
+static uint64_t pfor_test_add(uint64_t a, uint64_t b, void* ctx) {
+    (void)ctx;
+    return a + b;
+}
+
+// Each row of the nested test is itself a parallel_for over its pixels
+static void pfor_test_row(uint32_t begin, uint32_t end, void* ctx) {
+    (void)ctx;
+    for (uint32_t row = begin; row < end; row++) {
+        parallel_for(row * PFOR_TEST_WIDTH, (row + 1) * PFOR_TEST_WIDTH,
+                     PFOR_TEST_NESTED, pfor_test_fill, NULL);
+    }
+}
+
+static uint32_t pfor_test_us(uint64_t cycles) {
+    return (uint32_t)ktime_to_us(ktime_cycles_to_ns(cycles));
+}
+
+/**
+ * Check every pixel was written once with the right value
+ */
+static uint32_t pfor_test_verify(const char* label, uint32_t expected_visits) {
+    uint32_t wrong = 0;
+    for (uint32_t i = 0; i < PFOR_TEST_PIXELS; i++) {
+        if (g_visits[i] != expected_visits || g_pixels[i] != pfor_test_pattern(i)) wrong++;
+    }
+
+    gfx_print(label);
+    gfx_print(": wrong=");
+    gfx_print_decimal(wrong);
+    gfx_print(wrong ? "  FAIL\n" : "  OK\n");
+    return wrong;
+}
+
+void parallel_loop_test(void) {
+    gfx_print("\n=== Parallel Loop Test ===\n");
+    gfx_print("Pixels: ");
+    gfx_print_decimal(PFOR_TEST_PIXELS);
+    gfx_print("  workers: ");
+    gfx_print_decimal(parallel_worker_count());
+    gfx_print("\n");
+
+    g_pixels = (uint32_t*)heap_alloc(PFOR_TEST_PIXELS * sizeof(uint32_t));
+    g_visits = (uint8_t*)heap_zalloc(PFOR_TEST_PIXELS);
+    if (!g_pixels || !g_visits) {
+        gfx_print("  ERROR: buffer allocation failed\n");
+        if (g_pixels) heap_free(g_pixels);
+        if (g_visits) heap_free(g_visits);
+        return;
+    }
+
+    uint32_t errors = 0;
+    parallel_loop_stats_t* stats = parallel_loop_get_stats();
+
+    // Serial baselines
+    uint64_t start = ktime_get_cycles();
+    pfor_test_fill(0, PFOR_TEST_PIXELS, NULL);
+    uint64_t serial_fill = ktime_get_cycles() - start;
+    start = ktime_get_cycles();
+    uint64_t serial_sum = pfor_test_sum(0, PFOR_TEST_PIXELS, 0, NULL);
+    uint64_t serial_reduce = ktime_get_cycles() - start;
+
+    // Fill
+    memset(g_visits, 0, PFOR_TEST_PIXELS);
+    memset(g_pixels, 0, PFOR_TEST_PIXELS * sizeof(uint32_t));
+    uint32_t splits = stats->splits;
+    start = ktime_get_cycles();
+    parallel_for(0, PFOR_TEST_PIXELS, PARALLEL_GRAIN_AUTO, pfor_test_fill, NULL);
+    uint64_t parallel_fill = ktime_get_cycles() - start;
+    errors += pfor_test_verify("  for", 1);
+    gfx_print("    serial ");
+    gfx_print_decimal(pfor_test_us(serial_fill));
+    gfx_print("us, parallel ");
+    gfx_print_decimal(pfor_test_us(parallel_fill));
+    gfx_print("us, splits ");
+    gfx_print_decimal(stats->splits - splits);
+    gfx_print("\n");
+
+    // Checksum
+    splits = stats->splits;
+    start = ktime_get_cycles();
+    uint64_t sum = parallel_reduce(0, PFOR_TEST_PIXELS, PARALLEL_GRAIN_AUTO, 0,
+                                   pfor_test_sum, pfor_test_add, NULL);
+    uint64_t parallel_sum = ktime_get_cycles() - start;
+    gfx_print(sum == serial_sum ? "  reduce: OK\n" : "  reduce: mismatch  FAIL\n");
+    errors += sum == serial_sum ? 0 : 1;
+    gfx_print("    serial ");
+    gfx_print_decimal(pfor_test_us(serial_reduce));
+    gfx_print("us, parallel ");
+    gfx_print_decimal(pfor_test_us(parallel_sum));
+    gfx_print("us, splits ");
+    gfx_print_decimal(stats->splits - splits);
+    gfx_print("\n");
+
+    // Nested loops, fixed grain
+    parallel_for(0, PFOR_TEST_HEIGHT, 4, pfor_test_row, NULL);
+    errors += pfor_test_verify("  nested", 2);
+
+    // Ranges too small to split
+    uint64_t small = parallel_reduce(7, 8, 16, 0, pfor_test_sum, pfor_test_add, NULL);
+    uint64_t empty = parallel_reduce(8, 8, 16, 5, pfor_test_sum, pfor_test_add, NULL);
+    bool edges_ok = small == g_pixels[7] && empty == 5;
+    gfx_print(edges_ok ? "  edges: OK\n" : "  edges: FAIL\n");
+    errors += edges_ok ? 0 : 1;
+
+    heap_free(g_pixels);
+    heap_free(g_visits);
+
+    gfx_print(errors ? "Parallel loop test FAILED\n" : "Parallel loop test passed\n");
+    SERIAL_LOG(errors ? "PFOR_TEST: FAILED\n" : "PFOR_TEST: passed\n");
+}
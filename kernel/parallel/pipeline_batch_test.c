@@ -0,0 +1,252 @@
+/**
+ * QARMA - Pipeline Batch Test
+ *
+ * Runs numbered items through a chain of fine-grained glyphs with
+ * pipeline_execute_batch(), once calling each glyph per item and once
+ * through its batch entry point, and prints the cost per item of both.
+ * Also checks that failed items are dropped in order, that a run
+ * resumed from a checkpoint matches an uninterrupted one, that batch
+ * sizes follow the cost of a node's items, and that nodes that do not
+ * map a pointer to a pointer are refused.
+ */
+
+#include "execution_pipeline.h"
+#include "graphics/graphics.h"
+#include "core/memory/heap.h"
+#include "core/ktime.h"
+#include "config.h"
+
+#define BATCH_TEST_ITEMS        16384
+#define BATCH_TEST_NODES        8
+#define BATCH_TEST_SLOW_WORK    20000   // Spins per item in the slow glyph
+
+static void* batch_test_increment(void* input) {
+    return (void*)((uint32_t)input + 1);
+}
+
+static void batch_test_increment_batch(void* const* inputs, void** outputs, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        outputs[i] = (void*)((uint32_t)inputs[i] + 1);
+    }
+}
+
+// Drops odd items
+static void* batch_test_even(void* input) {
+    return ((uint32_t)input & 1) ? NULL : input;
+}
+
+static void* batch_test_slow(void* input) {
+    volatile uint32_t x = (uint32_t)input;
+    for (uint32_t i = 0; i < BATCH_TEST_SLOW_WORK; i++) {
+        x = x * 1103515245u + 12345u;
+    }
+    (void)x;
+    return input;
+}
+
+static glyph_function_t func_increment = {
+    .semantic_name = "test.increment",
+    .signature = SIG_PTR_TO_PTR,
+    .func_ptr = batch_test_increment,
+    .version_id = 1,
+    .estimated_cycles = 4,
+    .is_resumable = false,
+    .is_idempotent = true
+};
+
+static glyph_function_t func_increment_batch = {
+    .semantic_name = "test.increment_batch",
+    .signature = SIG_PTR_TO_PTR,
+    .func_ptr = batch_test_increment,
+    .batch_ptr = batch_test_increment_batch,
+    .version_id = 1,
+    .estimated_cycles = 1,
+    .is_resumable = false,
+    .is_idempotent = true
+};
+
+static glyph_function_t func_even = {
+    .semantic_name = "test.even",
+    .signature = SIG_PTR_TO_PTR,
+    .func_ptr = batch_test_even,
+    .version_id = 1,
+    .estimated_cycles = 4,
+    .is_resumable = false,
+    .is_idempotent = true
+};
+
+// Registered as int func(void*): must not be called per item
+static glyph_function_t func_not_ptr = {
+    .semantic_name = "test.not_ptr",
+    .signature = SIG_PTR_TO_INT,
+    .func_ptr = batch_test_increment,
+    .version_id = 1,
+    .estimated_cycles = 4,
+    .is_resumable = false,
+    .is_idempotent = true
+};
+
+static glyph_function_t func_slow = {
+    .semantic_name = "test.slow",
+    .signature = SIG_PTR_TO_PTR,
+    .func_ptr = batch_test_slow,
+    .version_id = 1,
+    .estimated_cycles = BATCH_TEST_SLOW_WORK * 4,
+    .is_resumable = false,
+    .is_idempotent = true
+};
+
+static uint32_t batch_test_check(const char* label, bool ok) {
+    gfx_print("  ");
+    gfx_print(label);
+    gfx_print(ok ? ": OK\n" : ": FAIL\n");
+    return ok ? 0 : 1;
+}
+
+static execution_pipeline_t* batch_test_chain(glyph_function_t* func, uint32_t nodes) {
+    execution_pipeline_t* pipeline = pipeline_create(0);
+    for (uint32_t i = 0; pipeline && i < nodes; i++) {
+        pipeline_add_node(pipeline, func);
+    }
+    return pipeline;
+}
+
+static bool batch_test_outputs_ok(void** outputs, uint32_t count, uint32_t offset) {
+    for (uint32_t i = 0; i < count; i++) {
+        if ((uint32_t)outputs[i] != i + 1 + offset) return false;
+    }
+    return true;
+}
+
+/**
+ * Time the chain per item and per batch; the outputs must match
+ */
+static uint32_t batch_test_overhead(void** inputs, void** outputs) {
+    uint32_t errors = 0;
+    glyph_function_t* funcs[2] = { &func_increment, &func_increment_batch };
+    const char* labels[2] = { "  per item:  ", "  per batch: " };
+
+    for (uint32_t i = 0; i < 2; i++) {
+        execution_pipeline_t* pipeline = batch_test_chain(funcs[i], BATCH_TEST_NODES);
+        if (!pipeline) return 1;
+
+        uint32_t produced = 0;
+        pipeline_execute_batch(pipeline, inputs, outputs, BATCH_TEST_ITEMS, &produced);   // Warm up
+        bool ok = pipeline_execute_batch(pipeline, inputs, outputs, BATCH_TEST_ITEMS, &produced);
+        ok = ok && produced == BATCH_TEST_ITEMS &&
+             batch_test_outputs_ok(outputs, produced, BATCH_TEST_NODES);
+
+        uint64_t ns = ktime_cycles_to_ns(pipeline->total_cycles);
+        gfx_print(labels[i]);
+        gfx_print_decimal((uint32_t)ktime_div_u32(ns, BATCH_TEST_ITEMS * BATCH_TEST_NODES));
+        gfx_print(" ns per item per node\n");
+
+        errors += batch_test_check(i ? "batch entry point" : "item entry point", ok);
+        pipeline_destroy(pipeline);
+    }
+    return errors;
+}
+
+static uint32_t batch_test_errors(void** inputs, void** outputs) {
+    execution_pipeline_t* pipeline = batch_test_chain(&func_even, 1);
+    if (!pipeline) return 1;
+
+    uint32_t produced = 0;
+    bool ok = !pipeline_execute_batch(pipeline, inputs, outputs, BATCH_TEST_ITEMS, &produced) &&
+              pipeline->has_error && produced == BATCH_TEST_ITEMS / 2 &&
+              pipeline->head->stats.errors == BATCH_TEST_ITEMS / 2;
+
+    // Inputs start at 1, so the evens are 2, 4, ...
+    for (uint32_t i = 0; ok && i < produced; i++) {
+        if ((uint32_t)outputs[i] != 2 * (i + 1)) ok = false;
+    }
+    pipeline_destroy(pipeline);
+    return batch_test_check("failed items dropped in order", ok);
+}
+
+/**
+ * Stop halfway, then carry on from the checkpoint
+ */
+static uint32_t batch_test_resume(void** inputs, void** outputs) {
+    execution_pipeline_t* pipeline = batch_test_chain(&func_increment_batch, BATCH_TEST_NODES);
+    if (!pipeline) return 1;
+
+    bool ok = pipeline_set_checkpoint_interval(pipeline, 4, 0);
+    uint32_t produced = 0;
+    ok = ok && pipeline_execute_batch(pipeline, inputs, outputs, BATCH_TEST_ITEMS / 2, &produced);
+    uint32_t taken = pipeline->checkpoints_taken;
+    ok = ok && taken > 1 && pipeline->batch_checkpoint->items_done == BATCH_TEST_ITEMS / 2 &&
+         pipeline_resume_batch(pipeline, pipeline->batch_checkpoint, inputs, outputs,
+                               BATCH_TEST_ITEMS, &produced);
+    ok = ok && produced == BATCH_TEST_ITEMS &&
+         batch_test_outputs_ok(outputs, produced, BATCH_TEST_NODES);
+
+    gfx_print("  checkpoints: ");
+    gfx_print_decimal(pipeline->checkpoints_taken);
+    gfx_print("\n");
+    pipeline_destroy(pipeline);
+    return batch_test_check("resume from checkpoint", ok);
+}
+
+static uint32_t batch_test_adaptive(void** inputs, void** outputs) {
+    execution_pipeline_t* pipeline = pipeline_create(0);
+    if (!pipeline) return 1;
+    pipeline_add_node(pipeline, &func_increment);
+    pipeline_add_node(pipeline, &func_slow);
+
+    uint32_t produced = 0;
+    bool ok = pipeline_execute_batch(pipeline, inputs, outputs, PIPELINE_BATCH_MAX * 4, &produced);
+    pipeline_print_stage_stats(pipeline);
+
+    // Without a TSC rate batches keep their initial size
+    uint32_t fast = pipeline->head->batch_size;
+    uint32_t slow = pipeline->head->next->batch_size;
+    if (ktime_tsc_khz()) {
+        ok = ok && fast == PIPELINE_BATCH_MAX && slow < fast;
+    }
+    pipeline_destroy(pipeline);
+    return batch_test_check("adaptive batch sizes", ok);
+}
+
+static uint32_t batch_test_signature(void** inputs, void** outputs) {
+    execution_pipeline_t* pipeline = pipeline_create(0);
+    if (!pipeline) return 1;
+    pipeline_add_node(pipeline, &func_increment);
+    pipeline_add_node(pipeline, &func_not_ptr);
+
+    uint32_t produced = 0;
+    bool ok = !pipeline_execute_batch(pipeline, inputs, outputs, BATCH_TEST_ITEMS, &produced) &&
+              !pipeline_stream(pipeline, inputs, outputs, BATCH_TEST_ITEMS, &produced) &&
+              produced == 0 && pipeline->head->stats.batches == 0 && !pipeline->is_running;
+    pipeline_destroy(pipeline);
+    return batch_test_check("non-pointer node refused", ok);
+}
+
+void pipeline_batch_test(void) {
+    gfx_print("\n=== Pipeline Batch Test ===\n");
+
+    void** inputs = (void**)heap_alloc(sizeof(void*) * BATCH_TEST_ITEMS);
+    void** outputs = (void**)heap_alloc(sizeof(void*) * BATCH_TEST_ITEMS);
+    if (!inputs || !outputs) {
+        if (inputs) heap_free(inputs);
+        if (outputs) heap_free(outputs);
+        gfx_print("Out of memory\n");
+        return;
+    }
+    for (uint32_t i = 0; i < BATCH_TEST_ITEMS; i++) {
+        inputs[i] = (void*)(i + 1);
+    }
+
+    uint32_t errors = 0;
+    errors += batch_test_overhead(inputs, outputs);
+    errors += batch_test_errors(inputs, outputs);
+    errors += batch_test_resume(inputs, outputs);
+    errors += batch_test_adaptive(inputs, outputs);
+    errors += batch_test_signature(inputs, outputs);
+
+    heap_free(outputs);
+    heap_free(inputs);
+
+    gfx_print(errors ? "Pipeline batch test FAILED\n" : "Pipeline batch test passed\n");
+    SERIAL_LOG(errors ? "PIPELINE_BATCH_TEST: FAILED\n" : "PIPELINE_BATCH_TEST: passed\n");
+}
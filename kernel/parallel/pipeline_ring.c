@@ -0,0 +1,78 @@
+/**
+ * QARMA - Single-producer single-consumer ring
+ *
+ * Also built for the host by `make bench-pipeline`, so it depends on
+ * nothing but the atomic helpers.
+ */
+
+#include "pipeline_ring.h"
+#include "core/atomic.h"
+
+bool pipeline_ring_init(pipeline_ring_t* ring, void** slots, uint32_t capacity) {
+    if (!ring || !slots || capacity < 2 || (capacity & (capacity - 1)) != 0) {
+        return false;
+    }
+
+    ring->head = 0;
+    ring->tail_cache = 0;
+    ring->full_stalls = 0;
+    ring->tail = 0;
+    ring->head_cache = 0;
+    ring->empty_stalls = 0;
+    ring->slots = slots;
+    ring->mask = capacity - 1;
+    return true;
+}
+
+uint32_t pipeline_ring_push(pipeline_ring_t* ring, void* const* items, uint32_t count) {
+    uint32_t head = ring->head;
+    uint32_t capacity = ring->mask + 1;
+    uint32_t room = capacity - (head - ring->tail_cache);
+
+    // Looks full: see how far the consumer has got
+    if (room < count) {
+        ring->tail_cache = atomic_load_u32(&ring->tail);
+        room = capacity - (head - ring->tail_cache);
+        if (room == 0) {
+            ring->full_stalls++;
+            return 0;
+        }
+    }
+
+    if (count > room) count = room;
+    for (uint32_t i = 0; i < count; i++) {
+        ring->slots[(head + i) & ring->mask] = items[i];
+    }
+
+    // Publish after the slots are written
+    atomic_store_u32(&ring->head, head + count);
+    return count;
+}
+
+uint32_t pipeline_ring_pop(pipeline_ring_t* ring, void** items, uint32_t max) {
+    uint32_t tail = ring->tail;
+    uint32_t available = ring->head_cache - tail;
+
+    // Looks empty: see what the producer has published
+    if (available < max) {
+        ring->head_cache = atomic_load_u32(&ring->head);
+        available = ring->head_cache - tail;
+        if (available == 0) {
+            ring->empty_stalls++;
+            return 0;
+        }
+    }
+
+    if (max > available) max = available;
+    for (uint32_t i = 0; i < max; i++) {
+        items[i] = ring->slots[(tail + i) & ring->mask];
+    }
+
+    // Hand the slots back after they are read
+    atomic_store_u32(&ring->tail, tail + max);
+    return max;
+}
+
+uint32_t pipeline_ring_count(const pipeline_ring_t* ring) {
+    return atomic_load_u32(&ring->head) - atomic_load_u32(&ring->tail);
+}
@@ -0,0 +1,302 @@
+/**
+ * QARMA - Task Graphs
+ *
+ * Dependency tracking for the parallel engine: nodes are parallel tasks,
+ * edges make a task wait for its predecessors (see parallel/task_graph.h).
+ */
+
+#include "task_graph.h"
+#include "core/kernel.h"
+#include "graphics/graphics.h"
+#include "core/memory/heap.h"
+#include "core/smp.h"
+#include "core/atomic.h"
+#include "core/ktime.h"
+#include "config.h"
+
+#define GRAPH_ARRAY_MIN 4
+
+/**
+ * Make room for one more element in an array holding 'count'. Capacity
+ * doubles from GRAPH_ARRAY_MIN, so the count alone says when it is full.
+ */
+static bool graph_array_reserve(void** array, uint32_t count, size_t elem_size) {
+    if (count != 0 && (count < GRAPH_ARRAY_MIN || (count & (count - 1)) != 0)) {
+        return true;
+    }
+
+    uint32_t capacity = count ? count * 2 : GRAPH_ARRAY_MIN;
+    void* grown = heap_alloc(capacity * elem_size);
+    if (!grown) return false;
+
+    if (count) {
+        memcpy(grown, *array, count * elem_size);
+        heap_free(*array);
+    }
+    *array = grown;
+    return true;
+}
+
+/**
+ * Create an empty graph
+ */
+parallel_graph_t* parallel_graph_create(const char* name) {
+    parallel_graph_t* graph = (parallel_graph_t*)heap_zalloc(sizeof(parallel_graph_t));
+    if (!graph) return NULL;
+
+    size_t name_len = strlen(name);
+    if (name_len >= sizeof(graph->name)) {
+        name_len = sizeof(graph->name) - 1;
+    }
+    memcpy(graph->name, name, name_len);
+    graph->name[name_len] = '\0';
+    return graph;
+}
+
+/**
+ * Free a graph and its nodes. A launched graph still running is left
+ * alone: its nodes are in the engine's queues.
+ */
+void parallel_graph_destroy(parallel_graph_t* graph) {
+    if (!graph) return;
+
+    if (graph->launched && !atomic_load_u32(&graph->done)) {
+        SERIAL_LOG("GRAPH: destroy of a running graph ignored\n");
+        return;
+    }
+
+    for (uint32_t i = 0; i < graph->node_count; i++) {
+        parallel_task_destroy(graph->nodes[i]);
+    }
+    if (graph->nodes) heap_free(graph->nodes);
+    heap_free(graph);
+}
+
+/**
+ * Add a task to the graph; it runs once all its predecessors have
+ */
+parallel_task_t* parallel_graph_add_node(parallel_graph_t* graph, const char* name,
+                                         void (*function)(void*), void* data) {
+    if (!graph || graph->launched) return NULL;
+
+    if (!graph_array_reserve((void**)&graph->nodes, graph->node_count, sizeof(parallel_task_t*))) {
+        return NULL;
+    }
+
+    parallel_task_t* task = parallel_task_create(name, function, data, 0);
+    if (!task) return NULL;
+
+    task->graph = graph;
+    task->on_complete = parallel_graph_task_done;
+    graph->nodes[graph->node_count++] = task;
+    return task;
+}
+
+/**
+ * Make 'after' wait for 'before'. Both must be nodes of the graph; an
+ * edge added twice counts once.
+ */
+bool parallel_graph_add_edge(parallel_graph_t* graph, parallel_task_t* before,
+                             parallel_task_t* after) {
+    if (!graph || graph->launched || !before || !after || before == after) return false;
+    if (before->graph != graph || after->graph != graph) return false;
+
+    for (uint32_t i = 0; i < before->dependent_count; i++) {
+        if (before->dependents[i] == after) return true;
+    }
+
+    if (!graph_array_reserve((void**)&before->dependents, before->dependent_count,
+                             sizeof(parallel_task_t*)) ||
+        !graph_array_reserve((void**)&after->dependencies, after->dependency_count,
+                             sizeof(uint32_t))) {
+        return false;
+    }
+
+    before->dependents[before->dependent_count++] = after;
+    after->dependencies[after->dependency_count++] = before->task_id;
+    graph->edge_count++;
+    return true;
+}
+
+/**
+ * Make a graph node wait for another node of the same graph, by task ID
+ */
+void parallel_task_add_dependency(parallel_task_t* task, uint32_t dependency_id) {
+    if (!task || !task->graph) return;
+
+    parallel_graph_t* graph = task->graph;
+    for (uint32_t i = 0; i < graph->node_count; i++) {
+        if (graph->nodes[i]->task_id == dependency_id) {
+            parallel_graph_add_edge(graph, graph->nodes[i], task);
+            return;
+        }
+    }
+}
+
+/**
+ * Have all of a task's predecessors completed?
+ */
+bool parallel_task_is_ready(parallel_task_t* task) {
+    if (!task) return false;
+    return atomic_load_u32(&task->completed_dependencies) >= task->dependency_count;
+}
+
+/**
+ * Kahn's algorithm over a scratch stack, counting in the nodes' own
+ * completed_dependencies: a cycle leaves some node never ready
+ */
+static bool parallel_graph_is_acyclic(parallel_graph_t* graph) {
+    parallel_task_t** ready = (parallel_task_t**)heap_alloc(graph->node_count * sizeof(parallel_task_t*));
+    if (!ready) return false;
+
+    uint32_t top = 0;
+    for (uint32_t i = 0; i < graph->node_count; i++) {
+        graph->nodes[i]->completed_dependencies = 0;
+        if (graph->nodes[i]->dependency_count == 0) {
+            ready[top++] = graph->nodes[i];
+        }
+    }
+
+    uint32_t visited = 0;
+    while (top) {
+        parallel_task_t* task = ready[--top];
+        visited++;
+        for (uint32_t i = 0; i < task->dependent_count; i++) {
+            parallel_task_t* next = task->dependents[i];
+            if (++next->completed_dependencies == next->dependency_count) {
+                ready[top++] = next;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < graph->node_count; i++) {
+        graph->nodes[i]->completed_dependencies = 0;
+    }
+    heap_free(ready);
+    return visited == graph->node_count;
+}
+
+/**
+ * Freeze the graph and submit its roots
+ */
+bool parallel_graph_launch(parallel_graph_t* graph) {
+    if (!graph || graph->launched || graph->node_count == 0) return false;
+
+    if (!parallel_graph_is_acyclic(graph)) {
+        SERIAL_LOG("GRAPH: cycle, not launched\n");
+        return false;
+    }
+
+    graph->launched = true;
+    graph->remaining = graph->node_count;
+    graph->done = 0;
+    for (uint32_t i = 0; i < graph->node_count; i++) {
+        parallel_task_t* task = graph->nodes[i];
+        task->state = task->dependency_count ? PARALLEL_TASK_WAITING : PARALLEL_TASK_READY;
+    }
+    graph->start_cycles = ktime_get_cycles();
+    atomic_fence();
+
+    // Roots spread out like any submission; the rest follow their predecessors
+    for (uint32_t i = 0; i < graph->node_count; i++) {
+        if (graph->nodes[i]->dependency_count == 0) {
+            parallel_task_submit(graph->nodes[i]);
+        }
+    }
+    return true;
+}
+
+/**
+ * A node completed on a core: release the successors it was the last
+ * predecessor of onto that core, then account for the node. Once the
+ * last node is accounted for the graph may be freed, so nothing touches
+ * it afterwards.
+ */
+void parallel_graph_task_done(parallel_task_t* task, uint32_t core_id) {
+    parallel_graph_t* graph = task->graph;
+
+    for (uint32_t i = 0; i < task->dependent_count; i++) {
+        parallel_task_t* next = task->dependents[i];
+        if (atomic_xadd_u32(&next->completed_dependencies, 1) + 1 == next->dependency_count) {
+            next->state = PARALLEL_TASK_READY;
+            parallel_task_submit_on(next, core_id);
+        }
+    }
+
+    if (atomic_dec_and_test_u32(&graph->remaining)) {
+        graph->end_cycles = ktime_get_cycles();
+        atomic_store_u32(&graph->done, 1);
+    }
+}
+
+bool parallel_graph_is_done(parallel_graph_t* graph) {
+    return graph && atomic_load_u32(&graph->done);
+}
+
+/**
+ * Wait for every node to complete, running queued tasks meanwhile
+ */
+bool parallel_graph_wait(parallel_graph_t* graph, uint32_t timeout_ms) {
+    if (!graph || !graph->launched) return false;
+
+    ktime_t deadline = timeout_ms ? ktime_get() + (uint64_t)timeout_ms * NSEC_PER_MSEC : 0;
+    while (!atomic_load_u32(&graph->done)) {
+        if (deadline && ktime_get() >= deadline) return false;
+        if (!parallel_help()) {
+            cpu_relax();
+        }
+    }
+    return true;
+}
+
+bool parallel_graph_run(parallel_graph_t* graph, uint32_t timeout_ms) {
+    return parallel_graph_launch(graph) && parallel_graph_wait(graph, timeout_ms);
+}
+
+/**
+ * Print a finished graph's shape and timing. Parallelism is the node
+ * time summed over the wall time from launch to the last completion.
+ */
+void parallel_graph_print(parallel_graph_t* graph) {
+    if (!graph) return;
+
+    uint64_t work = 0;
+    for (uint32_t i = 0; i < graph->node_count; i++) {
+        work += graph->nodes[i]->cpu_cycles_used;
+    }
+
+    gfx_print("Graph ");
+    gfx_print(graph->name);
+    gfx_print(": ");
+    gfx_print_decimal(graph->node_count);
+    gfx_print(" nodes, ");
+    gfx_print_decimal(graph->edge_count);
+    gfx_print(" edges");
+
+    if (!parallel_graph_is_done(graph)) {
+        gfx_print(graph->launched ? ", running\n" : ", not launched\n");
+        return;
+    }
+
+    uint64_t span = graph->end_cycles - graph->start_cycles;
+    gfx_print(", ");
+    gfx_print_decimal((uint32_t)ktime_to_us(ktime_cycles_to_ns(span)));
+    gfx_print("us wall, ");
+    gfx_print_decimal((uint32_t)ktime_to_us(ktime_cycles_to_ns(work)));
+    gfx_print("us work");
+
+    // Work/span ratio in hundredths, scaled down until it fits a divisor
+    while (span >> 25) {
+        span >>= 1;
+        work >>= 1;
+    }
+    if (span) {
+        uint32_t ratio = (uint32_t)ktime_div_u32(work * 100, (uint32_t)span);
+        gfx_print(", parallelism ");
+        gfx_print_decimal(ratio / 100);
+        gfx_print(".");
+        if (ratio % 100 < 10) gfx_print("0");
+        gfx_print_decimal(ratio % 100);
+    }
+    gfx_print("\n");
+}
@@ -0,0 +1,252 @@
+/**
+ * QARMA - Work Queue Stress Test
+ *
+ * Hammers the Chase-Lev deque with the BSP as owner (push/pop at the
+ * bottom) while every started AP steals from the top, then pushes a
+ * batch through the full engine. Each item records how many times it
+ * ran; any count other than exactly one is a lost or duplicated task.
+ * Meant to be run under multi-CPU QEMU (make run QEMU_CPUS=8).
+ */
+
+#include "parallel_engine.h"
+#include "graphics/graphics.h"
+#include "core/smp.h"
+#include "core/atomic.h"
+#include "core/timer.h"
+#include "core/memory/heap.h"
+#include "config.h"
+
+#define WQ_TEST_ITEMS           4096
+#define WQ_TEST_ROUNDS          4
+#define WQ_TEST_INITIAL_CAP     16      // Small on purpose: forces growth under contention
+#define WQ_TEST_TIMEOUT_TICKS   500     // ~5 s at 100 Hz
+
+// Heap-allocated for the duration of the test
+static parallel_task_t* g_items;
+static volatile uint32_t* g_run_count;
+static volatile uint32_t g_executed = 0;
+static volatile uint32_t g_engine_done = 0;     // Items the engine has finished with
+static volatile uint32_t g_stolen = 0;
+static volatile uint32_t g_thieves_started = 0;
+static volatile uint32_t g_thieves_running = 0;
+static volatile uint32_t g_stop = 0;
+static work_queue_t g_test_queue;
+
+static void wq_test_item(void* data) {
+    uint32_t index = (uint32_t)data;
+    atomic_inc_u32(&g_run_count[index]);
+    atomic_inc_u32(&g_executed);
+}
+
+// Runs after the engine's last access to the item
+static void wq_test_item_done(parallel_task_t* task, uint32_t core_id) {
+    (void)task;
+    (void)core_id;
+    atomic_inc_u32(&g_engine_done);
+}
+
+/**
+ * Long-running task placed on each AP: steal from the test deque until
+ * the owner says stop
+ */
+static void wq_test_thief(void* data) {
+    (void)data;
+    atomic_inc_u32(&g_thieves_started);
+
+    while (!atomic_load_u32(&g_stop)) {
+        parallel_task_t* task = work_queue_steal(&g_test_queue);
+        if (task) {
+            task->function(task->data);
+            atomic_inc_u32(&g_stolen);
+        } else {
+            cpu_relax();
+        }
+    }
+
+    atomic_dec_u32(&g_thieves_running);
+}
+
+static bool wq_test_core_has_ap(uint32_t core) {
+    smp_cpu_t* cpu = smp_get_cpu(core);
+    return core != 0 && core < get_cpu_core_count() && cpu && cpu->online;
+}
+
+static bool wq_test_wait(volatile uint32_t* value, uint32_t target) {
+    uint32_t start = get_ticks();
+    while (atomic_load_u32(value) != target) {
+        if (get_ticks() - start > WQ_TEST_TIMEOUT_TICKS) return false;
+        cpu_relax();
+    }
+    return true;
+}
+
+static void wq_test_reset_items(void) {
+    for (uint32_t i = 0; i < WQ_TEST_ITEMS; i++) {
+        memset(&g_items[i], 0, sizeof(parallel_task_t));
+        g_items[i].task_id = i;
+        g_items[i].function = wq_test_item;
+        g_items[i].data = (void*)i;
+        g_items[i].on_complete = wq_test_item_done;
+        g_run_count[i] = 0;
+    }
+    g_executed = 0;
+    g_engine_done = 0;
+}
+
+/**
+ * Check every item ran exactly once; prints and returns the error count
+ */
+static uint32_t wq_test_verify(const char* label) {
+    uint32_t lost = 0, duplicated = 0;
+    for (uint32_t i = 0; i < WQ_TEST_ITEMS; i++) {
+        if (g_run_count[i] == 0) lost++;
+        else if (g_run_count[i] > 1) duplicated++;
+    }
+
+    gfx_print(label);
+    gfx_print(": executed=");
+    gfx_print_decimal(g_executed);
+    gfx_print(" lost=");
+    gfx_print_decimal(lost);
+    gfx_print(" duplicated=");
+    gfx_print_decimal(duplicated);
+    gfx_print(lost || duplicated ? "  FAIL\n" : "  OK\n");
+    return lost + duplicated;
+}
+
+/**
+ * Phase 1: owner push/pop against concurrent thieves
+ */
+static uint32_t wq_test_deque_round(uint32_t round, uint32_t thieves) {
+    wq_test_reset_items();
+    g_stolen = 0;
+    g_stop = 0;
+    g_thieves_started = 0;
+    g_thieves_running = thieves;
+
+    if (!work_queue_init(&g_test_queue, WQ_TEST_INITIAL_CAP)) {
+        gfx_print("  ERROR: deque allocation failed\n");
+        return 1;
+    }
+
+    // One thief per AP-driven core
+    for (uint32_t core = 1; core < smp_cpu_count(); core++) {
+        if (!wq_test_core_has_ap(core)) continue;
+        parallel_task_t* thief = parallel_task_create("wq_thief", wq_test_thief, NULL, 0);
+        if (thief) {
+            parallel_task_submit_on(thief, core);
+        } else {
+            atomic_dec_u32(&g_thieves_running);
+        }
+    }
+    wq_test_wait(&g_thieves_started, thieves);
+
+    // Owner: bursts of pushes with interleaved pops, varying the pattern per round
+    uint32_t pop_every = 2 + round;
+    for (uint32_t i = 0; i < WQ_TEST_ITEMS; i++) {
+        work_queue_push(&g_test_queue, &g_items[i]);
+        if (i % pop_every == 0) {
+            parallel_task_t* task = work_queue_pop(&g_test_queue);
+            if (task) task->function(task->data);
+        }
+    }
+
+    parallel_task_t* task;
+    while ((task = work_queue_pop(&g_test_queue)) != NULL) {
+        task->function(task->data);
+    }
+
+    // Thieves may still be running the last items they stole
+    bool complete = wq_test_wait(&g_executed, WQ_TEST_ITEMS);
+
+    atomic_store_u32(&g_stop, 1);
+    bool stopped = wq_test_wait(&g_thieves_running, 0);
+
+    gfx_print("  round ");
+    gfx_print_decimal(round);
+    gfx_print(" stolen=");
+    gfx_print_decimal(g_stolen);
+    gfx_print(" capacity=");
+    gfx_print_decimal(g_test_queue.buffer->capacity);
+    if (!complete) gfx_print(" (timed out)");
+    gfx_print("\n");
+
+    uint32_t errors = wq_test_verify("  deque");
+
+    // A thief that never stopped may still read the buffers
+    if (stopped) {
+        work_queue_destroy(&g_test_queue);
+    } else {
+        errors++;
+    }
+    return errors;
+}
+
+/**
+ * Phase 2: end-to-end through parallel_task_submit and the core loops
+ */
+static uint32_t wq_test_engine(void) {
+    wq_test_reset_items();
+
+    for (uint32_t i = 0; i < WQ_TEST_ITEMS; i++) {
+        parallel_task_submit(&g_items[i]);
+    }
+
+    // The BSP drains the cores that have no AP behind them
+    uint32_t start = get_ticks();
+    while (atomic_load_u32(&g_engine_done) != WQ_TEST_ITEMS) {
+        parallel_engine_tick();
+        if (get_ticks() - start > WQ_TEST_TIMEOUT_TICKS) {
+            gfx_print("  engine timed out\n");
+            break;
+        }
+    }
+
+    return wq_test_verify("  engine");
+}
+
+void work_queue_stress_test(void) {
+    gfx_print("\n=== Work Queue Stress Test ===\n");
+
+    // Thieves need a processor of their own
+    uint32_t thieves = 0;
+    for (uint32_t core = 1; core < smp_cpu_count(); core++) {
+        if (wq_test_core_has_ap(core)) thieves++;
+    }
+
+    gfx_print("Items: ");
+    gfx_print_decimal(WQ_TEST_ITEMS);
+    gfx_print("  thieves (APs): ");
+    gfx_print_decimal(thieves);
+    gfx_print("\n");
+    if (thieves == 0) {
+        gfx_print("No APs online; deque races are not exercised\n");
+    }
+
+    g_items = (parallel_task_t*)heap_alloc(sizeof(parallel_task_t) * WQ_TEST_ITEMS);
+    g_run_count = (volatile uint32_t*)heap_alloc(sizeof(uint32_t) * WQ_TEST_ITEMS);
+    if (!g_items || !g_run_count) {
+        if (g_items) heap_free(g_items);
+        if (g_run_count) heap_free((void*)g_run_count);
+        gfx_print("Out of memory\n");
+        return;
+    }
+
+    uint32_t errors = 0;
+    for (uint32_t round = 0; round < WQ_TEST_ROUNDS; round++) {
+        errors += wq_test_deque_round(round, thieves);
+    }
+    errors += wq_test_engine();
+
+    // Items still queued somewhere would be freed under a core's feet
+    if (atomic_load_u32(&g_thieves_running) == 0 &&
+        atomic_load_u32(&g_engine_done) == WQ_TEST_ITEMS) {
+        heap_free(g_items);
+        heap_free((void*)g_run_count);
+    }
+    g_items = NULL;
+    g_run_count = NULL;
+
+    gfx_print(errors ? "Work queue stress test FAILED\n" : "Work queue stress test passed\n");
+    SERIAL_LOG(errors ? "WQ_TEST: FAILED\n" : "WQ_TEST: passed\n");
+}
@@ -69,16 +69,17 @@ LoginScreen* login_screen_create(void) {
     login.main_window->y = y;
     login.main_window->size.width = LOGIN_WINDOW_WIDTH;
     login.main_window->size.height = LOGIN_WINDOW_HEIGHT;
+    login.main_window->flags |= QARMA_FLAG_OPAQUE;  // Render fills the whole buffer
     
-    // Reallocate pixel buffer with correct size using heap_alloc (20MB heap, not 1MB malloc heap)
-    extern void* heap_alloc(size_t size);
+    // Reallocate pixel buffer with correct size from the kernel heap (not the 1MB malloc heap)
+    extern void* heap_zalloc(size_t size);
     extern void heap_free(void* ptr);
     
     if (login.main_window->pixel_buffer) {
         heap_free(login.main_window->pixel_buffer);
     }
     size_t buffer_size = LOGIN_WINDOW_WIDTH * LOGIN_WINDOW_HEIGHT * sizeof(uint32_t);
-    login.main_window->pixel_buffer = heap_alloc(buffer_size);
+    login.main_window->pixel_buffer = heap_zalloc(buffer_size);
     if (!login.main_window->pixel_buffer) {
         SERIAL_LOG("[LOGIN] Failed to allocate pixel buffer\n");
         return NULL;
@@ -30,11 +30,12 @@ QARMA_WIN_HANDLE* qarma_win_create(QARMA_WIN_TYPE type, const char* title, uint3
     static QARMA_WIN_VTABLE empty_vtable = {0};
     win->vtable = &empty_vtable;
     win->traits = NULL;   // No traits attached
+    win->dirty = true;    // Render before the first compose
     
     // Allocate pixel buffer for window using heap_alloc (20MB heap)
-    extern void* heap_alloc(size_t size);
+    extern void* heap_zalloc(size_t size);
     size_t buffer_size = win->size.width * win->size.height * sizeof(uint32_t);
-    win->pixel_buffer = heap_alloc(buffer_size);
+    win->pixel_buffer = heap_zalloc(buffer_size);
     if (!win->pixel_buffer) {
         SERIAL_LOG("[WINFACTORY] Failed to allocate pixel buffer\n");
         free(win);
@@ -20,7 +20,7 @@ void quantum_adaptive_init(QARMA_QUANTUM_REGISTER* reg, quantum_adaptive_policy_
     if (!reg) return;
     
     if (!reg->adaptive_state) {
-        reg->adaptive_state = (quantum_adaptive_state_t*)heap_alloc(sizeof(quantum_adaptive_state_t));
+        reg->adaptive_state = (quantum_adaptive_state_t*)heap_zalloc(sizeof(quantum_adaptive_state_t));
         if (!reg->adaptive_state) {
             SERIAL_LOG("Warning: Failed to allocate adaptive state\n");
             return;
@@ -8,6 +8,7 @@
 #include "quantum/quantum_register.h"
 #include "core/memory.h"
 #include "core/memory/heap.h"
+#include "core/ktime.h"
 #include "config.h"
 
 // Global observer instance
@@ -156,7 +157,7 @@ quantum_workload_profile_t quantum_ai_profile_register(QARMA_QUANTUM_REGISTER* r
     
     for (uint32_t i = 0; i < reg->count; i++) {
         if (reg->qubits[i].status == QUBIT_STATUS_COMPLETED) {
-            uint32_t duration = reg->qubits[i].end_time - reg->qubits[i].start_time;
+            uint32_t duration = (uint32_t)ktime_to_ms(reg->qubits[i].end_time - reg->qubits[i].start_time);
             total_time += duration;
             completed++;
         }
@@ -169,7 +170,7 @@ quantum_workload_profile_t quantum_ai_profile_register(QARMA_QUANTUM_REGISTER* r
         uint32_t variance_sum = 0;
         for (uint32_t i = 0; i < reg->count; i++) {
             if (reg->qubits[i].status == QUBIT_STATUS_COMPLETED) {
-                uint32_t duration = reg->qubits[i].end_time - reg->qubits[i].start_time;
+                uint32_t duration = (uint32_t)ktime_to_ms(reg->qubits[i].end_time - reg->qubits[i].start_time);
                 int32_t diff = (int32_t)duration - (int32_t)profile.avg_execution_time;
                 variance_sum += (diff * diff);
             }
@@ -7,7 +7,9 @@
 #include "quantum/quantum_register.h"
 #include "core/memory.h"
 #include "core/memory/heap.h"
+#include "core/memory/object_cache.h"
 #include "core/core_manager.h"
+#include "core/ktime.h"
 #include "parallel/parallel_engine.h"
 #include "graphics/graphics.h"
 #include "config.h"
@@ -46,6 +48,16 @@ static void qubit_free_result(QARMA_QUBIT* qubit) {
     }
 }
 
+/**
+ * Account a finished qubit; the last one completes the register's future
+ */
+static void qubit_finished(QARMA_QUANTUM_REGISTER* reg, volatile uint32_t* counter) {
+    __sync_fetch_and_add(counter, 1);
+    if (qarma_quantum_is_complete(reg)) {
+        future_complete(reg->completion, reg);
+    }
+}
+
 /**
  * Completion callback structure for tracking qubit execution
  */
@@ -54,6 +66,8 @@ typedef struct {
     QARMA_QUANTUM_REGISTER* reg;
 } qubit_context_t;
 
+static object_cache_t* g_qubit_ctx_cache = NULL;
+
 /**
  * Wrapper function for qubit execution
  * This is what actually gets dispatched to CPU cores via parallel task system
@@ -68,22 +82,22 @@ static void qubit_execute_wrapper(void* context) {
     
     // Mark as running
     qubit->status = QUBIT_STATUS_RUNNING;
-    qubit->start_time = 0; // TODO: Get actual timestamp from parallel engine
+    qubit->start_time = ktime_get();
     
     // Execute the qubit's function
     qubit->function(qubit->data);
     
     // Mark as completed
-    qubit->end_time = 0; // TODO: Get actual timestamp
+    qubit->end_time = ktime_get();
     qubit->status = QUBIT_STATUS_COMPLETED;
     
     // Update register's completion count atomically
     if (ctx->reg) {
-        __sync_fetch_and_add(&ctx->reg->completed_count, 1);
+        qubit_finished(ctx->reg, &ctx->reg->completed_count);
     }
     
     // Free the context
-    heap_free(ctx);
+    object_cache_free(g_qubit_ctx_cache, ctx);
 }
 
 // ============================================================================
@@ -125,7 +139,8 @@ QARMA_QUANTUM_REGISTER* qarma_quantum_register_create(uint32_t qubit_count) {
     reg->executing = false;
     reg->completed_count = 0;
     reg->failed_count = 0;
-    reg->lock = 0;
+    spin_lock_init(&reg->lock, "quantum_register");
+    reg->completion = NULL;
     
     // Initialize all qubits to disabled/pending
     for (uint32_t i = 0; i < qubit_count; i++) {
@@ -157,6 +172,7 @@ void qarma_quantum_register_destroy(QARMA_QUANTUM_REGISTER* reg) {
         heap_free(reg->collapse_output);
     }
     
+    future_put(reg->completion);
     heap_free(reg);
 }
 
@@ -267,11 +283,35 @@ void qarma_quantum_set_wait_all(QARMA_QUANTUM_REGISTER* reg, bool wait_all) {
 // ============================================================================
 
 bool qarma_quantum_execute(QARMA_QUANTUM_REGISTER* reg) {
-    if (!reg || reg->executing) {
+    if (!reg) {
+        return false;
+    }
+    
+    // Each execution settles a future of its own
+    future_t* completion = future_create();
+    if (!completion) {
+        return false;
+    }
+    
+    uint32_t flags = spin_lock_irqsave(&reg->lock);
+    bool busy = reg->executing;
+    future_t* previous = NULL;
+    if (!busy) {
+        reg->executing = true;
+        previous = reg->completion;
+        reg->completion = completion;
+    }
+    spin_unlock_irqrestore(&reg->lock, flags);
+    if (busy) {
+        future_put(completion);
         return false;
     }
+    future_put(previous);
+    
+    if (!g_qubit_ctx_cache) {
+        g_qubit_ctx_cache = object_cache_create("qubit_context_t", sizeof(qubit_context_t), 0, NULL);
+    }
     
-    reg->executing = true;
     reg->collapsed = false;
     reg->completed_count = 0;
     reg->failed_count = 0;
@@ -291,6 +331,11 @@ bool qarma_quantum_execute(QARMA_QUANTUM_REGISTER* reg) {
     GFX_LOG_HEX("Enabled qubits: ", enabled_count);
     GFX_LOG("\n");
     
+    // No qubit will finish to complete it
+    if (enabled_count == 0) {
+        future_complete(reg->completion, reg);
+    }
+    
     // Try to request cores from core manager for quantum subsystem
     // If this fails, parallel engine will still distribute tasks across available cores
     uint32_t cores_needed = enabled_count;
@@ -325,13 +370,13 @@ bool qarma_quantum_execute(QARMA_QUANTUM_REGISTER* reg) {
         }
         
         // Create context for this qubit
-        qubit_context_t* ctx = (qubit_context_t*)heap_alloc(sizeof(qubit_context_t));
+        qubit_context_t* ctx = (qubit_context_t*)object_cache_alloc(g_qubit_ctx_cache);
         if (!ctx) {
             GFX_LOG("Warning: Failed to allocate context for qubit ");
             GFX_LOG_HEX("", i);
             GFX_LOG("\n");
             qubit->status = QUBIT_STATUS_FAILED;
-            __sync_fetch_and_add(&reg->failed_count, 1);
+            qubit_finished(reg, &reg->failed_count);
             continue;
         }
         
@@ -374,7 +419,7 @@ bool qarma_quantum_execute(QARMA_QUANTUM_REGISTER* reg) {
             GFX_LOG("Warning: Failed to create parallel task for qubit ");
             GFX_LOG_HEX("", i);
             GFX_LOG("\n");
-            heap_free(ctx);
+            object_cache_free(g_qubit_ctx_cache, ctx);
             qubit->status = QUBIT_STATUS_FAILED;
             __sync_fetch_and_add(&reg->failed_count, 1);
         }
@@ -417,15 +462,25 @@ bool qarma_quantum_is_complete(QARMA_QUANTUM_REGISTER* reg) {
     return finished >= enabled_count;
 }
 
-bool qarma_quantum_wait(QARMA_QUANTUM_REGISTER* reg, uint32_t timeout_ms) {
-    (void)timeout_ms; // TODO: Implement timeout
+future_t* qarma_quantum_future(QARMA_QUANTUM_REGISTER* reg) {
+    if (!reg) return NULL;
     
-    // Simple spin-wait for now
-    while (!qarma_quantum_is_complete(reg)) {
-        // In real implementation, would use proper synchronization
+    uint32_t flags = spin_lock_irqsave(&reg->lock);
+    future_t* completion = future_get(reg->completion);
+    spin_unlock_irqrestore(&reg->lock, flags);
+    return completion;
+}
+
+bool qarma_quantum_wait(QARMA_QUANTUM_REGISTER* reg, uint32_t timeout_ms) {
+    future_t* completion = qarma_quantum_future(reg);
+    if (!completion) {
+        return qarma_quantum_is_complete(reg);
     }
     
-    return true;
+    // Runs queued qubit tasks, then parks until the last one finishes
+    bool done = future_wait(completion, timeout_ms);
+    future_put(completion);
+    return done;
 }
 
 // ============================================================================
@@ -449,6 +504,7 @@ void* qarma_quantum_collapse(QARMA_QUANTUM_REGISTER* reg) {
     }
     
     SERIAL_LOG("  Not collapsed yet, proceeding\n");
+    ktime_t collapse_start = ktime_get();
     
     // Ensure all qubits have completed
     if (!qarma_quantum_is_complete(reg)) {
@@ -646,6 +702,15 @@ void* qarma_quantum_collapse(QARMA_QUANTUM_REGISTER* reg) {
     }
     
     heap_free(results);
+
+    // Execution time is the sum of qubit run times, not wall-clock time
+    reg->total_execution_time = 0;
+    for (uint32_t i = 0; i < reg->count; i++) {
+        if (reg->qubits[i].status == QUBIT_STATUS_COMPLETED) {
+            reg->total_execution_time += reg->qubits[i].end_time - reg->qubits[i].start_time;
+        }
+    }
+    reg->collapse_time = ktime_get() - collapse_start;
     reg->collapsed = true;
     
     return reg->collapse_output;
@@ -1002,7 +1067,7 @@ void qarma_quantum_set_multidim(QARMA_QUANTUM_REGISTER* reg,
     
     // Allocate criteria structure if not already allocated
     if (!reg->multidim) {
-        reg->multidim = (QARMA_MULTIDIM_CRITERIA*)heap_alloc(sizeof(QARMA_MULTIDIM_CRITERIA));
+        reg->multidim = (QARMA_MULTIDIM_CRITERIA*)heap_zalloc(sizeof(QARMA_MULTIDIM_CRITERIA));
         if (!reg->multidim) return;
     }
     
@@ -1389,18 +1454,9 @@ void qarma_quantum_get_stats(QARMA_QUANTUM_REGISTER* reg, qarma_quantum_stats_t*
         }
     }
     
-    // Calculate average (cast to avoid 64-bit division on 32-bit system)
+    // Calculate average (ktime_div_u32 avoids __udivdi3 on 32-bit)
     if (stats->completed_qubits > 0) {
-        // Simple approximation to avoid __udivdi3
-        uint32_t time_hi = (uint32_t)(stats->total_execution_time >> 32);
-        uint32_t time_lo = (uint32_t)(stats->total_execution_time);
-        if (time_hi == 0) {
-            // Time fits in 32 bits, can do normal division
-            stats->avg_qubit_time = time_lo / stats->completed_qubits;
-        } else {
-            // Approximate for large times
-            stats->avg_qubit_time = 0xFFFFFFFF; // Max value
-        }
+        stats->avg_qubit_time = ktime_div_u32(stats->total_execution_time, stats->completed_qubits);
     }
 }
 
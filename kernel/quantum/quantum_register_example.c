@@ -13,6 +13,7 @@
 #include "core/memory/heap.h"
 #include "graphics/graphics.h"
 #include "core/memory.h"
+#include "core/ktime.h"
 #include "config.h"
 
 // ============================================================================
@@ -346,11 +347,11 @@ void example_ai_recommended(void) {
     
     // Execute and time it
     quantum_ai_observe_start(reg);
-    uint32_t start_time = 0; // TODO: Get actual timestamp
+    ktime_t start_time = ktime_get();
     
     qarma_quantum_execute_sync(reg);
     
-    uint32_t elapsed = 1; // TODO: Calculate actual elapsed time
+    uint32_t elapsed = (uint32_t)ktime_to_ms(ktime_get() - start_time);
     float quality = 1.0f; // Assume success
     
     quantum_ai_observe_complete(reg, elapsed, quality);
@@ -4,6 +4,7 @@
 
 #include "quantum/quantum_scheduler.h"
 #include "core/memory/heap.h"
+#include "core/ktime.h"
 #include "config.h"
 
 // Global scheduler state
@@ -63,7 +64,7 @@ void quantum_scheduler_predict(QARMA_QUANTUM_REGISTER* reg) {
         heap_free(g_scheduler.predictions);
     }
     
-    g_scheduler.predictions = (qubit_prediction_t*)heap_alloc(
+    g_scheduler.predictions = (qubit_prediction_t*)heap_zalloc(
         sizeof(qubit_prediction_t) * reg->count);
     
     if (!g_scheduler.predictions) {
@@ -198,7 +199,7 @@ void quantum_scheduler_learn(QARMA_QUANTUM_REGISTER* reg) {
         
         if (qubit->status != QUBIT_STATUS_COMPLETED) continue;
         
-        uint32_t actual_time = qubit->end_time - qubit->start_time;
+        uint32_t actual_time = (uint32_t)ktime_to_ms(qubit->end_time - qubit->start_time);
         qubit_prediction_t* pred = &g_scheduler.predictions[i];
         
         // Calculate error
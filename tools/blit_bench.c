@@ -0,0 +1,152 @@
+/**
+ * QARMA - Host benchmark for the span blitter
+ *
+ * Links kernel/graphics/blit.c and kernel/core/string.c (symbols prefixed
+ * with k_, built with the kernel's -mno-sse flags) against the host libc and
+ * reports megapixels per second for a window-sized surface with different
+ * alpha layouts. The float per-pixel blend the compositor used before is
+ * the baseline. Span results are checked against the exact integer kernel
+ * before timing. Build and run with `make bench-blit`.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+void k_blit_span_over(uint32_t* dst, const uint32_t* src, uint32_t count);
+void k_blit_span_fill(uint32_t* dst, uint32_t color, uint32_t count);
+void k_blit_rect_over(uint32_t* dst, uint32_t dst_stride, const uint32_t* src,
+                      uint32_t src_stride, uint32_t width, uint32_t height);
+_Bool k_blit_set_sse2(_Bool enable);
+void k_string_init_cpu(void);
+
+#define SURFACE_WIDTH   800
+#define SURFACE_HEIGHT  600
+#define SURFACE_PIXELS  (SURFACE_WIDTH * SURFACE_HEIGHT)
+#define TARGET_PIXELS   (200u * 1000 * 1000)    // Pixels blended per measurement
+
+static uint32_t* g_src;
+static uint32_t* g_dst;
+
+// The pre-span compositor: bounds check, offset and float blend per pixel
+static void __attribute__((noinline)) float_blend_pixel(int x, int y, uint32_t src) {
+    if (x < 0 || x >= SURFACE_WIDTH || y < 0 || y >= SURFACE_HEIGHT) return;
+    uint32_t offset = y * SURFACE_WIDTH + x;
+    uint32_t dst = g_dst[offset];
+    float alpha = (src >> 24) / 255.0f;
+    uint8_t r = (uint8_t)((src & 0xFF) * alpha + (dst & 0xFF) * (1 - alpha));
+    uint8_t g = (uint8_t)(((src >> 8) & 0xFF) * alpha + ((dst >> 8) & 0xFF) * (1 - alpha));
+    uint8_t b = (uint8_t)(((src >> 16) & 0xFF) * alpha + ((dst >> 16) & 0xFF) * (1 - alpha));
+    g_dst[offset] = r | (g << 8) | (b << 16) | 0xFF000000u;
+}
+
+static void run_float(void) {
+    for (int y = 0; y < SURFACE_HEIGHT; y++) {
+        for (int x = 0; x < SURFACE_WIDTH; x++) {
+            float_blend_pixel(x, y, g_src[y * SURFACE_WIDTH + x]);
+        }
+    }
+}
+
+static void run_span(void) {
+    k_blit_rect_over(g_dst, SURFACE_WIDTH, g_src, SURFACE_WIDTH, SURFACE_WIDTH, SURFACE_HEIGHT);
+}
+
+static void run_fill(void) {
+    for (int y = 0; y < SURFACE_HEIGHT; y++) {
+        k_blit_span_fill(g_dst + y * SURFACE_WIDTH, 0x80204060u, SURFACE_WIDTH);
+    }
+}
+
+static uint32_t reference_blend(uint32_t d, uint32_t s) {
+    uint32_t a = s >> 24;
+    if (a == 0) return d;
+    if (a == 0xFF) return s;
+    uint32_t out = 0xFF000000u;
+    for (int shift = 0; shift < 24; shift += 8) {
+        uint32_t sc = (s >> shift) & 0xFF, dc = (d >> shift) & 0xFF;
+        out |= ((a * sc + (255 - a) * dc + 128) >> 8) << shift;
+    }
+    return out;
+}
+
+static void check(void) {
+    uint32_t src[300], dst[300], expected[300];
+    srand(1);
+    for (int iter = 0; iter < 20000; iter++) {
+        uint32_t n = rand() % 260, off = rand() % 8;
+        for (int i = 0; i < 300; i++) {
+            src[i] = (uint32_t)rand() ^ ((uint32_t)rand() << 16);
+            if (i % 3 == 0) src[i] &= 0x00FFFFFF;
+            if (i % 5 == 0) src[i] |= 0xFF000000;
+            dst[i] = expected[i] = (uint32_t)rand() ^ ((uint32_t)rand() << 16);
+        }
+        k_blit_span_over(dst + off, src, n);
+        for (uint32_t i = 0; i < n; i++) expected[off + i] = reference_blend(expected[off + i], src[i]);
+        if (memcmp(dst, expected, sizeof(dst))) { printf("span mismatch n=%u off=%u\n", n, off); exit(1); }
+
+        uint32_t color = (uint32_t)rand() ^ ((uint32_t)rand() << 16);
+        k_blit_span_fill(dst, color, n);
+        for (uint32_t i = 0; i < n; i++) expected[i] = reference_blend(expected[i], color);
+        if (memcmp(dst, expected, sizeof(dst))) { printf("fill mismatch n=%u\n", n); exit(1); }
+    }
+}
+
+static double measure(void (*fn)(void)) {
+    uint32_t iterations = TARGET_PIXELS / SURFACE_PIXELS;
+    struct timespec start, end;
+
+    fn();   // Warm up
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t i = 0; i < iterations; i++) fn();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    return (double)SURFACE_PIXELS * iterations / seconds / 1e6;
+}
+
+// Alpha layouts: what a shadow, a clock overlay or a normal window looks like
+static void fill_source(const char* layout) {
+    for (uint32_t i = 0; i < SURFACE_PIXELS; i++) {
+        uint32_t rgb = (i * 2654435761u) & 0x00FFFFFF;
+        uint32_t alpha;
+        if (!strcmp(layout, "opaque")) alpha = 0xFF;
+        else if (!strcmp(layout, "transparent")) alpha = 0;
+        else if (!strcmp(layout, "translucent")) alpha = 0xC0;
+        else alpha = ((i / 16) % 3 == 0) ? 0 : ((i / 16) % 3 == 1) ? 0xFF : 0x60 + (i & 0x3F);
+        g_src[i] = rgb | (alpha << 24);
+    }
+}
+
+int main(void) {
+    static const char* layouts[] = { "opaque", "transparent", "translucent", "mixed" };
+    g_src = aligned_alloc(64, SURFACE_PIXELS * sizeof(uint32_t));
+    g_dst = aligned_alloc(64, SURFACE_PIXELS * sizeof(uint32_t));
+    memset(g_dst, 0x44, SURFACE_PIXELS * sizeof(uint32_t));
+
+    k_string_init_cpu();
+    _Bool has_sse2 = k_blit_set_sse2(1);
+    for (int pass = 0; pass < 2; pass++) {
+        k_blit_set_sse2(pass == 1);
+        check();
+    }
+    printf("correctness: ok\n\n");
+
+    printf("Mpix/s         %12s %12s %12s\n", "float", "span", has_sse2 ? "span+sse2" : "-");
+    for (size_t i = 0; i < sizeof(layouts) / sizeof(layouts[0]); i++) {
+        fill_source(layouts[i]);
+        printf("%-14s %12.1f", layouts[i], measure(run_float));
+        k_blit_set_sse2(0);
+        printf(" %12.1f", measure(run_span));
+        if (has_sse2) {
+            k_blit_set_sse2(1);
+            printf(" %12.1f", measure(run_span));
+        }
+        printf("\n");
+    }
+    printf("%-14s %12s %12.1f\n", "fill 50%", "-", measure(run_fill));
+    return 0;
+}
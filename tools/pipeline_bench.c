@@ -0,0 +1,126 @@
+/**
+ * QARMA - Host benchmark for the pipeline ring
+ *
+ * Links kernel/parallel/pipeline_ring.c (symbols prefixed with k_, built
+ * with the kernel's flags) against the host libc and pthreads, and runs
+ * chains of busy stages two ways: every stage in turn on one thread, and
+ * one thread per stage connected by rings the way pipeline_stream() does
+ * it. Results are checked for order before timing is reported. On a host
+ * with at least as many cores as stages the pipelined rate should stay
+ * near the single-stage rate. Build and run with `make bench-pipeline`.
+ */
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+// pipeline_ring_t is three cache lines; the bench only passes it around
+typedef struct { _Alignas(64) unsigned char bytes[192]; } ring_t;
+
+_Bool k_pipeline_ring_init(ring_t* ring, void** slots, uint32_t capacity);
+uint32_t k_pipeline_ring_push(ring_t* ring, void* const* items, uint32_t count);
+uint32_t k_pipeline_ring_pop(ring_t* ring, void** items, uint32_t max);
+
+#define ITEMS       (1u << 18)
+#define MAX_STAGES  8
+#define RING_SIZE   256         // PIPELINE_RING_SIZE
+#define BATCH       32          // PIPELINE_BATCH_SIZE
+#define WORK        200         // Spins per item per stage
+
+static ring_t g_rings[MAX_STAGES + 1];
+static void* g_slots[MAX_STAGES + 1][RING_SIZE];
+
+static inline uintptr_t stage_fn(uintptr_t value) {
+    volatile uint32_t x = (uint32_t)value;
+    for (uint32_t i = 0; i < WORK; i++) x = x * 1103515245u + 12345u;
+    return value + 1;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double run_sequential(uint32_t stages) {
+    double start = now();
+    for (uint32_t i = 0; i < ITEMS; i++) {
+        uintptr_t v = i + 1;
+        for (uint32_t s = 0; s < stages; s++) v = stage_fn(v);
+        if (v != i + 1 + stages) { printf("sequential mismatch at %u\n", i); exit(1); }
+    }
+    return ITEMS / (now() - start);
+}
+
+// Every stage moves exactly ITEMS items, so no close signal is needed
+static void* stage_thread(void* arg) {
+    uint32_t index = (uint32_t)(uintptr_t)arg;
+    ring_t* in = &g_rings[index];
+    ring_t* out = &g_rings[index + 1];
+    void* batch[BATCH];
+
+    for (uint32_t moved = 0; moved < ITEMS;) {
+        uint32_t count = k_pipeline_ring_pop(in, batch, BATCH);
+        if (!count) { sched_yield(); continue; }
+        for (uint32_t i = 0; i < count; i++) batch[i] = (void*)stage_fn((uintptr_t)batch[i]);
+        for (uint32_t pushed = 0; pushed < count;) {
+            uint32_t n = k_pipeline_ring_push(out, batch + pushed, count - pushed);
+            if (!n) sched_yield();
+            pushed += n;
+        }
+        moved += count;
+    }
+    return NULL;
+}
+
+static double run_pipelined(uint32_t stages) {
+    pthread_t threads[MAX_STAGES];
+    for (uint32_t i = 0; i <= stages; i++) k_pipeline_ring_init(&g_rings[i], g_slots[i], RING_SIZE);
+
+    double start = now();
+    for (uint32_t i = 0; i < stages; i++) {
+        pthread_create(&threads[i], NULL, stage_thread, (void*)(uintptr_t)i);
+    }
+
+    // Feed the first ring and drain the last, like the caller of pipeline_stream()
+    uint32_t fed = 0, collected = 0;
+    void* batch[BATCH];
+    while (collected < ITEMS) {
+        uint32_t progress = 0;
+        if (fed < ITEMS) {
+            uint32_t count = ITEMS - fed < BATCH ? ITEMS - fed : BATCH;
+            for (uint32_t i = 0; i < count; i++) batch[i] = (void*)(uintptr_t)(fed + i + 1);
+            uint32_t n = k_pipeline_ring_push(&g_rings[0], batch, count);
+            fed += n;
+            progress += n;
+        }
+        uint32_t got = k_pipeline_ring_pop(&g_rings[stages], batch, BATCH);
+        for (uint32_t i = 0; i < got; i++, collected++) {
+            if ((uintptr_t)batch[i] != collected + 1 + stages) {
+                printf("pipelined mismatch at %u\n", collected);
+                exit(1);
+            }
+        }
+        if (!(progress + got)) sched_yield();
+    }
+
+    double rate = ITEMS / (now() - start);
+    for (uint32_t i = 0; i < stages; i++) pthread_join(threads[i], NULL);
+    return rate;
+}
+
+int main(void) {
+    printf("items/s     %12s %12s %8s\n", "sequential", "pipelined", "speedup");
+    for (uint32_t stages = 1; stages <= MAX_STAGES; stages *= 2) {
+        double seq = run_sequential(stages);
+        double pipe = run_pipelined(stages);
+        printf("%u stage%s %12.0f %12.0f %7.2fx\n", stages, stages == 1 ? " " : "s",
+               seq, pipe, pipe / seq);
+    }
+    return 0;
+}
@@ -0,0 +1,169 @@
+/**
+ * QARMA - Host microbenchmark for the kernel memory routines
+ *
+ * Links kernel/core/string.c (symbols prefixed with k_, built with the
+ * kernel's -mno-sse flags and STRING_HOST_BENCH) against the host libc and
+ * reports bytes per cycle for each size class: a byte loop baseline, the
+ * rep movsd/stosd paths, and the SSE2 copy path. Results are checked against
+ * the baseline before timing. Build and run with `make bench-string`.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void* k_memcpy(void* dest, const void* src, size_t num);
+void* k_memset(void* ptr, int value, size_t num);
+void* k_memmove(void* dest, const void* src, size_t num);
+int k_memcmp(const void* ptr1, const void* ptr2, size_t num);
+void* k_memchr(const void* ptr, int value, size_t num);
+void k_string_init_cpu(void);
+_Bool k_string_set_sse2(_Bool enable);
+
+#define BUFFER_BYTES    (8u << 20)
+#define TARGET_BYTES    (256u << 20)    // Bytes moved per measurement
+
+static const size_t g_sizes[] = { 8, 64, 256, 1024, 4096, 65536, 1u << 20, 4u << 20 };
+
+static inline uint64_t rdtsc(void) {
+    uint32_t lo, hi;
+    __asm__ volatile("lfence; rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static void* __attribute__((noinline)) byte_memcpy(void* dest, const void* src, size_t num) {
+    volatile uint8_t* d = dest;
+    const uint8_t* s = src;
+    while (num--) *d++ = *s++;
+    return dest;
+}
+
+static void* __attribute__((noinline)) byte_memset(void* ptr, int value, size_t num) {
+    volatile uint8_t* p = ptr;
+    while (num--) *p++ = (uint8_t)value;
+    return ptr;
+}
+
+static uint8_t* g_src;
+static uint8_t* g_dst;
+
+typedef void (*bench_fn_t)(size_t size, size_t offset);
+
+static void run_byte_copy(size_t size, size_t offset) { byte_memcpy(g_dst + offset, g_src, size); }
+static void run_copy(size_t size, size_t offset)      { k_memcpy(g_dst + offset, g_src, size); }
+static void run_byte_fill(size_t size, size_t offset) { byte_memset(g_dst + offset, 0x5A, size); }
+static void run_fill(size_t size, size_t offset)      { k_memset(g_dst + offset, 0x5A, size); }
+static void run_move(size_t size, size_t offset)      { k_memmove(g_src + offset + 1, g_src, size); }
+
+static volatile int g_sink;
+static void run_compare(size_t size, size_t offset)   { g_sink += k_memcmp(g_dst + offset, g_dst + offset, size); }
+static void run_scan(size_t size, size_t offset)      { g_sink += k_memchr(g_dst + offset, 0x11, size) != NULL; }
+
+static double measure(bench_fn_t fn, size_t size, size_t offset) {
+    uint32_t iterations = TARGET_BYTES / size;
+    if (iterations > 2000000) iterations = 2000000;
+    if (iterations < 8) iterations = 8;
+
+    fn(size, offset);   // Warm up
+    uint64_t start = rdtsc();
+    for (uint32_t i = 0; i < iterations; i++) {
+        fn(size, offset);
+    }
+    uint64_t cycles = rdtsc() - start;
+    return (double)size * iterations / (double)cycles;
+}
+
+static void check(void) {
+    uint8_t* a = malloc(1u << 16);
+    uint8_t* b = malloc(1u << 16);
+    uint8_t* c = malloc(1u << 16);
+
+    for (size_t n = 0; n < 3000; n += (n < 64 ? 1 : 37)) {
+        for (size_t off = 0; off < 20; off += 3) {
+            for (size_t i = 0; i < (1u << 16); i++) a[i] = (uint8_t)(i * 7 + n);
+            memcpy(b, a, 1u << 16);
+            memcpy(c, a, 1u << 16);
+
+            k_memcpy(b + off, a + 5, n);
+            memcpy(c + off, a + 5, n);
+            if (memcmp(b, c, 1u << 16)) { printf("memcpy mismatch n=%zu off=%zu\n", n, off); exit(1); }
+
+            k_memset(b + off, (int)n, n);
+            memset(c + off, (int)n, n);
+            if (memcmp(b, c, 1u << 16)) { printf("memset mismatch n=%zu off=%zu\n", n, off); exit(1); }
+
+            k_memmove(b + off, b + 9, n);
+            memmove(c + off, c + 9, n);
+            k_memmove(b + 40, b + off, n);
+            memmove(c + 40, c + off, n);
+            if (memcmp(b, c, 1u << 16)) { printf("memmove mismatch n=%zu off=%zu\n", n, off); exit(1); }
+
+            if (n) {
+                c[off + n - 1] ^= 0x80;
+                int expected = memcmp(b + off, c + off, n);
+                int got = k_memcmp(b + off, c + off, n);
+                if ((expected < 0) != (got < 0) || (expected == 0) != (got == 0)) {
+                    printf("memcmp mismatch n=%zu off=%zu\n", n, off);
+                    exit(1);
+                }
+                if (k_memchr(a + off, a[off + n - 1], n) != memchr(a + off, a[off + n - 1], n)) {
+                    printf("memchr mismatch n=%zu off=%zu\n", n, off);
+                    exit(1);
+                }
+            }
+        }
+    }
+
+    free(a);
+    free(b);
+    free(c);
+}
+
+static void report(const char* name, bench_fn_t fn) {
+    printf("%-14s", name);
+    for (size_t i = 0; i < sizeof(g_sizes) / sizeof(g_sizes[0]); i++) {
+        printf(" %8.2f", measure(fn, g_sizes[i], 0));
+    }
+    printf("\n");
+}
+
+int main(void) {
+    g_src = aligned_alloc(64, BUFFER_BYTES + 64);
+    g_dst = aligned_alloc(64, BUFFER_BYTES + 64);
+    memset(g_src, 0x33, BUFFER_BYTES + 64);
+    memset(g_dst, 0x44, BUFFER_BYTES + 64);
+
+    k_string_init_cpu();
+    _Bool has_sse2 = k_string_set_sse2(1);
+
+    for (int pass = 0; pass < 2; pass++) {
+        k_string_set_sse2(pass == 1);
+        check();
+    }
+    printf("correctness: ok\n\n");
+
+    printf("bytes/cycle   ");
+    for (size_t i = 0; i < sizeof(g_sizes) / sizeof(g_sizes[0]); i++) {
+        if (g_sizes[i] >= (1u << 20)) printf(" %6zuMB", g_sizes[i] >> 20);
+        else if (g_sizes[i] >= 1024) printf(" %6zuKB", g_sizes[i] >> 10);
+        else printf(" %7zuB", g_sizes[i]);
+    }
+    printf("\n");
+
+    report("copy byte", run_byte_copy);
+    k_string_set_sse2(0);
+    report("copy rep", run_copy);
+    if (has_sse2) {
+        k_string_set_sse2(1);
+        report("copy sse2", run_copy);
+    }
+
+    report("fill byte", run_byte_fill);
+    report("fill rep", run_fill);
+
+    report("move overlap", run_move);
+    report("compare", run_compare);
+    report("scan", run_scan);
+    return 0;
+}